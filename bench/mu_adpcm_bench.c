@@ -0,0 +1,183 @@
+// @language: c11
+//
+// microbenchmark of compressed voices (xxxx_mu_adpcm.h): memory saved
+// and the noise added by the compression, the decoding cost for each
+// instruction set, and the cost of a voice in `Mu_Mix` when it is
+// decoded on the fly rather than read from int16 samples.
+//
+// Every instruction set is checked to decode the same samples, from
+// any frame.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_adpcm.h"
+#include "../xxxx_mu_mixer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_RATE = 48000,
+     MU_BENCH_BLOCK_FRAMES = 256,
+     MU_BENCH_VOICES_N = 64,
+     MU_BENCH_SOURCE_FRAMES = 5 * 48000,
+     MU_BENCH_REPEATS_N = 8,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// decaying partials and a little noise, like a sampled instrument
+MU_BENCH_INTERNAL
+struct Mu_AudioBuffer mu_bench_source(int channels)
+{
+     size_t const samples_n = (size_t)MU_BENCH_SOURCE_FRAMES * channels;
+     struct Mu_AudioBuffer source = {
+          .samples_count = samples_n,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = channels,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+     };
+     source.samples = malloc(samples_n * sizeof (int16_t));
+     uint32_t noise = 1;
+     for (size_t frame_i = 0; frame_i < MU_BENCH_SOURCE_FRAMES; ++frame_i) {
+          float const t = (float)frame_i / MU_BENCH_RATE;
+          for (int channel_i = 0; channel_i < channels; ++channel_i) {
+               float y = 0.0f;
+               for (int partial_i = 1; partial_i <= 6; ++partial_i) {
+                    y += sinf(2.0f * 3.14159265f * 220.0f * partial_i * (1.0f + 0.001f * channel_i) * t) * expf(-partial_i * t) / partial_i;
+               }
+               noise = noise * 1664525u + 1013904223u;
+               y += 0.002f * ((int32_t)noise / 2147483648.0f);
+               source.samples[frame_i * channels + channel_i] = (int16_t)(0.4f * 32767.0f * y);
+          }
+     }
+     return source;
+}
+
+MU_BENCH_INTERNAL
+double mu_bench_snr_db(struct Mu_AudioBuffer const *source, int16_t const *decoded)
+{
+     double signal = 0.0, noise = 0.0;
+     for (size_t sample_i = 0; sample_i < source->samples_count; ++sample_i) {
+          double const x = source->samples[sample_i], e = x - decoded[sample_i];
+          signal += x * x;
+          noise += e * e;
+     }
+     return 10.0 * log10(signal / (noise > 0.0? noise : 1.0));
+}
+
+// @return: nanoseconds per voice and block of MU_BENCH_BLOCK_FRAMES
+MU_BENCH_INTERNAL
+double mu_bench_mix(int isa, struct Mu_AudioBuffer const *source, struct Mu_AdpcmAudio const *adpcm)
+{
+     static struct Mu_MixerVoice voices[MU_BENCH_VOICES_N];
+     for (int voice_i = 0; voice_i < MU_BENCH_VOICES_N; ++voice_i) {
+          voices[voice_i] = (struct Mu_MixerVoice){
+               .source = source,
+               .adpcm = adpcm,
+               .gain = 1.0f / MU_BENCH_VOICES_N,
+               // cursors within blocks, as they are for voices started at any frame
+               .source_frame_i = (size_t)voice_i * 4099 % (MU_BENCH_SOURCE_FRAMES / 2),
+          };
+     }
+     static int16_t samples[MU_BENCH_BLOCK_FRAMES * 2];
+     struct Mu_AudioBuffer dest = {
+          .samples = samples,
+          .samples_count = MU_BENCH_BLOCK_FRAMES * 2,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = 2,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+     };
+     int const blocks_n = MU_BENCH_SOURCE_FRAMES / 2 / MU_BENCH_BLOCK_FRAMES;
+     uint64_t const t0 = mu_bench_nanoseconds();
+     for (int block_i = 0; block_i < blocks_n; ++block_i) {
+          memset(samples, 0, sizeof samples);
+          Mu_MixWithISA(isa, &dest, voices, MU_BENCH_VOICES_N);
+     }
+     uint64_t const t1 = mu_bench_nanoseconds();
+     return (double)(t1 - t0) / blocks_n / MU_BENCH_VOICES_N;
+}
+
+int main(void)
+{
+     static char const * const isa_names[] = { "auto", "scalar", "sse2", "avx2" };
+     int const isas[] = { MU_MIXER_ISA_SCALAR, MU_MIXER_ISA_SSE2, MU_MIXER_ISA_AVX2 };
+     int const isas_n = (int)(sizeof isas / sizeof isas[0]);
+
+     printf("%-8s %12s %12s %8s %10s\n", "channels", "int16 KB", "adpcm KB", "saved", "snr");
+     for (int channels = 1; channels <= 2; ++channels) {
+          struct Mu_AudioBuffer const source = mu_bench_source(channels);
+          struct Mu_AdpcmAudio adpcm;
+          if (!Mu_EncodeAdpcm(&source, &adpcm)) {
+               printf("ERROR: could not encode\n");
+               return 1;
+          }
+          size_t const source_bytes_n = source.samples_count * sizeof (int16_t);
+          int16_t *reference = malloc(source_bytes_n);
+          int16_t *decoded = malloc(source_bytes_n);
+          Mu_DecodeAdpcmWithISA(MU_MIXER_ISA_SCALAR, &adpcm, 0, reference, adpcm.frames_n);
+          printf("%-8d %12.1f %12.1f %7.1f%% %8.1fdB\n", channels, source_bytes_n / 1024.0, adpcm.bytes_n / 1024.0,
+                 100.0 * (1.0 - (double)adpcm.bytes_n / source_bytes_n), mu_bench_snr_db(&source, reference));
+
+          for (int isa_i = 0; isa_i < isas_n; ++isa_i) {
+               int const isa = isas[isa_i];
+               if (!Mu_DecodeAdpcmWithISA(isa, &adpcm, 0, decoded, 1)) continue;
+               // random access: spans of any length, from any frame
+               uint32_t random = 12345;
+               for (int span_i = 0; span_i < 1000; ++span_i) {
+                    random = random * 1664525u + 1013904223u;
+                    size_t const frame_i = (random >> 8) % adpcm.frames_n;
+                    size_t const frames_n = 1 + (random & 511);
+                    size_t const decoded_n = Mu_DecodeAdpcmWithISA(isa, &adpcm, frame_i, decoded, frames_n);
+                    if (memcmp(decoded, reference + frame_i * channels, decoded_n * channels * sizeof (int16_t)) != 0) {
+                         printf("ERROR: %s decodes differently from scalar at frame %zu\n", isa_names[isa], frame_i);
+                         return 1;
+                    }
+               }
+          }
+
+          printf("  %-8s %14s %14s\n", "isa", "decode ns/fr", "Mframes/s");
+          for (int isa_i = 0; isa_i < isas_n; ++isa_i) {
+               int const isa = isas[isa_i];
+               if (!Mu_DecodeAdpcmWithISA(isa, &adpcm, 0, decoded, 1)) continue;
+               uint64_t const t0 = mu_bench_nanoseconds();
+               for (int repeat_i = 0; repeat_i < MU_BENCH_REPEATS_N; ++repeat_i) {
+                    for (size_t frame_i = 0; frame_i < adpcm.frames_n; frame_i += MU_BENCH_BLOCK_FRAMES) {
+                         Mu_DecodeAdpcmWithISA(isa, &adpcm, frame_i, decoded + frame_i * channels, MU_BENCH_BLOCK_FRAMES);
+                    }
+               }
+               double const ns = (double)(mu_bench_nanoseconds() - t0) / MU_BENCH_REPEATS_N / adpcm.frames_n;
+               printf("  %-8s %14.2f %14.1f\n", isa_names[isa], ns, 1e3 / ns);
+          }
+
+          printf("  %-8s %14s %14s %14s\n", "isa", "int16 ns/voice", "adpcm ns/voice", "decode share");
+          for (int isa_i = 0; isa_i < isas_n; ++isa_i) {
+               int const isa = isas[isa_i];
+               if (!Mu_DecodeAdpcmWithISA(isa, &adpcm, 0, decoded, 1)) continue;
+               double const int16_ns = mu_bench_mix(isa, &source, NULL);
+               double const adpcm_ns = mu_bench_mix(isa, &source, &adpcm);
+               printf("  %-8s %14.1f %14.1f %13.0f%%\n", isa_names[isa], int16_ns, adpcm_ns, 100.0 * (adpcm_ns - int16_ns) / adpcm_ns);
+          }
+          free(decoded);
+          free(reference);
+          Mu_FreeAdpcm(&adpcm);
+          free(source.samples);
+     }
+     return 0;
+}
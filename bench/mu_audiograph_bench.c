@@ -0,0 +1,148 @@
+// @language: c11
+//
+// microbenchmark of the audio graph: voices spread over 8 submix buses
+// of a master with a limiter, rendered into 512 frame int16 stereo
+// blocks, on the audio thread alone then with the helpers. Reports
+// the cost of a block against its real-time budget. Both renders are
+// checked to give the same samples.
+//
+// usage: mu_audiograph_bench [--threads <n>]  (default: one per core)
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_audiograph.h"
+#include "../xxxx_mu_mixer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_RATE = 48000,
+     MU_BENCH_BLOCK_FRAMES = 512,
+     MU_BENCH_BLOCKS_N = 400,
+     MU_BENCH_SOURCE_FRAMES = 48000,
+     MU_BENCH_SUBMIXES_N = 8,
+     MU_BENCH_MAX_VOICES = 1024,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// @return: nanoseconds per block, the last block in `last_block`
+MU_BENCH_INTERNAL
+double mu_bench_render(struct Mu_AudioGraph *graph, struct Mu_AudioBuffer const *source, int voices_n, int16_t *last_block)
+{
+     static struct Mu_MixerVoice voices[MU_BENCH_MAX_VOICES];
+     for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+          voices[voice_i] = (struct Mu_MixerVoice){
+               .source = source,
+               .gain = 0.05f,
+               .source_frame_i = (size_t)MU_BENCH_SOURCE_FRAMES * voice_i / voices_n,
+          };
+     }
+     // voices of a bus are contiguous
+     for (int bus_i = 1; bus_i <= MU_BENCH_SUBMIXES_N; ++bus_i) {
+          int const first = voices_n * (bus_i - 1) / MU_BENCH_SUBMIXES_N, last = voices_n * bus_i / MU_BENCH_SUBMIXES_N;
+          graph->buses[bus_i].voices = voices + first;
+          graph->buses[bus_i].voices_n = last - first;
+     }
+     static int16_t samples[MU_BENCH_BLOCK_FRAMES * 2];
+     struct Mu_AudioBuffer block = {
+          .samples = samples,
+          .samples_count = MU_BENCH_BLOCK_FRAMES * 2,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = 2,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+     };
+     uint64_t const t0 = mu_bench_nanoseconds();
+     for (int block_i = 0; block_i < MU_BENCH_BLOCKS_N; ++block_i) {
+          for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+               if (voices[voice_i].source_frame_i >= MU_BENCH_SOURCE_FRAMES) voices[voice_i].source_frame_i = 0;
+          }
+          Mu_AudioGraphRender(graph, &block);
+     }
+     uint64_t const t1 = mu_bench_nanoseconds();
+     memcpy(last_block, samples, sizeof samples);
+     return (double)(t1 - t0) / MU_BENCH_BLOCKS_N;
+}
+
+MU_BENCH_INTERNAL
+Mu_Bool mu_bench_graph(struct Mu_AudioGraph *graph, int threads_n)
+{
+     *graph = (struct Mu_AudioGraph){
+          .buses_n = 1 + MU_BENCH_SUBMIXES_N,
+          .frames_capacity = MU_BENCH_BLOCK_FRAMES,
+          .threads_n = threads_n,
+          .parallel_min_voices = 1,
+     };
+     graph->buses[MU_AUDIOGRAPH_MASTER] = (struct Mu_AudioGraphBus){ .gain = 1.0f, .limiter_threshold = 0.9f };
+     for (int bus_i = 1; bus_i <= MU_BENCH_SUBMIXES_N; ++bus_i) {
+          graph->buses[bus_i] = (struct Mu_AudioGraphBus){ .parent = MU_AUDIOGRAPH_MASTER, .gain = 0.5f };
+     }
+     return Mu_AudioGraphInitialize(graph);
+}
+
+int main(int argc, char **argv)
+{
+     int threads_n = 0;
+     for (int arg_i = 1; arg_i < argc; ++arg_i) {
+          if (0 == strcmp(argv[arg_i], "--threads") && arg_i + 1 < argc) {
+               threads_n = atoi(argv[++arg_i]);
+          } else {
+               printf("usage: %s [--threads <n>]\n", argv[0]);
+               return 1;
+          }
+     }
+     static int16_t source_samples[MU_BENCH_SOURCE_FRAMES * 2];
+     for (int frame_i = 0; frame_i < MU_BENCH_SOURCE_FRAMES; ++frame_i) {
+          float const x = sinf(2.0f * 3.14159265f * 440.0f * frame_i / MU_BENCH_RATE) * expf(-3.0f * frame_i / MU_BENCH_RATE);
+          source_samples[2 * frame_i + 0] = (int16_t)(32767.0f * x);
+          source_samples[2 * frame_i + 1] = (int16_t)(-32767.0f * x);
+     }
+     struct Mu_AudioBuffer const source = {
+          .samples = source_samples,
+          .samples_count = MU_BENCH_SOURCE_FRAMES * 2,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = 2,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+     };
+     static struct Mu_AudioGraph serial, parallel;
+     if (!mu_bench_graph(&serial, 1) || !mu_bench_graph(&parallel, threads_n)) {
+          printf("ERROR: could not initialize the graphs\n");
+          return 1;
+     }
+     double const budget_ns = 1e9 * MU_BENCH_BLOCK_FRAMES / MU_BENCH_RATE;
+     printf("%-10s %8s %8s %14s %10s\n", "render", "voices", "threads", "us/block", "load");
+     static int const voices_counts[] = { 32, 128, 512, 1024 };
+     for (int count_i = 0; count_i < (int)(sizeof voices_counts / sizeof voices_counts[0]); ++count_i) {
+          int const voices_n = voices_counts[count_i];
+          static int16_t serial_block[MU_BENCH_BLOCK_FRAMES * 2], parallel_block[MU_BENCH_BLOCK_FRAMES * 2];
+          double const serial_ns = mu_bench_render(&serial, &source, voices_n, serial_block);
+          double const parallel_ns = mu_bench_render(&parallel, &source, voices_n, parallel_block);
+          if (memcmp(serial_block, parallel_block, sizeof serial_block) != 0) {
+               printf("ERROR: parallel render differs from serial render at %d voices\n", voices_n);
+               return 1;
+          }
+          printf("%-10s %8d %8d %14.1f %9.1f%%\n", "serial", voices_n, serial.threads_n, serial_ns / 1e3, 100.0 * serial_ns / budget_ns);
+          printf("%-10s %8d %8d %14.1f %9.1f%%\n", "parallel", voices_n, parallel.threads_n, parallel_ns / 1e3, 100.0 * parallel_ns / budget_ns);
+     }
+     printf("helpers real-time: %s\n", parallel.realtime? "yes" : "no");
+     Mu_AudioGraphClose(&serial);
+     Mu_AudioGraphClose(&parallel);
+     return 0;
+}
@@ -0,0 +1,121 @@
+// @language: c11
+//
+// microbenchmark of the fiber context switch behind the coroutine run
+// mode of the macos backend, against swapcontext: the main fiber and a
+// fiber on a 512KB stack switch back and forth, like Mu_Pull does twice
+// per frame. Reports the cost of one switch. The fiber checks on every
+// round trip that it finds its state as it left it.
+
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // ucontext
+#endif
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_fiber.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_ROUND_TRIPS_N = 2 * 1000 * 1000,
+     MU_BENCH_STACK_SIZE = 512 * 1024,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+struct Mu_Bench_Fibers
+{
+     struct Mu_Fiber main_fiber;
+     struct Mu_Fiber fiber;
+     ucontext_t main_context;
+     ucontext_t context;
+     uint64_t round_trips_n;
+     Mu_Bool failed;
+};
+
+// makecontext passes int arguments only
+MU_BENCH_INTERNAL struct Mu_Bench_Fibers mu_bench_fibers;
+
+MU_BENCH_INTERNAL
+void mu_bench_fiber(void *data)
+{
+     struct Mu_Bench_Fibers *fibers = data;
+     // lives across switches in callee-saved registers or on this stack
+     uint64_t round_trip_i = 0;
+     double x = 1.0;
+     for (;;) {
+          Mu_SwitchFiber(&fibers->fiber, &fibers->main_fiber);
+          ++round_trip_i;
+          x *= 1.5;
+          if (round_trip_i != fibers->round_trips_n || x != x) fibers->failed = MU_TRUE;
+          if (x > 1e300) x = 1.0;
+     }
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_context(void)
+{
+     struct Mu_Bench_Fibers *fibers = &mu_bench_fibers;
+     uint64_t round_trip_i = 0;
+     for (;;) {
+          swapcontext(&fibers->context, &fibers->main_context);
+          ++round_trip_i;
+          if (round_trip_i != fibers->round_trips_n) fibers->failed = MU_TRUE;
+     }
+}
+
+int main(void)
+{
+     struct Mu_Bench_Fibers *fibers = &mu_bench_fibers;
+     printf("%-14s %14s %12s\n", "switch", "round trips", "ns/switch");
+
+     if (!Mu_InitializeFiber(&fibers->fiber, MU_BENCH_STACK_SIZE, mu_bench_fiber, fibers)) {
+          printf("ERROR: could not create fiber\n");
+          return 1;
+     }
+     Mu_SwitchFiber(&fibers->main_fiber, &fibers->fiber); // to its first switch
+     uint64_t t0 = mu_bench_nanoseconds();
+     for (int round_trip_i = 0; round_trip_i < MU_BENCH_ROUND_TRIPS_N; ++round_trip_i) {
+          ++fibers->round_trips_n;
+          Mu_SwitchFiber(&fibers->main_fiber, &fibers->fiber);
+     }
+     uint64_t t1 = mu_bench_nanoseconds();
+     Mu_FreeFiber(&fibers->fiber);
+     if (fibers->failed) {
+          printf("ERROR: fiber state lost across switches\n");
+          return 1;
+     }
+     printf("%-14s %14d %12.1f\n", "Mu_SwitchFiber", MU_BENCH_ROUND_TRIPS_N, (t1 - t0) / (2.0 * MU_BENCH_ROUND_TRIPS_N));
+
+     void *stack = malloc(MU_BENCH_STACK_SIZE);
+     if (!stack || getcontext(&fibers->context) != 0) return 1;
+     fibers->context.uc_stack.ss_sp = stack;
+     fibers->context.uc_stack.ss_size = MU_BENCH_STACK_SIZE;
+     fibers->context.uc_link = NULL;
+     makecontext(&fibers->context, mu_bench_context, 0);
+     fibers->round_trips_n = 0;
+     swapcontext(&fibers->main_context, &fibers->context);
+     t0 = mu_bench_nanoseconds();
+     for (int round_trip_i = 0; round_trip_i < MU_BENCH_ROUND_TRIPS_N; ++round_trip_i) {
+          ++fibers->round_trips_n;
+          swapcontext(&fibers->main_context, &fibers->context);
+     }
+     t1 = mu_bench_nanoseconds();
+     free(stack);
+     if (fibers->failed) {
+          printf("ERROR: context state lost across switches\n");
+          return 1;
+     }
+     printf("%-14s %14d %12.1f\n", "swapcontext", MU_BENCH_ROUND_TRIPS_N, (t1 - t0) / (2.0 * MU_BENCH_ROUND_TRIPS_N));
+     return 0;
+}
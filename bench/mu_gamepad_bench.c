@@ -0,0 +1,166 @@
+// @language: c11
+//
+// microbenchmark of gamepad decoding: a stream of evdev values (mapped
+// and unmapped, as devices also send elements nobody binds) decoded
+// through the compiled dispatch table, against comparing every value
+// with every member of the mapping, as done before the tables; and
+// whole DUALSHOCK 4 reports.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_gamepad.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_VALUES_N = 4096,
+     MU_BENCH_ROUNDS_N = 2048,
+     MU_BENCH_REFERENCE_ADDRESSES_N = 22, // 14 buttons, 2 triggers, 2 sticks of 2 axes
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_BENCH_INTERNAL
+uint32_t mu_bench_random(uint32_t *state)
+{
+     *state = *state * 1664525u + 1013904223u;
+     return *state >> 8;
+}
+
+struct Mu_Bench_Value
+{
+     uint16_t usage_page;
+     uint16_t usage;
+     int32_t value;
+};
+
+// Reference: compare-all
+
+struct Mu_Bench_Reference
+{
+     struct Mu_HIDAddress addresses[MU_BENCH_REFERENCE_ADDRESSES_N];
+     float min[MU_BENCH_REFERENCE_ADDRESSES_N];
+     float range[MU_BENCH_REFERENCE_ADDRESSES_N];
+     float values[MU_BENCH_REFERENCE_ADDRESSES_N];
+};
+
+MU_BENCH_INTERNAL
+void mu_bench_reference_initialize(struct Mu_Bench_Reference *reference, struct Mu_Gamepad_HID_Mapping const *mapping)
+{
+     struct Mu_Gamepad_HID_Mapping_DigitalButton const *buttons[] = {
+          &mapping->a_button, &mapping->b_button, &mapping->x_button, &mapping->y_button,
+          &mapping->left_shoulder_button, &mapping->right_shoulder_button,
+          &mapping->up_button, &mapping->down_button, &mapping->left_button, &mapping->right_button,
+          &mapping->left_thumb_button, &mapping->right_thumb_button, &mapping->back_button, &mapping->start_button,
+     };
+     int address_i = 0;
+     for (int button_i = 0; button_i < (int)(sizeof buttons / sizeof *buttons); ++button_i, ++address_i) {
+          reference->addresses[address_i] = buttons[button_i]->address;
+          reference->min[address_i] = 0.0f;
+          reference->range[address_i] = 1.0f;
+     }
+     struct Mu_Gamepad_HID_Mapping_AnalogButton const *triggers[] = { &mapping->left_trigger, &mapping->right_trigger };
+     for (int trigger_i = 0; trigger_i < 2; ++trigger_i, ++address_i) {
+          reference->addresses[address_i] = triggers[trigger_i]->address;
+          reference->min[address_i] = triggers[trigger_i]->xmin;
+          reference->range[address_i] = triggers[trigger_i]->xmax - triggers[trigger_i]->xmin;
+     }
+     struct Mu_Gamepad_HID_Mapping_Stick const *sticks[] = { &mapping->left_thumb_stick, &mapping->right_thumb_stick };
+     for (int stick_i = 0; stick_i < 2; ++stick_i, address_i += 2) {
+          reference->addresses[address_i] = sticks[stick_i]->x_address;
+          reference->min[address_i] = sticks[stick_i]->xmin;
+          reference->range[address_i] = sticks[stick_i]->xmax - sticks[stick_i]->xmin;
+          reference->addresses[address_i + 1] = sticks[stick_i]->y_address;
+          reference->min[address_i + 1] = sticks[stick_i]->ymin;
+          reference->range[address_i + 1] = sticks[stick_i]->ymax - sticks[stick_i]->ymin;
+     }
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_reference_decode(struct Mu_Bench_Reference *reference, struct Mu_Bench_Value const *value)
+{
+     for (int address_i = 0; address_i < MU_BENCH_REFERENCE_ADDRESSES_N; ++address_i) {
+          if (reference->addresses[address_i].usage_page == value->usage_page && reference->addresses[address_i].usage == value->usage) {
+               reference->values[address_i] = ((float)value->value - reference->min[address_i]) / reference->range[address_i];
+          }
+     }
+}
+
+int main(void)
+{
+     int32_t abs_min[MU_EVDEV_ABS_N], abs_max[MU_EVDEV_ABS_N];
+     for (int code = 0; code < MU_EVDEV_ABS_N; ++code) abs_min[code] = -32768, abs_max[code] = 32767;
+     struct Mu_Gamepad_HID_Mapping mapping;
+     Mu_MakeEvdevGamepadMapping(&mapping, abs_min, abs_max);
+
+     // a third keys, a third axes, a third elements without a binding
+     static struct Mu_Bench_Value values[MU_BENCH_VALUES_N];
+     static uint16_t const keys[] = { 0x130, 0x131, 0x133, 0x134, 0x136, 0x137, 0x13a, 0x13b, 0x13d, 0x13e };
+     static uint16_t const axes[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x10, 0x11 };
+     uint32_t random_state = 1;
+     for (int value_i = 0; value_i < MU_BENCH_VALUES_N; ++value_i) {
+          uint32_t const r = mu_bench_random(&random_state);
+          switch (value_i % 3) {
+          case 0: values[value_i] = (struct Mu_Bench_Value){ MU_HID_PAGE_EVDEV_KEY, keys[r % 10], (int32_t)(r >> 8) & 1 }; break;
+          case 1: values[value_i] = (struct Mu_Bench_Value){ MU_HID_PAGE_EVDEV_ABS, axes[r % 8], (int32_t)(r & 0xffff) - 32768 }; break;
+          case 2: values[value_i] = (struct Mu_Bench_Value){ MU_HID_PAGE_EVDEV_ABS, 0x28 + r % 8, (int32_t)(r & 0xff) }; break;
+          }
+     }
+
+     printf("%-24s %14s %14s\n", "decoder", "ns/value", "Mvalues/s");
+
+     struct Mu_GamepadSlot slot = { .events.enabled = MU_TRUE };
+     if (!Mu_CompileGamepadMapping(&mapping, &slot.dispatch)) return 1;
+     uint64_t const t0 = mu_bench_nanoseconds();
+     for (int round_i = 0; round_i < MU_BENCH_ROUNDS_N; ++round_i) {
+          for (int value_i = 0; value_i < MU_BENCH_VALUES_N; ++value_i) {
+               Mu_DecodeGamepadValue(&slot, values[value_i].usage_page, values[value_i].usage, values[value_i].value, value_i);
+          }
+          // as Mu_Pull would, once per frame
+          Mu_PublishGamepad(&slot, &(struct Mu_Gamepad){ 0 }, NULL);
+     }
+     uint64_t const t1 = mu_bench_nanoseconds();
+     uint64_t const decoded_n = (uint64_t)MU_BENCH_ROUNDS_N * MU_BENCH_VALUES_N;
+     printf("%-24s %14.2f %14.1f\n", "dispatch table", (double)(t1 - t0) / decoded_n, decoded_n / ((t1 - t0) / 1e3));
+
+     static struct Mu_Bench_Reference reference;
+     mu_bench_reference_initialize(&reference, &mapping);
+     uint64_t const t2 = mu_bench_nanoseconds();
+     for (int round_i = 0; round_i < MU_BENCH_ROUNDS_N; ++round_i) {
+          for (int value_i = 0; value_i < MU_BENCH_VALUES_N; ++value_i) {
+               mu_bench_reference_decode(&reference, &values[value_i]);
+          }
+          __asm__ volatile("" : : "r"(reference.values) : "memory");
+     }
+     uint64_t const t3 = mu_bench_nanoseconds();
+     printf("%-24s %14.2f %14.1f\n", "compare all (reference)", (double)(t3 - t2) / decoded_n, decoded_n / ((t3 - t2) / 1e3));
+
+     // DUALSHOCK 4: sticks drifting, a button toggling every 16 reports
+     static uint8_t reports[256][64];
+     for (int report_i = 0; report_i < 256; ++report_i) {
+          uint8_t *report = reports[report_i];
+          report[0] = 0x01;
+          for (int axis_i = 1; axis_i <= 4; ++axis_i) report[axis_i] = (uint8_t)(report_i + 32 * axis_i);
+          report[5] = (uint8_t)(0x08 | ((report_i / 16) & 1) << 5);
+          report[8] = report[9] = (uint8_t)report_i;
+     }
+     uint64_t const t4 = mu_bench_nanoseconds();
+     for (int round_i = 0; round_i < MU_BENCH_ROUNDS_N * 4; ++round_i) {
+          for (int report_i = 0; report_i < 256; ++report_i) {
+               Mu_DecodeDS4Report(&slot, reports[report_i], sizeof reports[report_i], report_i);
+          }
+          Mu_PublishGamepad(&slot, &(struct Mu_Gamepad){ 0 }, NULL);
+     }
+     uint64_t const t5 = mu_bench_nanoseconds();
+     uint64_t const reports_n = (uint64_t)MU_BENCH_ROUNDS_N * 4 * 256;
+     printf("%-24s %14.2f %14.1f (reports)\n", "ds4 report", (double)(t5 - t4) / reports_n, reports_n / ((t5 - t4) / 1e3));
+     return 0;
+}
@@ -0,0 +1,89 @@
+// @language: c11
+//
+// microbenchmark of the PNG decoder:
+// - decode: megapixels per second, from memory, of each file given on
+//   the command line (test_assets/ln2.png by default)
+// - batch: `Mu_LoadImages` of many copies of those files, into an arena
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_BATCH_IMAGES = 256,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+     static char const * const default_filenames[] = { "test_assets/ln2.png" };
+     char const * const *filenames = argc > 1? (char const * const *)argv + 1 : default_filenames;
+     int const filenames_n = argc > 1? argc - 1 : 1;
+
+     printf("%-32s %10s %14s\n", "decode", "pixels", "Mpixels/s");
+     size_t batch_bytes_n = 0;
+     for (int file_i = 0; file_i < filenames_n; ++file_i) {
+          FILE *file = fopen(filenames[file_i], "rb");
+          if (!file) {
+               printf("ERROR: could not open %s\n", filenames[file_i]);
+               return 1;
+          }
+          fseek(file, 0, SEEK_END);
+          long const bytes_n = ftell(file);
+          fseek(file, 0, SEEK_SET);
+          uint8_t *bytes = malloc(bytes_n);
+          if (bytes_n <= 0 || fread(bytes, bytes_n, 1, file) != 1) {
+               free(bytes);
+               bytes = NULL;
+          }
+          fclose(file);
+          struct Mu_Image image = { 0 };
+          if (!bytes || !Mu_DecodePNG(bytes, bytes_n, &image)) {
+               printf("ERROR: could not decode %s\n", filenames[file_i]);
+               return 1;
+          }
+          uint64_t pixels_n = 0;
+          uint64_t const t0 = mu_bench_nanoseconds();
+          uint64_t t1 = t0;
+          while (t1 - t0 < 200*1000*1000) {
+               for (int iteration = 0; iteration < 16; ++iteration) {
+                    Mu_DecodePNG(bytes, bytes_n, &image);
+                    pixels_n += (uint64_t)image.width * image.height;
+               }
+               t1 = mu_bench_nanoseconds();
+          }
+          printf("%-32s %10d %14.1f\n", filenames[file_i], image.width * image.height, pixels_n / ((t1 - t0) / 1e3));
+          batch_bytes_n += ((size_t)image.width * image.height * 4 + 15) & ~(size_t)15;
+          free(image.pixels);
+          free(bytes);
+     }
+
+     printf("%-32s %10s %14s\n", "batch", "images", "images/s");
+     char const *batch_filenames[MU_BENCH_BATCH_IMAGES];
+     static struct Mu_Image images[MU_BENCH_BATCH_IMAGES];
+     for (int image_i = 0; image_i < MU_BENCH_BATCH_IMAGES; ++image_i) batch_filenames[image_i] = filenames[image_i % filenames_n];
+     size_t const arena_capacity = batch_bytes_n * (MU_BENCH_BATCH_IMAGES / filenames_n + 1);
+     struct Mu_ImageArena arena = { .bytes = malloc(arena_capacity), .bytes_capacity = arena_capacity };
+     uint64_t const t0 = mu_bench_nanoseconds();
+     int const loaded_n = Mu_LoadImages(batch_filenames, MU_BENCH_BATCH_IMAGES, images, &arena, NULL);
+     uint64_t const t1 = mu_bench_nanoseconds();
+     if (loaded_n != MU_BENCH_BATCH_IMAGES) {
+          printf("ERROR: loaded %d images out of %d\n", loaded_n, MU_BENCH_BATCH_IMAGES);
+          return 1;
+     }
+     printf("%-32s %10d %14.0f\n", "Mu_LoadImages", loaded_n, loaded_n / ((t1 - t0) / 1e9));
+     free(arena.bytes);
+     return 0;
+}
@@ -0,0 +1,199 @@
+// @language: c11
+//
+// microbenchmark of the image preparation module, on synthetic images:
+// - convert: megapixels per second of premultiplication and of the
+//   conversions to and from linear light, for each instruction set. The
+//   outputs of each instruction set are checked against the scalar ones
+// - mips: full mip chain of a 1024x1024 image, for each filter
+// - atlas: many small sprites packed into 1024x1024 pages, with their
+//   occupancy, on the calling thread then as jobs
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_imageprep.h"
+#include "../xxxx_mu_jobs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_IMAGE_SIZE = 1024,
+     MU_BENCH_SPRITES_N = 4000,
+     MU_BENCH_SPRITE_MIN_SIZE = 8,
+     MU_BENCH_SPRITE_MAX_SIZE = 64,
+     MU_BENCH_PAGE_SIZE = 1024,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_BENCH_INTERNAL
+uint32_t mu_bench_random(uint32_t *state)
+{
+     // xorshift32
+     uint32_t x = *state;
+     x ^= x << 13;
+     x ^= x >> 17;
+     x ^= x << 5;
+     return *state = x;
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_fill(struct Mu_Image *image, uint32_t seed)
+{
+     for (size_t i = 0; i < (size_t)image->width * image->height * 4; ++i) image->pixels[i] = (uint8_t)mu_bench_random(&seed);
+}
+
+int main(void)
+{
+     static char const * const isa_names[] = { "auto", "scalar", "sse2", "avx2" };
+     size_t const pixels_n = (size_t)MU_BENCH_IMAGE_SIZE * MU_BENCH_IMAGE_SIZE;
+     struct Mu_Image source = { .width = MU_BENCH_IMAGE_SIZE, .height = MU_BENCH_IMAGE_SIZE, .channels = 4, .pixels = malloc(pixels_n * 4) };
+     struct Mu_Image image = source, expected = source;
+     image.pixels = malloc(pixels_n * 4);
+     expected.pixels = malloc(pixels_n * 4);
+     float *linear = malloc(pixels_n * 4 * sizeof *linear);
+     float *expected_linear = malloc(pixels_n * 4 * sizeof *expected_linear);
+     if (!source.pixels || !image.pixels || !expected.pixels || !linear || !expected_linear) return 1;
+     mu_bench_fill(&source, 1);
+
+     printf("%-8s %-26s %14s\n", "isa", "convert", "Mpixels/s");
+     for (int flags = 0; flags <= MU_IMAGEPREP_SRGB; flags += MU_IMAGEPREP_SRGB) {
+          for (int isa = MU_IMAGEPREP_ISA_SCALAR; isa <= MU_IMAGEPREP_ISA_AVX2; ++isa) {
+               char name[32];
+               // premultiply, in place: from a fresh copy each time
+               uint64_t t = 0;
+               int runs_n = 0;
+               for (; t < 200*1000*1000; ++runs_n) {
+                    memcpy(image.pixels, source.pixels, pixels_n * 4);
+                    uint64_t const t0 = mu_bench_nanoseconds();
+                    if (!Mu_PremultiplyImageWithISA(isa, &image, flags)) break;
+                    t += mu_bench_nanoseconds() - t0;
+               }
+               if (runs_n == 0) {
+                    printf("%-8s (not supported)\n", isa_names[isa]);
+                    continue;
+               }
+               if (isa == MU_IMAGEPREP_ISA_SCALAR) memcpy(expected.pixels, image.pixels, pixels_n * 4);
+               if (memcmp(expected.pixels, image.pixels, pixels_n * 4) != 0) {
+                    printf("ERROR: %s premultiply differs from scalar\n", isa_names[isa]);
+                    return 1;
+               }
+               snprintf(name, sizeof name, "premultiply%s", flags? " srgb" : "");
+               printf("%-8s %-26s %14.1f\n", isa_names[isa], name, runs_n * (double)pixels_n / (t / 1e3));
+
+               uint64_t const t0 = mu_bench_nanoseconds();
+               uint64_t t1 = t0;
+               for (runs_n = 0; t1 - t0 < 200*1000*1000; ++runs_n) {
+                    Mu_ImageToLinearWithISA(isa, &source, flags, linear);
+                    t1 = mu_bench_nanoseconds();
+               }
+               if (isa == MU_IMAGEPREP_ISA_SCALAR) memcpy(expected_linear, linear, pixels_n * 4 * sizeof *linear);
+               if (memcmp(expected_linear, linear, pixels_n * 4 * sizeof *linear) != 0) {
+                    printf("ERROR: %s to linear differs from scalar\n", isa_names[isa]);
+                    return 1;
+               }
+               snprintf(name, sizeof name, "to linear%s", flags? " srgb" : "");
+               printf("%-8s %-26s %14.1f\n", isa_names[isa], name, runs_n * (double)pixels_n / ((t1 - t0) / 1e3));
+
+               uint64_t const t2 = mu_bench_nanoseconds();
+               uint64_t t3 = t2;
+               for (runs_n = 0; t3 - t2 < 200*1000*1000; ++runs_n) {
+                    Mu_ImageFromLinearWithISA(isa, expected_linear, flags, &image);
+                    t3 = mu_bench_nanoseconds();
+               }
+               // every byte comes back the same after a round trip
+               if (memcmp(source.pixels, image.pixels, pixels_n * 4) != 0) {
+                    printf("ERROR: %s from linear does not round trip\n", isa_names[isa]);
+                    return 1;
+               }
+               snprintf(name, sizeof name, "from linear%s", flags? " srgb" : "");
+               printf("%-8s %-26s %14.1f\n", isa_names[isa], name, runs_n * (double)pixels_n / ((t3 - t2) / 1e3));
+          }
+     }
+
+     printf("%-8s %-26s %14s\n", "filter", "mips", "ms");
+     static char const * const filter_names[] = { "box", "kaiser" };
+     for (int filter = MU_IMAGEPREP_FILTER_BOX; filter <= MU_IMAGEPREP_FILTER_KAISER; ++filter) {
+          struct Mu_ImageMips mips;
+          int runs_n = 0;
+          uint64_t const t0 = mu_bench_nanoseconds();
+          uint64_t t1 = t0;
+          for (; t1 - t0 < 500*1000*1000; ++runs_n) {
+               if (!Mu_GenerateImageMips(&source, filter, MU_IMAGEPREP_SRGB, &mips)) {
+                    printf("ERROR: could not generate mips\n");
+                    return 1;
+               }
+               Mu_FreeImageMips(&mips);
+               t1 = mu_bench_nanoseconds();
+          }
+          printf("%-8s %-26s %14.2f\n", filter_names[filter], "1024x1024 srgb", (t1 - t0) / 1e6 / runs_n);
+     }
+
+     struct Mu_Image *sprites = calloc(MU_BENCH_SPRITES_N, sizeof *sprites);
+     struct Mu_AtlasPlacement *placements = calloc(MU_BENCH_SPRITES_N, sizeof *placements);
+     if (!sprites || !placements) return 1;
+     uint32_t seed = 7;
+     uint64_t sprites_texels_n = 0;
+     for (int sprite_i = 0; sprite_i < MU_BENCH_SPRITES_N; ++sprite_i) {
+          struct Mu_Image *sprite = &sprites[sprite_i];
+          uint32_t const sizes_n = MU_BENCH_SPRITE_MAX_SIZE - MU_BENCH_SPRITE_MIN_SIZE + 1;
+          sprite->width = MU_BENCH_SPRITE_MIN_SIZE + mu_bench_random(&seed) % sizes_n;
+          sprite->height = MU_BENCH_SPRITE_MIN_SIZE + mu_bench_random(&seed) % sizes_n;
+          sprite->channels = 4;
+          sprite->pixels = malloc((size_t)sprite->width * sprite->height * 4);
+          if (!sprite->pixels) return 1;
+          mu_bench_fill(sprite, sprite_i + 1);
+          sprites_texels_n += (uint64_t)sprite->width * sprite->height;
+     }
+     struct Mu_Jobs jobs = { 0 };
+     if (!Mu_JobsInitialize(&jobs)) {
+          printf("ERROR: could not start the jobs\n");
+          return 1;
+     }
+     printf("%-8s %-26s %8s %8s %10s %10s\n", "workers", "atlas", "sprites", "pages", "occupancy", "ms");
+     for (int pass = 0; pass < 2; ++pass) {
+          struct Mu_Atlas atlas = { .page_width = MU_BENCH_PAGE_SIZE, .page_height = MU_BENCH_PAGE_SIZE, .padding = 1 };
+          uint64_t const t0 = mu_bench_nanoseconds();
+          int const placed_n = Mu_PackAtlas(&atlas, sprites, MU_BENCH_SPRITES_N, placements, pass? &jobs : NULL);
+          uint64_t const t1 = mu_bench_nanoseconds();
+          if (placed_n != MU_BENCH_SPRITES_N) {
+               printf("ERROR: placed %d sprites out of %d\n", placed_n, MU_BENCH_SPRITES_N);
+               return 1;
+          }
+          // every sprite is where its placement says, and none overlap
+          for (int sprite_i = 0; sprite_i < MU_BENCH_SPRITES_N; ++sprite_i) {
+               struct Mu_Image const *sprite = &sprites[sprite_i];
+               struct Mu_Image const *page = &atlas.pages[placements[sprite_i].page];
+               for (uint32_t y = 0; y < sprite->height; ++y) {
+                    uint8_t const *row = page->pixels + ((size_t)(placements[sprite_i].y + y) * page->width + placements[sprite_i].x) * 4;
+                    if (memcmp(row, sprite->pixels + (size_t)y * sprite->width * 4, (size_t)sprite->width * 4) != 0) {
+                         printf("ERROR: sprite %d is not where it was placed\n", sprite_i);
+                         return 1;
+                    }
+               }
+          }
+          double const page_texels_n = (double)atlas.pages_n * MU_BENCH_PAGE_SIZE * MU_BENCH_PAGE_SIZE;
+          printf("%-8d %-26s %8d %8d %9.1f%% %10.2f\n", pass? jobs.workers_n : 1, "1024x1024 padding 1", placed_n,
+                 atlas.pages_n, 100.0 * sprites_texels_n / page_texels_n, (t1 - t0) / 1e6);
+          Mu_FreeAtlas(&atlas);
+     }
+     Mu_JobsClose(&jobs);
+     for (int sprite_i = 0; sprite_i < MU_BENCH_SPRITES_N; ++sprite_i) free(sprites[sprite_i].pixels);
+     free(sprites);
+     free(placements);
+     free(expected_linear);
+     free(linear);
+     free(expected.pixels);
+     free(image.pixels);
+     free(source.pixels);
+     return 0;
+}
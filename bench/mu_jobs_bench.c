@@ -0,0 +1,140 @@
+// @language: c11
+//
+// benchmark of the job system on a synthetic frame modelled on the loop
+// of mu_test_unit.c, drawn in software: clear to a color animated by
+// theta, a nearest-neighbour blit of the logo, the frame time bar, and
+// a little shading per pixel so that there is some work. The frame is
+// cut into bands of rows, one job each, with their data and counter
+// from the frame arena.
+//
+// Run with workers_n = 1 (everything on the calling thread), then one
+// worker per core.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_jobs.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_WIDTH = 1280,
+     MU_BENCH_HEIGHT = 720,
+     MU_BENCH_BAND_ROWS = 16,
+     MU_BENCH_LOGO_SIZE = 256,
+     MU_BENCH_FRAMES_N = 240,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+struct Mu_Bench_Frame
+{
+     uint32_t *pixels;
+     uint32_t const *logo;
+     float theta;
+     int bar_height;
+};
+
+struct Mu_Bench_Band
+{
+     struct Mu_Bench_Frame const *frame;
+     int y_begin, y_end;
+};
+
+MU_BENCH_INTERNAL
+void mu_bench_draw_band(void *data)
+{
+     struct Mu_Bench_Band const *band = data;
+     struct Mu_Bench_Frame const *frame = band->frame;
+     float const r = fabsf(sinf(frame->theta)), g = fabsf(sinf(3 * frame->theta));
+     for (int y = band->y_begin; y < band->y_end; ++y) {
+          uint32_t *row = frame->pixels + (size_t)y * MU_BENCH_WIDTH;
+          for (int x = 0; x < MU_BENCH_WIDTH; ++x) {
+               // vignette over the clear color
+               float const dx = (x - MU_BENCH_WIDTH / 2) * (1.0f / MU_BENCH_WIDTH);
+               float const dy = (y - MU_BENCH_HEIGHT / 2) * (1.0f / MU_BENCH_HEIGHT);
+               float const v = 1.0f - sqrtf(dx * dx + dy * dy);
+               uint32_t color = (uint32_t)(255 * r * v) | (uint32_t)(255 * g * v) << 8 | (uint32_t)(153 * v) << 16 | 0xff000000u;
+               // dropped frame indicator
+               if (x >= 10 && x < 110 && y >= 10 && y < 110) color = 0xff0000ffu;
+               // logo, scaled twice
+               int const lx = (x - 10) / 2, ly = (y - 120) / 2;
+               if (x >= 10 && y >= 120 && lx < MU_BENCH_LOGO_SIZE && ly < MU_BENCH_LOGO_SIZE) {
+                    color = frame->logo[ly * MU_BENCH_LOGO_SIZE + lx];
+               }
+               // frame time
+               int const bar_y = 120 + 2 * MU_BENCH_LOGO_SIZE + 10;
+               if (x >= 10 && x < 30 && y >= bar_y && y < bar_y + frame->bar_height) color = 0xff0000ffu;
+               row[x] = color;
+          }
+     }
+}
+
+MU_BENCH_INTERNAL
+double mu_bench_run(int workers_n, uint32_t *pixels, uint32_t const *logo, uint64_t *checksum)
+{
+     struct Mu_Jobs jobs = { .workers_n = workers_n };
+     if (!Mu_JobsInitialize(&jobs)) {
+          printf("ERROR: could not start %d workers\n", workers_n);
+          return 0.0;
+     }
+     int const bands_n = (MU_BENCH_HEIGHT + MU_BENCH_BAND_ROWS - 1) / MU_BENCH_BAND_ROWS;
+     uint64_t const t0 = mu_bench_nanoseconds();
+     for (int frame_i = 0; frame_i < MU_BENCH_FRAMES_N; ++frame_i) {
+          // as Mu_Pull would
+          Mu_JobsPull(&jobs);
+          struct Mu_Bench_Frame *frame = Mu_JobsFrameAlloc(&jobs, sizeof *frame);
+          struct Mu_Bench_Band *bands = Mu_JobsFrameAlloc(&jobs, bands_n * sizeof *bands);
+          struct Mu_Job *bands_jobs = Mu_JobsFrameAlloc(&jobs, bands_n * sizeof *bands_jobs);
+          struct Mu_JobCounter *counter = Mu_JobsCounter(&jobs);
+          if (!frame || !bands || !bands_jobs || !counter) return 0.0;
+          *frame = (struct Mu_Bench_Frame){ pixels, logo, frame_i * 0.01f, (frame_i * 7) % 160 };
+          for (int band_i = 0; band_i < bands_n; ++band_i) {
+               int const y_end = (band_i + 1) * MU_BENCH_BAND_ROWS;
+               bands[band_i] = (struct Mu_Bench_Band){ frame, band_i * MU_BENCH_BAND_ROWS, y_end < MU_BENCH_HEIGHT? y_end : MU_BENCH_HEIGHT };
+               bands_jobs[band_i] = (struct Mu_Job){ mu_bench_draw_band, &bands[band_i] };
+          }
+          Mu_JobsRun(&jobs, bands_jobs, bands_n, counter);
+          Mu_JobsWait(&jobs, counter);
+     }
+     uint64_t const t1 = mu_bench_nanoseconds();
+     Mu_JobsPull(&jobs);
+     printf("%-10d %14.3f %12llu %12llu %14zu\n", jobs.workers_n, (t1 - t0) / 1e6 / MU_BENCH_FRAMES_N,
+            (unsigned long long)jobs.jobs_n, (unsigned long long)jobs.steals_n, jobs.frame_arena_bytes_n);
+     Mu_JobsClose(&jobs);
+     *checksum = 0;
+     for (size_t pixel_i = 0; pixel_i < (size_t)MU_BENCH_WIDTH * MU_BENCH_HEIGHT; ++pixel_i) *checksum += pixels[pixel_i];
+     return (t1 - t0) / 1e6 / MU_BENCH_FRAMES_N;
+}
+
+int main(void)
+{
+     uint32_t *pixels = malloc((size_t)MU_BENCH_WIDTH * MU_BENCH_HEIGHT * sizeof *pixels);
+     uint32_t *logo = malloc((size_t)MU_BENCH_LOGO_SIZE * MU_BENCH_LOGO_SIZE * sizeof *logo);
+     if (!pixels || !logo) return 1;
+     for (int y = 0; y < MU_BENCH_LOGO_SIZE; ++y) {
+          for (int x = 0; x < MU_BENCH_LOGO_SIZE; ++x) logo[y * MU_BENCH_LOGO_SIZE + x] = 0xff000000u | (uint32_t)(x ^ y) * 0x010101u;
+     }
+
+     printf("%-10s %14s %12s %12s %14s\n", "workers", "ms/frame", "jobs", "steals", "arena bytes");
+     uint64_t serial_checksum, parallel_checksum;
+     double const serial_ms = mu_bench_run(1, pixels, logo, &serial_checksum);
+     double const parallel_ms = mu_bench_run(0, pixels, logo, &parallel_checksum);
+     if (serial_checksum != parallel_checksum) {
+          printf("ERROR: frames differ\n");
+          return 1;
+     }
+     if (parallel_ms > 0.0) printf("speed-up: %.2fx\n", serial_ms / parallel_ms);
+     free(pixels);
+     free(logo);
+     return 0;
+}
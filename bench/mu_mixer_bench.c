@@ -0,0 +1,108 @@
+// @language: c11
+//
+// microbenchmark of `Mu_Mix`: how many voices can be mixed in real
+// time on one core, for each instruction set and channel layout.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_mixer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_RATE = 48000,
+     MU_BENCH_BLOCK_FRAMES = 256,
+     MU_BENCH_VOICES_N = 64,
+     MU_BENCH_SOURCE_FRAMES = 48000,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_BENCH_INTERNAL
+struct Mu_AudioBuffer mu_bench_source(int channels, uint32_t sample_format)
+{
+     size_t const samples_n = (size_t)MU_BENCH_SOURCE_FRAMES * channels;
+     struct Mu_AudioBuffer source = {
+          .samples_count = samples_n,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = channels,
+               .bytes_per_sample = sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32? sizeof (float) : sizeof (int16_t),
+               .sample_format = sample_format,
+          },
+     };
+     source.samples = malloc(samples_n * source.format.bytes_per_sample);
+     for (size_t sample_i = 0; sample_i < samples_n; ++sample_i) {
+          float const y = sinf(sample_i * 0.01f);
+          if (sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) source.float_samples[sample_i] = y;
+          else source.samples[sample_i] = (int16_t)(32767.0f * y);
+     }
+     return source;
+}
+
+int main(int argc, char **argv)
+{
+     static char const * const isa_names[] = { "auto", "scalar", "sse2", "avx2" };
+     struct {
+          char const *name;
+          int s_channels, d_channels;
+          uint32_t s_format, d_format;
+     } const cases[] = {
+          { "mono->stereo i16", 1, 2, MU_AUDIO_SAMPLE_FORMAT_INT16, MU_AUDIO_SAMPLE_FORMAT_INT16 },
+          { "stereo->stereo i16", 2, 2, MU_AUDIO_SAMPLE_FORMAT_INT16, MU_AUDIO_SAMPLE_FORMAT_INT16 },
+          { "stereo->stereo f32", 2, 2, MU_AUDIO_SAMPLE_FORMAT_FLOAT32, MU_AUDIO_SAMPLE_FORMAT_FLOAT32 },
+          { "mono->stereo f32", 1, 2, MU_AUDIO_SAMPLE_FORMAT_FLOAT32, MU_AUDIO_SAMPLE_FORMAT_FLOAT32 },
+          { "6ch->stereo i16", 6, 2, MU_AUDIO_SAMPLE_FORMAT_INT16, MU_AUDIO_SAMPLE_FORMAT_INT16 },
+     };
+     printf("%-20s %-8s %14s\n", "case", "isa", "voices/ms");
+     for (size_t case_i = 0; case_i < sizeof cases / sizeof *cases; ++case_i) {
+          struct Mu_AudioBuffer source = mu_bench_source(cases[case_i].s_channels, cases[case_i].s_format);
+          float dest_storage[MU_BENCH_BLOCK_FRAMES * MU_MIXER_MAX_CHANNELS];
+          struct Mu_AudioBuffer dest = {
+               .float_samples = dest_storage,
+               .samples_count = MU_BENCH_BLOCK_FRAMES * cases[case_i].d_channels,
+               .format = {
+                    .samples_per_second = MU_BENCH_RATE,
+                    .channels = cases[case_i].d_channels,
+                    .bytes_per_sample = cases[case_i].d_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32? sizeof (float) : sizeof (int16_t),
+                    .sample_format = cases[case_i].d_format,
+               },
+          };
+          for (int isa = MU_MIXER_ISA_SCALAR; isa <= MU_MIXER_ISA_AVX2; ++isa) {
+               struct Mu_MixerVoice voices[MU_BENCH_VOICES_N];
+               for (int voice_i = 0; voice_i < MU_BENCH_VOICES_N; ++voice_i) {
+                    voices[voice_i] = (struct Mu_MixerVoice){ .source = &source, .gain = 1.0f / MU_BENCH_VOICES_N, .source_frame_i = voice_i * 97 };
+               }
+               memset(dest_storage, 0, sizeof dest_storage);
+               if (!Mu_MixWithISA(isa, &dest, voices, MU_BENCH_VOICES_N)) continue;
+               uint64_t blocks_n = 0;
+               uint64_t const t0 = mu_bench_nanoseconds();
+               uint64_t t1 = t0;
+               while (t1 - t0 < 200*1000*1000) {
+                    for (int iteration = 0; iteration < 64; ++iteration, ++blocks_n) {
+                         for (int voice_i = 0; voice_i < MU_BENCH_VOICES_N; ++voice_i) {
+                              if (voices[voice_i].source_frame_i + MU_BENCH_BLOCK_FRAMES >= MU_BENCH_SOURCE_FRAMES) voices[voice_i].source_frame_i = 0;
+                         }
+                         Mu_MixWithISA(isa, &dest, voices, MU_BENCH_VOICES_N);
+                    }
+                    t1 = mu_bench_nanoseconds();
+               }
+               // voices that one core could mix continuously in real time
+               double const audio_ms = 1000.0 * blocks_n * MU_BENCH_BLOCK_FRAMES / MU_BENCH_RATE;
+               double const cpu_ms = (t1 - t0) / 1e6;
+               printf("%-20s %-8s %14.0f\n", cases[case_i].name, isa_names[isa], MU_BENCH_VOICES_N * audio_ms / cpu_ms);
+          }
+          free(source.samples);
+     }
+     return 0;
+}
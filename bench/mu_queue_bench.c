@@ -0,0 +1,132 @@
+// @language: c11
+//
+// microbenchmark of the command queue: a producer thread publishes
+// batches of commands of varying size, which a consumer thread reads
+// back and checks. Reports the cost per command for increasing batch
+// sizes, i.e. how well the handoff amortizes.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_queue.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_COMMANDS_N = 4 * 1024 * 1024,
+     MU_BENCH_COMMAND_PARAMETER = 1,
+     MU_BENCH_COMMAND_BUFFER = 2,
+};
+
+struct Mu_Bench_Parameter
+{
+     uint32_t sequence_i;
+     uint32_t parameter_i;
+     float value;
+};
+
+struct Mu_Bench_Buffer
+{
+     uint32_t sequence_i;
+     uint8_t bytes[44];
+};
+
+struct Mu_Bench_Consumer
+{
+     struct Mu_Queue *queue;
+     uint64_t commands_n;
+     uint64_t errors_n;
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_BENCH_INTERNAL
+void *mu_bench_consumer_main(void *argument)
+{
+     struct Mu_Bench_Consumer * const consumer = argument;
+     uint32_t sequence_i = 0;
+     while (sequence_i != MU_BENCH_COMMANDS_N) {
+          struct Mu_QueueCommand const *command = Mu_QueuePeek(consumer->queue);
+          if (!command) {
+               sched_yield();
+               continue;
+          }
+          do {
+               // every command starts with its sequence number
+               uint32_t const command_sequence_i = *(uint32_t const *)(command + 1);
+               if (command_sequence_i != sequence_i) consumer->errors_n++;
+               if (command->type == MU_BENCH_COMMAND_BUFFER) {
+                    struct Mu_Bench_Buffer const *buffer = (void const *)(command + 1);
+                    if (buffer->bytes[43] != (uint8_t)sequence_i) consumer->errors_n++;
+               } else if (command->type != MU_BENCH_COMMAND_PARAMETER) {
+                    consumer->errors_n++;
+               }
+               ++sequence_i;
+               Mu_QueuePop(consumer->queue);
+          } while ((command = Mu_QueuePeek(consumer->queue)));
+          Mu_QueueRelease(consumer->queue);
+     }
+     consumer->commands_n = sequence_i;
+     return NULL;
+}
+
+int main(void)
+{
+     static int const batches_n[] = { 1, 16, 256, 4096 };
+     printf("%-12s %14s %14s %12s %12s\n", "batch", "ns/command", "Mcommands/s", "rejected", "high water");
+     for (int batch_i = 0; batch_i < (int)(sizeof batches_n / sizeof batches_n[0]); ++batch_i) {
+          struct Mu_Queue queue = { .bytes_capacity = 256 * 1024 };
+          if (!Mu_QueueInitialize(&queue)) return 1;
+          struct Mu_Bench_Consumer consumer = { .queue = &queue };
+          pthread_t consumer_thread;
+          if (0 != pthread_create(&consumer_thread, NULL, mu_bench_consumer_main, &consumer)) return 1;
+
+          uint64_t const t0 = mu_bench_nanoseconds();
+          for (uint32_t sequence_i = 0; sequence_i < MU_BENCH_COMMANDS_N;) {
+               // one buffer handoff every 8 parameter changes
+               Mu_Bool pushed;
+               if (sequence_i % 8 == 7) {
+                    struct Mu_Bench_Buffer *buffer = Mu_QueueReserve(&queue, MU_BENCH_COMMAND_BUFFER, sizeof *buffer);
+                    if ((pushed = buffer != NULL)) {
+                         buffer->sequence_i = sequence_i;
+                         buffer->bytes[43] = (uint8_t)sequence_i;
+                    }
+               } else {
+                    struct Mu_Bench_Parameter const parameter = { .sequence_i = sequence_i, .parameter_i = sequence_i % 64, .value = 0.5f };
+                    pushed = Mu_QueuePush(&queue, MU_BENCH_COMMAND_PARAMETER, &parameter, sizeof parameter);
+               }
+               if (!pushed) {
+                    // full: hand over what we have and let the consumer catch up
+                    Mu_QueuePublish(&queue);
+                    sched_yield();
+                    continue;
+               }
+               ++sequence_i;
+               if (sequence_i % batches_n[batch_i] == 0) Mu_QueuePublish(&queue);
+          }
+          Mu_QueuePublish(&queue);
+          pthread_join(consumer_thread, NULL);
+          uint64_t const t1 = mu_bench_nanoseconds();
+
+          struct Mu_QueueStats stats;
+          Mu_QueueGetStats(&queue, &stats);
+          if (consumer.errors_n || stats.commands_n != MU_BENCH_COMMANDS_N) {
+               printf("ERROR: %llu commands out of order or corrupted\n", (unsigned long long)consumer.errors_n);
+               return 1;
+          }
+          printf("%-12d %14.2f %14.1f %12llu %12u\n", batches_n[batch_i],
+                 (double)(t1 - t0) / MU_BENCH_COMMANDS_N, MU_BENCH_COMMANDS_N / ((t1 - t0) / 1e3),
+                 (unsigned long long)stats.rejected_n, stats.bytes_high_water);
+          Mu_QueueClose(&queue);
+     }
+     return 0;
+}
@@ -0,0 +1,126 @@
+// @language: c11
+//
+// benchmark of the software rasterizer on the scene of mu_test_unit.c:
+// clear, dropped frame indicator, the ln2.png logo at 1:1, the frame
+// time bar, the gamepad sticks, the mouse cursor and the time cursor;
+// then the same with the logo stretched to cover most of the window.
+// For each instruction set, on the calling thread then as jobs on
+// every core. Frames must come out the same in every configuration.
+//
+// The logo is test_assets/ln2.png, or the file given on the command line.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_image.h"
+#include "../xxxx_mu_jobs.h"
+#include "../xxxx_mu_raster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_FRAMES_N = 200,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_scene(struct Mu_RasterList *list, struct Mu_Int2 size, struct Mu_Image const *logo, int frame_i, int stretched)
+{
+     Mu_RasterClear(list, Mu_RasterColor(0.5f, 0.5f, 0.5f, 1.0f));
+     int cy = 10;
+     uint32_t const indicator = frame_i & 1? Mu_RasterColor(1.0f, 0.0f, 0.0f, 1.0f) : Mu_RasterColor(0.0f, 1.0f, 1.0f, 1.0f);
+     Mu_RasterQuad(list, 10, cy, 110, cy + 100, indicator);
+     cy += 110;
+     int const w = stretched? size.x - 20 : (int)logo->width;
+     int const h = stretched? size.y - cy - 60 : (int)logo->height;
+     Mu_RasterTexturedQuad(list, 10, cy, 10 + w, cy + h, logo, 0, 0, logo->width, logo->height);
+     cy += h + 10;
+     int const fty = (frame_i * 7) % 40;
+     Mu_RasterQuad(list, 10, cy, 30, cy + fty, Mu_RasterColor(1.0f, 0.0f, 0.0f, 1.0f));
+     for (int stick_i = 0; stick_i < 2; ++stick_i) {
+          int const bx = 210 + stick_i * 60, by = 110;
+          Mu_RasterQuad(list, bx, by - 50, bx + 50, by, Mu_RasterColor(0.94f, 0.94f, 0.94f, 1.0f));
+          Mu_RasterQuad(list, bx + 20, by - 30, bx + 30, by - 20, Mu_RasterColor(0.04f, 0.04f, 0.04f, 1.0f));
+     }
+     int const mx = (frame_i * 13) % size.x, my = (frame_i * 5) % size.y;
+     Mu_RasterQuad(list, mx - 4, my - 4, mx + 4, my + 4, Mu_RasterColor(0.6f, 0.9f, 0.8f, 1.0f));
+     int const px = (frame_i * 11) % size.x;
+     Mu_RasterQuad(list, px, 0, px + 3, size.y, Mu_RasterColor(1.0f, 1.0f, 1.0f, 1.0f));
+}
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_checksum(struct Mu_Framebuffer const *framebuffer)
+{
+     uint64_t checksum = 0;
+     for (int y = 0; y < framebuffer->size.y; ++y) {
+          uint32_t const *row = (uint32_t const *)(framebuffer->pixels + (size_t)y * framebuffer->pitch);
+          for (int x = 0; x < framebuffer->size.x; ++x) checksum = checksum * 31 + row[x];
+     }
+     return checksum;
+}
+
+int main(int argc, char **argv)
+{
+     char const *filename = argc > 1? argv[1] : "test_assets/ln2.png";
+     struct Mu_Image logo = { 0 };
+     if (Mu_LoadImages(&filename, 1, &logo, NULL, NULL) != 1) {
+          printf("ERROR: could not load %s\n", filename);
+          return 1;
+     }
+     struct Mu_Jobs jobs = { 0 };
+     if (!Mu_JobsInitialize(&jobs)) return 1;
+     struct Mu_RasterList list = { 0 };
+     if (!Mu_AllocateRasterList(&list, 64)) return 1;
+
+     static char const * const isa_names[] = { "auto", "scalar", "sse2", "avx2" };
+     static struct Mu_Int2 const sizes[] = { { 640, 480 }, { 1920, 1080 } };
+     printf("%-10s %-10s %-8s %8s %12s %14s\n", "size", "scene", "isa", "workers", "ms/frame", "Mpixels/s");
+     for (int size_i = 0; size_i < (int)(sizeof sizes / sizeof *sizes); ++size_i) {
+          struct Mu_Framebuffer framebuffer = { .enabled = MU_TRUE, .size = sizes[size_i], .pitch = (sizes[size_i].x * 4 + 63) & ~63 };
+          framebuffer.pixels = aligned_alloc(64, (size_t)framebuffer.pitch * framebuffer.size.y);
+          if (!framebuffer.pixels) return 1;
+          char size_name[32];
+          snprintf(size_name, sizeof size_name, "%dx%d", framebuffer.size.x, framebuffer.size.y);
+          for (int stretched = 0; stretched < 2; ++stretched) {
+               uint64_t reference_checksum = 0;
+               for (int isa = MU_RASTER_ISA_SCALAR; isa <= MU_RASTER_ISA_AVX2; ++isa) {
+                    for (int parallel = 0; parallel < 2; ++parallel) {
+                         list.isa = isa;
+                         mu_bench_scene(&list, framebuffer.size, &logo, 0, stretched);
+                         if (!Mu_RasterRun(&list, &framebuffer, NULL)) break;
+                         uint64_t const t0 = mu_bench_nanoseconds();
+                         for (int frame_i = 0; frame_i < MU_BENCH_FRAMES_N; ++frame_i) {
+                              Mu_JobsPull(&jobs);
+                              mu_bench_scene(&list, framebuffer.size, &logo, frame_i, stretched);
+                              Mu_RasterRun(&list, &framebuffer, parallel? &jobs : NULL);
+                         }
+                         uint64_t const t1 = mu_bench_nanoseconds();
+                         uint64_t const checksum = mu_bench_checksum(&framebuffer);
+                         if (!reference_checksum) reference_checksum = checksum;
+                         else if (checksum != reference_checksum) {
+                              printf("ERROR: %s frames differ from scalar\n", isa_names[isa]);
+                              return 1;
+                         }
+                         uint64_t const pixels_n = (uint64_t)MU_BENCH_FRAMES_N * framebuffer.size.x * framebuffer.size.y;
+                         printf("%-10s %-10s %-8s %8d %12.3f %14.1f\n", size_name, stretched? "stretched" : "reference", isa_names[isa],
+                                parallel? jobs.workers_n : 1, (t1 - t0) / 1e6 / MU_BENCH_FRAMES_N, pixels_n / ((t1 - t0) / 1e3));
+                    }
+               }
+          }
+          free(framebuffer.pixels);
+     }
+     Mu_FreeRasterList(&list);
+     Mu_JobsClose(&jobs);
+     free(logo.pixels);
+     return 0;
+}
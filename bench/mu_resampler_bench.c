@@ -0,0 +1,111 @@
+// @language: c11
+//
+// microbenchmark of the resampler, for common rate pairs:
+// - streaming: how many stereo voices one core resamples in real time,
+//   for each instruction set
+// - on load: time to convert one minute of stereo int16 audio
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_mixer.h"
+#include "../xxxx_mu_resampler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_BLOCK_FRAMES = 512,
+     MU_BENCH_CHANNELS = 2,
+     MU_BENCH_LOAD_SECONDS = 60,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_BENCH_INTERNAL
+struct Mu_AudioBuffer mu_bench_source(uint32_t rate, size_t frames_n)
+{
+     struct Mu_AudioBuffer source = {
+          .samples_count = frames_n * MU_BENCH_CHANNELS,
+          .format = {
+               .samples_per_second = rate,
+               .channels = MU_BENCH_CHANNELS,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+     };
+     source.samples = malloc(source.samples_count * sizeof (int16_t));
+     for (size_t sample_i = 0; sample_i < source.samples_count; ++sample_i) {
+          source.samples[sample_i] = (int16_t)(16000.0f * sinf(sample_i * 0.013f));
+     }
+     return source;
+}
+
+int main(int argc, char **argv)
+{
+     static char const * const isa_names[] = { "auto", "scalar", "sse2", "avx2" };
+     struct { uint32_t s_rate, d_rate; } const cases[] = {
+          { 44100, 48000 },
+          { 48000, 96000 },
+          { 48000, 44100 },
+     };
+     static float frames[MU_BENCH_BLOCK_FRAMES * MU_BENCH_CHANNELS];
+
+     printf("%-16s %-8s %14s\n", "streaming", "isa", "voices/core");
+     for (size_t case_i = 0; case_i < sizeof cases / sizeof *cases; ++case_i) {
+          uint32_t const s_rate = cases[case_i].s_rate, d_rate = cases[case_i].d_rate;
+          struct Mu_AudioBuffer source = mu_bench_source(s_rate, s_rate);
+          char name[32];
+          snprintf(name, sizeof name, "%u->%u", s_rate, d_rate);
+          for (int isa = MU_MIXER_ISA_SCALAR; isa <= MU_MIXER_ISA_AVX2; ++isa) {
+               struct Mu_ResamplerFilter filter;
+               if (!Mu_InitializeResamplerFilterWithISA(isa, &filter, s_rate, d_rate)) continue;
+               static struct Mu_Resampler resampler;
+               Mu_InitializeResampler(&resampler, &filter, MU_BENCH_CHANNELS);
+               size_t source_frame_i = 0;
+               uint64_t frames_n = 0;
+               uint64_t const t0 = mu_bench_nanoseconds();
+               uint64_t t1 = t0;
+               while (t1 - t0 < 200*1000*1000) {
+                    for (int iteration = 0; iteration < 16; ++iteration) {
+                         size_t const n = Mu_Resample(&resampler, &source, &source_frame_i, frames, MU_BENCH_BLOCK_FRAMES);
+                         frames_n += n;
+                         if (n < MU_BENCH_BLOCK_FRAMES) source_frame_i = 0;
+                    }
+                    t1 = mu_bench_nanoseconds();
+               }
+               // voices that one core could resample continuously in real time
+               double const audio_seconds = (double)frames_n / d_rate;
+               printf("%-16s %-8s %14.0f\n", name, isa_names[isa], audio_seconds / ((t1 - t0) / 1e9));
+               Mu_FreeResamplerFilter(&filter);
+          }
+          free(source.samples);
+     }
+
+     printf("%-16s %14s %14s\n", "on load", "ms/minute", "x realtime");
+     for (size_t case_i = 0; case_i < sizeof cases / sizeof *cases; ++case_i) {
+          uint32_t const s_rate = cases[case_i].s_rate, d_rate = cases[case_i].d_rate;
+          struct Mu_AudioBuffer source = mu_bench_source(s_rate, (size_t)s_rate * MU_BENCH_LOAD_SECONDS);
+          struct Mu_AudioBuffer dest;
+          uint64_t const t0 = mu_bench_nanoseconds();
+          if (!Mu_ResampleAudio(&source, d_rate, &dest, NULL)) {
+               printf("ERROR: could not resample\n");
+               return 1;
+          }
+          uint64_t const t1 = mu_bench_nanoseconds();
+          char name[32];
+          snprintf(name, sizeof name, "%u->%u", s_rate, d_rate);
+          printf("%-16s %14.1f %14.0f\n", name, (t1 - t0) / 1e6, MU_BENCH_LOAD_SECONDS / ((t1 - t0) / 1e9));
+          free(dest.samples);
+          free(source.samples);
+     }
+     return 0;
+}
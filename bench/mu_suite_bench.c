@@ -0,0 +1,459 @@
+// @language: c11
+//
+// regression suite of the hot paths of Mu, on the headless backend:
+// - mix: `Mu_Mix` of the test chime into an int16 stereo block
+// - callback: the work of the test program's audio callback (notes
+//   rendered by the synth plus playing samples, mixed into a cleared
+//   device buffer) at increasing voice counts
+// - pull: `Mu_Pull`, whose cost is mostly resetting the input state
+//   of the previous frame, with keys and mouse buttons held
+// - gamepad: replay of the recorded test_assets/*.fixture and
+//   publication of the buttons and sticks they move
+// - load: WAV and PNG files of test_assets/
+//
+// Each benchmark is timed over many samples of a few operations, for
+// ns/op, throughput and the p50/p90/p99/max latency of one operation.
+//
+// usage: mu_suite_bench [--assets <dir>] [--filter <text>] [--json <file>]
+//                       [--baseline <file>] [--tolerance <percent>]
+//
+// --json writes the results, one benchmark per line, and --baseline
+// compares them with such a file, recorded on the same host: the exit
+// status is 1 when the p50 of a benchmark is more than <percent> (10
+// by default) slower than in the baseline, or when the baseline does
+// not have it (record it again).
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_gamepad.h"
+#include "../xxxx_mu_mixer.h"
+#include "../xxxx_mu_synth.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_CASES_CAPACITY = 32,
+     MU_BENCH_SAMPLES_CAPACITY = 100000,
+     MU_BENCH_MIN_SAMPLES = 32,
+     MU_BENCH_SAMPLE_BUDGET_NANOSECONDS = 300*1000*1000,
+     MU_BENCH_WARMUP_SAMPLES = 8,
+
+     MU_BENCH_RATE = 48000,
+     MU_BENCH_CHANNELS = 2,
+     MU_BENCH_MIX_FRAMES = 256,
+     MU_BENCH_DEVICE_FRAMES = 512, // MU_TEST_AUDIOSYNTH_BLOCK_FRAMES
+     MU_BENCH_NOTES_N = 16,
+     MU_BENCH_MAX_VOICES = 256,
+     MU_BENCH_HELD_KEYS_N = 8,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+struct Mu_Bench_Case;
+typedef void (*Mu_Bench_Run)(struct Mu_Bench_Case *bench_case);
+
+struct Mu_Bench_Case
+{
+     char name[64];
+     Mu_Bench_Run run;       // runs `ops_per_sample` operations
+     int ops_per_sample;
+     double items_per_op;    // of `unit`, for the throughput
+     char const *unit;
+     void *context;
+     int voices_n;
+};
+
+struct Mu_Bench_Result
+{
+     int samples_n;
+     uint64_t ops_n;
+     double ns_per_op; // mean
+     double p50_ns, p90_ns, p99_ns, max_ns;
+     double throughput; // `unit` per second
+};
+
+// Audio:
+
+struct Mu_Bench_Audio
+{
+     struct Mu_AudioBuffer chime;
+     struct Mu_AudioBuffer dest;
+     int16_t dest_samples[MU_BENCH_DEVICE_FRAMES * MU_BENCH_CHANNELS];
+     struct Mu_MixerVoice voices[1 + MU_BENCH_MAX_VOICES];
+
+     struct Mu_Synth synth;
+     float notes_frames[MU_BENCH_DEVICE_FRAMES];
+     struct Mu_AudioBuffer notes;
+};
+
+MU_BENCH_INTERNAL
+void mu_bench_start_voices(struct Mu_Bench_Audio *audio, struct Mu_MixerVoice *voices, int voices_n)
+{
+     // spread over the chime, so that they do not all end together
+     size_t const frames_n = audio->chime.samples_count / audio->chime.format.channels;
+     for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+          voices[voice_i] = (struct Mu_MixerVoice){
+               .source = &audio->chime,
+               .gain = 0.1f,
+               .source_frame_i = frames_n * voice_i / (voices_n + 1),
+          };
+     }
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_restart_ended_voices(struct Mu_Bench_Audio *audio, struct Mu_MixerVoice *voices, int voices_n)
+{
+     size_t const frames_n = audio->chime.samples_count / audio->chime.format.channels;
+     for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+          if (voices[voice_i].source_frame_i >= frames_n) voices[voice_i].source_frame_i = 0;
+     }
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_mix(struct Mu_Bench_Case *bench_case)
+{
+     struct Mu_Bench_Audio *audio = bench_case->context;
+     struct Mu_AudioBuffer dest = audio->dest;
+     dest.samples_count = MU_BENCH_MIX_FRAMES * MU_BENCH_CHANNELS;
+     for (int op_i = 0; op_i < bench_case->ops_per_sample; ++op_i) {
+          mu_bench_restart_ended_voices(audio, audio->voices, bench_case->voices_n);
+          Mu_Mix(&dest, audio->voices, bench_case->voices_n);
+     }
+}
+
+// as main_audio_callback, without its command queues
+MU_BENCH_INTERNAL
+void mu_bench_callback(struct Mu_Bench_Case *bench_case)
+{
+     struct Mu_Bench_Audio *audio = bench_case->context;
+     struct Mu_AudioBuffer *dest = &audio->dest;
+     for (int op_i = 0; op_i < bench_case->ops_per_sample; ++op_i) {
+          memset(dest->samples, 0, dest->samples_count * sizeof *dest->samples);
+          if (audio->synth.voices_n < MU_BENCH_NOTES_N) {
+               for (int note_i = audio->synth.voices_n; note_i < MU_BENCH_NOTES_N; ++note_i) {
+                    Mu_SynthNoteOn(&audio->synth, MU_BENCH_RATE, 220.0f * (1 + note_i % 5), 0.05f, 2.0f);
+               }
+          }
+          Mu_SynthRender(&audio->synth, audio->notes_frames, MU_BENCH_DEVICE_FRAMES);
+          audio->voices[0] = (struct Mu_MixerVoice){ .source = &audio->notes, .gain = 1.0f };
+          mu_bench_restart_ended_voices(audio, audio->voices + 1, bench_case->voices_n);
+          Mu_Mix(dest, audio->voices, 1 + bench_case->voices_n);
+     }
+}
+
+// Input:
+
+MU_BENCH_INTERNAL
+void mu_bench_pull(struct Mu_Bench_Case *bench_case)
+{
+     struct Mu *mu = bench_case->context;
+     for (int op_i = 0; op_i < bench_case->ops_per_sample; ++op_i) {
+          // what a frame of typing leaves for the reset
+          for (int key_i = 0; key_i < MU_BENCH_HELD_KEYS_N; ++key_i) {
+               mu->keys['a' + key_i] = (struct Mu_DigitalButton){ .down = MU_TRUE, .pressed = MU_TRUE, .half_transition_count = 1 };
+          }
+          mu->mouse.left_button = (struct Mu_DigitalButton){ .down = MU_TRUE, .pressed = MU_TRUE, .half_transition_count = 1 };
+          mu->mouse.delta_position = (struct Mu_Int2){ 1, 1 };
+          Mu_Pull(mu);
+          Mu_Push(mu);
+     }
+}
+
+struct Mu_Bench_Gamepad
+{
+     struct Mu_GamepadFixture fixture;
+     struct Mu_GamepadSlot slot;
+     struct Mu_Gamepad gamepad;
+};
+
+MU_BENCH_INTERNAL
+void mu_bench_gamepad(struct Mu_Bench_Case *bench_case)
+{
+     struct Mu_Bench_Gamepad *gamepad = bench_case->context;
+     for (int op_i = 0; op_i < bench_case->ops_per_sample; ++op_i) {
+          gamepad->fixture.replayed_n = 0;
+          Mu_ReplayGamepadFixture(&gamepad->fixture, &gamepad->slot, UINT64_MAX);
+          Mu_PublishGamepad(&gamepad->slot, &gamepad->gamepad, NULL);
+     }
+}
+
+// Files:
+
+struct Mu_Bench_File
+{
+     char path[4096];
+};
+
+MU_BENCH_INTERNAL
+void mu_bench_load_wav(struct Mu_Bench_Case *bench_case)
+{
+     struct Mu_Bench_File *file = bench_case->context;
+     for (int op_i = 0; op_i < bench_case->ops_per_sample; ++op_i) {
+          struct Mu_AudioBuffer audio = { 0 };
+          if (Mu_LoadAudio(file->path, &audio)) free(audio.samples);
+     }
+}
+
+MU_BENCH_INTERNAL
+void mu_bench_load_png(struct Mu_Bench_Case *bench_case)
+{
+     struct Mu_Bench_File *file = bench_case->context;
+     for (int op_i = 0; op_i < bench_case->ops_per_sample; ++op_i) {
+          struct Mu_Image image = { 0 };
+          if (Mu_LoadImage(file->path, &image)) free(image.pixels);
+     }
+}
+
+MU_BENCH_INTERNAL
+long mu_bench_file_size(char const *path)
+{
+     FILE *file = fopen(path, "rb");
+     if (!file) return -1;
+     fseek(file, 0, SEEK_END);
+     long const size = ftell(file);
+     fclose(file);
+     return size;
+}
+
+// Harness:
+
+MU_BENCH_INTERNAL
+int mu_bench_compare_doubles(void const *a_, void const *b_)
+{
+     double const a = *(double const *)a_, b = *(double const *)b_;
+     return a < b? -1 : a > b? 1 : 0;
+}
+
+MU_BENCH_INTERNAL
+double mu_bench_percentile(double const *sorted, int n, double p)
+{
+     int i = (int)(p * (n - 1) + 0.5);
+     return sorted[i < n? i : n - 1];
+}
+
+MU_BENCH_INTERNAL
+struct Mu_Bench_Result mu_bench_measure(struct Mu_Bench_Case *bench_case, double *samples)
+{
+     for (int sample_i = 0; sample_i < MU_BENCH_WARMUP_SAMPLES; ++sample_i) bench_case->run(bench_case);
+     struct Mu_Bench_Result result = { 0 };
+     double total_ns = 0.0;
+     uint64_t const t0 = mu_bench_nanoseconds();
+     while (result.samples_n < MU_BENCH_SAMPLES_CAPACITY
+            && (result.samples_n < MU_BENCH_MIN_SAMPLES || mu_bench_nanoseconds() - t0 < MU_BENCH_SAMPLE_BUDGET_NANOSECONDS)) {
+          uint64_t const t1 = mu_bench_nanoseconds();
+          bench_case->run(bench_case);
+          uint64_t const t2 = mu_bench_nanoseconds();
+          samples[result.samples_n++] = (double)(t2 - t1) / bench_case->ops_per_sample;
+          total_ns += (double)(t2 - t1);
+     }
+     result.ops_n = (uint64_t)result.samples_n * bench_case->ops_per_sample;
+     qsort(samples, result.samples_n, sizeof *samples, mu_bench_compare_doubles);
+     result.ns_per_op = total_ns / result.ops_n;
+     result.p50_ns = mu_bench_percentile(samples, result.samples_n, 0.50);
+     result.p90_ns = mu_bench_percentile(samples, result.samples_n, 0.90);
+     result.p99_ns = mu_bench_percentile(samples, result.samples_n, 0.99);
+     result.max_ns = samples[result.samples_n - 1];
+     result.throughput = result.ns_per_op > 0.0? bench_case->items_per_op * 1e9 / result.ns_per_op : 0.0;
+     return result;
+}
+
+// p50 of benchmark `name` in a file written by --json, -1 when absent
+MU_BENCH_INTERNAL
+double mu_bench_baseline_p50(char const *baseline, char const *name)
+{
+     char key[96];
+     snprintf(key, sizeof key, "\"name\": \"%.63s\"", name);
+     char const *line = strstr(baseline, key);
+     if (!line) return -1.0;
+     char const *end = strchr(line, '\n');
+     char const *p50 = strstr(line, "\"p50_ns\": ");
+     if (!p50 || (end && p50 > end)) return -1.0;
+     return strtod(p50 + strlen("\"p50_ns\": "), NULL);
+}
+
+MU_BENCH_INTERNAL
+char *mu_bench_read_file(char const *path)
+{
+     FILE *file = fopen(path, "rb");
+     if (!file) return NULL;
+     fseek(file, 0, SEEK_END);
+     long const size = ftell(file);
+     fseek(file, 0, SEEK_SET);
+     char *text = size >= 0? malloc(size + 1) : NULL;
+     if (text && fread(text, 1, size, file) != (size_t)size) {
+          free(text);
+          text = NULL;
+     }
+     fclose(file);
+     if (text) text[size] = 0;
+     return text;
+}
+
+int main(int argc, char **argv)
+{
+     char const *assets = "test_assets";
+     char const *filter = NULL, *json_path = NULL, *baseline_path = NULL;
+     double tolerance_percent = 10.0;
+     for (int arg_i = 1; arg_i < argc; ++arg_i) {
+          if (arg_i + 1 < argc && 0 == strcmp(argv[arg_i], "--assets")) assets = argv[++arg_i];
+          else if (arg_i + 1 < argc && 0 == strcmp(argv[arg_i], "--filter")) filter = argv[++arg_i];
+          else if (arg_i + 1 < argc && 0 == strcmp(argv[arg_i], "--json")) json_path = argv[++arg_i];
+          else if (arg_i + 1 < argc && 0 == strcmp(argv[arg_i], "--baseline")) baseline_path = argv[++arg_i];
+          else if (arg_i + 1 < argc && 0 == strcmp(argv[arg_i], "--tolerance")) tolerance_percent = atof(argv[++arg_i]);
+          else {
+               printf("usage: %s [--assets <dir>] [--filter <text>] [--json <file>] [--baseline <file>] [--tolerance <percent>]\n", argv[0]);
+               return 1;
+          }
+     }
+     char *baseline = NULL;
+     if (baseline_path && !(baseline = mu_bench_read_file(baseline_path))) {
+          printf("ERROR: could not read baseline %s\n", baseline_path);
+          return 1;
+     }
+
+     static struct Mu_Bench_Audio audio;
+     static struct Mu_Bench_Gamepad gamepads[2];
+     static struct Mu_Bench_File wav, png;
+     static char const * const fixture_names[] = { "ds4", "evdev" };
+     snprintf(wav.path, sizeof wav.path, "%s/chime.wav", assets);
+     snprintf(png.path, sizeof png.path, "%s/ln2.png", assets);
+     struct Mu_Image png_info = { 0 };
+     long const wav_bytes_n = mu_bench_file_size(wav.path);
+     if (!Mu_LoadAudio(wav.path, &audio.chime) || wav_bytes_n <= 0 || !Mu_LoadImage(png.path, &png_info)) {
+          printf("ERROR: could not load the test assets from %s\n", assets);
+          return 1;
+     }
+     free(png_info.pixels);
+     for (int fixture_i = 0; fixture_i < 2; ++fixture_i) {
+          char path[4096];
+          snprintf(path, sizeof path, "%s/gamepad_%s.fixture", assets, fixture_names[fixture_i]);
+          if (!Mu_LoadGamepadFixture(path, &gamepads[fixture_i].fixture)) {
+               printf("ERROR: could not load %s\n", path);
+               return 1;
+          }
+     }
+     audio.dest = (struct Mu_AudioBuffer){
+          .samples = audio.dest_samples,
+          .samples_count = MU_BENCH_DEVICE_FRAMES * MU_BENCH_CHANNELS,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = MU_BENCH_CHANNELS,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+     };
+     audio.notes = (struct Mu_AudioBuffer){
+          .float_samples = audio.notes_frames,
+          .samples_count = MU_BENCH_DEVICE_FRAMES,
+          .format = {
+               .samples_per_second = MU_BENCH_RATE,
+               .channels = 1,
+               .bytes_per_sample = sizeof (float),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32,
+          },
+     };
+     if (!Mu_SynthInitialize(&audio.synth, 4 * MU_BENCH_NOTES_N)) return 1;
+
+     // no devices, nor time spent waiting for frames: virtual clock
+     setenv("MU_HEADLESS_GAMEPADS", "0", 1);
+     static struct Mu mu;
+     if (!Mu_Initialize(&mu)) {
+          printf("ERROR: %s\n", mu.error);
+          return 1;
+     }
+
+     static struct Mu_Bench_Case cases[MU_BENCH_CASES_CAPACITY];
+     int cases_n = 0;
+     static int const mix_voices[] = { 1, 16, 64 };
+     for (int i = 0; i < (int)(sizeof mix_voices / sizeof mix_voices[0]); ++i) {
+          struct Mu_Bench_Case *c = &cases[cases_n++];
+          *c = (struct Mu_Bench_Case){ .run = mu_bench_mix, .ops_per_sample = 4, .items_per_op = MU_BENCH_MIX_FRAMES,
+                                       .unit = "frames/s", .context = &audio, .voices_n = mix_voices[i] };
+          snprintf(c->name, sizeof c->name, "mix/int16_stereo/%d_voices", mix_voices[i]);
+     }
+     static int const callback_voices[] = { 0, 8, 32, 128, 256 };
+     for (int i = 0; i < (int)(sizeof callback_voices / sizeof callback_voices[0]); ++i) {
+          struct Mu_Bench_Case *c = &cases[cases_n++];
+          *c = (struct Mu_Bench_Case){ .run = mu_bench_callback, .ops_per_sample = 1, .items_per_op = MU_BENCH_DEVICE_FRAMES,
+                                       .unit = "frames/s", .context = &audio, .voices_n = callback_voices[i] };
+          snprintf(c->name, sizeof c->name, "callback/%d_samples_%d_notes", callback_voices[i], MU_BENCH_NOTES_N);
+     }
+     cases[cases_n++] = (struct Mu_Bench_Case){ .name = "pull/input_reset", .run = mu_bench_pull, .ops_per_sample = 1,
+                                                .items_per_op = 1, .unit = "frames/s", .context = &mu };
+     for (int fixture_i = 0; fixture_i < 2; ++fixture_i) {
+          struct Mu_Bench_Case *c = &cases[cases_n++];
+          *c = (struct Mu_Bench_Case){ .run = mu_bench_gamepad, .ops_per_sample = 16, .items_per_op = gamepads[fixture_i].fixture.records_n,
+                                       .unit = "records/s", .context = &gamepads[fixture_i] };
+          snprintf(c->name, sizeof c->name, "gamepad/%s_fixture", fixture_names[fixture_i]);
+     }
+     cases[cases_n++] = (struct Mu_Bench_Case){ .name = "load/wav", .run = mu_bench_load_wav, .ops_per_sample = 1,
+                                                .items_per_op = wav_bytes_n, .unit = "bytes/s", .context = &wav };
+     cases[cases_n++] = (struct Mu_Bench_Case){ .name = "load/png", .run = mu_bench_load_png, .ops_per_sample = 1,
+                                                .items_per_op = (double)png_info.width * png_info.height, .unit = "pixels/s", .context = &png };
+
+     FILE *json = NULL;
+     if (json_path && !(json = fopen(json_path, "w"))) {
+          printf("ERROR: could not write %s\n", json_path);
+          return 1;
+     }
+     if (json) fprintf(json, "{\n  \"suite\": \"mu\",\n  \"benchmarks\": [\n");
+     static double samples[MU_BENCH_SAMPLES_CAPACITY];
+     int regressions_n = 0, missing_n = 0, written_n = 0;
+     printf("%-34s %12s %12s %12s %12s %22s %10s\n", "benchmark", "ns/op", "p50", "p99", "max", "throughput", "baseline");
+     for (int case_i = 0; case_i < cases_n; ++case_i) {
+          struct Mu_Bench_Case *c = &cases[case_i];
+          if (filter && !strstr(c->name, filter)) continue;
+          if (c->run == mu_bench_mix || c->run == mu_bench_callback) {
+               mu_bench_start_voices(&audio, c->run == mu_bench_mix? audio.voices : audio.voices + 1, c->voices_n);
+          }
+          struct Mu_Bench_Result const result = mu_bench_measure(c, samples);
+          char change[16] = "-";
+          double const baseline_p50 = baseline? mu_bench_baseline_p50(baseline, c->name) : -1.0;
+          if (baseline_p50 > 0.0) {
+               double const change_percent = 100.0 * (result.p50_ns / baseline_p50 - 1.0);
+               snprintf(change, sizeof change, "%+.1f%%", change_percent);
+               if (change_percent > tolerance_percent) ++regressions_n;
+          } else if (baseline) {
+               snprintf(change, sizeof change, "missing");
+               ++missing_n;
+          }
+          printf("%-34s %12.1f %12.1f %12.1f %12.1f %12.4g %-9s %10s\n", c->name, result.ns_per_op, result.p50_ns, result.p99_ns,
+                 result.max_ns, result.throughput, c->unit, change);
+          if (json) {
+               fprintf(json, "%s    {\"name\": \"%s\", \"samples\": %d, \"ops\": %llu, \"ns_per_op\": %.1f, "
+                       "\"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f, "
+                       "\"throughput\": %.6g, \"throughput_unit\": \"%s\"}",
+                       written_n++? ",\n" : "", c->name, result.samples_n, (unsigned long long)result.ops_n, result.ns_per_op,
+                       result.p50_ns, result.p90_ns, result.p99_ns, result.max_ns, result.throughput, c->unit);
+          }
+     }
+     if (json) {
+          fprintf(json, "\n  ]\n}\n");
+          fclose(json);
+     }
+
+     // stops the audio thread and closes the session
+     mu.quit = MU_TRUE;
+     Mu_Pull(&mu);
+     Mu_SynthClose(&audio.synth);
+     free(audio.chime.samples);
+     for (int fixture_i = 0; fixture_i < 2; ++fixture_i) Mu_CloseGamepadFixture(&gamepads[fixture_i].fixture);
+     free(baseline);
+     if (missing_n) {
+          printf("MISSING: %d benchmark(s) not in %s, which must be recorded again\n", missing_n, baseline_path);
+     }
+     if (regressions_n) {
+          printf("REGRESSION: %d benchmark(s) more than %.1f%% slower than %s at p50\n", regressions_n, tolerance_percent, baseline_path);
+     }
+     return regressions_n || missing_n? 1 : 0;
+}
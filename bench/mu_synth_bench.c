@@ -0,0 +1,94 @@
+// @language: c11
+//
+// microbenchmark of `Mu_SynthRender`: how many voices fit in one
+// 48kHz block on one core, against the former per-sample exp/sin synth.
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_synth.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MU_BENCH_INTERNAL static
+
+enum {
+     MU_BENCH_RATE = 48000,
+     MU_BENCH_BLOCK_FRAMES = 512,
+     MU_BENCH_REFERENCE_VOICES_N = 64,
+};
+
+MU_BENCH_INTERNAL
+uint64_t mu_bench_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// the synth of mu_test_unit.c before Mu_Synth
+MU_BENCH_INTERNAL
+void mu_bench_reference_render(double *phases, int voices_n, float *mono_frames, int frames_n)
+{
+     static const double TAU = 6.2831853071795864769252;
+     for (int frame_i = 0; frame_i < frames_n; ++frame_i) mono_frames[frame_i] = 0.0f;
+     for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+          double phase = phases[voice_i];
+          double const phase_delta = (110.0 + voice_i) / MU_BENCH_RATE;
+          for (int frame_i = 0; frame_i < frames_n; ++frame_i) {
+               double const env = fmin(1.0, exp(-6.0 * phase * 0.001));
+               mono_frames[frame_i] += (float)(env * 0.1 * sin(TAU*phase));
+               phase += phase_delta;
+          }
+          phases[voice_i] = phase;
+     }
+}
+
+int main(int argc, char **argv)
+{
+     static float mono_frames[MU_BENCH_BLOCK_FRAMES];
+     double const block_ns = 1e9 * MU_BENCH_BLOCK_FRAMES / MU_BENCH_RATE;
+     printf("%-10s %8s %14s %18s\n", "synth", "voices", "ns/block", "max voices/block");
+
+     /* reference */ {
+          static double phases[MU_BENCH_REFERENCE_VOICES_N];
+          uint64_t blocks_n = 0;
+          uint64_t const t0 = mu_bench_nanoseconds();
+          uint64_t t1 = t0;
+          while (t1 - t0 < 200*1000*1000) {
+               for (int voice_i = 0; voice_i < MU_BENCH_REFERENCE_VOICES_N; ++voice_i) phases[voice_i] = 0.0;
+               mu_bench_reference_render(phases, MU_BENCH_REFERENCE_VOICES_N, mono_frames, MU_BENCH_BLOCK_FRAMES);
+               ++blocks_n;
+               t1 = mu_bench_nanoseconds();
+          }
+          double const ns_per_block = (double)(t1 - t0) / blocks_n;
+          printf("%-10s %8d %14.0f %18.0f\n", "reference", MU_BENCH_REFERENCE_VOICES_N, ns_per_block,
+                 MU_BENCH_REFERENCE_VOICES_N * block_ns / ns_per_block);
+     }
+
+     for (int voices_n = 256; voices_n <= 16384; voices_n *= 4) {
+          struct Mu_Synth synth;
+          if (!Mu_SynthInitialize(&synth, voices_n)) {
+               printf("ERROR: could not allocate %d voices\n", voices_n);
+               return 1;
+          }
+          // voices that never end
+          for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+               Mu_SynthNoteOn(&synth, MU_BENCH_RATE, 110.0f + voice_i % 2000, 1.0f / voices_n, 0.0f);
+          }
+          uint64_t blocks_n = 0;
+          uint64_t const t0 = mu_bench_nanoseconds();
+          uint64_t t1 = t0;
+          while (t1 - t0 < 200*1000*1000) {
+               for (int iteration = 0; iteration < 8; ++iteration, ++blocks_n) {
+                    Mu_SynthRender(&synth, mono_frames, MU_BENCH_BLOCK_FRAMES);
+               }
+               t1 = mu_bench_nanoseconds();
+          }
+          double const ns_per_block = (double)(t1 - t0) / blocks_n;
+          printf("%-10s %8d %14.0f %18.0f\n", "Mu_Synth", synth.voices_n, ns_per_block, synth.voices_n * block_ns / ns_per_block);
+          Mu_SynthClose(&synth);
+     }
+     return 0;
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# Builds, then runs bench/mu_suite_bench.c against the baseline of this
+# host: bench/baselines/<host>-<arch>.json, or $BASELINE. The first run
+# records it. Extra arguments go to the suite (--tolerance <percent>,
+# --filter <text>). Fails when a benchmark regressed.
+
+HERE="$(dirname "${0}")"
+ODIR="${ODIR:-"${HERE}"/output}"
+BASELINE="${BASELINE:-"${HERE}"/bench/baselines/"$(uname -n)"-"$(uname -m)".json}"
+
+ODIR="${ODIR}" "${HERE}"/linux_build.sh > /dev/null || exit 1
+if [ -f "${BASELINE}" ]; then
+    "${ODIR}"/mu_suite_bench.elf --assets "${ODIR}"/test_assets \
+        --json "${ODIR}"/mu_suite_bench.json --baseline "${BASELINE}" "$@" || exit 1
+    printf "RESULTS\t%s\n" "${ODIR}"/mu_suite_bench.json
+else
+    mkdir -p "$(dirname "${BASELINE}")" || exit 1
+    "${ODIR}"/mu_suite_bench.elf --assets "${ODIR}"/test_assets --json "${BASELINE}" "$@" || exit 1
+    printf "BASELINE\t%s\n" "${BASELINE}"
+fi
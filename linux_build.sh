@@ -0,0 +1,277 @@
+#!/usr/bin/env bash
+CC=${CC:-cc}
+
+# To debug a build failure, uncomment this line:
+# set -x
+
+HERE="$(dirname "${0}")"
+ODIR="${ODIR:-"${HERE}"/output}"
+[ -d "${ODIR}" ] || (mkdir -p "${ODIR}" || exit 1)
+
+"${CC}" -fsyntax-only "${HERE}"/mu_headless_unit.c -DMU_HEADLESS_CLOCK=MU_HEADLESS_CLOCK_VIRTUAL -std=c11 -Wall -Werror || exit 1
+"${CC}" -fsyntax-only "${HERE}"/mu_headless_unit.c -DMU_HEADLESS_CLOCK=MU_HEADLESS_CLOCK_MONOTONIC -std=c11 -Wall -Werror || exit 1
+(O="${ODIR}"/mu_test_headless.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/mu_headless_unit.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_audioblock_unit.c \
+	 "${HERE}"/mu_audiofile_unit.c \
+	 "${HERE}"/mu_audiograph_unit.c \
+	 "${HERE}"/mu_gamepad_unit.c \
+	 "${HERE}"/mu_image_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_pack_unit.c \
+	 "${HERE}"/mu_queue_unit.c \
+	 "${HERE}"/mu_raster_unit.c \
+	 "${HERE}"/mu_record_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 "${HERE}"/mu_stats_unit.c \
+	 "${HERE}"/mu_synth_unit.c \
+	 "${HERE}"/mu_telemetry_unit.c \
+	 "${HERE}"/mu_test_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -lrt \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "PROGRAM\t%s\n" "${O}") || exit 1
+
+# Tools:
+(O="${ODIR}"/mu_pack_tool.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/tools/mu_pack_tool.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_audiofile_unit.c \
+	 "${HERE}"/mu_image_unit.c \
+	 "${HERE}"/mu_imageprep_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_pack_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "TOOL\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_telemetry_viewer.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/tools/mu_telemetry_viewer.c \
+	 "${HERE}"/mu_telemetry_unit.c \
+	 -Wall \
+	 -D_DEFAULT_SOURCE \
+	 -lrt \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "TOOL\t%s\n" "${O}") || exit 1
+
+# Benchmarks:
+(O="${ODIR}"/mu_mixer_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_mixer_bench.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_adpcm_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_adpcm_bench.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_synth_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_synth_bench.c \
+	 "${HERE}"/mu_synth_unit.c \
+	 -Wall \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_resampler_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_resampler_bench.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_audiograph_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_audiograph_bench.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_audiograph_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_image_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_image_bench.c \
+	 "${HERE}"/mu_image_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_imageprep_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_imageprep_bench.c \
+	 "${HERE}"/mu_imageprep_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_queue_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_queue_bench.c \
+	 "${HERE}"/mu_queue_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_gamepad_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_gamepad_bench.c \
+	 "${HERE}"/mu_gamepad_unit.c \
+	 -Wall \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_fiber_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_fiber_bench.c \
+	 "${HERE}"/mu_fiber_unit.c \
+	 -Wall \
+	 -D_DEFAULT_SOURCE \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_jobs_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_jobs_bench.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_raster_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_raster_bench.c \
+	 "${HERE}"/mu_image_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_raster_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/mu_suite_bench.elf ;
+ "${CC}" -o "${O}" \
+	 "${HERE}"/bench/mu_suite_bench.c \
+	 "${HERE}"/mu_headless_unit.c \
+	 "${HERE}"/mu_adpcm_unit.c \
+	 "${HERE}"/mu_audioblock_unit.c \
+	 "${HERE}"/mu_gamepad_unit.c \
+	 "${HERE}"/mu_image_unit.c \
+	 "${HERE}"/mu_jobs_unit.c \
+	 "${HERE}"/mu_mixer_unit.c \
+	 "${HERE}"/mu_resampler_unit.c \
+	 "${HERE}"/mu_stats_unit.c \
+	 "${HERE}"/mu_synth_unit.c \
+	 "${HERE}"/mu_telemetry_unit.c \
+	 -Wall \
+	 -pthread \
+	 -D_DEFAULT_SOURCE \
+	 -lm \
+	 -lrt \
+	 -g -O2 \
+	 -std=c11 \
+    && printf "BENCH\t%s\n" "${O}") || exit 1
+
+(O="${ODIR}"/test_assets/chime.wav I="${HERE}"/test_assets/chime.wav
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ cp "${I}" "${O}")
+(O="${ODIR}"/test_assets/chime.aif I="${HERE}"/test_assets/chime.aif
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ cp "${I}" "${O}")
+(O="${ODIR}"/test_assets/ln2.png I="${HERE}"/test_assets/ln2.png
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ cp "${I}" "${O}")
+(O="${ODIR}"/test_assets/gamepad_ds4.fixture I="${HERE}"/test_assets/gamepad_ds4.fixture
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ cp "${I}" "${O}")
+(O="${ODIR}"/test_assets/gamepad_evdev.fixture I="${HERE}"/test_assets/gamepad_evdev.fixture
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ cp "${I}" "${O}")
+(O="${ODIR}"/test_assets/test_assets.mupack
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ "${ODIR}"/mu_pack_tool.elf -o "${O}" -C "${HERE}" --mips \
+	 test_assets/chime.wav \
+	 test_assets/ln2.png \
+    && printf "PACK\t%s\n" "${O}") || exit 1
@@ -14,6 +14,23 @@ ODIR="${ODIR:-"${HERE}"/output}"
  "${OBJCC}" -o "${O}" \
 	    -DMU_MACOS_RUN_MODE=MU_MACOS_RUN_MODE_COROUTINE \
 	    "${HERE}"/mu_macos_unit.m \
+	    "${HERE}"/mu_adpcm_unit.c \
+	    "${HERE}"/mu_audioblock_unit.c \
+	    "${HERE}"/mu_audiofile_unit.c \
+	    "${HERE}"/mu_audiograph_unit.c \
+	    "${HERE}"/mu_fiber_unit.c \
+	    "${HERE}"/mu_gamepad_unit.c \
+	    "${HERE}"/mu_image_unit.c \
+	    "${HERE}"/mu_jobs_unit.c \
+	    "${HERE}"/mu_mixer_unit.c \
+	    "${HERE}"/mu_pack_unit.c \
+	    "${HERE}"/mu_queue_unit.c \
+	    "${HERE}"/mu_raster_unit.c \
+	    "${HERE}"/mu_record_unit.c \
+	    "${HERE}"/mu_resampler_unit.c \
+	    "${HERE}"/mu_stats_unit.c \
+	    "${HERE}"/mu_synth_unit.c \
+	    "${HERE}"/mu_telemetry_unit.c \
 	    "${HERE}"/mu_test_unit.c \
 	    -Wall \
 	    -framework OpenGL \
@@ -29,6 +46,10 @@ ODIR="${ODIR:-"${HERE}"/output}"
  OD="$(dirname "${O}")"
  [ -d "${OD}" ] || mkdir -p "${OD}"
  cp "${I}" "${O}")
+(O="${ODIR}"/test_assets/chime.aif I="${HERE}"/test_assets/chime.aif
+ OD="$(dirname "${O}")"
+ [ -d "${OD}" ] || mkdir -p "${OD}"
+ cp "${I}" "${O}")
 (O="${ODIR}"/test_assets/ln2.png I="${HERE}"/test_assets/ln2.png
  OD="$(dirname "${O}")"
  [ -d "${OD}" ] || mkdir -p "${OD}"
@@ -0,0 +1,352 @@
+// @language: c11
+// @dependencylist: xxxx_mu, xxxx_mu_mixer
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_adpcm.h"
+#include "xxxx_mu_mixer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MU_ADPCM_X86 1
+#include <immintrin.h>
+#define MU_ADPCM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MU_ADPCM_X86 0
+#endif
+
+#define MU_ADPCM_INTERNAL static
+
+enum {
+     // streams (one channel of one block) decoded at once, the SSE2
+     // kernel takes them 4 by 4
+     MU_ADPCM_LANES = 8,
+     MU_ADPCM_MAX_STEP_INDEX = 88,
+};
+
+MU_ADPCM_INTERNAL
+int32_t const mu_adpcm_steps[MU_ADPCM_MAX_STEP_INDEX + 1] = {
+     7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+     50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+     253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+     1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+     3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+     11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+     32767,
+};
+
+MU_ADPCM_INTERNAL
+int const mu_adpcm_step_index_deltas[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// decodes as silence, for the lanes left over
+MU_ADPCM_INTERNAL
+uint8_t const mu_adpcm_silence[MU_ADPCM_BLOCK_BYTES];
+
+struct Mu_AdpcmState
+{
+     int predictor;
+     int step_index;
+};
+
+MU_ADPCM_INTERNAL
+struct Mu_AdpcmState mu_adpcm_read_header(uint8_t const *stream)
+{
+     int const step_index = stream[2];
+     return (struct Mu_AdpcmState){
+          .predictor = (int16_t)(stream[0] | stream[1] << 8),
+          .step_index = step_index > MU_ADPCM_MAX_STEP_INDEX? MU_ADPCM_MAX_STEP_INDEX : step_index,
+     };
+}
+
+// @return: the decoded sample
+MU_ADPCM_INTERNAL
+int mu_adpcm_decode_nibble(struct Mu_AdpcmState *state, int nibble)
+{
+     int const step = mu_adpcm_steps[state->step_index];
+     int diff = step >> 3;
+     if (nibble & 4) diff += step;
+     if (nibble & 2) diff += step >> 1;
+     if (nibble & 1) diff += step >> 2;
+     int const predictor = state->predictor + ((nibble & 8)? -diff : diff);
+     int const step_index = state->step_index + mu_adpcm_step_index_deltas[nibble & 7];
+     state->predictor = predictor < -32768? -32768 : predictor > 32767? 32767 : predictor;
+     state->step_index = step_index < 0? 0 : step_index > MU_ADPCM_MAX_STEP_INDEX? MU_ADPCM_MAX_STEP_INDEX : step_index;
+     return state->predictor;
+}
+
+// @return: the nibble, `state` follows the decoder's
+MU_ADPCM_INTERNAL
+int mu_adpcm_encode_sample(struct Mu_AdpcmState *state, int sample)
+{
+     int const step = mu_adpcm_steps[state->step_index];
+     int diff = sample - state->predictor;
+     int nibble = 0;
+     if (diff < 0) nibble = 8, diff = -diff;
+     if (diff >= step) nibble |= 4, diff -= step;
+     if (diff >= step >> 1) nibble |= 2, diff -= step >> 1;
+     if (diff >= step >> 2) nibble |= 1;
+     mu_adpcm_decode_nibble(state, nibble);
+     return nibble;
+}
+
+// Decoding kernels:
+//
+// decode the MU_ADPCM_LANES streams `streams` into `decoded`, a row
+// of MU_ADPCM_LANES samples per frame of the block.
+
+typedef void (*Mu_AdpcmKernel)(uint8_t const *const *streams, int16_t *decoded);
+
+MU_ADPCM_INTERNAL
+void mu_adpcm_decode_scalar(uint8_t const *const *streams, int16_t *decoded)
+{
+     for (int lane_i = 0; lane_i < MU_ADPCM_LANES; ++lane_i) {
+          struct Mu_AdpcmState state = mu_adpcm_read_header(streams[lane_i]);
+          uint8_t const *nibbles = streams[lane_i] + MU_ADPCM_BLOCK_HEADER_BYTES;
+          for (int frame_i = 0; frame_i < MU_ADPCM_BLOCK_FRAMES; ++frame_i) {
+               int const nibble = (nibbles[frame_i / 2] >> (4 * (frame_i & 1))) & 15;
+               decoded[frame_i * MU_ADPCM_LANES + lane_i] = (int16_t)mu_adpcm_decode_nibble(&state, nibble);
+          }
+     }
+}
+
+#if MU_ADPCM_X86
+// 8 nibbles of each stream, at `word_i`
+MU_ADPCM_INTERNAL
+uint32_t mu_adpcm_read_word(uint8_t const *stream, int word_i)
+{
+     uint32_t word;
+     memcpy(&word, stream + MU_ADPCM_BLOCK_HEADER_BYTES + 4 * word_i, sizeof word);
+     return word;
+}
+
+// SSE2 kernel:
+//
+// the lanes run the scalar decoder in step, the step table is read
+// lane by lane.
+
+MU_ADPCM_INTERNAL
+void mu_adpcm_decode_4_sse2(uint8_t const *const *streams, int16_t *decoded)
+{
+     int32_t predictors[4], step_indices[4];
+     for (int lane_i = 0; lane_i < 4; ++lane_i) {
+          struct Mu_AdpcmState const state = mu_adpcm_read_header(streams[lane_i]);
+          predictors[lane_i] = state.predictor;
+          step_indices[lane_i] = state.step_index;
+     }
+     __m128i predictor = _mm_loadu_si128((__m128i const*)predictors);
+     __m128i step_index = _mm_loadu_si128((__m128i const*)step_indices);
+     __m128i const one = _mm_set1_epi32(1), two = _mm_set1_epi32(2), four = _mm_set1_epi32(4), eight = _mm_set1_epi32(8);
+     __m128i const three = _mm_set1_epi32(3), six = _mm_set1_epi32(6), seven = _mm_set1_epi32(7), fifteen = _mm_set1_epi32(15);
+     __m128i const zero = _mm_setzero_si128(), max_step_index = _mm_set1_epi32(MU_ADPCM_MAX_STEP_INDEX);
+     for (int word_i = 0; word_i < MU_ADPCM_BLOCK_FRAMES / 8; ++word_i) {
+          __m128i word = _mm_setr_epi32(mu_adpcm_read_word(streams[0], word_i), mu_adpcm_read_word(streams[1], word_i),
+                                        mu_adpcm_read_word(streams[2], word_i), mu_adpcm_read_word(streams[3], word_i));
+          for (int nibble_i = 0; nibble_i < 8; ++nibble_i, word = _mm_srli_epi32(word, 4)) {
+               __m128i const nibble = _mm_and_si128(word, fifteen);
+               _mm_storeu_si128((__m128i*)step_indices, step_index);
+               __m128i const step = _mm_setr_epi32(mu_adpcm_steps[step_indices[0]], mu_adpcm_steps[step_indices[1]],
+                                                   mu_adpcm_steps[step_indices[2]], mu_adpcm_steps[step_indices[3]]);
+               __m128i diff = _mm_srai_epi32(step, 3);
+               diff = _mm_add_epi32(diff, _mm_and_si128(step, _mm_cmpeq_epi32(_mm_and_si128(nibble, four), four)));
+               diff = _mm_add_epi32(diff, _mm_and_si128(_mm_srai_epi32(step, 1), _mm_cmpeq_epi32(_mm_and_si128(nibble, two), two)));
+               diff = _mm_add_epi32(diff, _mm_and_si128(_mm_srai_epi32(step, 2), _mm_cmpeq_epi32(_mm_and_si128(nibble, one), one)));
+               __m128i const negative = _mm_cmpeq_epi32(_mm_and_si128(nibble, eight), eight);
+               diff = _mm_sub_epi32(_mm_xor_si128(diff, negative), negative);
+               // saturates to int16, then sign extends back
+               __m128i const sample = _mm_packs_epi32(_mm_add_epi32(predictor, diff), zero);
+               predictor = _mm_srai_epi32(_mm_unpacklo_epi16(sample, sample), 16);
+               _mm_storel_epi64((__m128i*)(decoded + (8 * word_i + nibble_i) * MU_ADPCM_LANES), sample);
+
+               // -1 below 4, 2*(n&7)-6 above
+               __m128i const magnitude = _mm_and_si128(nibble, seven);
+               __m128i const above = _mm_cmpgt_epi32(magnitude, three);
+               __m128i const delta = _mm_or_si128(_mm_and_si128(above, _mm_sub_epi32(_mm_add_epi32(magnitude, magnitude), six)),
+                                                  _mm_andnot_si128(above, _mm_set1_epi32(-1)));
+               // indices stay within -1..96: 16 bit min/max clamp them,
+               // the high halves being 0 or -1 clamped to 0
+               step_index = _mm_min_epi16(_mm_max_epi16(_mm_add_epi32(step_index, delta), zero), max_step_index);
+          }
+     }
+}
+
+MU_ADPCM_INTERNAL
+void mu_adpcm_decode_sse2(uint8_t const *const *streams, int16_t *decoded)
+{
+     mu_adpcm_decode_4_sse2(streams, decoded);
+     mu_adpcm_decode_4_sse2(streams + 4, decoded + 4);
+}
+
+// AVX2 kernel:
+//
+// 8 lanes, with the step table read by a gather.
+
+MU_ADPCM_INTERNAL MU_ADPCM_TARGET_AVX2
+void mu_adpcm_decode_avx2(uint8_t const *const *streams, int16_t *decoded)
+{
+     int32_t predictors[8], step_indices[8];
+     for (int lane_i = 0; lane_i < 8; ++lane_i) {
+          struct Mu_AdpcmState const state = mu_adpcm_read_header(streams[lane_i]);
+          predictors[lane_i] = state.predictor;
+          step_indices[lane_i] = state.step_index;
+     }
+     __m256i predictor = _mm256_loadu_si256((__m256i const*)predictors);
+     __m256i step_index = _mm256_loadu_si256((__m256i const*)step_indices);
+     __m256i const one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2), four = _mm256_set1_epi32(4), eight = _mm256_set1_epi32(8);
+     __m256i const three = _mm256_set1_epi32(3), six = _mm256_set1_epi32(6), seven = _mm256_set1_epi32(7), fifteen = _mm256_set1_epi32(15);
+     __m256i const min_sample = _mm256_set1_epi32(-32768), max_sample = _mm256_set1_epi32(32767);
+     __m256i const zero = _mm256_setzero_si256(), max_step_index = _mm256_set1_epi32(MU_ADPCM_MAX_STEP_INDEX);
+     for (int word_i = 0; word_i < MU_ADPCM_BLOCK_FRAMES / 8; ++word_i) {
+          __m256i word = _mm256_setr_epi32(mu_adpcm_read_word(streams[0], word_i), mu_adpcm_read_word(streams[1], word_i),
+                                           mu_adpcm_read_word(streams[2], word_i), mu_adpcm_read_word(streams[3], word_i),
+                                           mu_adpcm_read_word(streams[4], word_i), mu_adpcm_read_word(streams[5], word_i),
+                                           mu_adpcm_read_word(streams[6], word_i), mu_adpcm_read_word(streams[7], word_i));
+          for (int nibble_i = 0; nibble_i < 8; ++nibble_i, word = _mm256_srli_epi32(word, 4)) {
+               __m256i const nibble = _mm256_and_si256(word, fifteen);
+               __m256i const step = _mm256_i32gather_epi32(mu_adpcm_steps, step_index, 4);
+               __m256i diff = _mm256_srai_epi32(step, 3);
+               diff = _mm256_add_epi32(diff, _mm256_and_si256(step, _mm256_cmpeq_epi32(_mm256_and_si256(nibble, four), four)));
+               diff = _mm256_add_epi32(diff, _mm256_and_si256(_mm256_srai_epi32(step, 1), _mm256_cmpeq_epi32(_mm256_and_si256(nibble, two), two)));
+               diff = _mm256_add_epi32(diff, _mm256_and_si256(_mm256_srai_epi32(step, 2), _mm256_cmpeq_epi32(_mm256_and_si256(nibble, one), one)));
+               __m256i const negative = _mm256_cmpeq_epi32(_mm256_and_si256(nibble, eight), eight);
+               diff = _mm256_sub_epi32(_mm256_xor_si256(diff, negative), negative);
+               predictor = _mm256_max_epi32(min_sample, _mm256_min_epi32(max_sample, _mm256_add_epi32(predictor, diff)));
+               // packs works within 128bit lanes, gather the 64bit quarters holding the samples
+               __m256i const sample = _mm256_permute4x64_epi64(_mm256_packs_epi32(predictor, predictor), 0x08);
+               _mm_storeu_si128((__m128i*)(decoded + (8 * word_i + nibble_i) * MU_ADPCM_LANES), _mm256_castsi256_si128(sample));
+
+               __m256i const magnitude = _mm256_and_si256(nibble, seven);
+               __m256i const delta = _mm256_blendv_epi8(_mm256_set1_epi32(-1), _mm256_sub_epi32(_mm256_add_epi32(magnitude, magnitude), six),
+                                                        _mm256_cmpgt_epi32(magnitude, three));
+               step_index = _mm256_max_epi32(zero, _mm256_min_epi32(max_step_index, _mm256_add_epi32(step_index, delta)));
+          }
+     }
+}
+#endif // MU_ADPCM_X86
+
+MU_ADPCM_INTERNAL
+Mu_AdpcmKernel mu_adpcm_kernel_for_isa(int isa)
+{
+     switch (isa) {
+     case MU_MIXER_ISA_SCALAR: return mu_adpcm_decode_scalar;
+#if MU_ADPCM_X86
+     case MU_MIXER_ISA_SSE2: return mu_adpcm_decode_sse2;
+     case MU_MIXER_ISA_AVX2: return __builtin_cpu_supports("avx2")? mu_adpcm_decode_avx2 : NULL;
+     case MU_MIXER_ISA_AUTO: return __builtin_cpu_supports("avx2")? mu_adpcm_decode_avx2 : mu_adpcm_decode_sse2;
+#else
+     case MU_MIXER_ISA_AUTO: return mu_adpcm_decode_scalar;
+#endif
+     }
+     return NULL;
+}
+
+// copies the frames of the decoded streams that fall within
+// `frame_i`..`frame_i + frames_n` to their place in `samples`
+MU_ADPCM_INTERNAL
+void mu_adpcm_interleave(int16_t const *decoded, int lanes_n, size_t const *lane_blocks, int const *lane_channels, int channels_n,
+                         size_t frame_i, size_t frames_n, int16_t *samples)
+{
+     for (int lane_i = 0; lane_i < lanes_n; ++lane_i) {
+          size_t const block_frame_i = lane_blocks[lane_i] * MU_ADPCM_BLOCK_FRAMES;
+          size_t const first_i = frame_i > block_frame_i? frame_i - block_frame_i : 0;
+          size_t const last_i = frame_i + frames_n - block_frame_i < MU_ADPCM_BLOCK_FRAMES? frame_i + frames_n - block_frame_i : MU_ADPCM_BLOCK_FRAMES;
+          int16_t *d = samples + (block_frame_i + first_i - frame_i) * channels_n + lane_channels[lane_i];
+          for (size_t i = first_i; i < last_i; ++i, d += channels_n) *d = decoded[i * MU_ADPCM_LANES + lane_i];
+     }
+}
+
+size_t Mu_DecodeAdpcmWithISA(int isa, struct Mu_AdpcmAudio const *adpcm, size_t frame_i, int16_t *samples, size_t frames_n)
+{
+     Mu_AdpcmKernel const kernel = mu_adpcm_kernel_for_isa(isa);
+     int const channels_n = adpcm->format.channels;
+     if (!kernel || channels_n == 0 || frame_i >= adpcm->frames_n) return 0;
+     if (frames_n > adpcm->frames_n - frame_i) frames_n = adpcm->frames_n - frame_i;
+
+     size_t const first_block_i = frame_i / MU_ADPCM_BLOCK_FRAMES;
+     size_t const last_block_i = (frame_i + frames_n - 1) / MU_ADPCM_BLOCK_FRAMES;
+     _Alignas(32) int16_t decoded[MU_ADPCM_BLOCK_FRAMES * MU_ADPCM_LANES];
+     uint8_t const *streams[MU_ADPCM_LANES];
+     size_t lane_blocks[MU_ADPCM_LANES];
+     int lane_channels[MU_ADPCM_LANES];
+     int lanes_n = 0;
+     for (size_t block_i = first_block_i; block_i <= last_block_i; ++block_i) {
+          for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+               streams[lanes_n] = adpcm->blocks + (block_i * channels_n + channel_i) * MU_ADPCM_BLOCK_BYTES;
+               lane_blocks[lanes_n] = block_i;
+               lane_channels[lanes_n] = channel_i;
+               if (++lanes_n < MU_ADPCM_LANES && !(block_i == last_block_i && channel_i + 1 == channels_n)) continue;
+               for (int lane_i = lanes_n; lane_i < MU_ADPCM_LANES; ++lane_i) streams[lane_i] = mu_adpcm_silence;
+               kernel(streams, decoded);
+               mu_adpcm_interleave(decoded, lanes_n, lane_blocks, lane_channels, channels_n, frame_i, frames_n, samples);
+               lanes_n = 0;
+          }
+     }
+     return frames_n;
+}
+
+size_t Mu_DecodeAdpcm(struct Mu_AdpcmAudio const *adpcm, size_t frame_i, int16_t *samples, size_t frames_n)
+{
+     return Mu_DecodeAdpcmWithISA(MU_MIXER_ISA_AUTO, adpcm, frame_i, samples, frames_n);
+}
+
+MU_ADPCM_INTERNAL
+int mu_adpcm_source_sample(struct Mu_AudioBuffer const *source, size_t sample_i)
+{
+     if (source->format.sample_format != MU_AUDIO_SAMPLE_FORMAT_FLOAT32) return source->samples[sample_i];
+     float const x = 32768.0f * source->float_samples[sample_i];
+     return x >= 32767.0f? 32767 : x <= -32768.0f? -32768 : (int)lrintf(x);
+}
+
+Mu_Bool Mu_EncodeAdpcm(struct Mu_AudioBuffer const *source, struct Mu_AdpcmAudio *adpcm)
+{
+     int const channels_n = source->format.channels;
+     if (channels_n == 0 || channels_n > MU_MIXER_MAX_CHANNELS) return MU_FALSE;
+     size_t const frames_n = source->samples_count / channels_n;
+     size_t const blocks_n = (frames_n + MU_ADPCM_BLOCK_FRAMES - 1) / MU_ADPCM_BLOCK_FRAMES;
+     size_t const bytes_n = blocks_n * channels_n * MU_ADPCM_BLOCK_BYTES;
+     uint8_t *blocks = calloc(bytes_n + 1, 1);
+     if (!blocks) return MU_FALSE;
+
+     // every channel is one continuous stream, its state written ahead
+     // of each block
+     for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+          struct Mu_AdpcmState state = { 0 };
+          for (size_t block_i = 0; block_i < blocks_n; ++block_i) {
+               uint8_t *stream = blocks + (block_i * channels_n + channel_i) * MU_ADPCM_BLOCK_BYTES;
+               stream[0] = (uint8_t)(state.predictor & 0xff);
+               stream[1] = (uint8_t)((state.predictor >> 8) & 0xff);
+               stream[2] = (uint8_t)state.step_index;
+               uint8_t *nibbles = stream + MU_ADPCM_BLOCK_HEADER_BYTES;
+               for (int frame_i = 0; frame_i < MU_ADPCM_BLOCK_FRAMES; ++frame_i) {
+                    size_t const s_frame_i = block_i * MU_ADPCM_BLOCK_FRAMES + frame_i;
+                    // past the end, holds the last sample
+                    int const sample = s_frame_i < frames_n? mu_adpcm_source_sample(source, s_frame_i * channels_n + channel_i) : state.predictor;
+                    nibbles[frame_i / 2] |= (uint8_t)(mu_adpcm_encode_sample(&state, sample) << (4 * (frame_i & 1)));
+               }
+          }
+     }
+     *adpcm = (struct Mu_AdpcmAudio){
+          .format = {
+               .samples_per_second = source->format.samples_per_second,
+               .channels = channels_n,
+               .bytes_per_sample = sizeof (int16_t),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16,
+          },
+          .frames_n = frames_n,
+          .blocks_n = blocks_n,
+          .blocks = blocks,
+          .bytes_n = bytes_n,
+     };
+     return MU_TRUE;
+}
+
+void Mu_FreeAdpcm(struct Mu_AdpcmAudio *adpcm)
+{
+     free(adpcm->blocks);
+     *adpcm = (struct Mu_AdpcmAudio){ 0 };
+}
+
+#undef MU_ADPCM_INTERNAL
+#undef MU_ADPCM_TARGET_AVX2
+#undef MU_ADPCM_X86
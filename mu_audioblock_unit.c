@@ -0,0 +1,103 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_audioblock.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MU_AUDIOBLOCK_INTERNAL static
+
+enum {
+     MU_AUDIOBLOCK_ALIGNMENT = 64,
+};
+
+Mu_Bool Mu_InitializeAudioBlockAdapter(struct Mu_AudioBlockAdapter *adapter, struct Mu_AudioFormat const *format,
+                                       uint32_t block_frames, Mu_AudioBlockRender render, void *render_context)
+{
+     *adapter = (struct Mu_AudioBlockAdapter){
+          .format = *format,
+          .block_frames = block_frames,
+          .block_read_frames = block_frames, // empty
+          .render = render,
+          .render_context = render_context,
+     };
+     if (block_frames == 0) return MU_TRUE;
+     if (block_frames > MU_MAX_AUDIO_BLOCK_FRAMES || (block_frames & (block_frames - 1)) != 0) return MU_FALSE;
+     size_t const bytes_n = (size_t)block_frames * format->channels * format->bytes_per_sample;
+     adapter->block = aligned_alloc(MU_AUDIOBLOCK_ALIGNMENT, (bytes_n + MU_AUDIOBLOCK_ALIGNMENT - 1) & ~(size_t)(MU_AUDIOBLOCK_ALIGNMENT - 1));
+     if (!adapter->block) return MU_FALSE;
+     memset(adapter->block, 0, bytes_n);
+     return MU_TRUE;
+}
+
+void Mu_FreeAudioBlockAdapter(struct Mu_AudioBlockAdapter *adapter)
+{
+     free(adapter->block);
+     adapter->block = NULL;
+}
+
+void Mu_AdaptAudioBlocks(struct Mu_AudioBlockAdapter *adapter, struct Mu_AudioBuffer *buffer)
+{
+     if (adapter->block_frames == 0) {
+          adapter->render(adapter->render_context, buffer);
+          return;
+     }
+     uint32_t const channels_n = adapter->format.channels;
+     size_t const frame_bytes_n = (size_t)channels_n * adapter->format.bytes_per_sample;
+     uint8_t *d = (uint8_t *)buffer->samples;
+     size_t frames_n = buffer->samples_count / channels_n;
+     while (frames_n > 0) {
+          if (adapter->block_read_frames == adapter->block_frames) {
+               // whole blocks go straight to the device when it is aligned for them
+               if (frames_n >= adapter->block_frames && ((uintptr_t)d & (MU_AUDIOBLOCK_ALIGNMENT - 1)) == 0) {
+                    struct Mu_AudioBuffer block = {
+                         .samples = (int16_t *)d, // or .float_samples, same storage
+                         .samples_count = adapter->block_frames * channels_n,
+                         .format = adapter->format,
+                    };
+                    adapter->render(adapter->render_context, &block);
+                    d += adapter->block_frames * frame_bytes_n;
+                    frames_n -= adapter->block_frames;
+                    continue;
+               }
+               struct Mu_AudioBuffer block = {
+                    .samples = (int16_t *)adapter->block,
+                    .samples_count = adapter->block_frames * channels_n,
+                    .format = adapter->format,
+               };
+               adapter->render(adapter->render_context, &block);
+               adapter->block_read_frames = 0;
+          }
+          size_t const available_n = adapter->block_frames - adapter->block_read_frames;
+          size_t const n = frames_n < available_n? frames_n : available_n;
+          memcpy(d, adapter->block + adapter->block_read_frames * frame_bytes_n, n * frame_bytes_n);
+          adapter->block_read_frames += (uint32_t)n;
+          d += n * frame_bytes_n;
+          frames_n -= n;
+     }
+}
+
+MU_AUDIOBLOCK_INTERNAL
+uint32_t mu_audioblock_gcd(uint32_t a, uint32_t b)
+{
+     while (b) {
+          uint32_t const r = a % b;
+          a = b;
+          b = r;
+     }
+     return a;
+}
+
+// what is left of the block after a period is a multiple of
+// gcd(block, period), from 0 to block - gcd(block, period)
+uint32_t Mu_AudioBlockLatencyFrames(uint32_t block_frames, uint32_t period_frames)
+{
+     if (block_frames == 0) return 0;
+     if (period_frames == 0) return block_frames - 1;
+     return block_frames - mu_audioblock_gcd(block_frames, period_frames);
+}
+
+#undef MU_AUDIOBLOCK_INTERNAL
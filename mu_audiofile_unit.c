@@ -0,0 +1,466 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // nanosleep
+#endif
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_audiofile.h"
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MU_AUDIOFILE_INTERNAL static
+#define MU_AUDIOFILE_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MU_AUDIOFILE_HOST_BIG_ENDIAN 1
+#else
+#define MU_AUDIOFILE_HOST_BIG_ENDIAN 0
+#endif
+
+enum {
+     MU_AUDIOSTREAM_DEFAULT_RING_FRAMES = 8192,
+};
+
+// Containers:
+
+// where and how the samples are stored in a file
+struct Mu_AudioFileLayout
+{
+     struct Mu_AudioFormat format; // of the stored samples
+     Mu_Bool big_endian;
+     uint64_t data_offset;
+     uint64_t data_bytes;
+     uint64_t frames_n;
+};
+
+MU_AUDIOFILE_INTERNAL
+uint32_t mu_audiofile_le32(uint8_t const *p)
+{
+     return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+MU_AUDIOFILE_INTERNAL
+uint16_t mu_audiofile_le16(uint8_t const *p)
+{
+     return (uint16_t)(p[0] | p[1] << 8);
+}
+
+MU_AUDIOFILE_INTERNAL
+uint32_t mu_audiofile_be32(uint8_t const *p)
+{
+     return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+MU_AUDIOFILE_INTERNAL
+uint16_t mu_audiofile_be16(uint8_t const *p)
+{
+     return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+// 80bit IEEE 754 extended precision, as used by the AIFF sample rate
+MU_AUDIOFILE_INTERNAL
+double mu_audiofile_be_extended(uint8_t const *p)
+{
+     int const exponent = (p[0] & 0x7f) << 8 | p[1];
+     uint64_t const mantissa = (uint64_t)mu_audiofile_be32(p + 2) << 32 | mu_audiofile_be32(p + 6);
+     double const x = ldexp((double)mantissa, exponent - 16383 - 63);
+     return p[0] & 0x80? -x : x;
+}
+
+MU_AUDIOFILE_INTERNAL
+Mu_Bool mu_audiofile_set_encoding(struct Mu_AudioFormat *format, Mu_Bool is_float, uint32_t bits_per_sample)
+{
+     if (!is_float && bits_per_sample == 16) format->sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16;
+     else if (is_float && bits_per_sample == 32) format->sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     else return MU_FALSE;
+     format->bytes_per_sample = bits_per_sample / 8;
+     return MU_TRUE;
+}
+
+MU_AUDIOFILE_INTERNAL
+Mu_Bool mu_audiofile_parse_wave(FILE *file, struct Mu_AudioFileLayout *layout)
+{
+     Mu_Bool has_format = MU_FALSE;
+     for (uint8_t chunk[8]; fread(chunk, sizeof chunk, 1, file) == 1; ) {
+          uint32_t const chunk_size = mu_audiofile_le32(chunk + 4);
+          long const chunk_end = ftell(file) + chunk_size + (chunk_size & 1);
+          if (0 == memcmp(chunk, "fmt ", 4)) {
+               uint8_t fmt[26];
+               size_t const fmt_n = chunk_size < sizeof fmt? chunk_size : sizeof fmt;
+               if (fmt_n < 16 || fread(fmt, fmt_n, 1, file) != 1) return MU_FALSE;
+               uint16_t format_tag = mu_audiofile_le16(fmt);
+               if (format_tag == /* WAVE_FORMAT_EXTENSIBLE */ 0xfffe && fmt_n == sizeof fmt) {
+                    format_tag = mu_audiofile_le16(fmt + 24); // first bytes of the sub-format GUID
+               }
+               layout->format.samples_per_second = mu_audiofile_le32(fmt + 4);
+               layout->format.channels = mu_audiofile_le16(fmt + 2);
+               if (format_tag != /* WAVE_FORMAT_PCM */ 1 && format_tag != /* WAVE_FORMAT_IEEE_FLOAT */ 3) return MU_FALSE;
+               if (!mu_audiofile_set_encoding(&layout->format, format_tag == 3, mu_audiofile_le16(fmt + 14))) return MU_FALSE;
+               has_format = MU_TRUE;
+          } else if (0 == memcmp(chunk, "data", 4)) {
+               if (!has_format || layout->format.channels == 0) return MU_FALSE;
+               layout->big_endian = MU_FALSE;
+               layout->data_offset = ftell(file);
+               layout->data_bytes = chunk_size;
+               return MU_TRUE;
+          }
+          fseek(file, chunk_end, SEEK_SET);
+     }
+     return MU_FALSE;
+}
+
+MU_AUDIOFILE_INTERNAL
+Mu_Bool mu_audiofile_parse_aiff(FILE *file, Mu_Bool is_aifc, struct Mu_AudioFileLayout *layout)
+{
+     Mu_Bool has_format = MU_FALSE;
+     for (uint8_t chunk[8]; fread(chunk, sizeof chunk, 1, file) == 1; ) {
+          uint32_t const chunk_size = mu_audiofile_be32(chunk + 4);
+          long const chunk_end = ftell(file) + chunk_size + (chunk_size & 1);
+          if (0 == memcmp(chunk, "COMM", 4)) {
+               uint8_t comm[22];
+               size_t const comm_n = is_aifc? 22 : 18;
+               if (chunk_size < comm_n || fread(comm, comm_n, 1, file) != 1) return MU_FALSE;
+               layout->format.channels = mu_audiofile_be16(comm);
+               layout->format.samples_per_second = (uint32_t)mu_audiofile_be_extended(comm + 8);
+               uint16_t const bits_per_sample = mu_audiofile_be16(comm + 6);
+               Mu_Bool is_float = MU_FALSE;
+               layout->big_endian = MU_TRUE;
+               if (is_aifc) {
+                    if (0 == memcmp(comm + 18, "sowt", 4)) layout->big_endian = MU_FALSE;
+                    else if (0 == memcmp(comm + 18, "fl32", 4) || 0 == memcmp(comm + 18, "FL32", 4)) is_float = MU_TRUE;
+                    else if (0 != memcmp(comm + 18, "NONE", 4)) return MU_FALSE;
+               }
+               if (!mu_audiofile_set_encoding(&layout->format, is_float, bits_per_sample)) return MU_FALSE;
+               has_format = MU_TRUE;
+          } else if (0 == memcmp(chunk, "SSND", 4)) {
+               uint8_t ssnd[8];
+               if (!has_format || layout->format.channels == 0) return MU_FALSE;
+               if (chunk_size < sizeof ssnd || fread(ssnd, sizeof ssnd, 1, file) != 1) return MU_FALSE;
+               uint32_t const offset = mu_audiofile_be32(ssnd);
+               if (offset > chunk_size - sizeof ssnd) return MU_FALSE;
+               layout->data_offset = ftell(file) + offset;
+               layout->data_bytes = chunk_size - sizeof ssnd - offset;
+               return MU_TRUE;
+          }
+          fseek(file, chunk_end, SEEK_SET);
+     }
+     return MU_FALSE;
+}
+
+/*
+ * Reads the header of `file`, which is left at the first sample.
+ */
+MU_AUDIOFILE_INTERNAL
+Mu_Bool mu_audiofile_parse(FILE *file, struct Mu_AudioFileLayout *layout)
+{
+     *layout = (struct Mu_AudioFileLayout){ 0 };
+     uint8_t header[12];
+     if (fread(header, sizeof header, 1, file) != 1) return MU_FALSE;
+     Mu_Bool parsed = MU_FALSE;
+     if (0 == memcmp(header, "RIFF", 4) && 0 == memcmp(header + 8, "WAVE", 4)) {
+          parsed = mu_audiofile_parse_wave(file, layout);
+     } else if (0 == memcmp(header, "FORM", 4) && 0 == memcmp(header + 8, "AIFF", 4)) {
+          parsed = mu_audiofile_parse_aiff(file, MU_FALSE, layout);
+     } else if (0 == memcmp(header, "FORM", 4) && 0 == memcmp(header + 8, "AIFC", 4)) {
+          parsed = mu_audiofile_parse_aiff(file, MU_TRUE, layout);
+     }
+     if (!parsed) return MU_FALSE;
+     // truncated files
+     if (0 != fseek(file, 0, SEEK_END)) return MU_FALSE;
+     long const file_size = ftell(file);
+     if (file_size < 0 || (uint64_t)file_size < layout->data_offset) return MU_FALSE;
+     if (layout->data_bytes > file_size - layout->data_offset) layout->data_bytes = file_size - layout->data_offset;
+     layout->frames_n = layout->data_bytes / (layout->format.channels * layout->format.bytes_per_sample);
+     layout->data_bytes = layout->frames_n * layout->format.channels * layout->format.bytes_per_sample;
+     return 0 == fseek(file, layout->data_offset, SEEK_SET);
+}
+
+/*
+ * Converts `samples_n` samples stored as described by `layout` into
+ * `d_sample_format` samples of the host.
+ */
+MU_AUDIOFILE_INTERNAL
+void mu_audiofile_convert(void *d, uint32_t d_sample_format, uint8_t const *s, struct Mu_AudioFileLayout const *layout, size_t samples_n)
+{
+     Mu_Bool const s_is_float = layout->format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     Mu_Bool const d_is_float = d_sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     Mu_Bool const swap = layout->big_endian != MU_AUDIOFILE_HOST_BIG_ENDIAN;
+     if (s_is_float == d_is_float && !swap) {
+          memcpy(d, s, samples_n * layout->format.bytes_per_sample);
+          return;
+     }
+     for (size_t sample_i = 0; sample_i < samples_n; ++sample_i) {
+          float x;
+          int16_t y;
+          if (s_is_float) {
+               uint8_t const *p = s + 4*sample_i;
+               uint32_t const bits = swap? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]
+                    : (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+               memcpy(&x, &bits, sizeof x);
+               y = x >= 1.0f? 32767 : x <= -1.0f? -32768 : (int16_t)(32767.0f*x);
+          } else {
+               uint8_t const *p = s + 2*sample_i;
+               y = (int16_t)(swap? p[0] << 8 | p[1] : p[1] << 8 | p[0]);
+               x = y / 32768.0f;
+          }
+          if (d_is_float) ((float *)d)[sample_i] = x;
+          else ((int16_t *)d)[sample_i] = y;
+     }
+}
+
+// Streams:
+
+struct Mu_AudioStreamDecoder
+{
+     FILE *file;
+     struct Mu_AudioFileLayout layout;
+     uint64_t data_read_bytes;
+     Mu_Bool loop;
+     uint32_t d_sample_format;
+     size_t d_frame_bytes;
+     size_t s_frame_bytes;
+
+     // file reads
+     uint8_t *chunk;
+     size_t chunk_frames;
+     uint64_t idle_nanoseconds; // wait when the ring is full
+
+     // single producer (decoder), single consumer (reader) ring
+     uint8_t *ring;
+     size_t ring_frames; // power of two
+     _Atomic uint64_t write_n; // @shared
+     _Atomic uint64_t read_n; // @shared
+     atomic_bool ended; // @shared: the decoder wrote its last frame
+     atomic_bool quit; // @shared
+
+     pthread_t thread;
+     Mu_Bool thread_started;
+};
+
+/*
+ * Decodes the next frames into the ring.
+ *
+ * @return: frames decoded, 0 when the ring is full or the file has ended
+ */
+MU_AUDIOFILE_INTERNAL
+size_t mu_audiostream_decode(struct Mu_AudioStreamDecoder *decoder)
+{
+     if (atomic_load_explicit(&decoder->ended, memory_order_relaxed)) return 0;
+     uint64_t const write_n = atomic_load_explicit(&decoder->write_n, memory_order_relaxed);
+     uint64_t const read_n = atomic_load_explicit(&decoder->read_n, memory_order_acquire);
+     size_t frames_n = decoder->ring_frames - (size_t)(write_n - read_n);
+     if (frames_n > decoder->chunk_frames) frames_n = decoder->chunk_frames;
+     if (frames_n == 0) return 0;
+
+     if (decoder->data_read_bytes == decoder->layout.data_bytes && decoder->loop && decoder->layout.frames_n) {
+          fseek(decoder->file, decoder->layout.data_offset, SEEK_SET);
+          decoder->data_read_bytes = 0;
+     }
+     uint64_t const remaining_frames_n = (decoder->layout.data_bytes - decoder->data_read_bytes) / decoder->s_frame_bytes;
+     if (frames_n > remaining_frames_n) frames_n = remaining_frames_n;
+     if (frames_n) {
+          frames_n = fread(decoder->chunk, decoder->s_frame_bytes, frames_n, decoder->file);
+     }
+     if (frames_n == 0) {
+          // end of the file (or read error)
+          atomic_store_explicit(&decoder->ended, MU_TRUE, memory_order_release);
+          return 0;
+     }
+     decoder->data_read_bytes += frames_n * decoder->s_frame_bytes;
+
+     size_t const channels = decoder->layout.format.channels;
+     size_t const ring_i = (size_t)write_n & (decoder->ring_frames - 1);
+     size_t const first_n = frames_n < decoder->ring_frames - ring_i? frames_n : decoder->ring_frames - ring_i;
+     mu_audiofile_convert(decoder->ring + ring_i * decoder->d_frame_bytes, decoder->d_sample_format,
+                          decoder->chunk, &decoder->layout, first_n * channels);
+     mu_audiofile_convert(decoder->ring, decoder->d_sample_format,
+                          decoder->chunk + first_n * decoder->s_frame_bytes, &decoder->layout, (frames_n - first_n) * channels);
+     atomic_store_explicit(&decoder->write_n, write_n + frames_n, memory_order_release);
+     return frames_n;
+}
+
+MU_AUDIOFILE_INTERNAL
+void *mu_audiostream_thread(void *arg)
+{
+     struct Mu_AudioStreamDecoder *decoder = arg;
+     while (!atomic_load_explicit(&decoder->quit, memory_order_relaxed)) {
+          if (mu_audiostream_decode(decoder)) continue;
+          if (atomic_load_explicit(&decoder->ended, memory_order_relaxed)) break;
+          struct timespec const idle = {
+               .tv_sec = decoder->idle_nanoseconds / 1000000000ull,
+               .tv_nsec = decoder->idle_nanoseconds % 1000000000ull,
+          };
+          nanosleep(&idle, NULL);
+     }
+     return NULL;
+}
+
+MU_AUDIOFILE_INTERNAL
+void mu_audiostream_free(struct Mu_AudioStreamDecoder *decoder)
+{
+     if (decoder->file) fclose(decoder->file);
+     free(decoder->chunk);
+     free(decoder->ring);
+     free(decoder);
+}
+
+Mu_Bool Mu_OpenAudioStream(const char *filename, struct Mu_AudioFormat format, struct Mu_AudioStream *stream)
+{
+     struct Mu_AudioStreamDecoder *decoder = calloc(1, sizeof *decoder);
+     if (!decoder) return MU_FALSE;
+     decoder->file = fopen(filename, "rb");
+     if (!decoder->file) goto error;
+     if (!mu_audiofile_parse(decoder->file, &decoder->layout)) {
+          MU_AUDIOFILE_TRACEF("ERROR: unsupported audio file %s\n", filename);
+          goto error;
+     }
+
+     struct Mu_AudioFormat const s_format = decoder->layout.format;
+     Mu_Bool const d_is_float = format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     decoder->loop = stream->loop;
+     decoder->d_sample_format = d_is_float? MU_AUDIO_SAMPLE_FORMAT_FLOAT32 : MU_AUDIO_SAMPLE_FORMAT_INT16;
+     decoder->d_frame_bytes = s_format.channels * (d_is_float? sizeof (float) : sizeof (int16_t));
+     decoder->s_frame_bytes = s_format.channels * s_format.bytes_per_sample;
+     decoder->ring_frames = 1;
+     while (decoder->ring_frames < (stream->ring_frames? stream->ring_frames : MU_AUDIOSTREAM_DEFAULT_RING_FRAMES)) {
+          decoder->ring_frames <<= 1;
+     }
+     // refill a quarter of the ring at a time
+     decoder->chunk_frames = decoder->ring_frames >= 4? decoder->ring_frames / 4 : 1;
+     decoder->idle_nanoseconds = 1000000000ull * decoder->chunk_frames / (s_format.samples_per_second? s_format.samples_per_second : 48000) / 2;
+     decoder->ring = malloc(decoder->ring_frames * decoder->d_frame_bytes);
+     decoder->chunk = malloc(decoder->chunk_frames * decoder->s_frame_bytes);
+     if (!decoder->ring || !decoder->chunk) goto error;
+     atomic_init(&decoder->write_n, 0);
+     atomic_init(&decoder->read_n, 0);
+     atomic_init(&decoder->ended, MU_FALSE);
+     atomic_init(&decoder->quit, MU_FALSE);
+
+     while (mu_audiostream_decode(decoder)) {}
+     if (!atomic_load(&decoder->ended)) {
+          if (0 != pthread_create(&decoder->thread, NULL, mu_audiostream_thread, decoder)) goto error;
+          decoder->thread_started = MU_TRUE;
+     }
+
+     stream->format = s_format;
+     stream->format.sample_format = decoder->d_sample_format;
+     stream->format.bytes_per_sample = d_is_float? sizeof (float) : sizeof (int16_t);
+     stream->frames_n = decoder->layout.frames_n;
+     stream->frames_read_n = 0;
+     stream->underruns_n = 0;
+     stream->ended = MU_FALSE;
+     stream->decoder = decoder;
+     return MU_TRUE;
+error:
+     mu_audiostream_free(decoder);
+     return MU_FALSE;
+}
+
+size_t Mu_ReadAudioStream(struct Mu_AudioStream *stream, void *frames, size_t frames_n)
+{
+     struct Mu_AudioStreamDecoder *decoder = stream->decoder;
+     if (!decoder || stream->ended) return 0;
+     // `ended` is read first: once set, `write_n` is final
+     Mu_Bool const ended = atomic_load_explicit(&decoder->ended, memory_order_acquire);
+     uint64_t const write_n = atomic_load_explicit(&decoder->write_n, memory_order_acquire);
+     uint64_t const read_n = atomic_load_explicit(&decoder->read_n, memory_order_relaxed);
+     size_t const available_n = (size_t)(write_n - read_n);
+     size_t const n = frames_n < available_n? frames_n : available_n;
+
+     size_t const ring_i = (size_t)read_n & (decoder->ring_frames - 1);
+     size_t const first_n = n < decoder->ring_frames - ring_i? n : decoder->ring_frames - ring_i;
+     memcpy(frames, decoder->ring + ring_i * decoder->d_frame_bytes, first_n * decoder->d_frame_bytes);
+     memcpy((uint8_t *)frames + first_n * decoder->d_frame_bytes, decoder->ring, (n - first_n) * decoder->d_frame_bytes);
+     atomic_store_explicit(&decoder->read_n, read_n + n, memory_order_release);
+
+     stream->frames_read_n += n;
+     if (ended && n == available_n) stream->ended = MU_TRUE;
+     else if (n < frames_n) stream->underruns_n++;
+     return n;
+}
+
+void Mu_CloseAudioStream(struct Mu_AudioStream *stream)
+{
+     struct Mu_AudioStreamDecoder *decoder = stream->decoder;
+     if (!decoder) return;
+     atomic_store(&decoder->quit, MU_TRUE);
+     if (decoder->thread_started) pthread_join(decoder->thread, NULL);
+     mu_audiostream_free(decoder);
+     stream->decoder = NULL;
+}
+
+// Mapped files:
+
+Mu_Bool Mu_MapAudio(const char *filename, struct Mu_AudioFormat format, struct Mu_MappedAudio *audio)
+{
+     FILE *file = fopen(filename, "rb");
+     if (!file) return MU_FALSE;
+     struct Mu_AudioFileLayout layout;
+     if (!mu_audiofile_parse(file, &layout)) {
+          MU_AUDIOFILE_TRACEF("ERROR: unsupported audio file %s\n", filename);
+          fclose(file);
+          return MU_FALSE;
+     }
+     // the mapping starts at the page holding the first sample
+     uint64_t const page_size = sysconf(_SC_PAGESIZE);
+     uint64_t const mapping_offset = layout.data_offset & ~(page_size - 1);
+     size_t const mapping_size = layout.data_offset - mapping_offset + layout.data_bytes;
+     void *mapping = mapping_size? mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, fileno(file), mapping_offset) : NULL;
+     fclose(file);
+     if (mapping == MAP_FAILED || !mapping) return MU_FALSE;
+     uint8_t const *s_samples = (uint8_t const *)mapping + (layout.data_offset - mapping_offset);
+
+     Mu_Bool const d_is_float = format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     uint32_t const d_sample_format = d_is_float? MU_AUDIO_SAMPLE_FORMAT_FLOAT32 : MU_AUDIO_SAMPLE_FORMAT_INT16;
+     size_t const d_bytes_per_sample = d_is_float? sizeof (float) : sizeof (int16_t);
+     size_t const samples_n = layout.frames_n * layout.format.channels;
+     *audio = (struct Mu_MappedAudio){
+          .buffer = {
+               .samples_count = samples_n,
+               .format = layout.format,
+          },
+     };
+     audio->buffer.format.sample_format = d_sample_format;
+     audio->buffer.format.bytes_per_sample = d_bytes_per_sample;
+
+     if (layout.format.sample_format == d_sample_format
+         && layout.big_endian == MU_AUDIOFILE_HOST_BIG_ENDIAN
+         && (uintptr_t)s_samples % d_bytes_per_sample == 0) {
+          audio->buffer.samples = (int16_t *)s_samples;
+          audio->zero_copy = MU_TRUE;
+          audio->mapping = mapping;
+          audio->mapping_size = mapping_size;
+          return MU_TRUE;
+     }
+     void *d_samples = malloc(samples_n * d_bytes_per_sample);
+     if (d_samples) mu_audiofile_convert(d_samples, d_sample_format, s_samples, &layout, samples_n);
+     munmap(mapping, mapping_size);
+     if (!d_samples) return MU_FALSE;
+     audio->buffer.samples = d_samples;
+     return MU_TRUE;
+}
+
+void Mu_UnmapAudio(struct Mu_MappedAudio *audio)
+{
+     if (audio->zero_copy) munmap(audio->mapping, audio->mapping_size);
+     else free(audio->buffer.samples);
+     *audio = (struct Mu_MappedAudio){ 0 };
+}
+
+#undef MU_AUDIOFILE_HOST_BIG_ENDIAN
+#undef MU_AUDIOFILE_TRACEF
+#undef MU_AUDIOFILE_INTERNAL
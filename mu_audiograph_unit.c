@@ -0,0 +1,478 @@
+// @language: c11
+// @dependencylist: xxxx_mu, mu_mixer_unit, pthread
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_audiograph.h"
+#include "xxxx_mu_mixer.h"
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h> // semaphores: unnamed POSIX ones are not implemented
+#else
+#include <semaphore.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#define MU_AUDIOGRAPH_PAUSE() _mm_pause()
+#elif defined(__aarch64__)
+#define MU_AUDIOGRAPH_PAUSE() __asm__ __volatile__("yield")
+#else
+#define MU_AUDIOGRAPH_PAUSE() ((void)0)
+#endif
+
+#define MU_AUDIOGRAPH_INTERNAL static
+#define MU_AUDIOGRAPH_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+enum {
+     MU_AUDIOGRAPH_CACHE_LINE = 64,
+     MU_AUDIOGRAPH_DEFAULT_FRAMES_CAPACITY = 1024,
+     // pauses the audio thread spends on the master before it sleeps
+     MU_AUDIOGRAPH_SPINS_N = 1024,
+};
+
+#define MU_AUDIOGRAPH_LIMITER_RELEASE_SECONDS 0.050f
+// of the threshold, where the knee of the limiter starts (-3.5dB)
+#define MU_AUDIOGRAPH_LIMITER_KNEE 0.66f
+
+// Semaphores:
+
+#if defined(__APPLE__)
+typedef semaphore_t Mu_AudioGraphSemaphore;
+
+MU_AUDIOGRAPH_INTERNAL
+Mu_Bool mu_audiograph_semaphore_initialize(Mu_AudioGraphSemaphore *semaphore)
+{
+     return KERN_SUCCESS == semaphore_create(mach_task_self(), semaphore, SYNC_POLICY_FIFO, 0);
+}
+
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_semaphore_destroy(Mu_AudioGraphSemaphore *semaphore)
+{
+     semaphore_destroy(mach_task_self(), *semaphore);
+}
+
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_semaphore_post(Mu_AudioGraphSemaphore *semaphore)
+{
+     semaphore_signal(*semaphore);
+}
+
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_semaphore_wait(Mu_AudioGraphSemaphore *semaphore)
+{
+     while (KERN_ABORTED == semaphore_wait(*semaphore)) {
+     }
+}
+#else
+typedef sem_t Mu_AudioGraphSemaphore;
+
+MU_AUDIOGRAPH_INTERNAL
+Mu_Bool mu_audiograph_semaphore_initialize(Mu_AudioGraphSemaphore *semaphore)
+{
+     return 0 == sem_init(semaphore, 0, 0);
+}
+
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_semaphore_destroy(Mu_AudioGraphSemaphore *semaphore)
+{
+     sem_destroy(semaphore);
+}
+
+// a futex wake, only when a helper sleeps
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_semaphore_post(Mu_AudioGraphSemaphore *semaphore)
+{
+     sem_post(semaphore);
+}
+
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_semaphore_wait(Mu_AudioGraphSemaphore *semaphore)
+{
+     while (0 != sem_wait(semaphore) && errno == EINTR) {
+     }
+}
+#endif
+
+// Schedule:
+
+struct Mu_AudioGraphBusState
+{
+     // @shared: epoch of the last render of the bus, stored once its
+     // samples are final
+     _Alignas(MU_AUDIOGRAPH_CACHE_LINE) atomic_uint rendered_epoch;
+     // @shared: children not rendered yet in the pass in progress, the
+     // thread that takes it to 0 renders the bus
+     atomic_uint children_pending;
+     float *samples; // frames_capacity * MU_MIXER_MAX_CHANNELS
+     float applied_gain;
+     float limiter_envelope;
+};
+
+struct Mu_AudioGraphStep
+{
+     int bus_i;
+     int parent_step_i; // -1 for the master
+     int children_first; // in `children`
+     int children_n;
+};
+
+struct Mu_AudioGraphSession
+{
+     struct Mu_AudioGraph *graph;
+     int steps_n;
+     struct Mu_AudioGraphStep steps[MU_AUDIOGRAPH_MAX_BUSES]; // children before their parent
+     int children[MU_AUDIOGRAPH_MAX_BUSES];
+     int leaves_n;
+     int leaves[MU_AUDIOGRAPH_MAX_BUSES]; // steps without children, claimed in order
+     struct Mu_AudioGraphBusState buses[MU_AUDIOGRAPH_MAX_BUSES];
+     float *samples;
+
+     // of the pass in progress, written before `claim`
+     size_t frames_n;
+     struct Mu_AudioFormat format; // float samples of the buses
+     float limiter_release;        // envelope multiplier per frame
+     uint32_t limiter_samples_per_second;
+     uint32_t epoch;
+
+     // @shared: epoch << 32 | next leaf to render. The epoch tells the
+     // helpers which pass a step they take belongs to
+     _Alignas(MU_AUDIOGRAPH_CACHE_LINE) atomic_uint_fast64_t claim;
+     atomic_bool quit; // @shared
+
+     Mu_AudioGraphSemaphore wake;
+     Mu_AudioGraphSemaphore done; // posted once the master is rendered
+     Mu_Bool wake_initialized;
+     Mu_Bool done_initialized;
+     int helpers_n;
+     pthread_t helpers[MU_AUDIOGRAPH_MAX_THREADS];
+};
+
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_render_step(struct Mu_AudioGraphSession *session, int step_i, uint32_t epoch)
+{
+     struct Mu_AudioGraphStep const *step = &session->steps[step_i];
+     struct Mu_AudioGraphBus const *bus = &session->graph->buses[step->bus_i];
+     struct Mu_AudioGraphBusState *state = &session->buses[step->bus_i];
+     size_t const frames_n = session->frames_n;
+     int const channels_n = session->format.channels;
+     size_t const samples_n = frames_n * channels_n;
+     float *samples = state->samples;
+
+     memset(samples, 0, samples_n * sizeof *samples);
+     if (bus->voices && bus->voices_n > 0) {
+          struct Mu_AudioBuffer buffer = { .float_samples = samples, .samples_count = samples_n, .format = session->format };
+          Mu_Mix(&buffer, bus->voices, bus->voices_n);
+     }
+     for (int child_i = 0; child_i < step->children_n; ++child_i) {
+          struct Mu_AudioGraphBusState const *child = &session->buses[session->children[step->children_first + child_i]];
+          float const *child_samples = child->samples;
+          for (size_t i = 0; i < samples_n; ++i) samples[i] += child_samples[i];
+     }
+
+     float const gain = bus->gain;
+     if (gain != state->applied_gain) {
+          float const gain_step = (gain - state->applied_gain) / frames_n;
+          for (size_t frame_i = 0; frame_i < frames_n; ++frame_i) {
+               float const frame_gain = state->applied_gain + gain_step * (frame_i + 1);
+               for (int c = 0; c < channels_n; ++c) samples[frame_i * channels_n + c] *= frame_gain;
+          }
+          state->applied_gain = gain;
+     } else if (gain != 1.0f) {
+          for (size_t i = 0; i < samples_n; ++i) samples[i] *= gain;
+     }
+
+     if (bus->limiter_threshold > 0.0f) {
+          // Peak envelope with an instant attack, through a soft knee:
+          // above `knee`, levels are bent towards the threshold along a
+          // tanh, which they approach without reaching. On a rising edge
+          // this shapes the wave like a soft clipper instead of cutting
+          // its top flat, and the gain then recovers with the envelope.
+          float const threshold = bus->limiter_threshold, release = session->limiter_release;
+          float const knee = MU_AUDIOGRAPH_LIMITER_KNEE * threshold, knee_range = threshold - knee;
+          float envelope = state->limiter_envelope;
+          for (size_t frame_i = 0; frame_i < frames_n; ++frame_i) {
+               float *frame = samples + frame_i * channels_n;
+               float peak = 0.0f;
+               for (int c = 0; c < channels_n; ++c) peak = fabsf(frame[c]) > peak? fabsf(frame[c]) : peak;
+               envelope = peak > envelope? peak : envelope * release;
+               if (envelope > knee) {
+                    float const level = knee + knee_range * tanhf((envelope - knee) / knee_range);
+                    float const limiter_gain = level / envelope;
+                    for (int c = 0; c < channels_n; ++c) frame[c] *= limiter_gain;
+               }
+          }
+          state->limiter_envelope = envelope;
+     }
+     atomic_store_explicit(&state->rendered_epoch, epoch, memory_order_release);
+}
+
+// renders `step_i`, then its parent when it was the last of its
+// children, and so on up: no thread ever waits for a bus that another
+// one is rendering
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_render_up(struct Mu_AudioGraphSession *session, int step_i, uint32_t epoch)
+{
+     for (;;) {
+          mu_audiograph_render_step(session, step_i, epoch);
+          int const parent_step_i = session->steps[step_i].parent_step_i;
+          if (parent_step_i < 0) {
+               mu_audiograph_semaphore_post(&session->done);
+               return;
+          }
+          // acq_rel: the parent's renderer sees the samples of all its children
+          struct Mu_AudioGraphBusState *parent = &session->buses[session->steps[parent_step_i].bus_i];
+          if (atomic_fetch_sub_explicit(&parent->children_pending, 1, memory_order_acq_rel) != 1) return;
+          step_i = parent_step_i;
+     }
+}
+
+// takes the next leaf until none is left, on the audio thread and on
+// the helpers
+MU_AUDIOGRAPH_INTERNAL
+void mu_audiograph_work(struct Mu_AudioGraphSession *session)
+{
+     for (;;) {
+          uint_fast64_t const claim = atomic_fetch_add_explicit(&session->claim, 1, memory_order_acq_rel);
+          uint32_t const leaf_i = (uint32_t)claim;
+          if (leaf_i >= (uint32_t)session->leaves_n) return;
+          mu_audiograph_render_up(session, session->leaves[leaf_i], (uint32_t)(claim >> 32));
+     }
+}
+
+MU_AUDIOGRAPH_INTERNAL
+void *mu_audiograph_helper_main(void *argument)
+{
+     struct Mu_AudioGraphSession *session = argument;
+     for (;;) {
+          mu_audiograph_semaphore_wait(&session->wake);
+          if (atomic_load(&session->quit)) break;
+          mu_audiograph_work(session);
+     }
+     return NULL;
+}
+
+MU_AUDIOGRAPH_INTERNAL
+Mu_Bool mu_audiograph_compile(struct Mu_AudioGraph const *graph, struct Mu_AudioGraphSession *session)
+{
+     int const buses_n = graph->buses_n;
+     if (buses_n < 1 || buses_n > MU_AUDIOGRAPH_MAX_BUSES) return MU_FALSE;
+     // depth below the master: parents are shallower than their children
+     int depths[MU_AUDIOGRAPH_MAX_BUSES];
+     int max_depth = 0;
+     for (int bus_i = 0; bus_i < buses_n; ++bus_i) {
+          int depth = 0;
+          for (int i = bus_i; i != MU_AUDIOGRAPH_MASTER; i = graph->buses[i].parent, ++depth) {
+               int const parent = graph->buses[i].parent;
+               if (parent < 0 || parent >= buses_n || parent == i || depth >= buses_n) return MU_FALSE; // cycle
+          }
+          depths[bus_i] = depth;
+          if (depth > max_depth) max_depth = depth;
+     }
+     session->steps_n = 0;
+     session->leaves_n = 0;
+     int children_n = 0;
+     int bus_steps[MU_AUDIOGRAPH_MAX_BUSES];
+     for (int depth = max_depth; depth >= 0; --depth) {
+          for (int bus_i = 0; bus_i < buses_n; ++bus_i) {
+               if (depths[bus_i] != depth) continue;
+               bus_steps[bus_i] = session->steps_n;
+               struct Mu_AudioGraphStep *step = &session->steps[session->steps_n++];
+               *step = (struct Mu_AudioGraphStep){ .bus_i = bus_i, .children_first = children_n };
+               for (int child_i = 1; child_i < buses_n; ++child_i) {
+                    if (child_i != bus_i && graph->buses[child_i].parent == bus_i) session->children[children_n++] = child_i;
+               }
+               step->children_n = children_n - step->children_first;
+               if (step->children_n == 0) session->leaves[session->leaves_n++] = session->steps_n - 1;
+          }
+     }
+     // parents come after their children, so every step is numbered by now
+     for (int step_i = 0; step_i < session->steps_n; ++step_i) {
+          struct Mu_AudioGraphStep *step = &session->steps[step_i];
+          step->parent_step_i = step->bus_i == MU_AUDIOGRAPH_MASTER? -1 : bus_steps[graph->buses[step->bus_i].parent];
+     }
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_AudioGraphInitialize(struct Mu_AudioGraph *graph)
+{
+     graph->session = NULL;
+     graph->realtime = MU_FALSE;
+     graph->serial_renders_n = 0;
+     graph->parallel_renders_n = 0;
+     if (graph->frames_capacity <= 0) graph->frames_capacity = MU_AUDIOGRAPH_DEFAULT_FRAMES_CAPACITY;
+     if (graph->parallel_min_voices <= 0) graph->parallel_min_voices = MU_AUDIOGRAPH_PARALLEL_MIN_VOICES;
+     int threads_n = graph->threads_n;
+     if (threads_n <= 0) {
+          long const cores_n = sysconf(_SC_NPROCESSORS_ONLN);
+          threads_n = cores_n > 0? (int)cores_n : 1;
+     }
+     if (threads_n > MU_AUDIOGRAPH_MAX_THREADS) threads_n = MU_AUDIOGRAPH_MAX_THREADS;
+
+     size_t const session_size = (sizeof (struct Mu_AudioGraphSession) + MU_AUDIOGRAPH_CACHE_LINE - 1) & ~(size_t)(MU_AUDIOGRAPH_CACHE_LINE - 1);
+     struct Mu_AudioGraphSession *session = aligned_alloc(MU_AUDIOGRAPH_CACHE_LINE, session_size);
+     if (!session) return MU_FALSE;
+     memset(session, 0, sizeof *session);
+     session->graph = graph;
+     size_t const bus_samples_n = (size_t)graph->frames_capacity * MU_MIXER_MAX_CHANNELS;
+     session->samples = malloc(graph->buses_n * bus_samples_n * sizeof *session->samples);
+     if (!session->samples || !mu_audiograph_compile(graph, session)) {
+          free(session->samples);
+          free(session);
+          return MU_FALSE;
+     }
+     for (int bus_i = 0; bus_i < graph->buses_n; ++bus_i) {
+          struct Mu_AudioGraphBusState *state = &session->buses[bus_i];
+          atomic_init(&state->rendered_epoch, 0);
+          atomic_init(&state->children_pending, 0);
+          state->samples = session->samples + bus_i * bus_samples_n;
+          state->applied_gain = graph->buses[bus_i].gain;
+     }
+     atomic_init(&session->claim, 0);
+     atomic_init(&session->quit, MU_FALSE);
+     graph->session = session;
+     graph->threads_n = 1;
+     if (threads_n == 1 || session->steps_n == 1) return MU_TRUE;
+
+     session->wake_initialized = mu_audiograph_semaphore_initialize(&session->wake);
+     session->done_initialized = mu_audiograph_semaphore_initialize(&session->done);
+     if (!session->wake_initialized || !session->done_initialized) {
+          Mu_AudioGraphClose(graph);
+          return MU_FALSE;
+     }
+     long const cores_n = sysconf(_SC_NPROCESSORS_ONLN);
+     for (int helper_i = 0; helper_i < threads_n - 1; ++helper_i) {
+          // same class as the audio thread, see mu_headless_unit.c. The
+          // audio thread must not wait on threads it can preempt, so
+          // without real-time priority the graph is rendered serially
+          pthread_attr_t attr;
+          pthread_attr_init(&attr);
+          pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+          pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+          struct sched_param param = { .sched_priority = sched_get_priority_max(SCHED_FIFO) - 1 };
+          pthread_attr_setschedparam(&attr, &param);
+          pthread_t *thread = &session->helpers[helper_i];
+          int const status = pthread_create(thread, &attr, mu_audiograph_helper_main, session);
+          pthread_attr_destroy(&attr);
+          if (status != 0) {
+               MU_AUDIOGRAPH_TRACEF("could not start audio graph helper %d with real-time priority, using %d\n", helper_i, session->helpers_n);
+               break;
+          }
+          ++session->helpers_n;
+#if defined(__linux__)
+          pthread_setname_np(*thread, "mu audio helper");
+          // the last cores, away from the main thread's
+          if (cores_n > 1) {
+               cpu_set_t cpus;
+               CPU_ZERO(&cpus);
+               CPU_SET((int)(cores_n - 1 - helper_i % cores_n), &cpus);
+               pthread_setaffinity_np(*thread, sizeof cpus, &cpus);
+          }
+#else
+          (void)cores_n; // no affinity API on macOS
+#endif
+     }
+     graph->threads_n = 1 + session->helpers_n;
+     graph->realtime = session->helpers_n > 0;
+     return MU_TRUE;
+}
+
+void Mu_AudioGraphClose(struct Mu_AudioGraph *graph)
+{
+     struct Mu_AudioGraphSession *session = graph->session;
+     if (!session) return;
+     atomic_store(&session->quit, MU_TRUE);
+     for (int helper_i = 0; helper_i < session->helpers_n; ++helper_i) mu_audiograph_semaphore_post(&session->wake);
+     for (int helper_i = 0; helper_i < session->helpers_n; ++helper_i) pthread_join(session->helpers[helper_i], NULL);
+     if (session->wake_initialized) mu_audiograph_semaphore_destroy(&session->wake);
+     if (session->done_initialized) mu_audiograph_semaphore_destroy(&session->done);
+     free(session->samples);
+     free(session);
+     graph->session = NULL;
+}
+
+void Mu_AudioGraphRender(struct Mu_AudioGraph *graph, struct Mu_AudioBuffer *dest)
+{
+     struct Mu_AudioGraphSession *session = graph->session;
+     struct Mu_AudioFormat const d_format = dest->format;
+     memset(dest->samples, 0, dest->samples_count * d_format.bytes_per_sample);
+     if (!session || d_format.channels == 0 || d_format.channels > MU_MIXER_MAX_CHANNELS) return;
+
+     session->format = (struct Mu_AudioFormat){
+          .samples_per_second = d_format.samples_per_second,
+          .channels = d_format.channels,
+          .bytes_per_sample = sizeof (float),
+          .sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32,
+     };
+     if (session->limiter_samples_per_second != d_format.samples_per_second && d_format.samples_per_second > 0) {
+          session->limiter_samples_per_second = d_format.samples_per_second;
+          session->limiter_release = expf(-1.0f / (MU_AUDIOGRAPH_LIMITER_RELEASE_SECONDS * d_format.samples_per_second));
+     }
+     int voices_n = 0;
+     for (int bus_i = 0; bus_i < graph->buses_n; ++bus_i) voices_n += graph->buses[bus_i].voices? graph->buses[bus_i].voices_n : 0;
+     Mu_Bool const parallel = graph->realtime && session->helpers_n > 0 && voices_n >= graph->parallel_min_voices;
+     if (parallel) ++graph->parallel_renders_n;
+     else ++graph->serial_renders_n;
+
+     struct Mu_AudioGraphBusState const *master = &session->buses[MU_AUDIOGRAPH_MASTER];
+     size_t const d_frames_n = dest->samples_count / d_format.channels;
+     for (size_t frame_i = 0; frame_i < d_frames_n; frame_i += session->frames_n) {
+          size_t const capacity = (size_t)graph->frames_capacity;
+          session->frames_n = d_frames_n - frame_i < capacity? d_frames_n - frame_i : capacity;
+          if (++session->epoch == 0) ++session->epoch;
+          uint32_t const epoch = session->epoch;
+          if (parallel) {
+               // the previous pass is over, every counter is back to 0
+               for (int step_i = 0; step_i < session->steps_n; ++step_i) {
+                    struct Mu_AudioGraphStep const *step = &session->steps[step_i];
+                    atomic_store_explicit(&session->buses[step->bus_i].children_pending, (unsigned)step->children_n, memory_order_relaxed);
+               }
+               // publishes the voices and the pass to the helpers
+               atomic_store_explicit(&session->claim, (uint_fast64_t)epoch << 32, memory_order_release);
+               for (int helper_i = 0; helper_i < session->helpers_n; ++helper_i) mu_audiograph_semaphore_post(&session->wake);
+               mu_audiograph_work(session);
+               // the master is often done by now, else sleep rather than
+               // hold a core a helper may need. `done` is posted once a pass
+               for (int spin_i = 0; spin_i < MU_AUDIOGRAPH_SPINS_N; ++spin_i) {
+                    if (atomic_load_explicit(&master->rendered_epoch, memory_order_acquire) == epoch) break;
+                    MU_AUDIOGRAPH_PAUSE();
+               }
+               mu_audiograph_semaphore_wait(&session->done);
+          } else {
+               for (int step_i = 0; step_i < session->steps_n; ++step_i) mu_audiograph_render_step(session, step_i, epoch);
+          }
+
+          struct Mu_AudioBuffer master_buffer = {
+               .float_samples = master->samples,
+               .samples_count = session->frames_n * d_format.channels,
+               .format = session->format,
+          };
+          struct Mu_AudioBuffer d_block = *dest;
+          d_block.samples = (int16_t *)((uint8_t *)dest->samples + frame_i * d_format.channels * d_format.bytes_per_sample);
+          d_block.samples_count = master_buffer.samples_count;
+          Mu_Mix(&d_block, &(struct Mu_MixerVoice){ .source = &master_buffer, .gain = 1.0f }, 1);
+     }
+}
+
+#undef MU_AUDIOGRAPH_LIMITER_KNEE
+#undef MU_AUDIOGRAPH_LIMITER_RELEASE_SECONDS
+#undef MU_AUDIOGRAPH_TRACEF
+#undef MU_AUDIOGRAPH_INTERNAL
+#undef MU_AUDIOGRAPH_PAUSE
@@ -0,0 +1,200 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+#endif
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_fiber.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MU_FIBER_INTERNAL static
+
+// local symbols of this unit, defined in assembly
+#if defined(__APPLE__)
+#define MU_FIBER_FUNCTION_BEGIN(name) "_" #name ":\n"
+#define MU_FIBER_FUNCTION_END(name) ""
+#else
+#define MU_FIBER_FUNCTION_BEGIN(name) ".type " #name ", %function\n" #name ":\n"
+#define MU_FIBER_FUNCTION_END(name) ".size " #name ", .-" #name "\n"
+#endif
+
+// Context switch:
+//
+// `mu_fiber_switch_stacks(&from->stack_pointer, to->stack_pointer)`
+// pushes the callee-saved registers, stores the stack pointer, loads
+// the other one and pops its registers. The caller-saved ones were
+// already spilled by the compiler around the call.
+//
+// `mu_fiber_start` is where a new fiber "returns" to on its first
+// switch, with the function and its context in callee-saved registers.
+
+void mu_fiber_switch_stacks(void **from_stack_pointer, void *to_stack_pointer);
+void mu_fiber_start(void);
+
+#if defined(__x86_64__)
+// System V: rbx, rbp, r12-r15, plus the control bits of mxcsr and of
+// the x87 FPU. Frame, from the stack pointer up:
+//   mxcsr (4), x87 control word (2), padding (2),
+//   r15, r14, r13, r12, rbx, rbp, return address
+enum {
+     MU_FIBER_FRAME_WORDS = 8,
+     MU_FIBER_FRAME_R13 = 3,
+     MU_FIBER_FRAME_R12 = 4,
+     MU_FIBER_FRAME_RETURN = 7,
+};
+
+__asm__(
+     ".text\n"
+     ".p2align 4\n"
+     MU_FIBER_FUNCTION_BEGIN(mu_fiber_switch_stacks)
+     "     pushq %rbp\n"
+     "     pushq %rbx\n"
+     "     pushq %r12\n"
+     "     pushq %r13\n"
+     "     pushq %r14\n"
+     "     pushq %r15\n"
+     "     subq $8, %rsp\n"
+     "     stmxcsr (%rsp)\n"
+     "     fnstcw 4(%rsp)\n"
+     "     movq %rsp, (%rdi)\n"
+     "     movq %rsi, %rsp\n"
+     "     ldmxcsr (%rsp)\n"
+     "     fldcw 4(%rsp)\n"
+     "     addq $8, %rsp\n"
+     "     popq %r15\n"
+     "     popq %r14\n"
+     "     popq %r13\n"
+     "     popq %r12\n"
+     "     popq %rbx\n"
+     "     popq %rbp\n"
+     "     ret\n"
+     MU_FIBER_FUNCTION_END(mu_fiber_switch_stacks)
+     ".p2align 4\n"
+     MU_FIBER_FUNCTION_BEGIN(mu_fiber_start)
+     "     movq %r12, %rdi\n"
+     "     callq *%r13\n"
+     "     ud2\n" // the function returned
+     MU_FIBER_FUNCTION_END(mu_fiber_start)
+);
+
+MU_FIBER_INTERNAL
+void *mu_fiber_initial_stack_pointer(uint8_t *stack_top, Mu_FiberFunction function, void *context)
+{
+     // the return address sits 8 bytes above a 16 bytes boundary, so
+     // that `mu_fiber_start` calls `function` with an aligned stack
+     uintptr_t *frame = (uintptr_t *)((uintptr_t)stack_top & ~(uintptr_t)15) - 2 - MU_FIBER_FRAME_WORDS;
+     memset(frame, 0, (MU_FIBER_FRAME_WORDS + 2) * sizeof *frame);
+     uint32_t const mxcsr = 0x1f80; // all exceptions masked, round to nearest
+     uint16_t const x87_control_word = 0x037f;
+     memcpy(frame, &mxcsr, sizeof mxcsr);
+     memcpy((uint8_t *)frame + 4, &x87_control_word, sizeof x87_control_word);
+     frame[MU_FIBER_FRAME_R12] = (uintptr_t)context;
+     frame[MU_FIBER_FRAME_R13] = (uintptr_t)function;
+     frame[MU_FIBER_FRAME_RETURN] = (uintptr_t)mu_fiber_start;
+     return frame;
+}
+
+#elif defined(__aarch64__)
+// AAPCS64: x19-x28, the frame pointer x29, the link register x30 and
+// the low halves of v8-v15. Frame, from the stack pointer up:
+//   x19 ... x28, x29, x30, d8 ... d15
+enum {
+     MU_FIBER_FRAME_WORDS = 20,
+     MU_FIBER_FRAME_X19 = 0,
+     MU_FIBER_FRAME_X20 = 1,
+     MU_FIBER_FRAME_X30 = 11,
+};
+
+__asm__(
+     ".text\n"
+     ".p2align 4\n"
+     MU_FIBER_FUNCTION_BEGIN(mu_fiber_switch_stacks)
+     "     sub sp, sp, #160\n"
+     "     stp x19, x20, [sp, #0]\n"
+     "     stp x21, x22, [sp, #16]\n"
+     "     stp x23, x24, [sp, #32]\n"
+     "     stp x25, x26, [sp, #48]\n"
+     "     stp x27, x28, [sp, #64]\n"
+     "     stp x29, x30, [sp, #80]\n"
+     "     stp d8, d9, [sp, #96]\n"
+     "     stp d10, d11, [sp, #112]\n"
+     "     stp d12, d13, [sp, #128]\n"
+     "     stp d14, d15, [sp, #144]\n"
+     "     mov x2, sp\n"
+     "     str x2, [x0]\n"
+     "     mov sp, x1\n"
+     "     ldp x19, x20, [sp, #0]\n"
+     "     ldp x21, x22, [sp, #16]\n"
+     "     ldp x23, x24, [sp, #32]\n"
+     "     ldp x25, x26, [sp, #48]\n"
+     "     ldp x27, x28, [sp, #64]\n"
+     "     ldp x29, x30, [sp, #80]\n"
+     "     ldp d8, d9, [sp, #96]\n"
+     "     ldp d10, d11, [sp, #112]\n"
+     "     ldp d12, d13, [sp, #128]\n"
+     "     ldp d14, d15, [sp, #144]\n"
+     "     add sp, sp, #160\n"
+     "     ret\n"
+     MU_FIBER_FUNCTION_END(mu_fiber_switch_stacks)
+     ".p2align 4\n"
+     MU_FIBER_FUNCTION_BEGIN(mu_fiber_start)
+     "     mov x0, x19\n"
+     "     blr x20\n"
+     "     brk #0\n" // the function returned
+     MU_FIBER_FUNCTION_END(mu_fiber_start)
+);
+
+MU_FIBER_INTERNAL
+void *mu_fiber_initial_stack_pointer(uint8_t *stack_top, Mu_FiberFunction function, void *context)
+{
+     uintptr_t *frame = (uintptr_t *)((uintptr_t)stack_top & ~(uintptr_t)15) - MU_FIBER_FRAME_WORDS;
+     memset(frame, 0, MU_FIBER_FRAME_WORDS * sizeof *frame);
+     frame[MU_FIBER_FRAME_X19] = (uintptr_t)context;
+     frame[MU_FIBER_FRAME_X20] = (uintptr_t)function;
+     frame[MU_FIBER_FRAME_X30] = (uintptr_t)mu_fiber_start;
+     return frame;
+}
+
+#else
+#error "Error: no fiber context switch for this architecture (x86-64 and AArch64 only)"
+#endif
+
+Mu_Bool Mu_InitializeFiber(struct Mu_Fiber *fiber, size_t stack_size, Mu_FiberFunction function, void *context)
+{
+     *fiber = (struct Mu_Fiber){ 0 };
+     size_t const page_size = (size_t)sysconf(_SC_PAGESIZE);
+     stack_size = (stack_size + page_size - 1) & ~(page_size - 1);
+     size_t const mapping_size = page_size + stack_size;
+     void *mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     if (mapping == MAP_FAILED) return MU_FALSE;
+     // stacks grow down: the guard page is the lowest one
+     if (mprotect(mapping, page_size, PROT_NONE) != 0) {
+          munmap(mapping, mapping_size);
+          return MU_FALSE;
+     }
+     fiber->mapping = mapping;
+     fiber->mapping_size = mapping_size;
+     fiber->stack_pointer = mu_fiber_initial_stack_pointer(fiber->mapping + mapping_size, function, context);
+     return MU_TRUE;
+}
+
+void Mu_FreeFiber(struct Mu_Fiber *fiber)
+{
+     if (fiber->mapping) munmap(fiber->mapping, fiber->mapping_size);
+     *fiber = (struct Mu_Fiber){ 0 };
+}
+
+void Mu_SwitchFiber(struct Mu_Fiber *from, struct Mu_Fiber *to)
+{
+     mu_fiber_switch_stacks(&from->stack_pointer, to->stack_pointer);
+}
+
+#undef MU_FIBER_FUNCTION_END
+#undef MU_FIBER_FUNCTION_BEGIN
+#undef MU_FIBER_INTERNAL
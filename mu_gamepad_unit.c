@@ -0,0 +1,560 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_gamepad.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MU_GAMEPAD_INTERNAL static
+#define MU_GAMEPAD_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+// in the order of MU_GAMEPAD_*_BUTTON
+#define MU_GAMEPAD_DIGITAL_BUTTONS_XENUM \
+     X(a_button)			 \
+     X(b_button)			 \
+     X(x_button)			 \
+     X(y_button)			 \
+     X(left_shoulder_button)		 \
+     X(right_shoulder_button)		 \
+     X(up_button)			 \
+     X(down_button)			 \
+     X(left_button)			 \
+     X(right_button)			 \
+     X(left_thumb_button)		 \
+     X(right_thumb_button)		 \
+     X(back_button)			 \
+     X(start_button)
+
+#define MU_GAMEPAD_ANALOG_BUTTONS_XENUM \
+     X(left_trigger) \
+     X(right_trigger)
+
+#define MU_GAMEPAD_STICKS_XENUM \
+     X(left_thumb_stick) \
+     X(right_thumb_stick)
+
+enum {
+     MU_GAMEPAD_BINDING_DIGITAL,
+     MU_GAMEPAD_BINDING_ANALOG,
+     MU_GAMEPAD_BINDING_STICK_X,
+     MU_GAMEPAD_BINDING_STICK_Y,
+};
+
+// Linux gamepad API, from <linux/input-event-codes.h>
+enum {
+     MU_EVDEV_BTN_SOUTH = 0x130,
+     MU_EVDEV_BTN_EAST = 0x131,
+     MU_EVDEV_BTN_NORTH = 0x133,
+     MU_EVDEV_BTN_WEST = 0x134,
+     MU_EVDEV_BTN_TL = 0x136,
+     MU_EVDEV_BTN_TR = 0x137,
+     MU_EVDEV_BTN_SELECT = 0x13a,
+     MU_EVDEV_BTN_START = 0x13b,
+     MU_EVDEV_BTN_THUMBL = 0x13d,
+     MU_EVDEV_BTN_THUMBR = 0x13e,
+     MU_EVDEV_ABS_X = 0x00,
+     MU_EVDEV_ABS_Y = 0x01,
+     MU_EVDEV_ABS_Z = 0x02,
+     MU_EVDEV_ABS_RX = 0x03,
+     MU_EVDEV_ABS_RY = 0x04,
+     MU_EVDEV_ABS_RZ = 0x05,
+     MU_EVDEV_ABS_HAT0X = 0x10,
+     MU_EVDEV_ABS_HAT0Y = 0x11,
+     MU_EVDEV_EV_KEY = 0x01,
+     MU_EVDEV_EV_ABS = 0x03,
+};
+
+MU_GAMEPAD_INTERNAL
+size_t const mu_gamepad_digital_button_offsets[] = {
+#define X(button_name) offsetof(struct Mu_Gamepad, button_name),
+     MU_GAMEPAD_DIGITAL_BUTTONS_XENUM
+#undef X
+};
+
+MU_GAMEPAD_INTERNAL
+size_t const mu_gamepad_analog_button_offsets[] = {
+#define X(analog_button_name) offsetof(struct Mu_Gamepad, analog_button_name),
+     MU_GAMEPAD_ANALOG_BUTTONS_XENUM
+#undef X
+};
+
+MU_GAMEPAD_INTERNAL
+size_t const mu_gamepad_stick_offsets[] = {
+#define X(stick_name) offsetof(struct Mu_Gamepad, stick_name),
+     MU_GAMEPAD_STICKS_XENUM
+#undef X
+};
+
+MU_GAMEPAD_INTERNAL
+struct Mu_DigitalButton *mu_gamepad_digital_button(struct Mu_Gamepad *gamepad, int button_i)
+{
+     return (struct Mu_DigitalButton *)((uint8_t *)gamepad + mu_gamepad_digital_button_offsets[button_i]);
+}
+
+MU_GAMEPAD_INTERNAL
+struct Mu_AnalogButton *mu_gamepad_analog_button(struct Mu_Gamepad *gamepad, int analog_button_i)
+{
+     return (struct Mu_AnalogButton *)((uint8_t *)gamepad + mu_gamepad_analog_button_offsets[analog_button_i]);
+}
+
+MU_GAMEPAD_INTERNAL
+struct Mu_Stick *mu_gamepad_stick(struct Mu_Gamepad *gamepad, int stick_i)
+{
+     return (struct Mu_Stick *)((uint8_t *)gamepad + mu_gamepad_stick_offsets[stick_i]);
+}
+
+// Section: Input events
+
+// keeps `events` sorted by time, dropping the newest when full
+MU_GAMEPAD_INTERNAL
+void mu_gamepad_event_push(struct Mu_InputEvents *events, struct Mu_InputEvent event)
+{
+     if (events->events_n == MU_MAX_INPUT_EVENTS) {
+          events->dropped_n++;
+          return;
+     }
+     int event_i = events->events_n++;
+     for (; event_i > 0 && events->events[event_i - 1].ticks > event.ticks; --event_i) {
+          events->events[event_i] = events->events[event_i - 1];
+     }
+     events->events[event_i] = event;
+}
+
+MU_GAMEPAD_INTERNAL
+void mu_gamepad_update_button(struct Mu_GamepadSlot *slot, int button_i, Mu_Bool is_down, uint64_t ticks)
+{
+     struct Mu_DigitalButton *button = mu_gamepad_digital_button(&slot->gamepad, button_i);
+     if (button->down == is_down) return;
+     button->down = is_down;
+     button->pressed |= is_down;
+     button->released |= !is_down;
+     if (button->half_transition_count != UINT8_MAX) button->half_transition_count++;
+     if (slot->events.enabled) {
+          mu_gamepad_event_push(&slot->events, (struct Mu_InputEvent){
+                    .ticks = ticks, .button = (uint16_t)button_i, .device = slot->device, .down = is_down });
+     }
+}
+
+MU_GAMEPAD_INTERNAL
+float mu_gamepad_clamp(float x, float min, float max)
+{
+     return x < min? min : x > max? max : x;
+}
+
+// Section: Dispatch tables
+
+MU_GAMEPAD_INTERNAL
+Mu_Bool mu_gamepad_address_less(struct Mu_HIDAddress a, struct Mu_HIDAddress b)
+{
+     return a.usage_page < b.usage_page || (a.usage_page == b.usage_page && a.usage < b.usage);
+}
+
+// appends the binding of `address`, unless it is unused
+MU_GAMEPAD_INTERNAL
+void mu_gamepad_bind(struct Mu_HIDAddress *addresses, struct Mu_GamepadBinding *bindings, int *bindings_n,
+                     struct Mu_HIDAddress address, struct Mu_GamepadBinding binding)
+{
+     if (address.usage_page == 0 && address.usage == 0) return;
+     if (address.usage >= MU_GAMEPAD_DISPATCH_USAGES) {
+          MU_GAMEPAD_TRACEF("ignoring usage %#x of page %#x\n", address.usage, address.usage_page);
+          return;
+     }
+     if (binding.range == 0.0f) binding.range = 1.0f;
+     addresses[*bindings_n] = address;
+     bindings[(*bindings_n)++] = binding;
+}
+
+Mu_Bool Mu_CompileGamepadMapping(struct Mu_Gamepad_HID_Mapping const *mapping, struct Mu_GamepadDispatch *dispatch)
+{
+     struct Mu_Gamepad_HID_Mapping_DigitalButton const *digital_buttons[] = {
+#define X(button_name) &mapping->button_name,
+          MU_GAMEPAD_DIGITAL_BUTTONS_XENUM
+#undef X
+     };
+     struct Mu_Gamepad_HID_Mapping_AnalogButton const *analog_buttons[] = {
+#define X(analog_button_name) &mapping->analog_button_name,
+          MU_GAMEPAD_ANALOG_BUTTONS_XENUM
+#undef X
+     };
+     struct Mu_Gamepad_HID_Mapping_Stick const *sticks[] = {
+#define X(stick_name) &mapping->stick_name,
+          MU_GAMEPAD_STICKS_XENUM
+#undef X
+     };
+     _Static_assert(sizeof digital_buttons / sizeof *digital_buttons + sizeof analog_buttons / sizeof *analog_buttons
+                    + 2 * sizeof sticks / sizeof *sticks <= MU_GAMEPAD_DISPATCH_BINDINGS, "dispatch too small for a mapping");
+     struct Mu_HIDAddress addresses[MU_GAMEPAD_DISPATCH_BINDINGS];
+     struct Mu_GamepadBinding bindings[MU_GAMEPAD_DISPATCH_BINDINGS];
+     int bindings_n = 0;
+
+     memset(dispatch, 0, sizeof *dispatch);
+
+     for (int button_i = 0; button_i < (int)(sizeof digital_buttons / sizeof *digital_buttons); ++button_i) {
+          struct Mu_Gamepad_HID_Mapping_DigitalButton const *button = digital_buttons[button_i];
+          if (button->states_n < 0 || button->states_n > MU_HID_MAPPING_MAX_STATES) return MU_FALSE;
+          struct Mu_GamepadBinding binding = {
+               .kind = MU_GAMEPAD_BINDING_DIGITAL, .target = (uint8_t)button_i, .states_n = (uint8_t)button->states_n,
+          };
+          for (int state_i = 0; state_i < button->states_n; ++state_i) binding.states[state_i] = (int8_t)button->states[state_i];
+          mu_gamepad_bind(addresses, bindings, &bindings_n, button->address, binding);
+     }
+     for (int analog_button_i = 0; analog_button_i < (int)(sizeof analog_buttons / sizeof *analog_buttons); ++analog_button_i) {
+          struct Mu_Gamepad_HID_Mapping_AnalogButton const *button = analog_buttons[analog_button_i];
+          mu_gamepad_bind(addresses, bindings, &bindings_n, button->address, (struct Mu_GamepadBinding){
+                    .kind = MU_GAMEPAD_BINDING_ANALOG, .target = (uint8_t)analog_button_i,
+                    .min = button->xmin, .range = button->xmax - button->xmin });
+     }
+     for (int stick_i = 0; stick_i < (int)(sizeof sticks / sizeof *sticks); ++stick_i) {
+          struct Mu_Gamepad_HID_Mapping_Stick const *stick = sticks[stick_i];
+          mu_gamepad_bind(addresses, bindings, &bindings_n, stick->x_address, (struct Mu_GamepadBinding){
+                    .kind = MU_GAMEPAD_BINDING_STICK_X, .target = (uint8_t)stick_i,
+                    .min = stick->xmin, .range = stick->xmax - stick->xmin });
+          mu_gamepad_bind(addresses, bindings, &bindings_n, stick->y_address, (struct Mu_GamepadBinding){
+                    .kind = MU_GAMEPAD_BINDING_STICK_Y, .target = (uint8_t)stick_i,
+                    .min = stick->ymin, .range = stick->ymax - stick->ymin });
+     }
+
+     // sort by address, so that the bindings of one element are contiguous
+     for (int binding_i = 1; binding_i < bindings_n; ++binding_i) {
+          struct Mu_HIDAddress const address = addresses[binding_i];
+          struct Mu_GamepadBinding const binding = bindings[binding_i];
+          int insert_i = binding_i;
+          for (; insert_i > 0 && mu_gamepad_address_less(address, addresses[insert_i - 1]); --insert_i) {
+               addresses[insert_i] = addresses[insert_i - 1];
+               bindings[insert_i] = bindings[insert_i - 1];
+          }
+          addresses[insert_i] = address;
+          bindings[insert_i] = binding;
+     }
+
+     for (int binding_i = 0; binding_i < bindings_n; ++binding_i) {
+          struct Mu_HIDAddress const address = addresses[binding_i];
+          struct Mu_GamepadBinding const binding = bindings[binding_i];
+          int page_i = 0;
+          while (page_i < dispatch->pages_n && dispatch->pages[page_i] != address.usage_page) ++page_i;
+          if (page_i == dispatch->pages_n) {
+               if (dispatch->pages_n == MU_GAMEPAD_DISPATCH_PAGES) {
+                    MU_GAMEPAD_TRACEF("ERROR: gamepad mapping uses more than %d usage pages\n", MU_GAMEPAD_DISPATCH_PAGES);
+                    return MU_FALSE;
+               }
+               dispatch->pages[dispatch->pages_n++] = address.usage_page;
+          }
+          if (dispatch->count[page_i][address.usage] == 0) dispatch->first[page_i][address.usage] = (uint8_t)binding_i;
+          dispatch->count[page_i][address.usage]++;
+          dispatch->bindings[dispatch->bindings_n++] = binding;
+     }
+     return MU_TRUE;
+}
+
+// Section: Decoding
+
+MU_GAMEPAD_INTERNAL
+void mu_gamepad_apply_binding(struct Mu_GamepadSlot *slot, struct Mu_GamepadBinding const *binding, int32_t value, uint64_t ticks)
+{
+     float const x = ((float)value - binding->min) / binding->range;
+     switch (binding->kind) {
+     case MU_GAMEPAD_BINDING_DIGITAL: {
+          Mu_Bool is_down = binding->states_n == 0 && value != 0;
+          for (int state_i = 0; state_i < binding->states_n; ++state_i) {
+               is_down |= binding->states[state_i] == value;
+          }
+          mu_gamepad_update_button(slot, binding->target, is_down, ticks);
+     } break;
+     case MU_GAMEPAD_BINDING_ANALOG:
+          mu_gamepad_analog_button(&slot->gamepad, binding->target)->value = mu_gamepad_clamp(x, 0.0f, 1.0f);
+          break;
+     case MU_GAMEPAD_BINDING_STICK_X:
+          mu_gamepad_stick(&slot->gamepad, binding->target)->x = mu_gamepad_clamp(2.0f * (x - 0.5f), -1.0f, 1.0f);
+          break;
+     case MU_GAMEPAD_BINDING_STICK_Y:
+          mu_gamepad_stick(&slot->gamepad, binding->target)->y = mu_gamepad_clamp(2.0f * (x - 0.5f), -1.0f, 1.0f);
+          break;
+     }
+}
+
+void Mu_DecodeGamepadValue(struct Mu_GamepadSlot *slot, uint16_t usage_page, uint16_t usage, int32_t value, uint64_t ticks)
+{
+     struct Mu_GamepadDispatch const *dispatch = &slot->dispatch;
+     if (usage >= MU_GAMEPAD_DISPATCH_USAGES) return;
+     int page_i = 0;
+     while (page_i < dispatch->pages_n && dispatch->pages[page_i] != usage_page) ++page_i;
+     if (page_i == dispatch->pages_n) return;
+     int const first = dispatch->first[page_i][usage];
+     int const count = dispatch->count[page_i][usage];
+     for (int binding_i = first; binding_i < first + count; ++binding_i) {
+          mu_gamepad_apply_binding(slot, &dispatch->bindings[binding_i], value, ticks);
+     }
+}
+
+Mu_Bool Mu_DecodeDS4Report(struct Mu_GamepadSlot *slot, uint8_t const *report, size_t report_n, uint64_t ticks)
+{
+     // bluetooth reports have two more bytes before the same layout
+     size_t offset;
+     if (report_n >= 10 && report[0] == 0x01) offset = 1;
+     else if (report_n >= 12 && report[0] == 0x11) offset = 3;
+     else return MU_FALSE;
+     uint8_t const *r = report + offset;
+
+     // [0..3]: sticks, y pointing down
+     struct Mu_Gamepad * const gamepad = &slot->gamepad;
+     gamepad->left_thumb_stick.x = (r[0] - 127.5f) / 127.5f;
+     gamepad->left_thumb_stick.y = (127.5f - r[1]) / 127.5f;
+     gamepad->right_thumb_stick.x = (r[2] - 127.5f) / 127.5f;
+     gamepad->right_thumb_stick.y = (127.5f - r[3]) / 127.5f;
+
+     // [4]: hat switch (0: up, clockwise, 8: released), square, cross, circle, triangle
+     int const hat = r[4] & 0x0f;
+     mu_gamepad_update_button(slot, MU_GAMEPAD_UP_BUTTON, hat == 7 || hat == 0 || hat == 1, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_RIGHT_BUTTON, hat >= 1 && hat <= 3, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_DOWN_BUTTON, hat >= 3 && hat <= 5, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_LEFT_BUTTON, hat >= 5 && hat <= 7, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_X_BUTTON, (r[4] & 0x10) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_A_BUTTON, (r[4] & 0x20) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_B_BUTTON, (r[4] & 0x40) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_Y_BUTTON, (r[4] & 0x80) != 0, ticks);
+
+     // [5]: L1, R1, L2, R2, share, options, L3, R3
+     mu_gamepad_update_button(slot, MU_GAMEPAD_LEFT_SHOULDER_BUTTON, (r[5] & 0x01) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_RIGHT_SHOULDER_BUTTON, (r[5] & 0x02) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_BACK_BUTTON, (r[5] & 0x10) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_START_BUTTON, (r[5] & 0x20) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_LEFT_THUMB_BUTTON, (r[5] & 0x40) != 0, ticks);
+     mu_gamepad_update_button(slot, MU_GAMEPAD_RIGHT_THUMB_BUTTON, (r[5] & 0x80) != 0, ticks);
+
+     // [6]: PS button and counter, [7..8]: L2, R2
+     gamepad->left_trigger.value = r[7] / 255.0f;
+     gamepad->right_trigger.value = r[8] / 255.0f;
+     return MU_TRUE;
+}
+
+// Section: Publishing
+
+MU_GAMEPAD_INTERNAL
+void mu_gamepad_publish_analog_button(struct Mu_AnalogButton *button, float const value)
+{
+     Mu_Bool is_down = (value >= button->threshold);
+     Mu_Bool was_down = button->down;
+     button->value = value;
+     button->down = is_down;
+     button->pressed = !was_down && is_down;
+     button->released = was_down && !is_down;
+}
+
+MU_GAMEPAD_INTERNAL
+void mu_gamepad_publish_stick(struct Mu_Stick *stick, float x, float y)
+{
+     stick->x = fabsf(x) <= stick->threshold? 0.0f : x;
+     stick->y = fabsf(y) <= stick->threshold? 0.0f : y;
+}
+
+void Mu_DisconnectGamepad(struct Mu_GamepadSlot *slot, uint64_t ticks)
+{
+     int const buttons_n = (int)(sizeof mu_gamepad_digital_button_offsets / sizeof *mu_gamepad_digital_button_offsets);
+     struct Mu_Gamepad gamepad = { 0 };
+     for (int button_i = 0; button_i < buttons_n; ++button_i) {
+          mu_gamepad_update_button(slot, button_i, MU_FALSE, ticks);
+          *mu_gamepad_digital_button(&gamepad, button_i) = *mu_gamepad_digital_button(&slot->gamepad, button_i);
+     }
+     slot->gamepad = gamepad;
+}
+
+void Mu_PublishGamepad(struct Mu_GamepadSlot *slot, struct Mu_Gamepad *gamepad, struct Mu_InputEvents *input_events)
+{
+     gamepad->connected = slot->gamepad.connected;
+#define X(button_name)                                                  \
+     gamepad->button_name = slot->gamepad.button_name;                  \
+     slot->gamepad.button_name = (struct Mu_DigitalButton){ .down = slot->gamepad.button_name.down };
+     MU_GAMEPAD_DIGITAL_BUTTONS_XENUM;
+#undef X
+#define X(analog_button_name) mu_gamepad_publish_analog_button(&gamepad->analog_button_name, slot->gamepad.analog_button_name.value);
+     MU_GAMEPAD_ANALOG_BUTTONS_XENUM;
+#undef X
+#define X(stick_name) mu_gamepad_publish_stick(&gamepad->stick_name, slot->gamepad.stick_name.x, slot->gamepad.stick_name.y);
+     MU_GAMEPAD_STICKS_XENUM;
+#undef X
+
+     if (input_events) {
+          for (uint32_t event_i = 0; event_i < slot->events.events_n; ++event_i) {
+               mu_gamepad_event_push(input_events, slot->events.events[event_i]);
+          }
+          input_events->dropped_n += slot->events.dropped_n;
+     }
+     slot->events.events_n = 0;
+     slot->events.dropped_n = 0;
+     slot->events.enabled = input_events && input_events->enabled;
+}
+
+// Section: Linux
+
+void Mu_MakeEvdevGamepadMapping(struct Mu_Gamepad_HID_Mapping *mapping, int32_t const abs_min[MU_EVDEV_ABS_N], int32_t const abs_max[MU_EVDEV_ABS_N])
+{
+#define MU_EVDEV_KEY(code) { .address = { MU_HID_PAGE_EVDEV_KEY, code } }
+#define MU_EVDEV_ABS(code) { MU_HID_PAGE_EVDEV_ABS, code }
+     *mapping = (struct Mu_Gamepad_HID_Mapping){
+          .a_button = MU_EVDEV_KEY(MU_EVDEV_BTN_SOUTH),
+          .b_button = MU_EVDEV_KEY(MU_EVDEV_BTN_EAST),
+          .x_button = MU_EVDEV_KEY(MU_EVDEV_BTN_WEST),
+          .y_button = MU_EVDEV_KEY(MU_EVDEV_BTN_NORTH),
+          .left_shoulder_button = MU_EVDEV_KEY(MU_EVDEV_BTN_TL),
+          .right_shoulder_button = MU_EVDEV_KEY(MU_EVDEV_BTN_TR),
+          .up_button = { .address = MU_EVDEV_ABS(MU_EVDEV_ABS_HAT0Y), .states_n = 1, .states = { -1 } },
+          .down_button = { .address = MU_EVDEV_ABS(MU_EVDEV_ABS_HAT0Y), .states_n = 1, .states = { 1 } },
+          .left_button = { .address = MU_EVDEV_ABS(MU_EVDEV_ABS_HAT0X), .states_n = 1, .states = { -1 } },
+          .right_button = { .address = MU_EVDEV_ABS(MU_EVDEV_ABS_HAT0X), .states_n = 1, .states = { 1 } },
+          .left_thumb_button = MU_EVDEV_KEY(MU_EVDEV_BTN_THUMBL),
+          .right_thumb_button = MU_EVDEV_KEY(MU_EVDEV_BTN_THUMBR),
+          .back_button = MU_EVDEV_KEY(MU_EVDEV_BTN_SELECT),
+          .start_button = MU_EVDEV_KEY(MU_EVDEV_BTN_START),
+          .left_trigger = { MU_EVDEV_ABS(MU_EVDEV_ABS_Z), abs_min[MU_EVDEV_ABS_Z], abs_max[MU_EVDEV_ABS_Z] },
+          .right_trigger = { MU_EVDEV_ABS(MU_EVDEV_ABS_RZ), abs_min[MU_EVDEV_ABS_RZ], abs_max[MU_EVDEV_ABS_RZ] },
+          // y axes point down
+          .left_thumb_stick = {
+               MU_EVDEV_ABS(MU_EVDEV_ABS_X), abs_min[MU_EVDEV_ABS_X], abs_max[MU_EVDEV_ABS_X],
+               MU_EVDEV_ABS(MU_EVDEV_ABS_Y), abs_max[MU_EVDEV_ABS_Y], abs_min[MU_EVDEV_ABS_Y],
+          },
+          .right_thumb_stick = {
+               MU_EVDEV_ABS(MU_EVDEV_ABS_RX), abs_min[MU_EVDEV_ABS_RX], abs_max[MU_EVDEV_ABS_RX],
+               MU_EVDEV_ABS(MU_EVDEV_ABS_RY), abs_max[MU_EVDEV_ABS_RY], abs_min[MU_EVDEV_ABS_RY],
+          },
+     };
+#undef MU_EVDEV_ABS
+#undef MU_EVDEV_KEY
+}
+
+// Section: Fixtures
+
+MU_GAMEPAD_INTERNAL
+Mu_Bool mu_gamepad_fixture_push(struct Mu_GamepadFixture *fixture, size_t *records_capacity, struct Mu_GamepadFixtureRecord const *record)
+{
+     if (fixture->records_n == *records_capacity) {
+          size_t const capacity = *records_capacity? 2 * *records_capacity : 256;
+          struct Mu_GamepadFixtureRecord *records = realloc(fixture->records, capacity * sizeof *records);
+          if (!records) return MU_FALSE;
+          fixture->records = records;
+          *records_capacity = capacity;
+     }
+     fixture->records[fixture->records_n++] = *record;
+     return MU_TRUE;
+}
+
+// bytes as pairs of hex digits, optionally separated by spaces
+MU_GAMEPAD_INTERNAL
+int mu_gamepad_parse_hex(char const *text, uint8_t *bytes, int bytes_capacity)
+{
+     int bytes_n = 0;
+     for (;;) {
+          while (*text == ' ' || *text == '\t') ++text;
+          if (!isxdigit((unsigned char)text[0])) break;
+          if (!isxdigit((unsigned char)text[1]) || bytes_n == bytes_capacity) return -1;
+          char const digits[3] = { text[0], text[1], 0 };
+          bytes[bytes_n++] = (uint8_t)strtoul(digits, NULL, 16);
+          text += 2;
+     }
+     return (*text == 0 || *text == '\n' || *text == '\r' || *text == '#')? bytes_n : -1;
+}
+
+Mu_Bool Mu_LoadGamepadFixture(const char *filename, struct Mu_GamepadFixture *fixture)
+{
+     *fixture = (struct Mu_GamepadFixture){ 0 };
+     FILE *file = fopen(filename, "r");
+     if (!file) {
+          MU_GAMEPAD_TRACEF("ERROR: could not open gamepad fixture '%s'\n", filename);
+          return MU_FALSE;
+     }
+     int32_t abs_min[MU_EVDEV_ABS_N], abs_max[MU_EVDEV_ABS_N];
+     for (int code = 0; code < MU_EVDEV_ABS_N; ++code) {
+          abs_min[code] = -32768;
+          abs_max[code] = 32767;
+     }
+     size_t records_capacity = 0;
+     int line_i = 0;
+     char line[512];
+     Mu_Bool result = MU_TRUE;
+     while (result && fgets(line, sizeof line, file)) {
+          ++line_i;
+          char *comment = strchr(line, '#');
+          if (comment) *comment = 0;
+          char *text = line;
+          while (isspace((unsigned char)*text)) ++text;
+          if (*text == 0) continue;
+
+          struct Mu_GamepadFixtureRecord record = { 0 };
+          unsigned long long nanoseconds;
+          int type, code, value, min, max, consumed_n;
+          if (fixture->kind == 0) {
+               if (0 == strncmp(text, "ds4", 3)) fixture->kind = MU_GAMEPAD_FIXTURE_DS4;
+               else if (0 == strncmp(text, "evdev", 5)) fixture->kind = MU_GAMEPAD_FIXTURE_EVDEV;
+               else result = MU_FALSE;
+          } else if (fixture->kind == MU_GAMEPAD_FIXTURE_EVDEV && 3 == sscanf(text, "abs %i %i %i", &code, &min, &max)) {
+               if (code < 0 || code >= MU_EVDEV_ABS_N) result = MU_FALSE;
+               else abs_min[code] = min, abs_max[code] = max;
+          } else if (fixture->kind == MU_GAMEPAD_FIXTURE_EVDEV && 4 == sscanf(text, "%llu %i %i %i", &nanoseconds, &type, &code, &value)) {
+               // only keys and axes, synchronization events carry nothing
+               if (type != MU_EVDEV_EV_KEY && type != MU_EVDEV_EV_ABS) continue;
+               record.nanoseconds = nanoseconds;
+               record.usage_page = (uint16_t)(0xff00 | type);
+               record.usage = (uint16_t)code;
+               record.value = value;
+               result = mu_gamepad_fixture_push(fixture, &records_capacity, &record);
+          } else if (fixture->kind == MU_GAMEPAD_FIXTURE_DS4 && 1 == sscanf(text, "%llu%n", &nanoseconds, &consumed_n)) {
+               int const report_n = mu_gamepad_parse_hex(text + consumed_n, record.report, MU_GAMEPAD_MAX_REPORT);
+               if (report_n <= 0) {
+                    result = MU_FALSE;
+               } else {
+                    record.nanoseconds = nanoseconds;
+                    record.report_n = (uint8_t)report_n;
+                    result = mu_gamepad_fixture_push(fixture, &records_capacity, &record);
+               }
+          } else {
+               result = MU_FALSE;
+          }
+          if (!result) MU_GAMEPAD_TRACEF("ERROR: %s:%d: invalid gamepad fixture line\n", filename, line_i);
+     }
+     fclose(file);
+     if (result && fixture->kind == 0) {
+          MU_GAMEPAD_TRACEF("ERROR: %s: empty gamepad fixture\n", filename);
+          result = MU_FALSE;
+     }
+     if (!result) {
+          Mu_CloseGamepadFixture(fixture);
+          return MU_FALSE;
+     }
+     if (fixture->kind == MU_GAMEPAD_FIXTURE_EVDEV) Mu_MakeEvdevGamepadMapping(&fixture->mapping, abs_min, abs_max);
+     return MU_TRUE;
+}
+
+void Mu_CloseGamepadFixture(struct Mu_GamepadFixture *fixture)
+{
+     free(fixture->records);
+     *fixture = (struct Mu_GamepadFixture){ 0 };
+}
+
+Mu_Bool Mu_ReplayGamepadFixture(struct Mu_GamepadFixture *fixture, struct Mu_GamepadSlot *slot, uint64_t nanoseconds)
+{
+     if (fixture->kind == MU_GAMEPAD_FIXTURE_EVDEV && slot->dispatch.bindings_n == 0) {
+          if (!Mu_CompileGamepadMapping(&fixture->mapping, &slot->dispatch)) return MU_FALSE;
+     }
+     slot->gamepad.connected = MU_TRUE;
+     for (; fixture->replayed_n < fixture->records_n; ++fixture->replayed_n) {
+          struct Mu_GamepadFixtureRecord const *record = &fixture->records[fixture->replayed_n];
+          if (record->nanoseconds > nanoseconds) break;
+          if (fixture->kind == MU_GAMEPAD_FIXTURE_DS4) {
+               Mu_DecodeDS4Report(slot, record->report, record->report_n, record->nanoseconds);
+          } else {
+               Mu_DecodeGamepadValue(slot, record->usage_page, record->usage, record->value, record->nanoseconds);
+          }
+     }
+     return fixture->replayed_n < fixture->records_n;
+}
+
+#undef MU_GAMEPAD_STICKS_XENUM
+#undef MU_GAMEPAD_ANALOG_BUTTONS_XENUM
+#undef MU_GAMEPAD_DIGITAL_BUTTONS_XENUM
+#undef MU_GAMEPAD_TRACEF
+#undef MU_GAMEPAD_INTERNAL
@@ -0,0 +1,948 @@
+// @language: c11
+// @platform: linux
+// @dependencylist: pthread
+
+// Integration:
+// ------------
+//
+// this file MUST be compiled in its own translation unit, unless you
+// define the preprocessor macro _GNU_SOURCE.
+//
+// A headless implementation of the Mu API: there is no window, no
+// keyboard or mouse and no audio device. Time, window and input are
+// filled from a clock, the audio callback is driven from a
+// (real-time priority if permitted) thread and rendered into a null
+// sink at the negotiated `Mu_AudioFormat`.
+//
+// Gamepads are read from /dev/hidraw* (DUALSHOCK 4) and
+// /dev/input/event* (anything else the kernel knows as a gamepad), when
+// readable. MU_HEADLESS_GAMEPADS=0 in the environment disables them, and
+// MU_HEADLESS_GAMEPAD_FIXTURE=<file> replays a captured gamepad (see
+// xxxx_mu_gamepad.h) as the first one.
+//
+// With `mu.framebuffer.enabled`, Mu_Push writes the framebuffer as a
+// binary PPM to MU_HEADLESS_PPM=<file>, every frame. A path ending with
+// '/' gets one file per frame. Without it, frames stay in memory.
+//
+// This lets one run and measure a client frame loop and its audio
+// callback on build/benchmark hosts without a window server.
+
+// Configuration macros:
+// ---------------------
+#define MU_HEADLESS_CLOCK_VIRTUAL (0x5e1f3c01)
+#define MU_HEADLESS_CLOCK_MONOTONIC (0x2b8d9e44)
+#if defined(MU_HEADLESS_CLOCK)
+#if MU_HEADLESS_CLOCK != MU_HEADLESS_CLOCK_VIRTUAL && MU_HEADLESS_CLOCK != MU_HEADLESS_CLOCK_MONOTONIC
+#error "Unknown MU_HEADLESS_CLOCK, must be either MU_HEADLESS_CLOCK_VIRTUAL or MU_HEADLESS_CLOCK_MONOTONIC"
+#endif
+#else
+// deterministic: every Mu_Pull advances time by exactly one frame
+// period, and the audio thread renders exactly the blocks covering
+// that period before Mu_Pull returns.
+#define MU_HEADLESS_CLOCK MU_HEADLESS_CLOCK_VIRTUAL
+#endif
+
+#if !defined(MU_HEADLESS_VIRTUAL_FRAME_NANOSECONDS)
+#define MU_HEADLESS_VIRTUAL_FRAME_NANOSECONDS (16666667) // 60hz
+#endif
+
+#if !defined(MU_HEADLESS_AUDIO_BLOCK_FRAMES)
+// period of the null sink, unless `mu.audio.device_period_frames` asks for another
+#define MU_HEADLESS_AUDIO_BLOCK_FRAMES (512)
+#endif
+
+#define _GNU_SOURCE
+#include "xxxx_mu.h"
+#include "xxxx_mu_audioblock.h"
+#include "xxxx_mu_gamepad.h"
+#include "xxxx_mu_headless.h"
+#include "xxxx_mu_image.h"
+#include "xxxx_mu_jobs.h"
+#include "xxxx_mu_stats.h"
+#include "xxxx_mu_telemetry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <linux/input.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+#include <stdatomic.h>
+
+#define MU_HEADLESS_INTERNAL static
+#define MU_HEADLESS_TRACEF(...) printf("Mu: " __VA_ARGS__);
+
+enum {
+     MU_DEFAULT_WIDTH = 640,
+     MU_DEFAULT_HEIGHT = 480,
+};
+
+enum {
+     MU_GAMEPAD_DEVICE_NONE,
+     MU_GAMEPAD_DEVICE_FIXTURE,
+     MU_GAMEPAD_DEVICE_HIDRAW_DS4,
+     MU_GAMEPAD_DEVICE_EVDEV,
+     MU_HEADLESS_MAX_HIDRAW = 16,
+     MU_HEADLESS_MAX_EVDEV = 32,
+};
+
+// Where the input of one of `mu->gamepads` comes from
+struct Mu_GamepadDevice
+{
+     int kind; // MU_GAMEPAD_DEVICE_*
+     int fd;
+     struct Mu_GamepadFixture fixture;
+};
+
+// Persistent data-structure holding resources and data that are
+// maintained for the API.
+struct Mu_Session
+{
+     // public resources, as published in the Mu structure.
+     struct Mu_Headless headless_resources;
+
+     uint64_t virtual_ticks;
+     uint64_t initial_ticks; // copy of `mu->time.initial_ticks`, for the audio thread
+     // timings of the frame in progress, recorded by the next Mu_Pull
+     // @clock{CLOCK_MONOTONIC} nanoseconds
+     struct Mu_FrameTimer frame_timer;
+
+     // audio session state
+     struct Mu_Audio audio;
+     pthread_t audio_thread;
+     Mu_Bool audio_thread_started;
+     pthread_mutex_t audio_mutex;
+     pthread_cond_t audio_cond;
+     uint64_t audio_target_frames_n; // @shared(audio_mutex)
+     uint64_t audio_rendered_frames_n; // @shared(audio_mutex)
+     Mu_Bool audio_quit; // @shared(audio_mutex)
+     void *audio_buffer; // a period, 64 bytes aligned
+     uint32_t audio_period_frames;
+     struct Mu_AudioBlockAdapter audio_blocks;
+
+     // `mu->framebuffer.pixels`, rows 64 bytes aligned
+     uint8_t *framebuffer_pixels;
+     size_t framebuffer_capacity;
+     char const *ppm_path;
+
+     // gamepads, in the order of `mu->gamepads`
+     struct Mu_GamepadSlot gamepads[MU_MAX_GAMEPADS];
+     struct Mu_GamepadDevice gamepad_devices[MU_MAX_GAMEPADS];
+     int gamepads_n;
+
+     // also published to `Mu_Headless` by Mu_Pull
+     struct Mu_AudioTelemetry audio_telemetry;
+
+     // frames passed to the callback so far, and when they are heard
+     uint64_t audio_frames_n; // audio thread only
+     atomic_uint audio_clock_sequence; // odd while being written
+     atomic_uint_fast64_t audio_clock_frames_n;
+     atomic_uint_fast64_t audio_clock_output_ticks;
+};
+
+MU_HEADLESS_INTERNAL
+uint64_t mu_monotonic_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+MU_HEADLESS_INTERNAL
+struct Mu_Session* mu_get_session(struct Mu *mu)
+{
+     return (struct Mu_Session*)mu->headless;
+}
+
+// Audio Clock:
+// a sequence lock, written by the audio thread without waiting
+
+MU_HEADLESS_INTERNAL
+void mu_audio_clock_publish(struct Mu_Session *session, uint64_t frames_n, uint64_t output_ticks)
+{
+     unsigned const sequence = atomic_load_explicit(&session->audio_clock_sequence, memory_order_relaxed);
+     atomic_store_explicit(&session->audio_clock_sequence, sequence + 1, memory_order_relaxed);
+     atomic_thread_fence(memory_order_release);
+     atomic_store_explicit(&session->audio_clock_frames_n, frames_n, memory_order_relaxed);
+     atomic_store_explicit(&session->audio_clock_output_ticks, output_ticks, memory_order_relaxed);
+     atomic_store_explicit(&session->audio_clock_sequence, sequence + 2, memory_order_release);
+}
+
+MU_HEADLESS_INTERNAL
+void mu_audio_clock_pull(struct Mu *mu, struct Mu_Session *session)
+{
+     for (;;) {
+          unsigned const sequence = atomic_load_explicit(&session->audio_clock_sequence, memory_order_acquire);
+          uint64_t const frames_n = atomic_load_explicit(&session->audio_clock_frames_n, memory_order_relaxed);
+          uint64_t const output_ticks = atomic_load_explicit(&session->audio_clock_output_ticks, memory_order_relaxed);
+          atomic_thread_fence(memory_order_acquire);
+          if ((sequence & 1) == 0 && sequence == atomic_load_explicit(&session->audio_clock_sequence, memory_order_relaxed)) {
+               mu->audio.clock = (struct Mu_AudioClock){ .frames_n = frames_n, .output_ticks = output_ticks };
+               return;
+          }
+     }
+}
+
+// Mu Audio:
+
+MU_HEADLESS_INTERNAL
+struct Mu_AudioFormat const mu_audio_audioformat = { 48000, 2, sizeof (int16_t) };
+
+MU_HEADLESS_INTERNAL
+void mu_audio_emit_silence(struct Mu_AudioBuffer* buffer)
+{
+     memset(buffer->samples, 0, buffer->samples_count * buffer->format.bytes_per_sample);
+}
+
+MU_HEADLESS_INTERNAL
+void mu_audio_render(void *context, struct Mu_AudioBuffer *block)
+{
+     struct Mu_Session *session = context;
+     session->audio.callback(block);
+}
+
+/*
+ * @param output_ticks: when the block is heard, as `Mu_Time.ticks`
+ */
+MU_HEADLESS_INTERNAL
+void mu_audio_render_block(struct Mu_Session *session, uint64_t output_ticks)
+{
+     mu_audio_clock_publish(session, session->audio_frames_n, output_ticks);
+     struct Mu_AudioBuffer audiobuffer = {
+          .samples = (int16_t*)session->audio_buffer, // or .float_samples, same storage
+          .samples_count = session->audio_period_frames * session->audio.format.channels,
+          .format = session->audio.format,
+     };
+     uint64_t const t0 = mu_monotonic_nanoseconds();
+     Mu_AdaptAudioBlocks(&session->audio_blocks, &audiobuffer);
+     uint64_t const dt = mu_monotonic_nanoseconds() - t0;
+     // null sink: the samples are dropped here
+
+     Mu_RecordAudioCallback(&session->audio_telemetry, session->audio_period_frames, session->audio.format.samples_per_second, dt);
+     session->audio_frames_n += session->audio_period_frames;
+}
+
+MU_HEADLESS_INTERNAL
+void* mu_audio_thread(void *context)
+{
+     struct Mu_Session *session = context;
+     uint64_t const block_frames_n = session->audio_period_frames;
+#if MU_HEADLESS_CLOCK == MU_HEADLESS_CLOCK_VIRTUAL
+     // render exactly as many blocks as needed to cover the virtual
+     // time published by Mu_Pull, then let it know we caught up.
+     pthread_mutex_lock(&session->audio_mutex);
+     for (;;) {
+          while (!session->audio_quit && session->audio_rendered_frames_n >= session->audio_target_frames_n) {
+               pthread_cond_wait(&session->audio_cond, &session->audio_mutex);
+          }
+          if (session->audio_quit) break;
+          uint64_t const rendered_frames_n = session->audio_rendered_frames_n;
+          pthread_mutex_unlock(&session->audio_mutex);
+          // heard at the virtual time it covers
+          mu_audio_render_block(session, rendered_frames_n * 1000000000ull / session->audio.format.samples_per_second - session->initial_ticks);
+          pthread_mutex_lock(&session->audio_mutex);
+          session->audio_rendered_frames_n += block_frames_n;
+          pthread_cond_broadcast(&session->audio_cond);
+     }
+     pthread_mutex_unlock(&session->audio_mutex);
+#else
+     // pace ourselves like a device would, one block per period
+     uint64_t const rate = session->audio.format.samples_per_second;
+     uint64_t const t0 = mu_monotonic_nanoseconds();
+     for (uint64_t block_i = 0;; ++block_i) {
+          pthread_mutex_lock(&session->audio_mutex);
+          Mu_Bool const quit = session->audio_quit;
+          pthread_mutex_unlock(&session->audio_mutex);
+          if (quit) break;
+          uint64_t const deadline = t0 + (block_i + 1) * block_frames_n * 1000000000ull / rate;
+          // heard from the end of the period it is rendered in
+          mu_audio_render_block(session, deadline - session->initial_ticks);
+          // a device would have run out of samples before this block was ready
+          if (mu_monotonic_nanoseconds() > deadline) Mu_AddAudioUnderrun(&session->audio_telemetry);
+          struct timespec const ts = { .tv_sec = deadline / 1000000000ull, .tv_nsec = deadline % 1000000000ull };
+          while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+               continue;
+          }
+     }
+#endif
+     return NULL;
+}
+
+MU_HEADLESS_INTERNAL
+Mu_Bool mu_audio_initialize(struct Mu *mu, struct Mu_Session *session)
+{
+     if (!mu->audio.callback) mu->audio.callback = mu_audio_emit_silence;
+     uint32_t const sample_format = mu->audio.format.sample_format;
+     mu->audio.format = mu_audio_audioformat;
+     if (sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) {
+          mu->audio.format.sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+          mu->audio.format.bytes_per_sample = sizeof (float);
+     }
+     char const *period_frames = getenv("MU_HEADLESS_AUDIO_PERIOD_FRAMES");
+     if (period_frames) mu->audio.device_period_frames = (uint32_t)strtoul(period_frames, NULL, 10);
+     if (!mu->audio.device_period_frames) mu->audio.device_period_frames = MU_HEADLESS_AUDIO_BLOCK_FRAMES;
+     if (mu->audio.device_period_frames > MU_MAX_AUDIO_BLOCK_FRAMES) mu->audio.device_period_frames = MU_MAX_AUDIO_BLOCK_FRAMES;
+     mu->audio.block_latency_frames = Mu_AudioBlockLatencyFrames(mu->audio.block_frames, mu->audio.device_period_frames);
+     session->audio = mu->audio;
+     session->audio_period_frames = mu->audio.device_period_frames;
+     size_t const period_bytes_n = (size_t)session->audio_period_frames * mu->audio.format.channels * mu->audio.format.bytes_per_sample;
+     session->audio_buffer = aligned_alloc(64, (period_bytes_n + 63) & ~(size_t)63);
+     if (!session->audio_buffer) {
+          mu->error = "could not allocate audio buffer";
+          return MU_FALSE;
+     }
+     memset(session->audio_buffer, 0, period_bytes_n);
+     if (!Mu_InitializeAudioBlockAdapter(&session->audio_blocks, &mu->audio.format, mu->audio.block_frames, mu_audio_render, session)) {
+          mu->error = "could not allocate audio blocks, or unsupported block size";
+          return MU_FALSE;
+     }
+     // ask for a real-time class first, which is only permitted with
+     // CAP_SYS_NICE or an rtprio limit, and fall back to a normal thread.
+     pthread_attr_t attr;
+     pthread_attr_init(&attr);
+     pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+     pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+     struct sched_param param = { .sched_priority = sched_get_priority_max(SCHED_FIFO) - 1 };
+     pthread_attr_setschedparam(&attr, &param);
+     int status = pthread_create(&session->audio_thread, &attr, mu_audio_thread, session);
+     pthread_attr_destroy(&attr);
+     session->headless_resources.audio_realtime = status == 0;
+     if (status == EPERM) {
+          MU_HEADLESS_TRACEF("could not get real-time priority for audio thread\n");
+          status = pthread_create(&session->audio_thread, NULL, mu_audio_thread, session);
+     }
+     if (status != 0) {
+          strerror_r(status, mu->error_buffer, MU_MAX_ERROR);
+          mu->error = mu->error_buffer;
+          return MU_FALSE;
+     }
+     pthread_setname_np(session->audio_thread, "mu audio");
+     session->audio_thread_started = MU_TRUE;
+     return MU_TRUE;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_audio_close(struct Mu *mu, struct Mu_Session *session)
+{
+     if (session->audio_thread_started) {
+          pthread_mutex_lock(&session->audio_mutex);
+          session->audio_quit = MU_TRUE;
+          pthread_cond_broadcast(&session->audio_cond);
+          pthread_mutex_unlock(&session->audio_mutex);
+          pthread_join(session->audio_thread, NULL);
+          session->audio_thread_started = MU_FALSE;
+     }
+     free(session->audio_buffer), session->audio_buffer = NULL;
+     Mu_FreeAudioBlockAdapter(&session->audio_blocks);
+}
+
+MU_HEADLESS_INTERNAL
+void mu_audio_publish_counters(struct Mu *mu, struct Mu_Session *session)
+{
+     struct Mu_AudioStats *stats = &mu->audio.stats;
+     Mu_PublishAudioStats(&session->audio_telemetry, stats);
+     struct Mu_Headless *headless = &session->headless_resources;
+     headless->audio_blocks_n = stats->callbacks_n;
+     headless->audio_frames_n = headless->audio_blocks_n * session->audio_period_frames;
+     headless->audio_callback_nanoseconds = stats->callback_nanoseconds;
+     headless->audio_callback_max_nanoseconds = stats->callback_max_nanoseconds;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_audio_pull(struct Mu *mu, struct Mu_Session *session)
+{
+#if MU_HEADLESS_CLOCK == MU_HEADLESS_CLOCK_VIRTUAL
+     // wait for the audio thread to cover the current virtual time
+     uint64_t const target_frames_n = mu->time.nanoseconds * session->audio.format.samples_per_second / 1000000000ull;
+     pthread_mutex_lock(&session->audio_mutex);
+     session->audio_target_frames_n = target_frames_n;
+     pthread_cond_broadcast(&session->audio_cond);
+     while (session->audio_rendered_frames_n < target_frames_n) {
+          pthread_cond_wait(&session->audio_cond, &session->audio_mutex);
+     }
+     pthread_mutex_unlock(&session->audio_mutex);
+#endif
+     mu_audio_publish_counters(mu, session);
+     mu_audio_clock_pull(mu, session);
+}
+
+// Mu Time:
+
+MU_HEADLESS_INTERNAL
+void mu_time_update(struct Mu* mu, struct Mu_Session* session, uint64_t ticks)
+{
+  uint64_t const t0 = mu->time.initial_ticks;
+  uint64_t const tps = mu->time.ticks_per_second;
+  mu->time.delta_ticks = (ticks - t0) - mu->time.ticks;
+  mu->time.ticks = ticks - t0;
+
+  // ticks are nanoseconds
+  mu->time.nanoseconds = mu->time.ticks;
+  mu->time.microseconds = mu->time.nanoseconds / 1000;
+  mu->time.milliseconds = mu->time.microseconds / 1000;
+  mu->time.seconds = (float)mu->time.ticks / (float)tps;
+
+  mu->time.delta_nanoseconds = mu->time.delta_ticks;
+  mu->time.delta_microseconds = mu->time.delta_nanoseconds / 1000;
+  mu->time.delta_milliseconds = mu->time.delta_microseconds / 1000;
+  mu->time.delta_seconds = (float)mu->time.delta_ticks / (float)tps;
+}
+
+MU_HEADLESS_INTERNAL
+uint64_t mu_time_now(struct Mu_Session *session)
+{
+#if MU_HEADLESS_CLOCK == MU_HEADLESS_CLOCK_VIRTUAL
+     return session->virtual_ticks;
+#else
+     return mu_monotonic_nanoseconds();
+#endif
+}
+
+MU_HEADLESS_INTERNAL
+Mu_Bool mu_time_initialize(struct Mu *mu, struct Mu_Session *session)
+{
+     session->virtual_ticks = 0;
+     mu->time.initial_ticks = mu_time_now(session);
+     mu->time.ticks_per_second = 1000000000ull;
+     session->initial_ticks = mu->time.initial_ticks;
+     mu_time_update(mu, session, mu->time.initial_ticks);
+     return MU_TRUE;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_time_pull(struct Mu *mu, struct Mu_Session *session)
+{
+#if MU_HEADLESS_CLOCK == MU_HEADLESS_CLOCK_VIRTUAL
+     if (session->headless_resources.frames_n != 0) {
+          session->virtual_ticks += MU_HEADLESS_VIRTUAL_FRAME_NANOSECONDS;
+     }
+#endif
+     mu_time_update(mu, session, mu_time_now(session));
+}
+
+// Mu Window:
+
+MU_HEADLESS_INTERNAL
+Mu_Bool mu_window_initialize(struct Mu *mu, struct Mu_Session *session)
+{
+#define get_opt(x, x_ifnull) (x)? (x) : (x_ifnull)
+     mu->window.title = get_opt(mu->window.title, "Mu");
+     mu->window.size.x = get_opt(mu->window.size.x, MU_DEFAULT_WIDTH);
+     mu->window.size.y = get_opt(mu->window.size.y, MU_DEFAULT_HEIGHT);
+#undef get_opt
+     return MU_TRUE;
+}
+
+// Mu Framebuffer:
+
+MU_HEADLESS_INTERNAL
+Mu_Bool mu_framebuffer_pull(struct Mu *mu, struct Mu_Session *session)
+{
+     struct Mu_Framebuffer *framebuffer = &mu->framebuffer;
+     if (!framebuffer->enabled) return MU_TRUE;
+     if (framebuffer->pixels && framebuffer->size.x == mu->window.size.x && framebuffer->size.y == mu->window.size.y) return MU_TRUE;
+     int const pitch = (mu->window.size.x * 4 + 63) & ~63;
+     size_t const bytes_n = (size_t)pitch * mu->window.size.y;
+     if (bytes_n > session->framebuffer_capacity) {
+          free(session->framebuffer_pixels);
+          session->framebuffer_pixels = aligned_alloc(64, bytes_n);
+          session->framebuffer_capacity = session->framebuffer_pixels? bytes_n : 0;
+          if (!session->framebuffer_pixels) {
+               *framebuffer = (struct Mu_Framebuffer){ .enabled = MU_TRUE };
+               mu->error = "could not allocate framebuffer";
+               return MU_FALSE;
+          }
+     }
+     memset(session->framebuffer_pixels, 0, bytes_n);
+     framebuffer->pixels = session->framebuffer_pixels;
+     framebuffer->pitch = pitch;
+     framebuffer->size = mu->window.size;
+     return MU_TRUE;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_framebuffer_push(struct Mu *mu, struct Mu_Session *session)
+{
+     struct Mu_Framebuffer const *framebuffer = &mu->framebuffer;
+     if (!framebuffer->enabled || !framebuffer->pixels || !session->ppm_path) return;
+     char path[4096];
+     size_t const path_n = strlen(session->ppm_path);
+     if (path_n > 0 && session->ppm_path[path_n - 1] == '/') {
+          snprintf(path, sizeof path, "%sframe%06llu.ppm", session->ppm_path, (unsigned long long)session->headless_resources.frames_n);
+     } else {
+          snprintf(path, sizeof path, "%s", session->ppm_path);
+     }
+     FILE *file = fopen(path, "wb");
+     if (!file) {
+          MU_HEADLESS_TRACEF("WARNING: could not write '%s', frames will not be dumped\n", path);
+          session->ppm_path = NULL;
+          return;
+     }
+     fprintf(file, "P6\n%d %d\n255\n", framebuffer->size.x, framebuffer->size.y);
+     uint8_t row[3 * 4096];
+     for (int y = 0; y < framebuffer->size.y; ++y) {
+          uint8_t const *pixels = framebuffer->pixels + (size_t)y * framebuffer->pitch;
+          for (int x_begin = 0; x_begin < framebuffer->size.x; x_begin += 4096) {
+               int const x_end = framebuffer->size.x - x_begin < 4096? framebuffer->size.x : x_begin + 4096;
+               for (int x = x_begin; x < x_end; ++x) memcpy(&row[3 * (x - x_begin)], &pixels[4 * x], 3);
+               fwrite(row, 3, x_end - x_begin, file);
+          }
+     }
+     fclose(file);
+}
+
+// Mu Gamepads:
+
+MU_HEADLESS_INTERNAL
+struct Mu_GamepadSlot *mu_gamepad_add(struct Mu *mu, struct Mu_Session *session, int kind, int fd)
+{
+     int const gamepad_i = session->gamepads_n++;
+     struct Mu_GamepadSlot *slot = &session->gamepads[gamepad_i];
+     slot->device = (uint8_t)(MU_INPUT_DEVICE_GAMEPAD + gamepad_i);
+     slot->gamepad.connected = MU_TRUE;
+     slot->events.enabled = mu->input_events.enabled;
+     session->gamepad_devices[gamepad_i] = (struct Mu_GamepadDevice){ .kind = kind, .fd = fd };
+     return slot;
+}
+
+MU_HEADLESS_INTERNAL
+Mu_Bool mu_gamepad_test_bit(unsigned long const *bits, int bit_i)
+{
+     int const long_bits = 8 * sizeof *bits;
+     return (bits[bit_i / long_bits] >> (bit_i % long_bits)) & 1;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_gamepad_open_hidraw_devices(struct Mu *mu, struct Mu_Session *session)
+{
+     for (int device_i = 0; device_i < MU_HEADLESS_MAX_HIDRAW && session->gamepads_n < MU_MAX_GAMEPADS; ++device_i) {
+          char path[32];
+          snprintf(path, sizeof path, "/dev/hidraw%d", device_i);
+          int const fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+          if (fd < 0) continue;
+          struct hidraw_devinfo info;
+          if (ioctl(fd, HIDIOCGRAWINFO, &info) < 0
+              || (uint16_t)info.vendor != MU_DS4_VENDOR_ID
+              || ((uint16_t)info.product != MU_DS4_PRODUCT_ID && (uint16_t)info.product != MU_DS4_V2_PRODUCT_ID)) {
+               close(fd);
+               continue;
+          }
+          MU_HEADLESS_TRACEF("gamepad %d: DUALSHOCK 4 (%s)\n", session->gamepads_n, path);
+          mu_gamepad_add(mu, session, MU_GAMEPAD_DEVICE_HIDRAW_DS4, fd);
+     }
+}
+
+MU_HEADLESS_INTERNAL
+void mu_gamepad_open_evdev_devices(struct Mu *mu, struct Mu_Session *session, Mu_Bool has_ds4)
+{
+     for (int device_i = 0; device_i < MU_HEADLESS_MAX_EVDEV && session->gamepads_n < MU_MAX_GAMEPADS; ++device_i) {
+          char path[32];
+          snprintf(path, sizeof path, "/dev/input/event%d", device_i);
+          int const fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+          if (fd < 0) continue;
+          unsigned long key_bits[KEY_MAX / (8 * sizeof (unsigned long)) + 1] = { 0 };
+          struct input_id id;
+          if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof key_bits), key_bits) < 0
+              || !mu_gamepad_test_bit(key_bits, BTN_GAMEPAD)
+              || ioctl(fd, EVIOCGID, &id) < 0
+              // already read whole reports through hidraw
+              || (has_ds4 && id.vendor == MU_DS4_VENDOR_ID)) {
+               close(fd);
+               continue;
+          }
+          int32_t abs_min[MU_EVDEV_ABS_N], abs_max[MU_EVDEV_ABS_N];
+          for (int code = 0; code < MU_EVDEV_ABS_N; ++code) {
+               struct input_absinfo absinfo = { .minimum = -1, .maximum = 1 };
+               ioctl(fd, EVIOCGABS(code), &absinfo);
+               abs_min[code] = absinfo.minimum;
+               abs_max[code] = absinfo.maximum;
+          }
+          // timestamps from the clock of `mu->time`
+          int clock_id = CLOCK_MONOTONIC;
+          ioctl(fd, EVIOCSCLOCKID, &clock_id);
+
+          struct Mu_Gamepad_HID_Mapping mapping;
+          Mu_MakeEvdevGamepadMapping(&mapping, abs_min, abs_max);
+          MU_HEADLESS_TRACEF("gamepad %d: %04x:%04x (%s)\n", session->gamepads_n, id.vendor, id.product, path);
+          struct Mu_GamepadSlot *slot = mu_gamepad_add(mu, session, MU_GAMEPAD_DEVICE_EVDEV, fd);
+          Mu_CompileGamepadMapping(&mapping, &slot->dispatch);
+     }
+}
+
+MU_HEADLESS_INTERNAL
+Mu_Bool mu_gamepad_initialize(struct Mu *mu, struct Mu_Session *session)
+{
+     for (int gamepad_i = 0; gamepad_i < MU_MAX_GAMEPADS; ++gamepad_i) {
+          struct Mu_Gamepad *gamepad = &mu->gamepads[gamepad_i];
+#define X(threshold) if (gamepad->threshold == 0.0f) gamepad->threshold = mu->gamepad.threshold;
+          X(left_trigger.threshold);
+          X(right_trigger.threshold);
+          X(left_thumb_stick.threshold);
+          X(right_thumb_stick.threshold);
+#undef X
+          session->gamepad_devices[gamepad_i].fd = -1;
+     }
+     char const *fixture_filename = getenv("MU_HEADLESS_GAMEPAD_FIXTURE");
+     if (fixture_filename) {
+          struct Mu_GamepadFixture fixture;
+          if (!Mu_LoadGamepadFixture(fixture_filename, &fixture)) {
+               mu->error = "could not load gamepad fixture";
+               return MU_FALSE;
+          }
+          MU_HEADLESS_TRACEF("gamepad %d: fixture %s\n", session->gamepads_n, fixture_filename);
+          mu_gamepad_add(mu, session, MU_GAMEPAD_DEVICE_FIXTURE, -1);
+          session->gamepad_devices[0].fixture = fixture;
+     }
+     char const *gamepads = getenv("MU_HEADLESS_GAMEPADS");
+     if (!gamepads || 0 != strcmp(gamepads, "0")) {
+          int const first_ds4_i = session->gamepads_n;
+          mu_gamepad_open_hidraw_devices(mu, session);
+          mu_gamepad_open_evdev_devices(mu, session, session->gamepads_n > first_ds4_i);
+     }
+     return MU_TRUE;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_gamepad_disconnect(struct Mu_Session *session, int gamepad_i, uint64_t ticks)
+{
+     struct Mu_GamepadDevice *device = &session->gamepad_devices[gamepad_i];
+     MU_HEADLESS_TRACEF("gamepad %d: disconnected\n", gamepad_i);
+     close(device->fd);
+     device->fd = -1;
+     device->kind = MU_GAMEPAD_DEVICE_NONE;
+     Mu_DisconnectGamepad(&session->gamepads[gamepad_i], ticks);
+}
+
+// reads everything the devices sent since the last frame
+MU_HEADLESS_INTERNAL
+void mu_gamepad_pull(struct Mu *mu, struct Mu_Session *session)
+{
+     for (int gamepad_i = 0; gamepad_i < session->gamepads_n; ++gamepad_i) {
+          struct Mu_GamepadDevice *device = &session->gamepad_devices[gamepad_i];
+          struct Mu_GamepadSlot *slot = &session->gamepads[gamepad_i];
+          if (device->kind == MU_GAMEPAD_DEVICE_FIXTURE) {
+               Mu_ReplayGamepadFixture(&device->fixture, slot, mu->time.ticks);
+          } else if (device->kind == MU_GAMEPAD_DEVICE_HIDRAW_DS4) {
+               // reports carry no time, they are seen at the start of the frame
+               uint8_t report[MU_GAMEPAD_MAX_REPORT];
+               ssize_t report_n;
+               while ((report_n = read(device->fd, report, sizeof report)) > 0) {
+                    Mu_DecodeDS4Report(slot, report, (size_t)report_n, mu->time.ticks);
+               }
+               if (report_n == 0 || (report_n < 0 && errno != EAGAIN && errno != EINTR)) mu_gamepad_disconnect(session, gamepad_i, mu->time.ticks);
+          } else if (device->kind == MU_GAMEPAD_DEVICE_EVDEV) {
+               struct input_event events[64];
+               ssize_t bytes_n;
+               while ((bytes_n = read(device->fd, events, sizeof events)) > 0) {
+                    for (int event_i = 0; event_i < (int)(bytes_n / sizeof *events); ++event_i) {
+                         struct input_event const *event = &events[event_i];
+                         if (event->type != EV_KEY && event->type != EV_ABS) continue;
+#if MU_HEADLESS_CLOCK == MU_HEADLESS_CLOCK_VIRTUAL
+                         uint64_t const ticks = mu->time.ticks;
+#else
+                         uint64_t const event_nanoseconds = (uint64_t)event->input_event_sec * 1000000000ull + (uint64_t)event->input_event_usec * 1000ull;
+                         uint64_t const ticks = event_nanoseconds - mu->time.initial_ticks;
+#endif
+                         Mu_DecodeGamepadValue(slot, (uint16_t)(0xff00 | event->type), event->code, event->value, ticks);
+                    }
+               }
+               if (bytes_n == 0 || (bytes_n < 0 && errno != EAGAIN && errno != EINTR)) mu_gamepad_disconnect(session, gamepad_i, mu->time.ticks);
+          }
+     }
+     // every slot, so that buttons of disconnected pads are released
+     int first_connected_i = -1;
+     for (int gamepad_i = MU_MAX_GAMEPADS - 1; gamepad_i >= 0; --gamepad_i) {
+          Mu_PublishGamepad(&session->gamepads[gamepad_i], &mu->gamepads[gamepad_i], &mu->input_events);
+          if (mu->gamepads[gamepad_i].connected) first_connected_i = gamepad_i;
+     }
+     mu->gamepad = mu->gamepads[first_connected_i >= 0? first_connected_i : 0];
+}
+
+MU_HEADLESS_INTERNAL
+void mu_gamepad_close(struct Mu_Session *session)
+{
+     for (int gamepad_i = 0; gamepad_i < session->gamepads_n; ++gamepad_i) {
+          struct Mu_GamepadDevice *device = &session->gamepad_devices[gamepad_i];
+          if (device->fd >= 0) close(device->fd);
+          Mu_CloseGamepadFixture(&device->fixture);
+     }
+}
+
+// releases what Mu_Initialize acquired, when quitting or when one of
+// its steps failed: each step undoes nothing it did not do
+MU_HEADLESS_INTERNAL
+void mu_session_close(struct Mu *mu, struct Mu_Session *session)
+{
+     mu_audio_close(mu, session);
+     mu_gamepad_close(session);
+     Mu_JobsClose(&mu->jobs);
+     Mu_CloseTelemetry(mu);
+     free(session->framebuffer_pixels);
+     mu->framebuffer.pixels = NULL;
+     pthread_mutex_destroy(&session->audio_mutex);
+     pthread_cond_destroy(&session->audio_cond);
+     mu->headless = NULL;
+     free(session);
+}
+
+Mu_Bool Mu_Initialize(struct Mu *mu)
+{
+     struct Mu_Session *session = calloc(sizeof(struct Mu_Session), 1);
+     if (!session) {
+          mu->error = "could not allocate session";
+          return MU_FALSE;
+     }
+     pthread_mutex_init(&session->audio_mutex, NULL);
+     pthread_cond_init(&session->audio_cond, NULL);
+     char const *frames_limit = getenv("MU_HEADLESS_FRAMES");
+     if (frames_limit) session->headless_resources.frames_limit = strtoull(frames_limit, NULL, 10);
+
+     if (!mu_time_initialize(mu, session)) goto error;
+     Mu_OpenTelemetry(mu);
+     if (!Mu_JobsInitialize(&mu->jobs)) {
+          mu->error = "could not start job workers";
+          goto error;
+     }
+     if (!mu_window_initialize(mu, session)) goto error;
+     session->ppm_path = getenv("MU_HEADLESS_PPM");
+     if (!mu_framebuffer_pull(mu, session)) goto error;
+     if (!mu_gamepad_initialize(mu, session)) goto error;
+     if (!mu_audio_initialize(mu, session)) goto error;
+     mu->initialized = MU_TRUE;
+     mu->headless = &session->headless_resources;
+     return MU_TRUE;
+
+error:
+     // the job workers and the audio thread may already run
+     mu_session_close(mu, session);
+     return MU_FALSE;
+}
+
+MU_HEADLESS_INTERNAL
+void mu_headless_trace_summary(struct Mu_Headless const *headless, struct Mu const *mu)
+{
+     struct Mu_FrameStats const *frame_stats = &mu->frame_stats;
+     uint64_t const frames_n = headless->frames_n? headless->frames_n : 1;
+     uint64_t const blocks_n = headless->audio_blocks_n? headless->audio_blocks_n : 1;
+     MU_HEADLESS_TRACEF("frames: %llu, client avg: %llu ns, max: %llu ns\n",
+                        (unsigned long long)headless->frames_n,
+                        (unsigned long long)(headless->client_nanoseconds / frames_n),
+                        (unsigned long long)headless->client_max_nanoseconds);
+     struct Mu_FrameStageSummary const *frame = &frame_stats->summary[MU_FRAME_STAGE_FRAME];
+     MU_HEADLESS_TRACEF("frame p50: %u ns, p99: %u ns, max: %u ns, missed deadlines: %llu\n",
+                        frame->p50_nanoseconds, frame->p99_nanoseconds, frame->max_nanoseconds,
+                        (unsigned long long)frame_stats->missed_n);
+     MU_HEADLESS_TRACEF("audio periods: %llu (%u frames, blocks of %u, latency %u frames), callback avg: %llu ns, max: %llu ns%s\n",
+                        (unsigned long long)headless->audio_blocks_n, mu->audio.device_period_frames,
+                        mu->audio.block_frames, mu->audio.block_latency_frames,
+                        (unsigned long long)(headless->audio_callback_nanoseconds / blocks_n),
+                        (unsigned long long)headless->audio_callback_max_nanoseconds,
+                        headless->audio_realtime? "" : " (not real-time)");
+     MU_HEADLESS_TRACEF("audio load max: %.1f%%, overruns: %llu, underruns: %llu\n",
+                        mu->audio.stats.load_max_permille / 10.0,
+                        (unsigned long long)mu->audio.stats.overruns_n,
+                        (unsigned long long)mu->audio.stats.underruns_n);
+}
+
+// the last frame, whoever set `mu->quit`: publishes it, and releases
+// everything
+MU_HEADLESS_INTERNAL
+void mu_headless_quit(struct Mu *mu, struct Mu_Session *session)
+{
+     Mu_PublishTelemetry(mu);
+     mu_audio_close(mu, session);
+     mu_audio_publish_counters(mu, session);
+     mu_headless_trace_summary(&session->headless_resources, mu);
+     mu_session_close(mu, session);
+}
+
+Mu_Bool Mu_Pull(struct Mu *mu)
+{
+     if (!mu->initialized) return MU_FALSE;
+     struct Mu_Session* session = mu_get_session(mu);
+     if (!session) return MU_FALSE; // closed by the last frame
+     if (mu->quit) {
+          // set by the program
+          mu_headless_quit(mu, session);
+          return MU_FALSE;
+     }
+     struct Mu_Headless *headless = &session->headless_resources;
+     uint64_t const frame_ticks = mu_monotonic_nanoseconds();
+     Mu_PullFrameStats(&mu->frame_stats, &session->frame_timer, frame_ticks);
+     Mu_JobsPull(&mu->jobs);
+
+     // reset window state
+     mu->window.resized = headless->frames_n == 0;
+
+     // reset mouse state
+     mu->mouse.left_button = (struct Mu_DigitalButton){.down=mu->mouse.left_button.down};
+     mu->mouse.right_button = (struct Mu_DigitalButton){.down=mu->mouse.right_button.down};
+     mu->mouse.delta_wheel = 0;
+     mu->mouse.delta_position = (struct Mu_Int2){0};
+
+     // reset keyboard state
+     for (int key_i = 0; key_i < MU_MAX_KEYS; ++key_i) {
+       mu->keys[key_i] = (struct Mu_DigitalButton){.down=mu->keys[key_i].down};
+     }
+     mu->text[0] = 0;
+     mu->text_length = 0;
+     mu->input_events.events_n = 0;
+     mu->input_events.dropped_n = 0;
+     uint64_t const update_ticks = mu_monotonic_nanoseconds();
+
+     mu_time_pull(mu, session);
+     if (!mu_framebuffer_pull(mu, session)) mu->quit = MU_TRUE;
+     mu_gamepad_pull(mu, session);
+     mu_audio_pull(mu, session);
+
+     if (headless->frames_limit && headless->frames_n >= headless->frames_limit) {
+          mu->quit = MU_TRUE;
+     }
+     if (mu->quit) {
+          mu_headless_quit(mu, session);
+          return MU_FALSE;
+     }
+     Mu_PublishTelemetry(mu);
+     ++headless->frames_n;
+     struct Mu_FrameTimer *frame_timer = &session->frame_timer;
+     frame_timer->pull_ticks = mu_monotonic_nanoseconds();
+     frame_timer->frame_ticks = frame_ticks;
+     frame_timer->events_ticks_n = update_ticks - frame_ticks;
+     frame_timer->update_ticks_n = frame_timer->pull_ticks - update_ticks;
+     return MU_TRUE;
+}
+
+void Mu_Push(struct Mu *mu)
+{
+     if (!mu->initialized || mu->quit) return;
+     struct Mu_Session* session = mu_get_session(mu);
+     if (!session) return;
+     struct Mu_Headless *headless = &session->headless_resources;
+     struct Mu_FrameTimer *frame_timer = &session->frame_timer;
+     frame_timer->push_ticks = mu_monotonic_nanoseconds();
+     uint64_t const client_nanoseconds = frame_timer->push_ticks - frame_timer->pull_ticks;
+     headless->client_nanoseconds += client_nanoseconds;
+     if (client_nanoseconds > headless->client_max_nanoseconds) headless->client_max_nanoseconds = client_nanoseconds;
+     // nothing to swap, besides the dump of the framebuffer
+     mu_framebuffer_push(mu, session);
+     frame_timer->swap_ticks_n = mu_monotonic_nanoseconds() - frame_timer->push_ticks;
+}
+
+Mu_Bool Mu_LoadImage(const char *filename, struct Mu_Image *d_image)
+{
+     // @note: links with mu_image_unit.c
+     d_image->pixels = NULL;
+     return Mu_LoadImages(&filename, 1, d_image, NULL, NULL) == 1;
+}
+
+MU_HEADLESS_INTERNAL
+uint32_t mu_read_le32(uint8_t const *p)
+{
+     return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+MU_HEADLESS_INTERNAL
+uint16_t mu_read_le16(uint8_t const *p)
+{
+     return (uint16_t)(p[0] | p[1] << 8);
+}
+
+Mu_Bool Mu_LoadAudio(const char *filename, struct Mu_AudioBuffer *audio)
+{
+     return Mu_LoadAudioWithFormat(filename, (struct Mu_AudioFormat){ .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16 }, audio);
+}
+
+// RIFF/WAVE, 16bit PCM or 32bit float only
+// @note: samples are read as-is, which assumes a little-endian host
+Mu_Bool Mu_LoadAudioWithFormat(const char *filename, struct Mu_AudioFormat d_format, struct Mu_AudioBuffer *audio)
+{
+     FILE *file = fopen(filename, "rb");
+     if (!file) return MU_FALSE;
+     uint8_t header[12];
+     if (fread(header, sizeof header, 1, file) != 1
+         || memcmp(header, "RIFF", 4) != 0
+         || memcmp(header + 8, "WAVE", 4) != 0) {
+          goto error_with_file_open;
+     }
+     struct Mu_AudioFormat format = {0};
+     for (uint8_t chunk[8]; fread(chunk, sizeof chunk, 1, file) == 1; ) {
+          uint32_t const chunk_size = mu_read_le32(chunk + 4);
+          if (0 == memcmp(chunk, "fmt ", 4)) {
+               uint8_t fmt[16];
+               if (chunk_size < sizeof fmt || fread(fmt, sizeof fmt, 1, file) != 1) goto error_with_file_open;
+               uint16_t const format_tag = mu_read_le16(fmt);
+               uint16_t const bits_per_sample = mu_read_le16(fmt + 14);
+               format = (struct Mu_AudioFormat){
+                    .samples_per_second = mu_read_le32(fmt + 4),
+                    .channels = mu_read_le16(fmt + 2),
+                    .bytes_per_sample = bits_per_sample / 8,
+               };
+               if (format_tag == /* WAVE_FORMAT_PCM */ 1 && bits_per_sample == 16) {
+                    format.sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16;
+               } else if (format_tag == /* WAVE_FORMAT_IEEE_FLOAT */ 3 && bits_per_sample == 32) {
+                    format.sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+               } else {
+                    MU_HEADLESS_TRACEF("ERROR: unsupported wave format in %s\n", filename);
+                    goto error_with_file_open;
+               }
+               fseek(file, (chunk_size - sizeof fmt) + (chunk_size & 1), SEEK_CUR);
+          } else if (0 == memcmp(chunk, "data", 4)) {
+               if (format.channels == 0) goto error_with_file_open;
+               size_t const samples_count = chunk_size / format.bytes_per_sample;
+               Mu_Bool const d_is_float = d_format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+               size_t const d_bytes_per_sample = d_is_float? sizeof (float) : sizeof (int16_t);
+               // room for converting in place, from the end
+               size_t const bytes_per_sample = d_bytes_per_sample > format.bytes_per_sample? d_bytes_per_sample : format.bytes_per_sample;
+               char *samples = malloc(samples_count * bytes_per_sample);
+               char *s_samples = samples + samples_count * (bytes_per_sample - format.bytes_per_sample);
+               if (!samples || fread(s_samples, format.bytes_per_sample, samples_count, file) != samples_count) {
+                    free(samples);
+                    goto error_with_file_open;
+               }
+               fclose(file);
+               if (d_is_float && format.sample_format == MU_AUDIO_SAMPLE_FORMAT_INT16) {
+                    int16_t const *s_sample = (int16_t const*)s_samples;
+                    float *d_sample = (float*)samples;
+                    for (size_t sample_i = 0; sample_i < samples_count; ++sample_i) {
+                         d_sample[sample_i] = s_sample[sample_i] / 32768.0f;
+                    }
+               } else if (!d_is_float && format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) {
+                    float const *s_sample = (float const*)s_samples;
+                    int16_t *d_sample = (int16_t*)samples;
+                    for (size_t sample_i = 0; sample_i < samples_count; ++sample_i) {
+                         float const x = s_sample[sample_i];
+                         d_sample[sample_i] = x >= 1.0f? 32767 : x <= -1.0f? -32768 : (int16_t)(32767.0f*x);
+                    }
+                    samples = realloc(samples, samples_count * d_bytes_per_sample);
+               }
+               if (d_is_float) audio->float_samples = (float*)samples;
+               else audio->samples = (int16_t*)samples;
+               audio->samples_count = samples_count - samples_count % format.channels;
+               audio->format = format;
+               audio->format.bytes_per_sample = d_bytes_per_sample;
+               audio->format.sample_format = d_is_float? MU_AUDIO_SAMPLE_FORMAT_FLOAT32 : MU_AUDIO_SAMPLE_FORMAT_INT16;
+               return MU_TRUE;
+          } else {
+               fseek(file, chunk_size + (chunk_size & 1), SEEK_CUR);
+          }
+     }
+error_with_file_open:
+     fclose(file);
+     return MU_FALSE;
+}
+
+#undef MU_HEADLESS_CLOCK_VIRTUAL
+#undef MU_HEADLESS_CLOCK_MONOTONIC
+#undef MU_HEADLESS_CLOCK
+#undef MU_HEADLESS_INTERNAL
+#undef MU_HEADLESS_TRACEF
@@ -0,0 +1,723 @@
+// @language: c11
+// @dependencylist: xxxx_mu, mu_jobs_unit, pthread
+
+// Configuration macros:
+// ---------------------
+#if !defined(MU_IMAGE_SIMD)
+// SSE2/AVX2 unfiltering on x86, set to 0 for the scalar code only
+#define MU_IMAGE_SIMD (1)
+#endif
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_image.h"
+#include "xxxx_mu_jobs.h"
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if MU_IMAGE_SIMD && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64))
+#define MU_IMAGE_X86 1
+#include <immintrin.h>
+#define MU_IMAGE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MU_IMAGE_X86 0
+#endif
+
+#define MU_IMAGE_INTERNAL static
+
+enum {
+     MU_INFLATE_FAST_BITS = 9,
+};
+
+// Inflate (RFC 1951):
+
+struct Mu_InflateHuffman
+{
+     // (code length << 9 | symbol) of the codes up to MU_INFLATE_FAST_BITS
+     // long, indexed by the next bits of the stream. 0 for longer codes.
+     uint16_t fast[1 << MU_INFLATE_FAST_BITS];
+     uint16_t counts[16]; // codes of each length
+     uint16_t symbols[288]; // by canonical code
+};
+
+struct Mu_Inflate
+{
+     uint8_t const *s;
+     uint8_t const *s_end;
+     uint64_t bits;
+     int bits_n;
+     int overread_n; // bytes read past the end of the input
+
+     uint8_t *d;
+     size_t d_i;
+     size_t d_n;
+};
+
+MU_IMAGE_INTERNAL
+void mu_inflate_refill(struct Mu_Inflate *z)
+{
+     while (z->bits_n <= 56) {
+          if (z->s < z->s_end) z->bits |= (uint64_t)*z->s++ << z->bits_n;
+          else z->overread_n++;
+          z->bits_n += 8;
+     }
+}
+
+MU_IMAGE_INTERNAL
+uint32_t mu_inflate_bits(struct Mu_Inflate *z, int n)
+{
+     if (z->bits_n < n) mu_inflate_refill(z);
+     uint32_t const x = (uint32_t)(z->bits & ((1ull << n) - 1));
+     z->bits >>= n;
+     z->bits_n -= n;
+     return x;
+}
+
+MU_IMAGE_INTERNAL
+Mu_Bool mu_inflate_build(struct Mu_InflateHuffman *h, uint8_t const *lengths, int n)
+{
+     memset(h->counts, 0, sizeof h->counts);
+     memset(h->fast, 0, sizeof h->fast);
+     for (int symbol = 0; symbol < n; ++symbol) h->counts[lengths[symbol]]++;
+     h->counts[0] = 0;
+     int left = 1;
+     for (int length = 1; length < 16; ++length) {
+          left = 2*left - h->counts[length];
+          if (left < 0) return MU_FALSE; // over-subscribed
+     }
+     uint16_t offsets[16];
+     offsets[1] = 0;
+     for (int length = 1; length < 15; ++length) offsets[length + 1] = offsets[length] + h->counts[length];
+     for (int symbol = 0; symbol < n; ++symbol) {
+          if (lengths[symbol]) h->symbols[offsets[lengths[symbol]]++] = symbol;
+     }
+
+     // the fast table, indexed by bit-reversed codes
+     int code = 0, symbol_i = 0;
+     for (int length = 1; length <= MU_INFLATE_FAST_BITS; ++length) {
+          for (int i = 0; i < h->counts[length]; ++i, ++code, ++symbol_i) {
+               int reversed = 0;
+               for (int bit_i = 0; bit_i < length; ++bit_i) reversed |= ((code >> bit_i) & 1) << (length - 1 - bit_i);
+               for (int fill = reversed; fill < (1 << MU_INFLATE_FAST_BITS); fill += 1 << length) {
+                    h->fast[fill] = (uint16_t)(length << 9 | h->symbols[symbol_i]);
+               }
+          }
+          code <<= 1;
+     }
+     return MU_TRUE;
+}
+
+MU_IMAGE_INTERNAL
+int mu_inflate_decode(struct Mu_Inflate *z, struct Mu_InflateHuffman const *h)
+{
+     if (z->bits_n < 16) mu_inflate_refill(z);
+     uint16_t const fast = h->fast[z->bits & ((1 << MU_INFLATE_FAST_BITS) - 1)];
+     if (fast) {
+          z->bits >>= fast >> 9;
+          z->bits_n -= fast >> 9;
+          return fast & 511;
+     }
+     // canonical decoding, bit by bit
+     int code = 0, first = 0, index = 0;
+     for (int length = 1; length < 16; ++length) {
+          code |= (int)(z->bits & 1);
+          z->bits >>= 1;
+          z->bits_n--;
+          int const count = h->counts[length];
+          if (code - count < first) return h->symbols[index + (code - first)];
+          index += count;
+          first = (first + count) << 1;
+          code <<= 1;
+     }
+     return -1;
+}
+
+MU_IMAGE_INTERNAL
+Mu_Bool mu_inflate_block(struct Mu_Inflate *z, struct Mu_InflateHuffman const *lengths, struct Mu_InflateHuffman const *distances)
+{
+     static uint16_t const length_base[29] = {
+          3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+     static uint8_t const length_extra[29] = {
+          0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+     static uint16_t const distance_base[30] = {
+          1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+          257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+     static uint8_t const distance_extra[30] = {
+          0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+     uint8_t * const d = z->d;
+     size_t d_i = z->d_i;
+     for (;;) {
+          int const symbol = mu_inflate_decode(z, lengths);
+          if (symbol < 256) {
+               if (symbol < 0 || d_i == z->d_n) return MU_FALSE;
+               d[d_i++] = (uint8_t)symbol;
+               continue;
+          }
+          if (symbol == 256) break;
+          if (symbol > 285) return MU_FALSE;
+          size_t const length = length_base[symbol - 257] + mu_inflate_bits(z, length_extra[symbol - 257]);
+          int const distance_symbol = mu_inflate_decode(z, distances);
+          if (distance_symbol < 0 || distance_symbol >= 30) return MU_FALSE;
+          size_t const distance = distance_base[distance_symbol] + mu_inflate_bits(z, distance_extra[distance_symbol]);
+          if (distance > d_i || length > z->d_n - d_i) return MU_FALSE;
+          uint8_t const *s = d + d_i - distance;
+          if (distance >= length) {
+               memcpy(d + d_i, s, length);
+          } else {
+               // overlapping: repeats the last `distance` bytes
+               for (size_t i = 0; i < length; ++i) d[d_i + i] = s[i];
+          }
+          d_i += length;
+     }
+     z->d_i = d_i;
+     return z->overread_n <= 8;
+}
+
+MU_IMAGE_INTERNAL
+Mu_Bool mu_inflate_dynamic_tables(struct Mu_Inflate *z, struct Mu_InflateHuffman *lengths, struct Mu_InflateHuffman *distances)
+{
+     static uint8_t const order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+     int const lengths_n = mu_inflate_bits(z, 5) + 257;
+     int const distances_n = mu_inflate_bits(z, 5) + 1;
+     int const code_lengths_n = mu_inflate_bits(z, 4) + 4;
+     uint8_t code_lengths[19] = { 0 };
+     for (int i = 0; i < code_lengths_n; ++i) code_lengths[order[i]] = (uint8_t)mu_inflate_bits(z, 3);
+     struct Mu_InflateHuffman code_lengths_huffman;
+     if (!mu_inflate_build(&code_lengths_huffman, code_lengths, 19)) return MU_FALSE;
+
+     uint8_t all_lengths[286 + 30];
+     int n = 0;
+     while (n < lengths_n + distances_n) {
+          int const symbol = mu_inflate_decode(z, &code_lengths_huffman);
+          int repeat, value;
+          if (symbol < 0) return MU_FALSE;
+          if (symbol < 16) {
+               all_lengths[n++] = (uint8_t)symbol;
+               continue;
+          } else if (symbol == 16) {
+               if (n == 0) return MU_FALSE;
+               value = all_lengths[n - 1], repeat = 3 + mu_inflate_bits(z, 2);
+          } else if (symbol == 17) {
+               value = 0, repeat = 3 + mu_inflate_bits(z, 3);
+          } else {
+               value = 0, repeat = 11 + mu_inflate_bits(z, 7);
+          }
+          if (n + repeat > lengths_n + distances_n) return MU_FALSE;
+          memset(all_lengths + n, value, repeat);
+          n += repeat;
+     }
+     return mu_inflate_build(lengths, all_lengths, lengths_n)
+          && mu_inflate_build(distances, all_lengths + lengths_n, distances_n);
+}
+
+// tables of the fixed Huffman codes (RFC 1951, 3.2.6), built once for all threads
+MU_IMAGE_INTERNAL struct Mu_InflateHuffman mu_inflate_fixed_lengths, mu_inflate_fixed_distances;
+MU_IMAGE_INTERNAL pthread_once_t mu_inflate_fixed_once = PTHREAD_ONCE_INIT;
+
+MU_IMAGE_INTERNAL
+void mu_inflate_build_fixed(void)
+{
+     uint8_t fixed[288];
+     memset(fixed, 8, 144);
+     memset(fixed + 144, 9, 112);
+     memset(fixed + 256, 7, 24);
+     memset(fixed + 280, 8, 8);
+     mu_inflate_build(&mu_inflate_fixed_lengths, fixed, 288);
+     memset(fixed, 5, 30);
+     mu_inflate_build(&mu_inflate_fixed_distances, fixed, 30);
+}
+
+/*
+ * Inflates the zlib stream `s` into exactly `d_n` bytes.
+ */
+MU_IMAGE_INTERNAL
+Mu_Bool mu_inflate_zlib(uint8_t *d, size_t d_n, uint8_t const *s, size_t s_n)
+{
+     if (s_n < 2 || (s[0] & 15) != 8 || ((s[0] << 8) | s[1]) % 31 != 0 || (s[1] & 0x20)) return MU_FALSE;
+     struct Mu_Inflate z = { .s = s + 2, .s_end = s + s_n, .d = d, .d_n = d_n };
+     struct Mu_InflateHuffman lengths, distances;
+     for (Mu_Bool last = MU_FALSE; !last; ) {
+          last = mu_inflate_bits(&z, 1);
+          int const type = mu_inflate_bits(&z, 2);
+          if (type == 0) {
+               // stored: aligned on a byte
+               mu_inflate_bits(&z, z.bits_n & 7);
+               uint32_t const length = mu_inflate_bits(&z, 16);
+               uint32_t const length_complement = mu_inflate_bits(&z, 16);
+               if ((length ^ 0xffff) != length_complement || length > d_n - z.d_i) return MU_FALSE;
+               // drain the bit buffer first, then copy from the input
+               uint32_t i = 0;
+               for (; i < length && z.bits_n >= 8; ++i) z.d[z.d_i++] = (uint8_t)mu_inflate_bits(&z, 8);
+               if (length - i > (size_t)(z.s_end - z.s)) return MU_FALSE;
+               memcpy(z.d + z.d_i, z.s, length - i);
+               z.d_i += length - i;
+               z.s += length - i;
+          } else if (type == 1) {
+               pthread_once(&mu_inflate_fixed_once, mu_inflate_build_fixed);
+               if (!mu_inflate_block(&z, &mu_inflate_fixed_lengths, &mu_inflate_fixed_distances)) return MU_FALSE;
+          } else if (type == 2) {
+               if (!mu_inflate_dynamic_tables(&z, &lengths, &distances)) return MU_FALSE;
+               if (!mu_inflate_block(&z, &lengths, &distances)) return MU_FALSE;
+          } else {
+               return MU_FALSE;
+          }
+     }
+     return z.d_i == d_n;
+}
+
+// Unfiltering (PNG filter types 1-4, applied to `row` given the previous row `prior`):
+
+MU_IMAGE_INTERNAL
+uint8_t mu_png_paeth(int a, int b, int c)
+{
+     int const p = a + b - c;
+     int const pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+     if (pa <= pb && pa <= pc) return (uint8_t)a;
+     if (pb <= pc) return (uint8_t)b;
+     return (uint8_t)c;
+}
+
+MU_IMAGE_INTERNAL
+void mu_png_unfilter_scalar(int filter, uint8_t *row, uint8_t const *prior, size_t n, size_t bpp)
+{
+     switch (filter) {
+     case 1:
+          for (size_t i = bpp; i < n; ++i) row[i] += row[i - bpp];
+          break;
+     case 2:
+          for (size_t i = 0; i < n; ++i) row[i] += prior[i];
+          break;
+     case 3:
+          for (size_t i = 0; i < bpp; ++i) row[i] += prior[i] >> 1;
+          for (size_t i = bpp; i < n; ++i) row[i] += (row[i - bpp] + prior[i]) >> 1;
+          break;
+     case 4:
+          for (size_t i = 0; i < bpp; ++i) row[i] += prior[i];
+          for (size_t i = bpp; i < n; ++i) row[i] += mu_png_paeth(row[i - bpp], prior[i], prior[i - bpp]);
+          break;
+     }
+}
+
+#if MU_IMAGE_X86
+// The Sub, Average and Paeth filters depend on the previous pixel:
+// the SSE2 paths work one pixel (3 or 4 bytes) at a time, across its
+// channels. Up has no such dependency and is done 16/32 bytes at a time.
+
+MU_IMAGE_INTERNAL
+__m128i mu_png_load_pixel(uint8_t const *p, size_t bpp)
+{
+     uint32_t x = 0;
+     memcpy(&x, p, bpp);
+     return _mm_cvtsi32_si128((int)x);
+}
+
+MU_IMAGE_INTERNAL
+void mu_png_store_pixel(uint8_t *p, __m128i x, size_t bpp)
+{
+     uint32_t const y = (uint32_t)_mm_cvtsi128_si32(x);
+     memcpy(p, &y, bpp);
+}
+
+MU_IMAGE_INTERNAL
+void mu_png_unfilter_up_sse2(uint8_t *row, uint8_t const *prior, size_t n)
+{
+     size_t i = 0;
+     for (; i + 16 <= n; i += 16) {
+          __m128i const x = _mm_add_epi8(_mm_loadu_si128((__m128i const *)(row + i)), _mm_loadu_si128((__m128i const *)(prior + i)));
+          _mm_storeu_si128((__m128i *)(row + i), x);
+     }
+     for (; i < n; ++i) row[i] += prior[i];
+}
+
+MU_IMAGE_INTERNAL MU_IMAGE_TARGET_AVX2
+void mu_png_unfilter_up_avx2(uint8_t *row, uint8_t const *prior, size_t n)
+{
+     size_t i = 0;
+     for (; i + 32 <= n; i += 32) {
+          __m256i const x = _mm256_add_epi8(_mm256_loadu_si256((__m256i const *)(row + i)), _mm256_loadu_si256((__m256i const *)(prior + i)));
+          _mm256_storeu_si256((__m256i *)(row + i), x);
+     }
+     for (; i < n; ++i) row[i] += prior[i];
+}
+
+MU_IMAGE_INTERNAL
+void mu_png_unfilter_pixels_sse2(int filter, uint8_t *row, uint8_t const *prior, size_t n, size_t bpp)
+{
+     __m128i const zero = _mm_setzero_si128();
+     __m128i a = zero, c = zero; // previous pixel, and previous pixel of the prior row
+     // the last pixel is done in scalar code, since the 4 bytes loads/stores of a pixel of 3 bytes overrun
+     size_t const simd_n = bpp == 3? (n >= 3? n - 3 : 0) : n;
+     size_t i = 0;
+     switch (filter) {
+     case 1:
+          for (; i < simd_n; i += bpp) {
+               a = _mm_add_epi8(a, mu_png_load_pixel(row + i, bpp));
+               mu_png_store_pixel(row + i, a, bpp);
+          }
+          break;
+     case 3:
+          for (; i < simd_n; i += bpp) {
+               __m128i const b = mu_png_load_pixel(prior + i, bpp);
+               // floor((a + b) / 2), as _mm_avg_epu8 rounds up
+               __m128i const average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+               a = _mm_add_epi8(average, mu_png_load_pixel(row + i, bpp));
+               mu_png_store_pixel(row + i, a, bpp);
+          }
+          break;
+     case 4:
+          for (; i < simd_n; i += bpp) {
+               __m128i const b = mu_png_load_pixel(prior + i, bpp);
+               // in 16 bits: pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|
+               __m128i const a16 = _mm_unpacklo_epi8(a, zero), b16 = _mm_unpacklo_epi8(b, zero), c16 = _mm_unpacklo_epi8(c, zero);
+               __m128i const pa_signed = _mm_sub_epi16(b16, c16);
+               __m128i const pb_signed = _mm_sub_epi16(a16, c16);
+               __m128i const pc_signed = _mm_add_epi16(pa_signed, pb_signed);
+               __m128i const pa = _mm_max_epi16(pa_signed, _mm_sub_epi16(zero, pa_signed));
+               __m128i const pb = _mm_max_epi16(pb_signed, _mm_sub_epi16(zero, pb_signed));
+               __m128i const pc = _mm_max_epi16(pc_signed, _mm_sub_epi16(zero, pc_signed));
+               // a when pa <= pb and pa <= pc, else b when pb <= pc, else c
+               __m128i const use_c = _mm_cmplt_epi16(pc, _mm_min_epi16(pa, pb));
+               __m128i const use_b_or_c = _mm_or_si128(_mm_cmplt_epi16(pb, pa), use_c);
+               __m128i const b_or_c = _mm_or_si128(_mm_and_si128(use_c, c16), _mm_andnot_si128(use_c, b16));
+               __m128i const predictor = _mm_or_si128(_mm_and_si128(use_b_or_c, b_or_c), _mm_andnot_si128(use_b_or_c, a16));
+               c = b;
+               a = _mm_add_epi8(_mm_packus_epi16(predictor, zero), mu_png_load_pixel(row + i, bpp));
+               mu_png_store_pixel(row + i, a, bpp);
+          }
+          break;
+     }
+     // remaining bytes
+     for (; i < n; ++i) {
+          uint8_t const left = i >= bpp? row[i - bpp] : 0;
+          uint8_t const up_left = i >= bpp? prior[i - bpp] : 0;
+          if (filter == 1) row[i] += left;
+          else if (filter == 3) row[i] += (left + prior[i]) >> 1;
+          else row[i] += mu_png_paeth(left, prior[i], up_left);
+     }
+}
+#endif
+
+MU_IMAGE_INTERNAL
+void mu_png_unfilter(int filter, uint8_t *row, uint8_t const *prior, size_t n, size_t bpp)
+{
+#if MU_IMAGE_X86
+     if (filter == 2) {
+          // reads the flags libgcc set at startup, safe from the jobs of Mu_LoadImages
+          if (__builtin_cpu_supports("avx2")) mu_png_unfilter_up_avx2(row, prior, n);
+          else mu_png_unfilter_up_sse2(row, prior, n);
+          return;
+     }
+     if (filter != 0 && (bpp == 3 || bpp == 4)) {
+          mu_png_unfilter_pixels_sse2(filter, row, prior, n, bpp);
+          return;
+     }
+#endif
+     mu_png_unfilter_scalar(filter, row, prior, n, bpp);
+}
+
+// PNG:
+
+MU_IMAGE_INTERNAL
+uint32_t mu_png_be32(uint8_t const *p)
+{
+     return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+struct Mu_PNGHeader
+{
+     uint32_t width;
+     uint32_t height;
+     int bit_depth;
+     int color_type;
+     int channels; // stored
+};
+
+MU_IMAGE_INTERNAL
+Mu_Bool mu_png_read_header(uint8_t const *bytes, size_t bytes_n, struct Mu_PNGHeader *header)
+{
+     static uint8_t const signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+     if (bytes_n < 8 + 8 + 13 || 0 != memcmp(bytes, signature, 8) || 0 != memcmp(bytes + 12, "IHDR", 4)) return MU_FALSE;
+     uint8_t const *ihdr = bytes + 16;
+     *header = (struct Mu_PNGHeader){
+          .width = mu_png_be32(ihdr),
+          .height = mu_png_be32(ihdr + 4),
+          .bit_depth = ihdr[8],
+          .color_type = ihdr[9],
+     };
+     if (ihdr[10] != 0 || ihdr[11] != 0) return MU_FALSE;
+     if (ihdr[12] != 0) return MU_FALSE; // @todo: Adam7 interlacing
+     if (header->width == 0 || header->height == 0 || header->width > (1u << 24) || header->height > (1u << 24)) return MU_FALSE;
+     int const depth = header->bit_depth;
+     switch (header->color_type) {
+     case 0: header->channels = 1; break;
+     case 2: header->channels = 3; break;
+     case 3: header->channels = 1; break;
+     case 4: header->channels = 2; break;
+     case 6: header->channels = 4; break;
+     default: return MU_FALSE;
+     }
+     if (header->color_type == 3) return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+     // @todo: grayscale of less than 8 bits
+     return depth == 8 || depth == 16;
+}
+
+/*
+ * `scratch` is reused from one call to the next, free it once done.
+ */
+MU_IMAGE_INTERNAL
+Mu_Bool mu_png_decode(uint8_t const *bytes, size_t bytes_n, struct Mu_Image *image, uint8_t **scratch, size_t *scratch_n)
+{
+     struct Mu_PNGHeader header;
+     if (!mu_png_read_header(bytes, bytes_n, &header)) return MU_FALSE;
+
+     size_t const bits_per_pixel = (size_t)header.channels * header.bit_depth;
+     size_t const stride = (header.width * bits_per_pixel + 7) / 8;
+     size_t const bpp = bits_per_pixel >= 8? bits_per_pixel / 8 : 1;
+     size_t const filtered_n = header.height * (stride + 1);
+
+     // the concatenated IDAT data, then the filtered rows
+     size_t idat_n = 0;
+     uint8_t palette[256][4];
+     memset(palette, 0xff, sizeof palette);
+     for (size_t chunk_i = 8; chunk_i + 12 <= bytes_n; ) {
+          uint32_t const length = mu_png_be32(bytes + chunk_i);
+          uint8_t const *type = bytes + chunk_i + 4;
+          uint8_t const *data = bytes + chunk_i + 8;
+          if (length > bytes_n - chunk_i - 12) return MU_FALSE;
+          if (0 == memcmp(type, "IDAT", 4)) {
+               idat_n += length;
+          } else if (0 == memcmp(type, "PLTE", 4)) {
+               for (uint32_t entry_i = 0; entry_i < length / 3 && entry_i < 256; ++entry_i) memcpy(palette[entry_i], data + 3*entry_i, 3);
+          } else if (0 == memcmp(type, "tRNS", 4) && header.color_type == 3) {
+               for (uint32_t entry_i = 0; entry_i < length && entry_i < 256; ++entry_i) palette[entry_i][3] = data[entry_i];
+          } else if (0 == memcmp(type, "IEND", 4)) {
+               break;
+          }
+          chunk_i += 12 + length; // @note: CRCs are not checked
+     }
+     if (*scratch_n < idat_n + filtered_n) {
+          free(*scratch);
+          *scratch_n = idat_n + filtered_n;
+          *scratch = malloc(*scratch_n);
+          if (!*scratch) {
+               *scratch_n = 0;
+               return MU_FALSE;
+          }
+     }
+     uint8_t *idat = *scratch;
+     uint8_t *filtered = *scratch + idat_n;
+     idat_n = 0;
+     for (size_t chunk_i = 8; chunk_i + 12 <= bytes_n; ) {
+          uint32_t const length = mu_png_be32(bytes + chunk_i);
+          if (0 == memcmp(bytes + chunk_i + 4, "IDAT", 4)) {
+               memcpy(idat + idat_n, bytes + chunk_i + 8, length);
+               idat_n += length;
+          } else if (0 == memcmp(bytes + chunk_i + 4, "IEND", 4)) {
+               break;
+          }
+          chunk_i += 12 + length;
+     }
+     if (!mu_inflate_zlib(filtered, filtered_n, idat, idat_n)) return MU_FALSE;
+
+     // rows are unfiltered in place, the first one against a row of zeros
+     uint8_t *zero_row = idat; // the compressed data is no longer needed
+     Mu_Bool const zero_row_fits = idat_n >= stride;
+     uint8_t *zero_row_allocated = zero_row_fits? NULL : calloc(1, stride);
+     if (zero_row_fits) memset(zero_row, 0, stride);
+     else zero_row = zero_row_allocated;
+     if (!zero_row) return MU_FALSE;
+     for (uint32_t y = 0; y < header.height; ++y) {
+          uint8_t *row = filtered + y * (stride + 1);
+          int const filter = row[0];
+          if (filter > 4) {
+               free(zero_row_allocated);
+               return MU_FALSE;
+          }
+          uint8_t const *prior = y == 0? zero_row : row - stride;
+          if (filter != 0) mu_png_unfilter(filter, row + 1, prior, stride, bpp);
+     }
+     free(zero_row_allocated);
+
+     size_t const pixels_n = (size_t)header.width * header.height;
+     uint8_t *pixels = image->pixels;
+     if (!pixels) {
+          pixels = malloc(pixels_n * 4);
+          if (!pixels) return MU_FALSE;
+     }
+     int const byte_step = header.bit_depth == 16? 2 : 1; // the high byte of 16 bits samples
+     for (uint32_t y = 0; y < header.height; ++y) {
+          uint8_t const *s = filtered + y * (stride + 1) + 1;
+          uint8_t *d = pixels + (size_t)y * header.width * 4;
+          switch (header.color_type) {
+          case 6:
+               if (byte_step == 1) {
+                    memcpy(d, s, header.width * 4);
+                    break;
+               }
+               for (uint32_t x = 0; x < header.width; ++x) for (int k = 0; k < 4; ++k) d[4*x + k] = s[(4*x + k) * 2];
+               break;
+          case 2:
+               for (uint32_t x = 0; x < header.width; ++x) {
+                    d[4*x + 0] = s[(3*x + 0) * byte_step];
+                    d[4*x + 1] = s[(3*x + 1) * byte_step];
+                    d[4*x + 2] = s[(3*x + 2) * byte_step];
+                    d[4*x + 3] = 255;
+               }
+               break;
+          case 4:
+               for (uint32_t x = 0; x < header.width; ++x) {
+                    d[4*x + 0] = d[4*x + 1] = d[4*x + 2] = s[(2*x) * byte_step];
+                    d[4*x + 3] = s[(2*x + 1) * byte_step];
+               }
+               break;
+          case 0:
+               for (uint32_t x = 0; x < header.width; ++x) {
+                    d[4*x + 0] = d[4*x + 1] = d[4*x + 2] = s[x * byte_step];
+                    d[4*x + 3] = 255;
+               }
+               break;
+          case 3: {
+               int const depth = header.bit_depth;
+               int const mask = (1 << depth) - 1;
+               for (uint32_t x = 0; x < header.width; ++x) {
+                    size_t const bit_i = (size_t)x * depth;
+                    int const entry = (s[bit_i / 8] >> (8 - depth - bit_i % 8)) & mask;
+                    memcpy(d + 4*x, palette[entry], 4);
+               }
+          } break;
+          }
+     }
+     *image = (struct Mu_Image){
+          .pixels = pixels,
+          .channels = 4,
+          .width = header.width,
+          .height = header.height,
+     };
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_DecodePNG(uint8_t const *bytes, size_t bytes_n, struct Mu_Image *image)
+{
+     uint8_t *scratch = NULL;
+     size_t scratch_n = 0;
+     Mu_Bool const decoded = mu_png_decode(bytes, bytes_n, image, &scratch, &scratch_n);
+     free(scratch);
+     return decoded;
+}
+
+Mu_Bool Mu_ReadImageInfo(const char *filename, struct Mu_Image *image)
+{
+     FILE *file = fopen(filename, "rb");
+     if (!file) return MU_FALSE;
+     uint8_t bytes[8 + 8 + 13];
+     Mu_Bool const read = fread(bytes, sizeof bytes, 1, file) == 1;
+     fclose(file);
+     struct Mu_PNGHeader header;
+     if (!read || !mu_png_read_header(bytes, sizeof bytes, &header)) return MU_FALSE;
+     image->channels = 4;
+     image->width = header.width;
+     image->height = header.height;
+     return MU_TRUE;
+}
+
+// Batches:
+
+struct Mu_ImageBatch
+{
+     char const * const *filenames;
+     struct Mu_Image *images;
+     int images_n;
+     atomic_int next_i; // @shared: next image to load
+     atomic_int loaded_n; // @shared
+};
+
+MU_IMAGE_INTERNAL
+void mu_image_batch_worker(void *arg)
+{
+     struct Mu_ImageBatch *batch = arg;
+     uint8_t *bytes = NULL, *scratch = NULL;
+     size_t bytes_capacity = 0, scratch_n = 0;
+     for (int image_i; (image_i = atomic_fetch_add(&batch->next_i, 1)) < batch->images_n; ) {
+          struct Mu_Image *image = &batch->images[image_i];
+          Mu_Bool loaded = MU_FALSE;
+          FILE *file = fopen(batch->filenames[image_i], "rb");
+          if (file) {
+               fseek(file, 0, SEEK_END);
+               long const file_n = ftell(file);
+               fseek(file, 0, SEEK_SET);
+               if (file_n > 0 && (size_t)file_n > bytes_capacity) {
+                    free(bytes);
+                    bytes_capacity = file_n;
+                    bytes = malloc(bytes_capacity);
+                    if (!bytes) bytes_capacity = 0;
+               }
+               if (file_n > 0 && bytes && fread(bytes, file_n, 1, file) == 1) {
+                    loaded = mu_png_decode(bytes, file_n, image, &scratch, &scratch_n);
+               }
+               fclose(file);
+          }
+          if (loaded) atomic_fetch_add(&batch->loaded_n, 1);
+          else image->width = image->height = 0;
+     }
+     free(bytes);
+     free(scratch);
+}
+
+int Mu_LoadImages(char const * const *filenames, int filenames_n, struct Mu_Image *images, struct Mu_ImageArena *arena, struct Mu_Jobs *jobs)
+{
+     if (filenames_n <= 0) return 0;
+     // places images in the arena, from their headers
+     for (int image_i = 0; arena && image_i < filenames_n; ++image_i) {
+          struct Mu_Image *image = &images[image_i];
+          if (image->pixels) continue;
+          struct Mu_Image info;
+          if (!Mu_ReadImageInfo(filenames[image_i], &info)) continue;
+          size_t const bytes_n = (size_t)info.width * info.height * 4;
+          if (bytes_n > arena->bytes_capacity - arena->bytes_n) continue;
+          image->pixels = arena->bytes + arena->bytes_n;
+          arena->bytes_n += (bytes_n + 15) & ~(size_t)15;
+          if (arena->bytes_n > arena->bytes_capacity) arena->bytes_n = arena->bytes_capacity;
+     }
+
+     struct Mu_ImageBatch batch = {
+          .filenames = filenames,
+          .images = images,
+          .images_n = filenames_n,
+     };
+     atomic_init(&batch.next_i, 0);
+     atomic_init(&batch.loaded_n, 0);
+     // without workers of the caller, a pool for this batch only
+     struct Mu_Jobs batch_jobs = { 0 };
+     if (!jobs) {
+          long const cores_n = sysconf(_SC_NPROCESSORS_ONLN);
+          batch_jobs.workers_n = cores_n < filenames_n? (int)cores_n : filenames_n;
+          batch_jobs.frame_arena_capacity = 64;
+          jobs = Mu_JobsInitialize(&batch_jobs)? &batch_jobs : NULL;
+     }
+     if (jobs) {
+          // one job per worker, each loading images until none is left
+          struct Mu_Job workers_jobs[64];
+          int jobs_n = jobs->workers_n < filenames_n? jobs->workers_n : filenames_n;
+          if (jobs_n > (int)(sizeof workers_jobs / sizeof *workers_jobs)) jobs_n = (int)(sizeof workers_jobs / sizeof *workers_jobs);
+          for (int job_i = 0; job_i < jobs_n; ++job_i) workers_jobs[job_i] = (struct Mu_Job){ mu_image_batch_worker, &batch };
+          Mu_JobsRunAndWait(jobs, workers_jobs, jobs_n);
+     } else {
+          mu_image_batch_worker(&batch);
+     }
+     Mu_JobsClose(&batch_jobs);
+     return atomic_load(&batch.loaded_n);
+}
+
+#undef MU_IMAGE_TARGET_AVX2
+#undef MU_IMAGE_X86
+#undef MU_IMAGE_INTERNAL
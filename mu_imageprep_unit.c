@@ -0,0 +1,867 @@
+// @language: c11
+// @dependencylist: xxxx_mu, mu_jobs_unit, pthread
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_imageprep.h"
+#include "xxxx_mu_jobs.h"
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MU_IMAGEPREP_X86 1
+#include <immintrin.h>
+#define MU_IMAGEPREP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MU_IMAGEPREP_X86 0
+#endif
+
+#define MU_IMAGEPREP_INTERNAL static
+
+enum {
+     // linear values quantized to 12 bits before encoding to sRGB: every
+     // sRGB byte comes back the same after a round trip through linear
+     MU_IMAGEPREP_ENCODE_TABLE_N = 4096,
+     MU_IMAGEPREP_CHUNK_PIXELS = 256, // converted at once on the stack
+     MU_IMAGEPREP_KAISER_RADIUS = 3,  // in texels of the smaller level
+     MU_IMAGEPREP_MAX_BATCH_JOBS = 64,
+};
+
+#define MU_IMAGEPREP_KAISER_ALPHA 4.0
+#define MU_IMAGEPREP_PI 3.14159265358979323846
+
+uint32_t Mu_ImageStride(struct Mu_Image const *image)
+{
+     return image->stride? image->stride : image->width * image->channels;
+}
+
+// Tables:
+
+// [0, 256[: sRGB byte to linear, [256, 512[: byte / 255
+MU_IMAGEPREP_INTERNAL float mu_imageprep_decode_table[512];
+// sRGB byte of the linear values in [i / N, (i + 1) / N[, and of 1.0 at
+// N. Bytes as 32 bits for gathers
+MU_IMAGEPREP_INTERNAL int32_t mu_imageprep_encode_table[MU_IMAGEPREP_ENCODE_TABLE_N + 1];
+MU_IMAGEPREP_INTERNAL pthread_once_t mu_imageprep_tables_once = PTHREAD_ONCE_INIT;
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_initialize_tables(void)
+{
+     for (int i = 0; i < 256; ++i) {
+          double const c = i / 255.0;
+          mu_imageprep_decode_table[i] = (float)(c <= 0.04045? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+          mu_imageprep_decode_table[256 + i] = (float)c;
+     }
+     for (int i = 0; i <= MU_IMAGEPREP_ENCODE_TABLE_N; ++i) {
+          double const l = i < MU_IMAGEPREP_ENCODE_TABLE_N? (i + 0.5) / MU_IMAGEPREP_ENCODE_TABLE_N : 1.0;
+          double const c = l <= 0.0031308? 12.92 * l : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+          mu_imageprep_encode_table[i] = (int32_t)(255.0 * c + 0.5);
+     }
+}
+
+// Kernels:
+
+// `n` pixels of RGBA8, in place
+typedef void (*Mu_ImagePrepPremultiply)(uint8_t *pixels, uint32_t n);
+// `n` pixels: colors through `mu_imageprep_decode_table + color_offset`,
+// alpha through `mu_imageprep_decode_table + 256`
+typedef void (*Mu_ImagePrepToLinear)(float *d, uint8_t const *s, uint32_t n, int color_offset);
+// `n` pixels, colors encoded to sRGB when `srgb`
+typedef void (*Mu_ImagePrepFromLinear)(uint8_t *d, float const *s, uint32_t n, Mu_Bool srgb);
+
+struct Mu_ImagePrepKernels
+{
+     Mu_ImagePrepPremultiply premultiply;
+     Mu_ImagePrepToLinear to_linear;
+     Mu_ImagePrepFromLinear from_linear;
+};
+
+MU_IMAGEPREP_INTERNAL
+uint8_t mu_imageprep_multiply_bytes(uint32_t c, uint32_t a)
+{
+     // c * a / 255, rounded to nearest
+     uint32_t const t = c * a + 128;
+     return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_premultiply_scalar(uint8_t *pixels, uint32_t n)
+{
+     for (uint32_t i = 0; i < n; ++i, pixels += 4) {
+          uint32_t const a = pixels[3];
+          pixels[0] = mu_imageprep_multiply_bytes(pixels[0], a);
+          pixels[1] = mu_imageprep_multiply_bytes(pixels[1], a);
+          pixels[2] = mu_imageprep_multiply_bytes(pixels[2], a);
+     }
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_to_linear_scalar(float *d, uint8_t const *s, uint32_t n, int color_offset)
+{
+     float const *color = mu_imageprep_decode_table + color_offset, *alpha = mu_imageprep_decode_table + 256;
+     for (uint32_t i = 0; i < 4 * n; i += 4) {
+          d[i + 0] = color[s[i + 0]];
+          d[i + 1] = color[s[i + 1]];
+          d[i + 2] = color[s[i + 2]];
+          d[i + 3] = alpha[s[i + 3]];
+     }
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_from_linear_scalar(uint8_t *d, float const *s, uint32_t n, Mu_Bool srgb)
+{
+     for (uint32_t i = 0; i < 4 * n; ++i) {
+          float const x = s[i] > 0.0f? (s[i] < 1.0f? s[i] : 1.0f) : 0.0f; // NaN to 0
+          if (srgb && (i & 3) != 3) d[i] = (uint8_t)mu_imageprep_encode_table[(int32_t)(x * MU_IMAGEPREP_ENCODE_TABLE_N)];
+          else d[i] = (uint8_t)(x * 255.0f + 0.5f);
+     }
+}
+
+#if MU_IMAGEPREP_X86
+// two pixels, as 16 bits per channel
+MU_IMAGEPREP_INTERNAL
+__m128i mu_imageprep_premultiply_2_sse2(__m128i x)
+{
+     __m128i const alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+     __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xff), 0xff);
+     a = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), _mm_and_si128(alpha_lanes, _mm_set1_epi16(255)));
+     __m128i const t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+     return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_premultiply_sse2(uint8_t *pixels, uint32_t n)
+{
+     __m128i const zero = _mm_setzero_si128();
+     uint32_t i = 0;
+     for (; i + 4 <= n; i += 4) {
+          __m128i const x = _mm_loadu_si128((__m128i const *)(pixels + 4 * i));
+          __m128i const lo = mu_imageprep_premultiply_2_sse2(_mm_unpacklo_epi8(x, zero));
+          __m128i const hi = mu_imageprep_premultiply_2_sse2(_mm_unpackhi_epi8(x, zero));
+          _mm_storeu_si128((__m128i *)(pixels + 4 * i), _mm_packus_epi16(lo, hi));
+     }
+     mu_imageprep_premultiply_scalar(pixels + 4 * i, n - i);
+}
+
+// without gathers, table lookups stay scalar: only the clamping and
+// the conversion of straight bytes are vectors
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_from_linear_sse2(uint8_t *d, float const *s, uint32_t n, Mu_Bool srgb)
+{
+     uint32_t i = 0;
+     if (!srgb) {
+          __m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+          for (; i + 4 <= n; i += 4) {
+               __m128i v[4];
+               for (int k = 0; k < 4; ++k) {
+                    __m128 const x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(s + 4 * (i + k)), zero), one);
+                    v[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, scale), half));
+               }
+               __m128i const bytes = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+               _mm_storeu_si128((__m128i *)(d + 4 * i), bytes);
+          }
+     }
+     mu_imageprep_from_linear_scalar(d + 4 * i, s + 4 * i, n - i, srgb);
+}
+
+MU_IMAGEPREP_INTERNAL MU_IMAGEPREP_TARGET_AVX2
+__m256i mu_imageprep_premultiply_4_avx2(__m256i x)
+{
+     __m256i const alpha_lanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+     __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xff), 0xff);
+     a = _mm256_or_si256(_mm256_andnot_si256(alpha_lanes, a), _mm256_and_si256(alpha_lanes, _mm256_set1_epi16(255)));
+     __m256i const t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+     return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+MU_IMAGEPREP_INTERNAL MU_IMAGEPREP_TARGET_AVX2
+void mu_imageprep_premultiply_avx2(uint8_t *pixels, uint32_t n)
+{
+     __m256i const zero = _mm256_setzero_si256();
+     uint32_t i = 0;
+     for (; i + 8 <= n; i += 8) {
+          __m256i const x = _mm256_loadu_si256((__m256i const *)(pixels + 4 * i));
+          __m256i const lo = mu_imageprep_premultiply_4_avx2(_mm256_unpacklo_epi8(x, zero));
+          __m256i const hi = mu_imageprep_premultiply_4_avx2(_mm256_unpackhi_epi8(x, zero));
+          _mm256_storeu_si256((__m256i *)(pixels + 4 * i), _mm256_packus_epi16(lo, hi));
+     }
+     mu_imageprep_premultiply_sse2(pixels + 4 * i, n - i);
+}
+
+MU_IMAGEPREP_INTERNAL MU_IMAGEPREP_TARGET_AVX2
+void mu_imageprep_to_linear_avx2(float *d, uint8_t const *s, uint32_t n, int color_offset)
+{
+     __m256i const offsets = _mm256_setr_epi32(color_offset, color_offset, color_offset, 256,
+                                               color_offset, color_offset, color_offset, 256);
+     uint32_t i = 0;
+     for (; i + 2 <= n; i += 2) {
+          __m256i const index = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *)(s + 4 * i))), offsets);
+          _mm256_storeu_ps(d + 4 * i, _mm256_i32gather_ps(mu_imageprep_decode_table, index, 4));
+     }
+     mu_imageprep_to_linear_scalar(d + 4 * i, s + 4 * i, n - i, color_offset);
+}
+
+MU_IMAGEPREP_INTERNAL MU_IMAGEPREP_TARGET_AVX2
+void mu_imageprep_from_linear_avx2(uint8_t *d, float const *s, uint32_t n, Mu_Bool srgb)
+{
+     float const color_scale = srgb? (float)MU_IMAGEPREP_ENCODE_TABLE_N : 255.0f;
+     float const color_bias = srgb? 0.0f : 0.5f;
+     __m256 const scale = _mm256_setr_ps(color_scale, color_scale, color_scale, 255.0f, color_scale, color_scale, color_scale, 255.0f);
+     __m256 const bias = _mm256_setr_ps(color_bias, color_bias, color_bias, 0.5f, color_bias, color_bias, color_bias, 0.5f);
+     __m256i const alpha_lanes = _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1);
+     __m256 const zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+     __m256i const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+     uint32_t i = 0;
+     for (; i + 4 <= n; i += 4) {
+          __m256i v[2];
+          for (int k = 0; k < 2; ++k) {
+               __m256 const x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(s + 4 * i + 8 * k), zero), one);
+               v[k] = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(x, scale), bias));
+               if (srgb) v[k] = _mm256_blendv_epi8(_mm256_i32gather_epi32(mu_imageprep_encode_table, v[k], 4), v[k], alpha_lanes);
+          }
+          // pixels 0 and 2 in the low lane, 1 and 3 in the high lane
+          __m256i const words = _mm256_packus_epi32(v[0], v[1]);
+          __m256i const bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words, words), order);
+          _mm_storeu_si128((__m128i *)(d + 4 * i), _mm256_castsi256_si128(bytes));
+     }
+     mu_imageprep_from_linear_scalar(d + 4 * i, s + 4 * i, n - i, srgb);
+}
+#endif
+
+MU_IMAGEPREP_INTERNAL
+Mu_Bool mu_imageprep_kernels_for_isa(int isa, struct Mu_ImagePrepKernels *kernels)
+{
+     pthread_once(&mu_imageprep_tables_once, mu_imageprep_initialize_tables);
+     if (isa == MU_IMAGEPREP_ISA_AUTO) {
+#if MU_IMAGEPREP_X86
+          isa = __builtin_cpu_supports("avx2")? MU_IMAGEPREP_ISA_AVX2 : MU_IMAGEPREP_ISA_SSE2;
+#else
+          isa = MU_IMAGEPREP_ISA_SCALAR;
+#endif
+     }
+     switch (isa) {
+     case MU_IMAGEPREP_ISA_SCALAR:
+          *kernels = (struct Mu_ImagePrepKernels){ mu_imageprep_premultiply_scalar, mu_imageprep_to_linear_scalar, mu_imageprep_from_linear_scalar };
+          return MU_TRUE;
+#if MU_IMAGEPREP_X86
+     case MU_IMAGEPREP_ISA_SSE2:
+          *kernels = (struct Mu_ImagePrepKernels){ mu_imageprep_premultiply_sse2, mu_imageprep_to_linear_scalar, mu_imageprep_from_linear_sse2 };
+          return MU_TRUE;
+     case MU_IMAGEPREP_ISA_AVX2:
+          if (!__builtin_cpu_supports("avx2")) return MU_FALSE;
+          *kernels = (struct Mu_ImagePrepKernels){ mu_imageprep_premultiply_avx2, mu_imageprep_to_linear_avx2, mu_imageprep_from_linear_avx2 };
+          return MU_TRUE;
+#endif
+     }
+     return MU_FALSE;
+}
+
+// Conversions:
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_premultiply_linear(float *pixels, uint32_t n)
+{
+     for (uint32_t i = 0; i < 4 * n; i += 4) {
+          float const a = pixels[i + 3];
+          pixels[i + 0] *= a;
+          pixels[i + 1] *= a;
+          pixels[i + 2] *= a;
+     }
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_unpremultiply_linear(float *d, float const *s, uint32_t n)
+{
+     for (uint32_t i = 0; i < 4 * n; i += 4) {
+          float const a = s[i + 3];
+          float const inverse = a > 1e-6f? 1.0f / a : 0.0f;
+          d[i + 0] = s[i + 0] * inverse;
+          d[i + 1] = s[i + 1] * inverse;
+          d[i + 2] = s[i + 2] * inverse;
+          d[i + 3] = a;
+     }
+}
+
+Mu_Bool Mu_PremultiplyImageWithISA(int isa, struct Mu_Image *image, uint32_t flags)
+{
+     struct Mu_ImagePrepKernels kernels;
+     if (image->channels != 4 || !mu_imageprep_kernels_for_isa(isa, &kernels)) return MU_FALSE;
+     uint32_t const stride = Mu_ImageStride(image);
+     for (uint32_t y = 0; y < image->height; ++y) {
+          uint8_t *row = image->pixels + (size_t)y * stride;
+          if (!(flags & MU_IMAGEPREP_SRGB)) {
+               kernels.premultiply(row, image->width);
+               continue;
+          }
+          float chunk[4 * MU_IMAGEPREP_CHUNK_PIXELS];
+          for (uint32_t x = 0; x < image->width; x += MU_IMAGEPREP_CHUNK_PIXELS) {
+               uint32_t const n = image->width - x < MU_IMAGEPREP_CHUNK_PIXELS? image->width - x : MU_IMAGEPREP_CHUNK_PIXELS;
+               kernels.to_linear(chunk, row + 4 * x, n, 0);
+               mu_imageprep_premultiply_linear(chunk, n);
+               kernels.from_linear(row + 4 * x, chunk, n, MU_TRUE);
+          }
+     }
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_PremultiplyImage(struct Mu_Image *image, uint32_t flags)
+{
+     return Mu_PremultiplyImageWithISA(MU_IMAGEPREP_ISA_AUTO, image, flags);
+}
+
+Mu_Bool Mu_ImageToLinearWithISA(int isa, struct Mu_Image const *image, uint32_t flags, float *linear)
+{
+     struct Mu_ImagePrepKernels kernels;
+     if (image->channels != 4 || !mu_imageprep_kernels_for_isa(isa, &kernels)) return MU_FALSE;
+     uint32_t const stride = Mu_ImageStride(image);
+     int const color_offset = flags & MU_IMAGEPREP_SRGB? 0 : 256;
+     for (uint32_t y = 0; y < image->height; ++y) {
+          kernels.to_linear(linear + (size_t)y * image->width * 4, image->pixels + (size_t)y * stride, image->width, color_offset);
+     }
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_ImageToLinear(struct Mu_Image const *image, uint32_t flags, float *linear)
+{
+     return Mu_ImageToLinearWithISA(MU_IMAGEPREP_ISA_AUTO, image, flags, linear);
+}
+
+Mu_Bool Mu_ImageFromLinearWithISA(int isa, float const *linear, uint32_t flags, struct Mu_Image *image)
+{
+     struct Mu_ImagePrepKernels kernels;
+     if (image->channels != 4 || !mu_imageprep_kernels_for_isa(isa, &kernels)) return MU_FALSE;
+     uint32_t const stride = Mu_ImageStride(image);
+     for (uint32_t y = 0; y < image->height; ++y) {
+          kernels.from_linear(image->pixels + (size_t)y * stride, linear + (size_t)y * image->width * 4, image->width, (flags & MU_IMAGEPREP_SRGB) != 0);
+     }
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_ImageFromLinear(float const *linear, uint32_t flags, struct Mu_Image *image)
+{
+     return Mu_ImageFromLinearWithISA(MU_IMAGEPREP_ISA_AUTO, linear, flags, image);
+}
+
+// Mips:
+
+// source texels of each destination texel along one axis, with their
+// weights. Texels past the edges repeat the edge
+struct Mu_ImagePrepTaps
+{
+     int taps_n; // per destination texel
+     int32_t *indices;
+     float *weights;
+};
+
+MU_IMAGEPREP_INTERNAL
+double mu_imageprep_bessel_i0(double x)
+{
+     double sum = 1.0, term = 1.0;
+     for (int k = 1; k < 64 && term > 1e-12 * sum; ++k) {
+          double const y = x / (2.0 * k);
+          term *= y * y;
+          sum += term;
+     }
+     return sum;
+}
+
+// `t` in texels of the destination
+MU_IMAGEPREP_INTERNAL
+double mu_imageprep_kaiser(double t)
+{
+     double const radius = MU_IMAGEPREP_KAISER_RADIUS;
+     if (t <= -radius || t >= radius) return 0.0;
+     double const u = t / radius;
+     double const window = mu_imageprep_bessel_i0(MU_IMAGEPREP_KAISER_ALPHA * sqrt(1.0 - u * u)) / mu_imageprep_bessel_i0(MU_IMAGEPREP_KAISER_ALPHA);
+     double const x = MU_IMAGEPREP_PI * t;
+     return (t == 0.0? 1.0 : sin(x) / x) * window;
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_free_taps(struct Mu_ImagePrepTaps *taps)
+{
+     free(taps->indices);
+     free(taps->weights);
+     *taps = (struct Mu_ImagePrepTaps){ 0 };
+}
+
+MU_IMAGEPREP_INTERNAL
+Mu_Bool mu_imageprep_taps(struct Mu_ImagePrepTaps *taps, uint32_t s_n, uint32_t d_n, int filter)
+{
+     // texel j covers [j, j + 1[, destination texels cover `ratio` of them
+     double const ratio = (double)s_n / d_n;
+     double const support = filter == MU_IMAGEPREP_FILTER_KAISER? MU_IMAGEPREP_KAISER_RADIUS * ratio : 0.5 * ratio;
+     taps->taps_n = (int)ceil(2.0 * support) + 2;
+     taps->indices = malloc((size_t)d_n * taps->taps_n * sizeof *taps->indices);
+     taps->weights = malloc((size_t)d_n * taps->taps_n * sizeof *taps->weights);
+     if (!taps->indices || !taps->weights) {
+          mu_imageprep_free_taps(taps);
+          return MU_FALSE;
+     }
+     for (uint32_t i = 0; i < d_n; ++i) {
+          double const center = (i + 0.5) * ratio;
+          int64_t const first = (int64_t)floor(center - support);
+          int32_t *indices = taps->indices + (size_t)i * taps->taps_n;
+          float *weights = taps->weights + (size_t)i * taps->taps_n;
+          double w[64], sum = 0.0;
+          int const taps_n = taps->taps_n < 64? taps->taps_n : 64;
+          for (int k = 0; k < taps_n; ++k) {
+               int64_t const j = first + k;
+               if (filter == MU_IMAGEPREP_FILTER_KAISER) {
+                    w[k] = mu_imageprep_kaiser((j + 0.5 - center) / ratio);
+               } else {
+                    // area of the texel under the destination texel
+                    double const x0 = j > center - support? (double)j : center - support;
+                    double const x1 = j + 1 < center + support? (double)(j + 1) : center + support;
+                    w[k] = x1 > x0? x1 - x0 : 0.0;
+               }
+               sum += w[k];
+               indices[k] = (int32_t)(j < 0? 0 : j >= (int64_t)s_n? (int64_t)s_n - 1 : j);
+          }
+          for (int k = 0; k < taps->taps_n; ++k) weights[k] = k < taps_n && sum != 0.0? (float)(w[k] / sum) : 0.0f;
+          for (int k = taps_n; k < taps->taps_n; ++k) indices[k] = indices[0];
+     }
+     return MU_TRUE;
+}
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_filter_row(float *d, float const *s, struct Mu_ImagePrepTaps const *taps, uint32_t d_n)
+{
+     for (uint32_t i = 0; i < d_n; ++i) {
+          int32_t const *indices = taps->indices + (size_t)i * taps->taps_n;
+          float const *weights = taps->weights + (size_t)i * taps->taps_n;
+#if MU_IMAGEPREP_X86
+          // a texel is one vector
+          __m128 sum = _mm_setzero_ps();
+          for (int k = 0; k < taps->taps_n; ++k) {
+               sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(s + 4 * indices[k])));
+          }
+          _mm_storeu_ps(d + 4 * i, sum);
+#else
+          float sum[4] = { 0 };
+          for (int k = 0; k < taps->taps_n; ++k) {
+               for (int c = 0; c < 4; ++c) sum[c] += weights[k] * s[4 * indices[k] + c];
+          }
+          memcpy(d + 4 * i, sum, sizeof sum);
+#endif
+     }
+}
+
+// row `y` of the destination, from rows of `width` texels
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_filter_column(float *d, float const *s, struct Mu_ImagePrepTaps const *taps, uint32_t y, uint32_t width)
+{
+     int32_t const *indices = taps->indices + (size_t)y * taps->taps_n;
+     float const *weights = taps->weights + (size_t)y * taps->taps_n;
+     size_t const n = (size_t)width * 4;
+     memset(d, 0, n * sizeof *d);
+     for (int k = 0; k < taps->taps_n; ++k) {
+          if (weights[k] == 0.0f) continue;
+          float const w = weights[k];
+          float const *row = s + (size_t)indices[k] * n;
+          for (size_t i = 0; i < n; ++i) d[i] += w * row[i];
+     }
+}
+
+Mu_Bool Mu_GenerateImageMips(struct Mu_Image const *image, int filter, uint32_t flags, struct Mu_ImageMips *mips)
+{
+     *mips = (struct Mu_ImageMips){ 0 };
+     struct Mu_ImagePrepKernels kernels;
+     if (image->channels != 4 || !image->pixels || !image->width || !image->height) return MU_FALSE;
+     if (!mu_imageprep_kernels_for_isa(MU_IMAGEPREP_ISA_AUTO, &kernels)) return MU_FALSE;
+     Mu_Bool const srgb = (flags & MU_IMAGEPREP_SRGB) != 0, premultiplied = (flags & MU_IMAGEPREP_PREMULTIPLIED) != 0;
+
+     mips->levels[0] = *image;
+     mips->levels_n = 1;
+     size_t pixels_n = 0;
+     for (uint32_t w = image->width, h = image->height; (w > 1 || h > 1) && mips->levels_n < MU_IMAGEPREP_MAX_MIPS; ) {
+          w = w > 1? w / 2 : 1;
+          h = h > 1? h / 2 : 1;
+          mips->levels[mips->levels_n++] = (struct Mu_Image){ .channels = 4, .width = w, .height = h };
+          pixels_n += (size_t)w * h;
+     }
+     if (mips->levels_n == 1) return MU_TRUE;
+
+     // levels are filtered from the previous one, kept in floats. The
+     // image itself is converted a row at a time
+     struct Mu_Image const *level1 = &mips->levels[1];
+     size_t const linear_n = (size_t)level1->width * level1->height * 4;
+     mips->pixels = malloc(pixels_n * 4);
+     float *source_row = malloc((size_t)image->width * 4 * sizeof (float));
+     float *rows = malloc((size_t)level1->width * image->height * 4 * sizeof (float));
+     float *linear = malloc(2 * linear_n * sizeof (float));
+     Mu_Bool generated = mips->pixels && source_row && rows && linear;
+     float *previous = linear, *next = linear + linear_n;
+     uint8_t *pixels = mips->pixels;
+     for (int level_i = 1; generated && level_i < mips->levels_n; ++level_i) {
+          struct Mu_Image const *s = &mips->levels[level_i - 1];
+          struct Mu_Image *d = &mips->levels[level_i];
+          d->pixels = pixels;
+          pixels += (size_t)d->width * d->height * 4;
+          struct Mu_ImagePrepTaps taps_x = { 0 }, taps_y = { 0 };
+          if (!mu_imageprep_taps(&taps_x, s->width, d->width, filter) || !mu_imageprep_taps(&taps_y, s->height, d->height, filter)) {
+               mu_imageprep_free_taps(&taps_x);
+               generated = MU_FALSE;
+               break;
+          }
+          uint32_t const s_stride = Mu_ImageStride(s);
+          for (uint32_t y = 0; y < s->height; ++y) {
+               float const *row = previous + (size_t)y * s->width * 4;
+               if (level_i == 1) {
+                    kernels.to_linear(source_row, s->pixels + (size_t)y * s_stride, s->width, srgb? 0 : 256);
+                    if (!premultiplied) mu_imageprep_premultiply_linear(source_row, s->width);
+                    row = source_row;
+               }
+               mu_imageprep_filter_row(rows + (size_t)y * d->width * 4, row, &taps_x, d->width);
+          }
+          for (uint32_t y = 0; y < d->height; ++y) {
+               float *row = next + (size_t)y * d->width * 4;
+               mu_imageprep_filter_column(row, rows, &taps_y, y, d->width);
+               if (!premultiplied) {
+                    // `source_row` is as wide as the image, free after level 1
+                    mu_imageprep_unpremultiply_linear(source_row, row, d->width);
+                    kernels.from_linear(d->pixels + (size_t)y * d->width * 4, source_row, d->width, srgb);
+               } else {
+                    kernels.from_linear(d->pixels + (size_t)y * d->width * 4, row, d->width, srgb);
+               }
+          }
+          mu_imageprep_free_taps(&taps_x);
+          mu_imageprep_free_taps(&taps_y);
+          float *swap = previous;
+          previous = next;
+          next = swap;
+     }
+     free(linear);
+     free(rows);
+     free(source_row);
+     if (!generated) Mu_FreeImageMips(mips);
+     return generated;
+}
+
+void Mu_FreeImageMips(struct Mu_ImageMips *mips)
+{
+     free(mips->pixels);
+     *mips = (struct Mu_ImageMips){ 0 };
+}
+
+// Batches:
+
+struct Mu_ImagePrepBatch;
+typedef Mu_Bool (*Mu_ImagePrepItem)(struct Mu_ImagePrepBatch *batch, int item_i);
+
+struct Mu_ImagePrepBatch
+{
+     Mu_ImagePrepItem item;
+     int items_n;
+     atomic_int next_i; // @shared: next item to run
+     atomic_int done_n; // @shared
+
+     // parameters of the items
+     struct Mu_Image *images;
+     struct Mu_Image const *source_images;
+     uint32_t flags;
+     int filter;
+     struct Mu_ImageMips *mips;
+     struct Mu_Atlas const *atlas;
+     struct Mu_AtlasPlacement const *placements;
+};
+
+MU_IMAGEPREP_INTERNAL
+void mu_imageprep_batch_worker(void *arg)
+{
+     struct Mu_ImagePrepBatch *batch = arg;
+     for (int item_i; (item_i = atomic_fetch_add(&batch->next_i, 1)) < batch->items_n; ) {
+          if (batch->item(batch, item_i)) atomic_fetch_add(&batch->done_n, 1);
+     }
+}
+
+MU_IMAGEPREP_INTERNAL
+int mu_imageprep_run_batch(struct Mu_ImagePrepBatch *batch, struct Mu_Jobs *jobs)
+{
+     atomic_init(&batch->next_i, 0);
+     atomic_init(&batch->done_n, 0);
+     if (batch->items_n <= 0) return 0;
+     if (jobs && jobs->workers_n > 1 && batch->items_n > 1) {
+          // one job per worker, each running items until none is left
+          struct Mu_Job workers_jobs[MU_IMAGEPREP_MAX_BATCH_JOBS];
+          int jobs_n = jobs->workers_n < batch->items_n? jobs->workers_n : batch->items_n;
+          if (jobs_n > MU_IMAGEPREP_MAX_BATCH_JOBS) jobs_n = MU_IMAGEPREP_MAX_BATCH_JOBS;
+          for (int job_i = 0; job_i < jobs_n; ++job_i) workers_jobs[job_i] = (struct Mu_Job){ mu_imageprep_batch_worker, batch };
+          Mu_JobsRunAndWait(jobs, workers_jobs, jobs_n);
+     } else {
+          mu_imageprep_batch_worker(batch);
+     }
+     return atomic_load(&batch->done_n);
+}
+
+MU_IMAGEPREP_INTERNAL
+Mu_Bool mu_imageprep_premultiply_item(struct Mu_ImagePrepBatch *batch, int item_i)
+{
+     return Mu_PremultiplyImage(&batch->images[item_i], batch->flags);
+}
+
+int Mu_PremultiplyImages(struct Mu_Image *images, int images_n, uint32_t flags, struct Mu_Jobs *jobs)
+{
+     struct Mu_ImagePrepBatch batch = {
+          .item = mu_imageprep_premultiply_item,
+          .items_n = images_n,
+          .images = images,
+          .flags = flags,
+     };
+     return mu_imageprep_run_batch(&batch, jobs);
+}
+
+MU_IMAGEPREP_INTERNAL
+Mu_Bool mu_imageprep_mips_item(struct Mu_ImagePrepBatch *batch, int item_i)
+{
+     return Mu_GenerateImageMips(&batch->source_images[item_i], batch->filter, batch->flags, &batch->mips[item_i]);
+}
+
+int Mu_GenerateImagesMips(struct Mu_Image const *images, int images_n, int filter, uint32_t flags,
+                          struct Mu_ImageMips *mips, struct Mu_Jobs *jobs)
+{
+     struct Mu_ImagePrepBatch batch = {
+          .item = mu_imageprep_mips_item,
+          .items_n = images_n,
+          .source_images = images,
+          .flags = flags,
+          .filter = filter,
+          .mips = mips,
+     };
+     return mu_imageprep_run_batch(&batch, jobs);
+}
+
+// Atlas:
+
+// the top of the images of a page, from left to right: [x, x + width[
+// is filled up to y
+struct Mu_AtlasSkylineNode
+{
+     uint32_t x, y, width;
+};
+
+struct Mu_AtlasSkyline
+{
+     int nodes_n;
+     int nodes_capacity;
+     struct Mu_AtlasSkylineNode *nodes;
+};
+
+// lowest y where `w` x `h` fits with its left edge at node `node_i`,
+// UINT32_MAX when it does not
+MU_IMAGEPREP_INTERNAL
+uint32_t mu_atlas_fit(struct Mu_AtlasSkyline const *skyline, int node_i, uint32_t w, uint32_t h, uint32_t page_width, uint32_t page_height)
+{
+     if (skyline->nodes[node_i].x + w > page_width) return UINT32_MAX;
+     uint32_t y = 0;
+     for (uint32_t width_left = w; width_left > 0; ++node_i) {
+          struct Mu_AtlasSkylineNode const *node = &skyline->nodes[node_i];
+          if (node->y > y) y = node->y;
+          if (y + h > page_height) return UINT32_MAX;
+          width_left -= width_left < node->width? width_left : node->width;
+     }
+     return y;
+}
+
+MU_IMAGEPREP_INTERNAL
+Mu_Bool mu_atlas_place(struct Mu_AtlasSkyline *skyline, uint32_t w, uint32_t h, uint32_t page_width, uint32_t page_height,
+                       uint32_t *x, uint32_t *y, Mu_Bool *failed)
+{
+     // bottom-left: the lowest spot, then the narrowest node
+     int best_i = -1;
+     uint32_t best_y = UINT32_MAX, best_width = UINT32_MAX;
+     for (int node_i = 0; node_i < skyline->nodes_n; ++node_i) {
+          uint32_t const node_y = mu_atlas_fit(skyline, node_i, w, h, page_width, page_height);
+          if (node_y < best_y || (node_y == best_y && node_y != UINT32_MAX && skyline->nodes[node_i].width < best_width)) {
+               best_i = node_i;
+               best_y = node_y;
+               best_width = skyline->nodes[node_i].width;
+          }
+     }
+     if (best_i < 0) return MU_FALSE;
+     if (skyline->nodes_n == skyline->nodes_capacity) {
+          int const capacity = skyline->nodes_capacity? 2 * skyline->nodes_capacity : 16;
+          struct Mu_AtlasSkylineNode *nodes = realloc(skyline->nodes, capacity * sizeof *nodes);
+          if (!nodes) {
+               *failed = MU_TRUE;
+               return MU_FALSE;
+          }
+          skyline->nodes = nodes;
+          skyline->nodes_capacity = capacity;
+     }
+     *x = skyline->nodes[best_i].x;
+     *y = best_y;
+
+     // the new node hides the ones under it
+     struct Mu_AtlasSkylineNode *nodes = skyline->nodes;
+     memmove(&nodes[best_i + 1], &nodes[best_i], (skyline->nodes_n - best_i) * sizeof *nodes);
+     nodes[best_i] = (struct Mu_AtlasSkylineNode){ *x, best_y + h, w };
+     ++skyline->nodes_n;
+     uint32_t const right = *x + w;
+     int const next_i = best_i + 1;
+     while (next_i < skyline->nodes_n && nodes[next_i].x < right) {
+          uint32_t const hidden = right - nodes[next_i].x;
+          if (hidden < nodes[next_i].width) {
+               nodes[next_i].x += hidden;
+               nodes[next_i].width -= hidden;
+               break;
+          }
+          memmove(&nodes[next_i], &nodes[next_i + 1], (skyline->nodes_n - next_i - 1) * sizeof *nodes);
+          --skyline->nodes_n;
+     }
+     // and merges with its neighbours at the same height
+     for (int node_i = 0; node_i + 1 < skyline->nodes_n; ) {
+          if (nodes[node_i].y == nodes[node_i + 1].y) {
+               nodes[node_i].width += nodes[node_i + 1].width;
+               memmove(&nodes[node_i + 1], &nodes[node_i + 2], (skyline->nodes_n - node_i - 2) * sizeof *nodes);
+               --skyline->nodes_n;
+          } else {
+               ++node_i;
+          }
+     }
+     return MU_TRUE;
+}
+
+MU_IMAGEPREP_INTERNAL
+Mu_Bool mu_atlas_copy_item(struct Mu_ImagePrepBatch *batch, int image_i)
+{
+     struct Mu_AtlasPlacement const *placement = &batch->placements[image_i];
+     if (placement->page < 0) return MU_FALSE;
+     struct Mu_Image const *image = &batch->source_images[image_i];
+     struct Mu_Image const *page = &batch->atlas->pages[placement->page];
+     int64_t const padding = batch->atlas->padding, h = image->height;
+     uint32_t const stride = Mu_ImageStride(image), width = image->width;
+     for (int64_t y = -padding; y < h + padding; ++y) {
+          uint8_t const *s = image->pixels + (size_t)(y < 0? 0 : y >= h? h - 1 : y) * stride;
+          uint8_t *d = page->pixels + (size_t)(placement->y + y) * page->width * 4 + (size_t)placement->x * 4;
+          for (int64_t x = -padding; x < 0; ++x) memcpy(d + 4 * x, s, 4);
+          memcpy(d, s, (size_t)width * 4);
+          for (int64_t x = width; x < width + padding; ++x) memcpy(d + 4 * x, s + 4 * (width - 1), 4);
+     }
+     return MU_TRUE;
+}
+
+struct Mu_AtlasItem
+{
+     uint32_t width, height;
+     int image_i;
+};
+
+MU_IMAGEPREP_INTERNAL
+int mu_atlas_compare_items(void const *a_, void const *b_)
+{
+     struct Mu_AtlasItem const *a = a_, *b = b_;
+     if (a->height != b->height) return a->height > b->height? -1 : 1;
+     if (a->width != b->width) return a->width > b->width? -1 : 1;
+     return a->image_i - b->image_i;
+}
+
+int Mu_PackAtlas(struct Mu_Atlas *atlas, struct Mu_Image const *images, int images_n,
+                 struct Mu_AtlasPlacement *placements, struct Mu_Jobs *jobs)
+{
+     atlas->pages_n = 0;
+     atlas->pages = NULL;
+     atlas->used_texels_n = 0;
+     if (!atlas->page_width || !atlas->page_height || images_n < 0) return -1;
+
+     // tallest first, which keeps the skyline flat
+     struct Mu_AtlasItem *items = malloc((images_n? images_n : 1) * sizeof *items);
+     if (!items) return -1;
+     int items_n = 0;
+     for (int image_i = 0; image_i < images_n; ++image_i) {
+          struct Mu_Image const *image = &images[image_i];
+          placements[image_i] = (struct Mu_AtlasPlacement){ .page = -1 };
+          uint64_t const w = (uint64_t)image->width + 2 * atlas->padding, h = (uint64_t)image->height + 2 * atlas->padding;
+          if (image->channels != 4 || !image->pixels || !image->width || !image->height) continue;
+          if (w > atlas->page_width || h > atlas->page_height) continue;
+          items[items_n++] = (struct Mu_AtlasItem){ (uint32_t)w, (uint32_t)h, image_i };
+     }
+     qsort(items, items_n, sizeof *items, mu_atlas_compare_items);
+
+     int placed_n = 0;
+     int skylines_capacity = 0;
+     struct Mu_AtlasSkyline *skylines = NULL;
+     Mu_Bool failed = MU_FALSE;
+     for (int item_i = 0; !failed && item_i < items_n; ++item_i) {
+          struct Mu_AtlasItem const *item = &items[item_i];
+          uint32_t x = 0, y = 0;
+          int page_i = 0;
+          while (page_i < atlas->pages_n && !mu_atlas_place(&skylines[page_i], item->width, item->height, atlas->page_width, atlas->page_height, &x, &y, &failed)) {
+               ++page_i;
+          }
+          if (failed) break;
+          if (page_i == atlas->pages_n) {
+               if (atlas->pages_n == skylines_capacity) {
+                    skylines_capacity = skylines_capacity? 2 * skylines_capacity : 4;
+                    struct Mu_AtlasSkyline *grown = realloc(skylines, skylines_capacity * sizeof *grown);
+                    if (!grown) {
+                         failed = MU_TRUE;
+                         break;
+                    }
+                    skylines = grown;
+               }
+               struct Mu_AtlasSkyline *skyline = &skylines[atlas->pages_n++];
+               *skyline = (struct Mu_AtlasSkyline){ .nodes_n = 1, .nodes_capacity = 16 };
+               skyline->nodes = malloc(skyline->nodes_capacity * sizeof *skyline->nodes);
+               if (!skyline->nodes) {
+                    failed = MU_TRUE;
+                    break;
+               }
+               skyline->nodes[0] = (struct Mu_AtlasSkylineNode){ 0, 0, atlas->page_width };
+               mu_atlas_place(skyline, item->width, item->height, atlas->page_width, atlas->page_height, &x, &y, &failed);
+          }
+          placements[item->image_i] = (struct Mu_AtlasPlacement){ page_i, x + atlas->padding, y + atlas->padding };
+          atlas->used_texels_n += (uint64_t)item->width * item->height;
+          ++placed_n;
+     }
+     for (int page_i = 0; page_i < atlas->pages_n; ++page_i) free(skylines[page_i].nodes);
+     free(skylines);
+     free(items);
+
+     if (!failed && atlas->pages_n > 0) {
+          atlas->pages = calloc(atlas->pages_n, sizeof *atlas->pages);
+          failed = !atlas->pages;
+          for (int page_i = 0; !failed && page_i < atlas->pages_n; ++page_i) {
+               struct Mu_Image *page = &atlas->pages[page_i];
+               *page = (struct Mu_Image){ .channels = 4, .width = atlas->page_width, .height = atlas->page_height };
+               page->pixels = calloc((size_t)atlas->page_width * atlas->page_height, 4);
+               failed = !page->pixels;
+          }
+     }
+     if (failed) {
+          Mu_FreeAtlas(atlas);
+          return -1;
+     }
+     struct Mu_ImagePrepBatch batch = {
+          .item = mu_atlas_copy_item,
+          .items_n = images_n,
+          .source_images = images,
+          .atlas = atlas,
+          .placements = placements,
+     };
+     mu_imageprep_run_batch(&batch, jobs);
+     return placed_n;
+}
+
+void Mu_FreeAtlas(struct Mu_Atlas *atlas)
+{
+     for (int page_i = 0; atlas->pages && page_i < atlas->pages_n; ++page_i) free(atlas->pages[page_i].pixels);
+     free(atlas->pages);
+     atlas->pages = NULL;
+     atlas->pages_n = 0;
+     atlas->used_texels_n = 0;
+}
+
+#undef MU_IMAGEPREP_PI
+#undef MU_IMAGEPREP_KAISER_ALPHA
+#undef MU_IMAGEPREP_TARGET_AVX2
+#undef MU_IMAGEPREP_X86
+#undef MU_IMAGEPREP_INTERNAL
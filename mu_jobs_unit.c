@@ -0,0 +1,384 @@
+// @language: c11
+// @dependencylist: xxxx_mu, pthread
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_jobs.h"
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MU_JOBS_INTERNAL static
+#define MU_JOBS_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+enum {
+     MU_JOBS_MAX_WORKERS = 64,
+     MU_JOBS_DEQUE_CAPACITY = 1024, // jobs, a power of two
+     MU_JOBS_CACHE_LINE = 64,
+     MU_JOBS_DEFAULT_FRAME_ARENA_CAPACITY = 1024 * 1024,
+     MU_JOBS_IDLE_ROUNDS = 16, // searches for work before a worker sleeps
+};
+
+struct Mu_JobCounter
+{
+     atomic_int_fast64_t n; // jobs not done yet
+};
+
+// a queued job, written by its owner while thieves may be reading a
+// previous one at the same place: hence atomic fields
+struct Mu_JobsSlot
+{
+     _Atomic(Mu_JobFunction) function;
+     _Atomic(void *) data;
+     _Atomic(struct Mu_JobCounter *) counter;
+};
+
+struct Mu_JobsTask
+{
+     Mu_JobFunction function;
+     void *data;
+     struct Mu_JobCounter *counter;
+};
+
+/*
+ * Chase-Lev deque (Lê et al., "Correct and Efficient Work-Stealing for
+ * Weak Memory Models", 2013): the owner pushes and takes at the bottom,
+ * thieves steal at the top.
+ */
+struct Mu_JobsWorker
+{
+     _Alignas(MU_JOBS_CACHE_LINE) atomic_int_fast64_t top; // @shared
+     _Alignas(MU_JOBS_CACHE_LINE) atomic_int_fast64_t bottom; // @shared
+     struct Mu_JobsSlot slots[MU_JOBS_DEQUE_CAPACITY];
+
+     // single writer, read by Mu_JobsPull
+     atomic_uint_fast64_t jobs_n;
+     atomic_uint_fast64_t steals_n;
+
+     struct Mu_JobsPool *pool;
+     int worker_i;
+     uint32_t random; // victim selection
+     pthread_t thread;
+     Mu_Bool thread_started;
+};
+
+struct Mu_JobsPool
+{
+     int workers_n;
+     pthread_t main_thread; // worker 0
+
+     // sleeping workers wait for `queued_n` to be positive
+     _Alignas(MU_JOBS_CACHE_LINE) atomic_int_fast64_t queued_n; // @shared
+     atomic_int sleeping_n; // @shared
+     atomic_bool quit; // @shared
+     pthread_mutex_t mutex;
+     pthread_cond_t cond;
+
+     // frame arena
+     _Alignas(MU_JOBS_CACHE_LINE) atomic_size_t arena_bytes_n; // @shared
+     uint8_t *arena_bytes;
+     size_t arena_capacity;
+
+     struct Mu_JobsWorker workers[];
+};
+
+// of the worker threads, the main thread is found from `main_thread`
+MU_JOBS_INTERNAL _Thread_local struct Mu_JobsWorker *mu_jobs_thread_worker;
+
+MU_JOBS_INTERNAL
+struct Mu_JobsWorker *mu_jobs_current_worker(struct Mu_JobsPool *pool)
+{
+     if (pthread_equal(pthread_self(), pool->main_thread)) return &pool->workers[0];
+     struct Mu_JobsWorker *worker = mu_jobs_thread_worker;
+     return worker && worker->pool == pool? worker : NULL;
+}
+
+// Section: Deques
+
+MU_JOBS_INTERNAL
+Mu_Bool mu_jobs_push(struct Mu_JobsWorker *worker, struct Mu_JobsTask const *task)
+{
+     int_fast64_t const bottom = atomic_load_explicit(&worker->bottom, memory_order_relaxed);
+     int_fast64_t const top = atomic_load_explicit(&worker->top, memory_order_acquire);
+     if (bottom - top >= MU_JOBS_DEQUE_CAPACITY) return MU_FALSE;
+     struct Mu_JobsSlot *slot = &worker->slots[bottom & (MU_JOBS_DEQUE_CAPACITY - 1)];
+     atomic_store_explicit(&slot->function, task->function, memory_order_relaxed);
+     atomic_store_explicit(&slot->data, task->data, memory_order_relaxed);
+     atomic_store_explicit(&slot->counter, task->counter, memory_order_relaxed);
+     atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_release);
+     return MU_TRUE;
+}
+
+MU_JOBS_INTERNAL
+void mu_jobs_read_slot(struct Mu_JobsWorker *worker, int_fast64_t i, struct Mu_JobsTask *task)
+{
+     struct Mu_JobsSlot *slot = &worker->slots[i & (MU_JOBS_DEQUE_CAPACITY - 1)];
+     task->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+     task->data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+     task->counter = atomic_load_explicit(&slot->counter, memory_order_relaxed);
+}
+
+// owner only: the most recently pushed job
+MU_JOBS_INTERNAL
+Mu_Bool mu_jobs_take(struct Mu_JobsWorker *worker, struct Mu_JobsTask *task)
+{
+     int_fast64_t const bottom = atomic_load_explicit(&worker->bottom, memory_order_relaxed) - 1;
+     atomic_store_explicit(&worker->bottom, bottom, memory_order_relaxed);
+     atomic_thread_fence(memory_order_seq_cst);
+     int_fast64_t top = atomic_load_explicit(&worker->top, memory_order_relaxed);
+     if (top > bottom) {
+          atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+          return MU_FALSE;
+     }
+     mu_jobs_read_slot(worker, bottom, task);
+     if (top < bottom) return MU_TRUE;
+     // the last job: race the thieves for it
+     Mu_Bool const taken = atomic_compare_exchange_strong_explicit(&worker->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+     atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+     return taken;
+}
+
+// any thread: the oldest job
+MU_JOBS_INTERNAL
+Mu_Bool mu_jobs_steal(struct Mu_JobsWorker *worker, struct Mu_JobsTask *task)
+{
+     int_fast64_t top = atomic_load_explicit(&worker->top, memory_order_acquire);
+     atomic_thread_fence(memory_order_seq_cst);
+     int_fast64_t const bottom = atomic_load_explicit(&worker->bottom, memory_order_acquire);
+     if (top >= bottom) return MU_FALSE;
+     mu_jobs_read_slot(worker, top, task);
+     return atomic_compare_exchange_strong_explicit(&worker->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+// Section: Workers
+
+// single writer: a plain load and store, which other threads may read at any time
+MU_JOBS_INTERNAL
+void mu_jobs_stats_add(atomic_uint_fast64_t *counter, uint64_t n)
+{
+     atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+MU_JOBS_INTERNAL
+void mu_jobs_execute(struct Mu_JobsWorker *worker, struct Mu_JobsTask const *task)
+{
+     task->function(task->data);
+     if (task->counter) atomic_fetch_sub_explicit(&task->counter->n, 1, memory_order_acq_rel);
+     if (worker) mu_jobs_stats_add(&worker->jobs_n, 1);
+}
+
+// own jobs first, then those of the others, starting from a random one
+MU_JOBS_INTERNAL
+Mu_Bool mu_jobs_find(struct Mu_JobsPool *pool, struct Mu_JobsWorker *worker, struct Mu_JobsTask *task)
+{
+     if (mu_jobs_take(worker, task)) {
+          atomic_fetch_sub_explicit(&pool->queued_n, 1, memory_order_relaxed);
+          return MU_TRUE;
+     }
+     worker->random ^= worker->random << 13;
+     worker->random ^= worker->random >> 17;
+     worker->random ^= worker->random << 5;
+     int const first_i = (int)(worker->random % (uint32_t)pool->workers_n);
+     for (int victim_n = 0; victim_n < pool->workers_n; ++victim_n) {
+          int const victim_i = (first_i + victim_n) % pool->workers_n;
+          if (victim_i == worker->worker_i) continue;
+          if (mu_jobs_steal(&pool->workers[victim_i], task)) {
+               atomic_fetch_sub_explicit(&pool->queued_n, 1, memory_order_relaxed);
+               mu_jobs_stats_add(&worker->steals_n, 1);
+               return MU_TRUE;
+          }
+     }
+     return MU_FALSE;
+}
+
+MU_JOBS_INTERNAL
+void *mu_jobs_worker_main(void *argument)
+{
+     struct Mu_JobsWorker *worker = argument;
+     struct Mu_JobsPool *pool = worker->pool;
+     mu_jobs_thread_worker = worker;
+     for (int idle_n = 0;;) {
+          struct Mu_JobsTask task;
+          if (mu_jobs_find(pool, worker, &task)) {
+               mu_jobs_execute(worker, &task);
+               idle_n = 0;
+               continue;
+          }
+          if (atomic_load(&pool->quit)) break;
+          if (++idle_n < MU_JOBS_IDLE_ROUNDS) {
+               sched_yield();
+               continue;
+          }
+          // sleeping_n, then queued_n: either we see the job, or its
+          // producer sees us and wakes us up
+          pthread_mutex_lock(&pool->mutex);
+          atomic_fetch_add(&pool->sleeping_n, 1);
+          while (atomic_load(&pool->queued_n) <= 0 && !atomic_load(&pool->quit)) {
+               pthread_cond_wait(&pool->cond, &pool->mutex);
+          }
+          atomic_fetch_sub(&pool->sleeping_n, 1);
+          pthread_mutex_unlock(&pool->mutex);
+          idle_n = 0;
+     }
+     return NULL;
+}
+
+// Section: API
+
+Mu_Bool Mu_JobsInitialize(struct Mu_Jobs *jobs)
+{
+     int workers_n = jobs->workers_n;
+     if (workers_n <= 0) workers_n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+     if (workers_n < 1) workers_n = 1;
+     if (workers_n > MU_JOBS_MAX_WORKERS) workers_n = MU_JOBS_MAX_WORKERS;
+     size_t const arena_capacity = jobs->frame_arena_capacity? jobs->frame_arena_capacity : MU_JOBS_DEFAULT_FRAME_ARENA_CAPACITY;
+
+     size_t const pool_size = sizeof (struct Mu_JobsPool) + workers_n * sizeof (struct Mu_JobsWorker);
+     struct Mu_JobsPool *pool = aligned_alloc(MU_JOBS_CACHE_LINE, (pool_size + MU_JOBS_CACHE_LINE - 1) & ~(size_t)(MU_JOBS_CACHE_LINE - 1));
+     uint8_t *arena_bytes = aligned_alloc(MU_JOBS_CACHE_LINE, (arena_capacity + MU_JOBS_CACHE_LINE - 1) & ~(size_t)(MU_JOBS_CACHE_LINE - 1));
+     if (!pool || !arena_bytes) {
+          free(pool);
+          free(arena_bytes);
+          return MU_FALSE;
+     }
+     memset(pool, 0, pool_size);
+     pool->workers_n = workers_n;
+     pool->main_thread = pthread_self();
+     atomic_init(&pool->queued_n, 0);
+     atomic_init(&pool->sleeping_n, 0);
+     atomic_init(&pool->quit, MU_FALSE);
+     atomic_init(&pool->arena_bytes_n, 0);
+     pool->arena_bytes = arena_bytes;
+     pool->arena_capacity = arena_capacity;
+     pthread_mutex_init(&pool->mutex, NULL);
+     pthread_cond_init(&pool->cond, NULL);
+     for (int worker_i = 0; worker_i < workers_n; ++worker_i) {
+          struct Mu_JobsWorker *worker = &pool->workers[worker_i];
+          atomic_init(&worker->top, 0);
+          atomic_init(&worker->bottom, 0);
+          atomic_init(&worker->jobs_n, 0);
+          atomic_init(&worker->steals_n, 0);
+          worker->pool = pool;
+          worker->worker_i = worker_i;
+          worker->random = 0x9e3779b9u * (uint32_t)(worker_i + 1);
+     }
+     jobs->pool = pool;
+     for (int worker_i = 1; worker_i < workers_n; ++worker_i) {
+          struct Mu_JobsWorker *worker = &pool->workers[worker_i];
+          worker->thread_started = 0 == pthread_create(&worker->thread, NULL, mu_jobs_worker_main, worker);
+          if (!worker->thread_started) {
+               MU_JOBS_TRACEF("ERROR: could not start job worker %d\n", worker_i);
+               Mu_JobsClose(jobs);
+               return MU_FALSE;
+          }
+     }
+     jobs->workers_n = workers_n;
+     return MU_TRUE;
+}
+
+void Mu_JobsClose(struct Mu_Jobs *jobs)
+{
+     struct Mu_JobsPool *pool = jobs->pool;
+     if (!pool) return;
+     pthread_mutex_lock(&pool->mutex);
+     atomic_store(&pool->quit, MU_TRUE);
+     pthread_cond_broadcast(&pool->cond);
+     pthread_mutex_unlock(&pool->mutex);
+     for (int worker_i = 1; worker_i < pool->workers_n; ++worker_i) {
+          if (pool->workers[worker_i].thread_started) pthread_join(pool->workers[worker_i].thread, NULL);
+     }
+     pthread_mutex_destroy(&pool->mutex);
+     pthread_cond_destroy(&pool->cond);
+     free(pool->arena_bytes);
+     free(pool);
+     jobs->pool = NULL;
+}
+
+void Mu_JobsPull(struct Mu_Jobs *jobs)
+{
+     struct Mu_JobsPool *pool = jobs->pool;
+     if (!pool) return;
+     uint64_t jobs_n = 0, steals_n = 0;
+     for (int worker_i = 0; worker_i < pool->workers_n; ++worker_i) {
+          jobs_n += atomic_load_explicit(&pool->workers[worker_i].jobs_n, memory_order_relaxed);
+          steals_n += atomic_load_explicit(&pool->workers[worker_i].steals_n, memory_order_relaxed);
+     }
+     size_t const arena_bytes_n = atomic_exchange_explicit(&pool->arena_bytes_n, 0, memory_order_relaxed);
+     jobs->jobs_n = jobs_n;
+     jobs->steals_n = steals_n;
+     jobs->frame_arena_bytes_n = arena_bytes_n < pool->arena_capacity? arena_bytes_n : pool->arena_capacity;
+}
+
+void *Mu_JobsFrameAlloc(struct Mu_Jobs *jobs, size_t size)
+{
+     struct Mu_JobsPool *pool = jobs->pool;
+     size_t const n = (size + MU_JOBS_CACHE_LINE - 1) & ~(size_t)(MU_JOBS_CACHE_LINE - 1);
+     size_t const offset = atomic_fetch_add_explicit(&pool->arena_bytes_n, n, memory_order_relaxed);
+     if (offset + n > pool->arena_capacity) return NULL;
+     return pool->arena_bytes + offset;
+}
+
+struct Mu_JobCounter *Mu_JobsCounter(struct Mu_Jobs *jobs)
+{
+     struct Mu_JobCounter *counter = Mu_JobsFrameAlloc(jobs, sizeof *counter);
+     if (counter) atomic_init(&counter->n, 0);
+     return counter;
+}
+
+void Mu_JobsRun(struct Mu_Jobs *jobs, struct Mu_Job const *jobs_list, int jobs_n, struct Mu_JobCounter *counter)
+{
+     struct Mu_JobsPool *pool = jobs->pool;
+     if (jobs_n <= 0) return;
+     if (counter) atomic_fetch_add_explicit(&counter->n, jobs_n, memory_order_relaxed);
+     struct Mu_JobsWorker *worker = mu_jobs_current_worker(pool);
+     int pushed_n = 0;
+     for (int job_i = 0; job_i < jobs_n; ++job_i) {
+          struct Mu_JobsTask const task = { jobs_list[job_i].function, jobs_list[job_i].data, counter };
+          if (worker && pool->workers_n > 1 && mu_jobs_push(worker, &task)) ++pushed_n;
+          else mu_jobs_execute(worker, &task);
+     }
+     if (pushed_n == 0) return;
+     atomic_fetch_add(&pool->queued_n, pushed_n);
+     if (atomic_load(&pool->sleeping_n) > 0) {
+          pthread_mutex_lock(&pool->mutex);
+          if (pushed_n > 1) pthread_cond_broadcast(&pool->cond);
+          else pthread_cond_signal(&pool->cond);
+          pthread_mutex_unlock(&pool->mutex);
+     }
+}
+
+void Mu_JobsWait(struct Mu_Jobs *jobs, struct Mu_JobCounter *counter)
+{
+     struct Mu_JobsPool *pool = jobs->pool;
+     struct Mu_JobsWorker *worker = mu_jobs_current_worker(pool);
+     while (atomic_load_explicit(&counter->n, memory_order_acquire) > 0) {
+          struct Mu_JobsTask task;
+          if (worker && mu_jobs_find(pool, worker, &task)) mu_jobs_execute(worker, &task);
+          else sched_yield();
+     }
+}
+
+void Mu_JobsRunAndWait(struct Mu_Jobs *jobs, struct Mu_Job const *jobs_list, int jobs_n)
+{
+     struct Mu_JobCounter counter;
+     atomic_init(&counter.n, 0);
+     Mu_JobsRun(jobs, jobs_list, jobs_n, &counter);
+     Mu_JobsWait(jobs, &counter);
+}
+
+int Mu_JobsWorkerIndex(struct Mu_Jobs const *jobs)
+{
+     struct Mu_JobsWorker const *worker = mu_jobs_current_worker(jobs->pool);
+     return worker? worker->worker_i : -1;
+}
+
+#undef MU_JOBS_TRACEF
+#undef MU_JOBS_INTERNAL
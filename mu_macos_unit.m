@@ -9,9 +9,8 @@
 // Integration:
 // ------------
 //
-// this file MUST be compiled in its own translation unit, unless you
-// define the preprocessor macro _XOPEN_SOURCE=600 or
-// MU_MACOS_RUN_MODE_PLAIN.
+// this file MUST be compiled in its own translation unit, and linked
+// with mu_fiber_unit.c unless you define MU_MACOS_RUN_MODE_PLAIN.
 
 // Configuration macros:
 // ---------------------
@@ -32,7 +31,8 @@
 // Gamepad support has been implemented for the Sony DUALSHOCK4. In
 // theory it's easy to add new mappings for a USB-HID compliant
 // controllers, check @fn{mu_gamepad_initialize} and how it sets the
-// hid mapping table.
+// hid mapping table. Decoding is shared with the other platforms, in
+// mu_gamepad_unit.c
 //
 //
 // Implementation Details
@@ -40,20 +40,20 @@
 //
 // To let the user-code run continously during a resize, we implement
 // a fiber-based solution similar to what Per Vognsen implemented on
-// windows, this time using the setcontext/getcontext/swapcontext BSD
-// APIs. These have been deprecated from POSIX but BSD kernels like
-// darwin should still support them.
+// windows, this time with the context switch of mu_fiber_unit.c
+// (x86-64 and arm64), which unlike swapcontext makes no system call.
 //
 // Nevertheless if you have any problem with them, simply define
 // MU_MACOS_RUN_MODE_PLAIN before compiling.
 
-#if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
-#define _XOPEN_SOURCE 600
-#include <ucontext.h>
-#endif
-
 #include "xxxx_mu.h" // public API as published by Per Vognsen
+#include "xxxx_mu_audioblock.h"
 #include "xxxx_mu_cocoa.h"
+#include "xxxx_mu_fiber.h"
+#include "xxxx_mu_gamepad.h"
+#include "xxxx_mu_jobs.h"
+#include "xxxx_mu_stats.h"
+#include "xxxx_mu_telemetry.h"
 
 #include <AppKit/AppKit.h>
 #include <CoreAudio/AudioHardware.h>
@@ -152,55 +152,16 @@ enum {
 // @todo @idea{
 // @url: https://github.com/gabomdq/SDL_GameControllerDB
 // }
-struct Mu_HIDAddress
-{
-     uint16_t usage_page;
-     uint16_t usage;
-};
-
-enum
-{
-     MU_HID_MAPPING_MAX_STATES = 4,
-};
-
-struct Mu_Gamepad_HID_Mapping_DigitalButton
-{
-     struct Mu_HIDAddress address;
-     // states_n == 0 for normal buttons, otherwise states_n <=
-     // MU_HID_MAPPING_MAX_STATES for HID buttons that trigger on
-     // different discrete values. (Hatswitch)
-     int states_n;
-     int states[MU_HID_MAPPING_MAX_STATES];     
-};
-
-struct Mu_Gamepad_HID_Mapping_AnalogButton
-{
-     struct Mu_HIDAddress address;
-     float xmin, xmax;
-};
-
-struct Mu_Gamepad_HID_Mapping_Stick
-{
-     struct Mu_HIDAddress x_address;
-     float xmin, xmax;
-     struct Mu_HIDAddress y_address;
-     float ymin, ymax;
-};
+//
+// The mapping data-structures are in xxxx_mu_gamepad.h
 
-// Descriptors of how HID elements are bound to members of Mu_Gamepad
-struct Mu_Gamepad_HID_Mapping
+// One of `session->gamepads`, context of its IOKit callbacks
+struct Mu_GamepadDevice
 {
-#define X(button_name) struct Mu_Gamepad_HID_Mapping_DigitalButton button_name;
-     MU_GAMEPAD_DIGITAL_BUTTONS_XENUM
-#undef X
-     
-#define X(analog_button_name) struct Mu_Gamepad_HID_Mapping_AnalogButton analog_button_name;
-     MU_GAMEPAD_ANALOG_BUTTONS_XENUM
-#undef X
-
-#define X(stick_name) struct Mu_Gamepad_HID_Mapping_Stick stick_name;
-     MU_GAMEPAD_STICKS_XENUM
-#undef X
+     struct Mu_Session *session;
+     int gamepad_i;
+     IOHIDDeviceRef device; // NULL once removed
+     uint8_t report[MU_GAMEPAD_MAX_REPORT]; // @shared(IOKit)
 };
 
 // Persistent data-structure holding resources and data that are
@@ -213,22 +174,29 @@ struct Mu_Session
      struct Mu *pull_destination;
 
      mach_timebase_info_data_t timebase;
+     uint64_t initial_ticks; // copy of `mu->time.initial_ticks`, for the audio thread
+
+     // timings of the frame in progress, recorded by the next Mu_Pull
+     // @clock{mach_absolute_time} ticks
+     struct Mu_FrameTimer frame_timer;
 
 #if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
-     char* run_loop_fiber_stack;
-     ucontext_t run_loop_fiber;
-     ucontext_t main_fiber;
+     struct Mu_Fiber run_loop_fiber;
+     struct Mu_Fiber main_fiber;
 #endif
      // gamepad    
      IOHIDManagerRef hidmanager;
-     struct Mu_Gamepad_HID_Mapping gamepad_hid_mapping;
 
      // can be touched more than once per `Mu_Pull`, due to the event
-     // based nature of the Macos IOKit APIs.
-     struct Mu_Gamepad gamepad; 
+     // based nature of the Macos IOKit APIs. In the order of `mu->gamepads`
+     struct Mu_GamepadSlot gamepads[MU_MAX_GAMEPADS];
+     struct Mu_GamepadDevice gamepad_devices[MU_MAX_GAMEPADS];
+     int gamepads_n;
      
      // video&opengl session state
      Mu_WindowDelegate *window_delegate;
+     uint8_t *framebuffer_pixels; // `mu->framebuffer.pixels`, rows 64 bytes aligned
+     size_t framebuffer_capacity;
      Mu_OpenGLView *opengl_view;
      Mu_Bool macos_wants_us_to_quit;
      
@@ -239,6 +207,17 @@ struct Mu_Session
      AudioDeviceIOProcID IOProcID;
      int audio_channels_n;
      int audio_channels[MU_MAX_AUDIO_CHANNELS];
+     struct Mu_AudioTelemetry audio_telemetry;
+     uint64_t audio_restarts_n;
+     struct Mu_AudioBlockAdapter audio_blocks;
+     void *audio_buffer; // a period when the device is not interleaved like us, 64 bytes aligned
+     uint32_t audio_buffer_frames;
+
+     // frames passed to the callback so far, and when they are heard
+     uint64_t audio_frames_n; // audio thread only
+     atomic_uint audio_clock_sequence; // odd while being written
+     atomic_uint_fast64_t audio_clock_frames_n;
+     atomic_uint_fast64_t audio_clock_output_ticks;
 #if !defined(NDEBUG)
      // @debug signal
      double audio_debug_signal_phase;
@@ -309,6 +288,85 @@ OSStatus mu_coreaudio_property_listener(AudioObjectID inObjectID, UInt32 inNumbe
      return noErr;
 }
 
+// Audio Clock:
+// a sequence lock, written by the audio thread without waiting
+
+MU_MACOS_INTERNAL
+void mu_audio_clock_publish(struct Mu_Session *session, uint64_t frames_n, uint64_t output_ticks)
+{
+     unsigned const sequence = atomic_load_explicit(&session->audio_clock_sequence, memory_order_relaxed);
+     atomic_store_explicit(&session->audio_clock_sequence, sequence + 1, memory_order_relaxed);
+     atomic_thread_fence(memory_order_release);
+     atomic_store_explicit(&session->audio_clock_frames_n, frames_n, memory_order_relaxed);
+     atomic_store_explicit(&session->audio_clock_output_ticks, output_ticks, memory_order_relaxed);
+     atomic_store_explicit(&session->audio_clock_sequence, sequence + 2, memory_order_release);
+}
+
+MU_MACOS_INTERNAL
+void mu_audio_clock_pull(struct Mu *mu, struct Mu_Session *session)
+{
+     for (;;) {
+          unsigned const sequence = atomic_load_explicit(&session->audio_clock_sequence, memory_order_acquire);
+          uint64_t const frames_n = atomic_load_explicit(&session->audio_clock_frames_n, memory_order_relaxed);
+          uint64_t const output_ticks = atomic_load_explicit(&session->audio_clock_output_ticks, memory_order_relaxed);
+          atomic_thread_fence(memory_order_acquire);
+          if ((sequence & 1) == 0 && sequence == atomic_load_explicit(&session->audio_clock_sequence, memory_order_relaxed)) {
+               mu->audio.clock = (struct Mu_AudioClock){ .frames_n = frames_n, .output_ticks = output_ticks };
+               return;
+          }
+     }
+}
+
+MU_MACOS_INTERNAL
+AudioObjectPropertyAddress const MU_MACOS_COREAUDIO_OVERLOAD_PROPERTY_ADDRESS = (AudioObjectPropertyAddress){.mSelector=kAudioDeviceProcessorOverload, .mScope=kAudioObjectPropertyScopeGlobal, .mElement=kAudioObjectPropertyElementMaster};
+
+// the device missed a cycle, i.e. the IO proc (or another one) was late
+MU_MACOS_INTERNAL
+OSStatus mu_coreaudio_overload_listener(AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress *inAddresses, void *inClientData)
+{
+     struct Mu_Session *session = inClientData;
+     Mu_AddAudioUnderrun(&session->audio_telemetry);
+     return noErr;
+}
+
+MU_MACOS_INTERNAL
+void mu_coreaudio_render_block(void *context, struct Mu_AudioBuffer *audiobuffer)
+{
+     struct Mu_Session *session = context;
+#if !defined(NDEBUG)
+     // @debug default signal to let users know they should fill up the buffer
+     {
+          int const channels_n = audiobuffer->format.channels;
+          int const frame_n = audiobuffer->samples_count / channels_n;
+          double phase = session->audio_debug_signal_phase;
+          double const phase_inc = session->audio_debug_signal_phase_inc;
+          for (int frame_i = 0; frame_i < frame_n; frame_i++, phase += phase_inc) {
+               double const y = 328*cos(6.2831853071795864769252*phase);
+               for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+                    if (audiobuffer->format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) {
+                         audiobuffer->float_samples[channels_n*frame_i + channel_i] = y/32768.0;
+                    } else {
+                         audiobuffer->samples[channels_n*frame_i + channel_i] = y;
+                    }
+               }
+          }
+          while (phase >= 1.0) phase -= 1.0;
+          session->audio_debug_signal_phase = phase;
+     }
+#endif
+     session->audio.callback(audiobuffer);
+}
+
+MU_MACOS_INTERNAL
+void mu_coreaudio_render(struct Mu_Session *session, struct Mu_AudioBuffer *audiobuffer)
+{
+     uint64_t const t0 = mach_absolute_time();
+     Mu_AdaptAudioBlocks(&session->audio_blocks, audiobuffer);
+     uint64_t const dt = (mach_absolute_time() - t0) * session->timebase.numer / session->timebase.denom;
+     Mu_RecordAudioCallback(&session->audio_telemetry, audiobuffer->samples_count / audiobuffer->format.channels,
+                               audiobuffer->format.samples_per_second, dt);
+}
+
 MU_MACOS_INTERNAL
 OSStatus
 mu_coreaudio_callback(
@@ -355,40 +413,63 @@ mu_coreaudio_callback(
 	  }
      }
 
-     if (found_outputs_n < outputs_n) return noErr;
-     if (outputs[0].frame_n != outputs[1].frame_n) return noErr; // actually that's weird
-     if (outputs[0].frame_n == 0) return noErr; // that's weird too
+     // the device plays these buffers without our samples
+     if (found_outputs_n < outputs_n
+         || outputs[0].frame_n != outputs[1].frame_n // actually that's weird
+         || outputs[0].frame_n == 0) { // that's weird too
+          Mu_AddAudioUnderrun(&session->audio_telemetry);
+          return noErr;
+     }
      
-     // generate into temporary buffers
-     struct Mu_AudioFormat audioformat = {
+     struct Mu_AudioFormat const audioformat = {
 	  .samples_per_second = session->audio.format.samples_per_second,
 	  .channels = 2,
-	  .bytes_per_sample = sizeof (int16_t),
+	  .bytes_per_sample = session->audio.format.bytes_per_sample,
+	  .sample_format = session->audio.format.sample_format,
      };
      int const frame_n = outputs[0].frame_n;
-     int16_t client_buffer[audioformat.channels*frame_n];
-#if !defined(NDEBUG)
-     // @debug default signal to let users know they should fill up the buffer
-     {
-          int const channels_n = audioformat.channels;
-          double phase = session->audio_debug_signal_phase;
-          double const phase_inc = session->audio_debug_signal_phase_inc;
-          for (int frame_i = 0; frame_i < frame_n; frame_i++, phase += phase_inc) {
-               double const y = 328*cos(6.2831853071795864769252*phase);
-               for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
-                    client_buffer[channels_n*frame_i + channel_i] = y;
-               }
-          }
-          while (phase >= 1.0) phase -= 1.0;
-          session->audio_debug_signal_phase = phase;
+     Mu_Bool const interleaved = outputs[0].frame_stride == audioformat.channels && outputs[1].dest == outputs[0].dest + 1;
+     if (frame_n > session->audio_buffer_frames
+         && !(audioformat.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32 && interleaved)) {
+          // larger than any period the device announced
+          Mu_AddAudioUnderrun(&session->audio_telemetry);
+          return noErr;
+     }
+     /* audio clock */ {
+          uint64_t const output_host_ticks = (inOutputTime->mFlags & kAudioTimeStampHostTimeValid)? inOutputTime->mHostTime : mach_absolute_time();
+          mu_audio_clock_publish(session, session->audio_frames_n, output_host_ticks - session->initial_ticks);
+          session->audio_frames_n += frame_n;
      }
-#endif
      struct Mu_AudioBuffer audiobuffer = {
-	  .samples = client_buffer,
 	  .samples_count = frame_n * audioformat.channels,
 	  .format = audioformat
      };
-     session->audio.callback(&audiobuffer);
+
+     if (audioformat.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) {
+	  if (interleaved) {
+	       // the device buffer is interleaved like ours, render in place
+	       audiobuffer.float_samples = outputs[0].dest;
+	       mu_coreaudio_render(session, &audiobuffer);
+	       return noErr;
+	  }
+	  // generate into temporary buffers
+	  float *client_buffer = session->audio_buffer;
+	  audiobuffer.float_samples = client_buffer;
+	  mu_coreaudio_render(session, &audiobuffer);
+	  // emit to destination
+	  for (int c_i = 0; c_i < 2; ++c_i) {
+	       struct Output const output = outputs[c_i];
+	       for (int frame_i = 0; frame_i < frame_n; ++frame_i) {
+		    output.dest[frame_i * output.frame_stride] = client_buffer[2*frame_i + c_i];
+	       }
+	  }
+	  return noErr;
+     }
+
+     // generate into temporary buffers
+     int16_t *client_buffer = session->audio_buffer;
+     audiobuffer.samples = client_buffer;
+     mu_coreaudio_render(session, &audiobuffer);
 
      // convert+emit to destination
      for (int c_i = 0; c_i < 2; ++c_i) {
@@ -493,9 +574,49 @@ mu_audio_output_start(struct Mu *mu, struct Mu_Session *session)
 	  }
      }
 
+     uint32_t const sample_format = mu->audio.format.sample_format;
      mu->audio.format = mu_audio_audioformat;
      mu->audio.format.samples_per_second = selected_format.mFormat.mSampleRate;
+     if (sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) {
+	  mu->audio.format.sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+	  mu->audio.format.bytes_per_sample = sizeof (float);
+     }
      session->DeviceID = output_device;
+
+     // the device period: the one asked for when it is in range, otherwise what the device has
+     AudioObjectPropertyAddress const buffer_frame_size_address = {.mSelector=kAudioDevicePropertyBufferFrameSize, .mScope=kAudioObjectPropertyScopeGlobal, .mElement=kAudioObjectPropertyElementMaster};
+     if (mu->audio.device_period_frames) {
+	  UInt32 const frames = mu->audio.device_period_frames;
+	  if (AudioObjectSetPropertyData(output_device, &buffer_frame_size_address, 0, NULL, sizeof frames, &frames) != noErr) {
+	       MU_MACOS_TRACEF("could not set audio device period to %u frames\n", (unsigned)frames);
+	  }
+     }
+     UInt32 period_frames = 0;
+     for (UInt32 size = sizeof period_frames; AudioObjectGetPropertyData(output_device, &buffer_frame_size_address, 0, NULL, &size, &period_frames) != noErr; ) {
+	  period_frames = 0;
+	  break;
+     }
+     AudioValueRange period_frames_range = { 0 };
+     for (UInt32 size = sizeof period_frames_range; AudioObjectGetPropertyData(output_device, &((AudioObjectPropertyAddress){.mSelector=kAudioDevicePropertyBufferFrameSizeRange, .mScope=kAudioObjectPropertyScopeGlobal, .mElement=kAudioObjectPropertyElementMaster}), 0, NULL, &size, &period_frames_range) != noErr; ) {
+	  period_frames_range.mMaximum = period_frames;
+	  break;
+     }
+     mu->audio.device_period_frames = period_frames;
+     mu->audio.block_latency_frames = Mu_AudioBlockLatencyFrames(mu->audio.block_frames, period_frames);
+     session->audio_buffer_frames = period_frames_range.mMaximum > period_frames? (uint32_t)period_frames_range.mMaximum : period_frames;
+     if (session->audio_buffer_frames > MU_MAX_AUDIO_BLOCK_FRAMES) session->audio_buffer_frames = MU_MAX_AUDIO_BLOCK_FRAMES;
+     size_t const audio_buffer_bytes_n = (size_t)session->audio_buffer_frames * mu->audio.format.channels * mu->audio.format.bytes_per_sample;
+     free(session->audio_buffer);
+     session->audio_buffer = aligned_alloc(64, (audio_buffer_bytes_n + 63) & ~(size_t)63);
+     if (!session->audio_buffer && audio_buffer_bytes_n) {
+	  mu->error = "could not allocate audio buffer";
+	  goto error;
+     }
+     Mu_FreeAudioBlockAdapter(&session->audio_blocks);
+     if (!Mu_InitializeAudioBlockAdapter(&session->audio_blocks, &mu->audio.format, mu->audio.block_frames, mu_coreaudio_render_block, session)) {
+	  mu->error = "could not allocate audio blocks, or unsupported block size";
+	  goto error;
+     }
      session->audio = mu->audio;
 #if !defined(NDEBUG)
      session->audio_debug_signal_phase_inc = 1000.0 / mu->audio.format.samples_per_second;
@@ -510,6 +631,9 @@ mu_audio_output_start(struct Mu *mu, struct Mu_Session *session)
 	  mu->error = "coult not start audio device";
 	  goto error;
      }
+     if (AudioObjectAddPropertyListener(output_device, &MU_MACOS_COREAUDIO_OVERLOAD_PROPERTY_ADDRESS, mu_coreaudio_overload_listener, session) != noErr) {
+	  MU_MACOS_TRACEF("could not listen to audio overloads");
+     }
      return MU_TRUE;
 error_allocated_streams:
      free(streams);
@@ -540,6 +664,7 @@ void
 mu_audio_output_close(struct Mu* mu, struct Mu_Session* session)
 {
      if (session->DeviceID && session->IOProcID) {
+	  AudioObjectRemovePropertyListener(session->DeviceID, &MU_MACOS_COREAUDIO_OVERLOAD_PROPERTY_ADDRESS, mu_coreaudio_overload_listener, session);
 	  if (AudioDeviceStop(session->DeviceID, mu_coreaudio_callback) != noErr
 	      || AudioDeviceDestroyIOProcID(session->DeviceID, session->IOProcID) != noErr) {
 	       MU_MACOS_TRACEF("could not close audio device");
@@ -547,6 +672,9 @@ mu_audio_output_close(struct Mu* mu, struct Mu_Session* session)
 	  session->DeviceID = 0;
 	  session->IOProcID = 0;
      }
+     Mu_FreeAudioBlockAdapter(&session->audio_blocks);
+     free(session->audio_buffer), session->audio_buffer = NULL;
+     session->audio_buffer_frames = 0;
 }
 
 @implementation Mu_WindowDelegate
@@ -589,7 +717,10 @@ MU_MACOS_INTERNAL
 Mu_Bool mu_time_initialize(struct Mu *mu, struct Mu_Session *session)
 {
   if (mach_timebase_info(&session->timebase)) return MU_FALSE;
+  session->frame_timer.ticks_numer = session->timebase.numer;
+  session->frame_timer.ticks_denom = session->timebase.denom;
   mu->time.initial_ticks = mach_absolute_time();
+  session->initial_ticks = mu->time.initial_ticks;
   mu->time.ticks_per_second = 1000*1000*1000*session->timebase.numer/session->timebase.denom;
   mu_time_update(mu, session, mu->time.initial_ticks);
   return MU_TRUE;
@@ -715,150 +846,89 @@ void mu_update_digital_button(struct Mu_DigitalButton *button, Mu_Bool is_down)
 {
      Mu_Bool was_down = button->down;
      button->down = is_down;
-     button->pressed = !was_down && is_down;
-     button->released = was_down && !is_down;
-}
-
-MU_MACOS_INTERNAL
-void mu_update_analog_button(struct Mu_AnalogButton *button, float const value)
-{
-     Mu_Bool is_down = (value >= button->threshold);
-     Mu_Bool was_down = button->down;
-     button->value = value;
-     button->down = is_down;
-     button->pressed = !was_down && is_down;
-     button->released = was_down && !is_down;
-}
-
-MU_MACOS_INTERNAL
-void mu_update_stick(struct Mu_Stick *stick, float const x, float const y)
-{
-     stick->x = x;
-     stick->y = y;
-     if (fabs(stick->x) <= stick->threshold) stick->x = 0.0f;
-     if (fabs(stick->y) <= stick->threshold) stick->y = 0.0f;
-}
-
-
-// Mu Gamepads
-
-MU_MACOS_INTERNAL
-Mu_Bool mu_gamepad_hidaddress_equals(struct Mu_HIDAddress a, struct Mu_HIDAddress b)
-{
-     return a.usage_page == b.usage_page && a.usage == b.usage;
+     button->pressed |= !was_down && is_down;
+     button->released |= was_down && !is_down;
+     if (was_down != is_down && button->half_transition_count < UINT8_MAX) button->half_transition_count++;
 }
 
+// keeps the events sorted by time, they mostly arrive in order
 MU_MACOS_INTERNAL
-void mu_gamepad_hid_update_digital_button(struct Mu_DigitalButton *button, struct Mu_Gamepad_HID_Mapping_DigitalButton const * mapping, int state)
+void mu_input_event_push(struct Mu_InputEvents *input_events, struct Mu_InputEvent const event)
 {
-     if (!mapping->states_n) {
-	  mu_update_digital_button(button, state != 0);
-     } else {
-	  int state_i;
-	  for (state_i = 0; state_i < mapping->states_n && mapping->states[state_i] != state; ++state_i) {
-	       continue;
-	  }
-	  mu_update_digital_button(button, state_i != mapping->states_n);
+     if (!input_events->enabled) return;
+     if (input_events->events_n == MU_MAX_INPUT_EVENTS) {
+          input_events->dropped_n++;
+          return;
      }
+     uint32_t event_i = input_events->events_n++;
+     for (; event_i > 0 && input_events->events[event_i - 1].ticks > event.ticks; --event_i) {
+          input_events->events[event_i] = input_events->events[event_i - 1];
+     }
+     input_events->events[event_i] = event;
 }
 
 MU_MACOS_INTERNAL
-void mu_gamepad_hid_update_stick(struct Mu_Stick *stick, struct Mu_Gamepad_HID_Mapping_Stick const *mapping, struct Mu_HIDAddress address, float const scaled_value)
+void mu_update_logged_digital_button(struct Mu_DigitalButton *button, Mu_Bool is_down, struct Mu_InputEvents *input_events, int device, int button_i, uint64_t ticks)
 {
-     if (mu_gamepad_hidaddress_equals(mapping->x_address, address)) {
-	  stick->x = 2.0f*((scaled_value - mapping->xmin)/(mapping->xmax - mapping->xmin) - 0.5f);
-     } else if (mu_gamepad_hidaddress_equals(mapping->y_address, address)) {
-	  stick->y = 2.0f*((scaled_value - mapping->ymin)/(mapping->ymax - mapping->ymin) - 0.5f);
+     if (button->down != is_down) {
+          mu_input_event_push(input_events, (struct Mu_InputEvent){
+                    .ticks = ticks,
+                    .button = button_i,
+                    .device = device,
+                    .down = is_down,
+               });
      }
+     mu_update_digital_button(button, is_down);
 }
 
-MU_MACOS_INTERNAL
-void mu_gamepad_hid_update_analog_button(struct Mu_AnalogButton *analog_button, struct Mu_Gamepad_HID_Mapping_AnalogButton const *mapping, float const scaled_value)
-{
-     float const value = (scaled_value - mapping->xmin)/(mapping->xmax - mapping->xmin);
-     mu_update_analog_button(analog_button, value);
-}
+// Mu Gamepads
 
 MU_MACOS_INTERNAL
 void mu_gamepad_hid_input_value_callback(void *context, IOReturn result, void *sender, IOHIDValueRef value)
 {
      if (result != kIOReturnSuccess) return;
 
-     struct Mu_Session *session = context;
-     struct Mu_Gamepad_HID_Mapping *mapping = &session->gamepad_hid_mapping;
-     struct Mu_Gamepad *gamepad = &session->gamepad; // accumulated state, which will be later published to Mu
-     
-     IOHIDElementRef const element = IOHIDValueGetElement(value);
-     int state = (int)IOHIDValueGetIntegerValue(value);
-     float const scaled_value = IOHIDValueGetScaledValue(value, kIOHIDValueScaleTypePhysical);
-
-     struct Mu_HIDAddress address = {
-	  .usage_page = IOHIDElementGetUsagePage(element),
-	  .usage = IOHIDElementGetUsage(element)
-     };
+     struct Mu_GamepadDevice *device = context;
+     struct Mu_Session *session = device->session;
+     // accumulated state, which will be later published to Mu
+     struct Mu_GamepadSlot *slot = &session->gamepads[device->gamepad_i];
 
-#define X(button_name) if (mu_gamepad_hidaddress_equals(mapping->button_name.address, address)) mu_gamepad_hid_update_digital_button(&gamepad->button_name, &mapping->button_name, state);
-     MU_GAMEPAD_DIGITAL_BUTTONS_XENUM;
-#undef X
+     IOHIDElementRef const element = IOHIDValueGetElement(value);
+     int32_t const state = (int32_t)IOHIDValueGetIntegerValue(value);
+     uint16_t const usage_page = IOHIDElementGetUsagePage(element);
+     uint16_t const usage = IOHIDElementGetUsage(element);
+     // when the device reported it, @clock{mach_absolute_time}
+     uint64_t const ticks = IOHIDValueGetTimeStamp(value) - session->initial_ticks;
+     Mu_DecodeGamepadValue(slot, usage_page, usage, state, ticks);
 
-#define X(analog_button_name) if (mu_gamepad_hidaddress_equals(mapping->analog_button_name.address, address)) mu_gamepad_hid_update_analog_button(&gamepad->analog_button_name, &mapping->analog_button_name, scaled_value);
-     MU_GAMEPAD_ANALOG_BUTTONS_XENUM;
-#undef X
-     
-#define X(stick_name) mu_gamepad_hid_update_stick(&gamepad->stick_name, &mapping->stick_name, address, scaled_value);
-     MU_GAMEPAD_STICKS_XENUM;
-#undef X
-     
 #if 0 // @debug show HID values/messages
-     float analog = IOHIDValueGetScaledValue(value, kIOHIDValueScaleTypePhysical);
-     // Button debugging
-     if (address.usage_page == 0x09 && state != 0)
-	  MU_MACOS_TRACEF("Gamepad: InputValue: usagePage: 0x%02X, usage 0x%02X, value: %d / %f\n", address.usage_page, address.usage, state, analog);
-      MU_MACOS_TRACEF("Gamepad: InputValue: usagePage: 0x%02X, usage 0x%02X, value: %d / %f\n", address.usage_page, address.usage, state, analog);
+     MU_MACOS_TRACEF("Gamepad: InputValue: usagePage: 0x%02X, usage 0x%02X, value: %d\n", usage_page, usage, state);
 #endif
 }
 
-#if 0 // (experimental) low-level DS4 report
-enum {
-     Mu_DS4_MAGIC = 0x0004ff05,
-     Mu_DS4_VENDOR_ID = 0x54c,
-     Mu_DS4_PRODUCT_ID = 0x5c4,
-};
-#pragma pack(push, 1)
-struct Mu_DS4_Touch_Report {
-     uint32_t id : 7;
-     uint32_t inactive : 1;
-     uint32_t x : 12;
-     uint32_t y : 12;
-};
-#pragma pack(pop)
-#pragma pack(push, 1)
-struct Mu_DS4_Input_Report {
-     uint8_t prepad;
-     uint8_t leftx, lefty, rightx, righty;
-     uint16_t buttons;
-     uint8_t trackpad_ps : 2;
-     uint8_t timestamp : 6;
-     uint8_t l2, r2;
-     uint8_t pad[2];
-     uint8_t battery;
-     int16_t accel[3], gyro[3];
-     uint8_t pad0[35 - 25];
-     struct Mu_DS4_Touch_Report touch[2];
-     uint8_t pad2[64 - 43];
-};
-#pragma pack(pop)
-
+// whole DUALSHOCK 4 reports, rather than one callback per element
 MU_MACOS_INTERNAL
-void mu_gamepad_hid_input_report_callback(void *context, IOReturn result, void *sender, IOHIDReportType type, uint32_t reportID, uint8_t *report, CFIndex reportLength)
+void mu_gamepad_ds4_input_report_callback(void *context, IOReturn result, void *sender, IOHIDReportType type, uint32_t reportID, uint8_t *report, CFIndex reportLength)
 {
      if (result != kIOReturnSuccess) return;
-     struct Mu_DS4_Input_Report ds4_report;
-     assert(reportLength == sizeof ds4_report);
-     memcpy(&ds4_report, report, reportLength);
-     MU_MACOS_TRACEF("Gamepad: DS4InputReport, battery: %f\n", ds4_report.battery/255.f);
+     struct Mu_GamepadDevice *device = context;
+     struct Mu_Session *session = device->session;
+     uint64_t const ticks = mach_absolute_time() - session->initial_ticks;
+     Mu_DecodeDS4Report(&session->gamepads[device->gamepad_i], report, (size_t)reportLength, ticks);
+}
+
+MU_MACOS_INTERNAL
+void mu_gamepad_device_removal_callback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device)
+{
+     struct Mu_Session *session = context;
+     for (int gamepad_i = 0; gamepad_i < session->gamepads_n; ++gamepad_i) {
+	  struct Mu_GamepadDevice *gamepad_device = &session->gamepad_devices[gamepad_i];
+	  if (gamepad_device->device != device) continue;
+	  MU_MACOS_TRACEF("Gamepad %d: disconnected\n", gamepad_i);
+	  gamepad_device->device = NULL;
+	  Mu_DisconnectGamepad(&session->gamepads[gamepad_i], mach_absolute_time() - session->initial_ticks);
+     }
 }
-#endif // experimental
 
 MU_MACOS_INTERNAL
 struct Mu_Gamepad_HID_Mapping const mu_ds4_mapping = {
@@ -913,11 +983,11 @@ struct Mu_Gamepad_HID_Mapping const mu_huijia_3_0xe8f_0x3013_mapping = {
      .right_button = { .address = { .usage_page = kHIDPage_GenericDesktop, .usage = 0x39 }, .states_n = 3, .states = { 3, 2, 1, } },
      .left_trigger = {
 	  .address = { .usage_page = kHIDPage_Button, .usage = 0x05 },
-	  .xmin = 0.0f, .xmax = 255.0f
+	  .xmin = 0.0f, .xmax = 1.0f
      },
      .right_trigger = {
 	  .address = { .usage_page = kHIDPage_Button, .usage = 0x06 },
-	  .xmin = 0.0f, .xmax = 255.0f
+	  .xmin = 0.0f, .xmax = 1.0f
      },
      .left_thumb_stick = {
 	  .x_address = { .usage_page = kHIDPage_GenericDesktop, .usage = kHIDUsage_GD_X }, .y_address = { .usage_page = kHIDPage_GenericDesktop, .usage = kHIDUsage_GD_Y },
@@ -951,39 +1021,51 @@ Mu_Bool mu_gamepad_initialize(struct Mu *mu, struct Mu_Session *session)
      [input_value_matching_array retain];
      IOHIDManagerSetDeviceMatchingMultiple(manager, (__bridge CFArrayRef)device_matching_array);
 
+     for (int gamepad_i = 0; gamepad_i < MU_MAX_GAMEPADS; ++gamepad_i) {
+	  struct Mu_Gamepad *gamepad = &mu->gamepads[gamepad_i];
+#define X(threshold) if (gamepad->threshold == 0.0f) gamepad->threshold = mu->gamepad.threshold;
+	  X(left_trigger.threshold);
+	  X(right_trigger.threshold);
+	  X(left_thumb_stick.threshold);
+	  X(right_thumb_stick.threshold);
+#undef X
+     }
+
      // Initial set
      NSSet *devices = (__bridge NSSet*)IOHIDManagerCopyDevices(manager);
      MU_MACOS_TRACEF("Gamepad: found %lu controllers\n", [devices count]);
      IOHIDDeviceRef device;
      for (NSEnumerator *device_enumerator = [devices objectEnumerator];
-	  !mu->gamepad.connected && (device = (IOHIDDeviceRef)[device_enumerator nextObject]); ) {
+	  session->gamepads_n < MU_MAX_GAMEPADS && (device = (IOHIDDeviceRef)[device_enumerator nextObject]); ) {
 	  NSUInteger vid = [(__bridge NSNumber *)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDVendorIDKey)) unsignedIntegerValue];
 	  NSUInteger pid = [(__bridge NSNumber *)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductIDKey)) unsignedIntegerValue];
-	  if (vid == /* Sony */ 0x054c && pid == /* Dual Shock 4 */ 0x05c4) {
-	       MU_MACOS_TRACEF("Gamepad: found Sony DUALSHOCK 4\n");
-	       IOHIDDeviceRegisterInputValueCallback(device, mu_gamepad_hid_input_value_callback, (void *)session);
-	       IOHIDDeviceSetInputValueMatchingMultiple(device, (__bridge CFArrayRef)input_value_matching_array);
-
-#if 0 // experimental native DS4 support
-	       struct Mu_DS4_Input_Report *report_buffer = calloc(1, sizeof *report_buffer); // @todo @leak
-	       IOHIDDeviceRegisterInputReportCallback(device, (uint8_t*)report_buffer, sizeof *report_buffer, mu_gamepad_hid_input_report_callback, session);
-#endif // experimental
-	       session->gamepad_hid_mapping = mu_ds4_mapping;
-	       mu->gamepad.connected = MU_TRUE;
-	  } else if (vid == 0xe8f && pid == 0x3013) {
-	       MU_MACOS_TRACEF("Gamepad: found HuiJia USB Gamepad connector\n");       
-	       IOHIDDeviceRegisterInputValueCallback(device, mu_gamepad_hid_input_value_callback, (void *)session);
-	       IOHIDDeviceSetInputValueMatchingMultiple(device, (__bridge CFArrayRef)input_value_matching_array);
-	       session->gamepad_hid_mapping = mu_huijia_3_0xe8f_0x3013_mapping;
-	       mu->gamepad.connected = MU_TRUE;
+	  int const gamepad_i = session->gamepads_n;
+	  struct Mu_GamepadDevice *gamepad_device = &session->gamepad_devices[gamepad_i];
+	  struct Mu_GamepadSlot *slot = &session->gamepads[gamepad_i];
+	  *gamepad_device = (struct Mu_GamepadDevice){ .session = session, .gamepad_i = gamepad_i, .device = device };
+	  if (vid == MU_DS4_VENDOR_ID && (pid == MU_DS4_PRODUCT_ID || pid == MU_DS4_V2_PRODUCT_ID)) {
+	       MU_MACOS_TRACEF("Gamepad %d: found Sony DUALSHOCK 4\n", gamepad_i);
+	       IOHIDDeviceRegisterInputReportCallback(device, gamepad_device->report, sizeof gamepad_device->report, mu_gamepad_ds4_input_report_callback, gamepad_device);
 	  } else {
-	       MU_MACOS_TRACEF("Gamepad: skipping device 0x%0lx 0x%0lx\n", vid, pid);
-	       mu->gamepad.connected = MU_TRUE;
-	       session->gamepad_hid_mapping = mu_ds4_mapping;
+	       struct Mu_Gamepad_HID_Mapping const *mapping = &mu_ds4_mapping;
+	       if (vid == 0xe8f && pid == 0x3013) {
+		    MU_MACOS_TRACEF("Gamepad %d: found HuiJia USB Gamepad connector\n", gamepad_i);
+		    mapping = &mu_huijia_3_0xe8f_0x3013_mapping;
+	       } else {
+		    MU_MACOS_TRACEF("Gamepad %d: device 0x%0lx 0x%0lx, assuming the DUALSHOCK 4 mapping\n", gamepad_i, vid, pid);
+	       }
+	       if (!Mu_CompileGamepadMapping(mapping, &slot->dispatch)) continue;
+	       IOHIDDeviceRegisterInputValueCallback(device, mu_gamepad_hid_input_value_callback, gamepad_device);
+	       IOHIDDeviceSetInputValueMatchingMultiple(device, (__bridge CFArrayRef)input_value_matching_array);
 	  }
+	  slot->device = (uint8_t)(MU_INPUT_DEVICE_GAMEPAD + gamepad_i);
+	  slot->gamepad.connected = MU_TRUE;
+	  slot->events.enabled = mu->input_events.enabled;
+	  session->gamepads_n++;
      }
      [input_value_matching_array release], input_value_matching_array = nil;
      
+     IOHIDManagerRegisterDeviceRemovalCallback(manager, mu_gamepad_device_removal_callback, session);
      // @todo establish live feedback. However doesn't that necessitate changing the API?
      IOHIDManagerScheduleWithRunLoop(manager, CFRunLoopGetMain(), kCFRunLoopDefaultMode);
      
@@ -997,22 +1079,20 @@ error:
 MU_MACOS_INTERNAL
 void mu_gamepad_close(struct Mu *mu, struct Mu_Session *session)
 {
-     IOHIDManagerClose(session->hidmanager, 0), session->hidmanager = NULL;
+     if (session->hidmanager) IOHIDManagerClose(session->hidmanager, 0), session->hidmanager = NULL;
 }
 
 MU_MACOS_INTERNAL
 void mu_gamepad_pull(struct Mu *mu, struct Mu_Session *session)
 {
-     // Copy incremental state from the session to the user data:
-#define X(button_name) mu_update_digital_button(&mu->gamepad.button_name, session->gamepad.button_name.down);
-     MU_GAMEPAD_DIGITAL_BUTTONS_XENUM;
-#undef X
-#define X(analog_button_name) mu_update_analog_button(&mu->gamepad.analog_button_name, session->gamepad.analog_button_name.value);
-     MU_GAMEPAD_ANALOG_BUTTONS_XENUM;
-#undef X
-#define X(stick_name) mu_update_stick(&mu->gamepad.stick_name, session->gamepad.stick_name.x, session->gamepad.stick_name.y);
-     MU_GAMEPAD_STICKS_XENUM
-#undef X
+     // Copy incremental state from the session to the user data, for
+     // every slot so that buttons of disconnected pads are released
+     int first_connected_i = -1;
+     for (int gamepad_i = MU_MAX_GAMEPADS - 1; gamepad_i >= 0; --gamepad_i) {
+	  Mu_PublishGamepad(&session->gamepads[gamepad_i], &mu->gamepads[gamepad_i], &mu->input_events);
+	  if (mu->gamepads[gamepad_i].connected) first_connected_i = gamepad_i;
+     }
+     mu->gamepad = mu->gamepads[first_connected_i >= 0? first_connected_i : 0];
 
 #if 0 // Show each press @debug
 #define X(button_name) if (mu->gamepad.button_name.pressed) MU_MACOS_TRACEF("pressed: " #button_name "\n");
@@ -1022,15 +1102,86 @@ void mu_gamepad_pull(struct Mu *mu, struct Mu_Session *session)
 #endif
 }
 
+// Mu Framebuffer:
+
+MU_MACOS_INTERNAL
+Mu_Bool mu_framebuffer_pull(struct Mu *mu, struct Mu_Session *session)
+{
+     struct Mu_Framebuffer *framebuffer = &mu->framebuffer;
+     if (!framebuffer->enabled) return MU_TRUE;
+     if (framebuffer->pixels && framebuffer->size.x == mu->window.size.x && framebuffer->size.y == mu->window.size.y) return MU_TRUE;
+     int const pitch = (mu->window.size.x * 4 + 63) & ~63;
+     size_t const bytes_n = (size_t)pitch * mu->window.size.y;
+     if (bytes_n > session->framebuffer_capacity) {
+	  free(session->framebuffer_pixels);
+	  session->framebuffer_pixels = aligned_alloc(64, bytes_n);
+	  session->framebuffer_capacity = session->framebuffer_pixels? bytes_n : 0;
+	  if (!session->framebuffer_pixels) {
+	       *framebuffer = (struct Mu_Framebuffer){ .enabled = MU_TRUE };
+	       mu->error = "could not allocate framebuffer";
+	       return MU_FALSE;
+	  }
+     }
+     memset(session->framebuffer_pixels, 0, bytes_n);
+     framebuffer->pixels = session->framebuffer_pixels;
+     framebuffer->pitch = pitch;
+     framebuffer->size = mu->window.size;
+     return MU_TRUE;
+}
+
+// draws the framebuffer over the whole view, rows going down
+MU_MACOS_INTERNAL
+void mu_framebuffer_push(struct Mu *mu, struct Mu_Session *session)
+{
+     struct Mu_Framebuffer const *framebuffer = &mu->framebuffer;
+     if (!framebuffer->enabled || !framebuffer->pixels) return;
+     glPixelStorei(GL_UNPACK_ROW_LENGTH, framebuffer->pitch / 4);
+     glPixelZoom(1.0f, -1.0f);
+     glWindowPos2i(0, framebuffer->size.y);
+     glDrawPixels(framebuffer->size.x, framebuffer->size.y, GL_RGBA, GL_UNSIGNED_BYTE, framebuffer->pixels);
+     glPixelZoom(1.0f, 1.0f);
+     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+// releases what Mu_Initialize acquired, when quitting or when one of
+// its steps failed: each step undoes nothing it did not do
+MU_MACOS_INTERNAL
+void mu_session_close(struct Mu *mu, struct Mu_Session *session)
+{
+     [session->window_delegate release];
+     [session->opengl_view release];
+     AudioObjectRemovePropertyListener(kAudioObjectSystemObject, &MU_MACOS_COREAUDIO_DEFAULT_OUTPUT_DEVICE_PROPERTY_ADDRESS, mu_coreaudio_property_listener, session);
+     mu_audio_output_close(mu, session);
+#if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
+     mu_fibers_close(mu, session);
+#endif
+     mu_gamepad_close(mu, session);
+     Mu_JobsClose(&mu->jobs);
+     Mu_CloseTelemetry(mu);
+     free(session->framebuffer_pixels);
+     mu->framebuffer.pixels = NULL;
+     mu->cocoa = NULL;
+     free(session);
+}
+
 Mu_Bool Mu_Initialize(struct Mu *mu)
 {
      struct Mu_Session *session = calloc(sizeof(struct Mu_Session), 1);
+     if (!session) {
+          mu->error = "could not allocate session";
+          return MU_FALSE;
+     }
      @autoreleasepool {
-          if (!mu_time_initialize(mu, session)) return MU_FALSE;
-	  if (!mu_application_initialize(mu, session)) return MU_FALSE;
-	  if (!mu_window_initialize(mu, session)) return MU_FALSE;
-	  if (!mu_audio_initialize(mu, session)) return MU_FALSE;
-	  if (!mu_gamepad_initialize(mu, session)) return MU_FALSE;
+          if (!mu_time_initialize(mu, session)) goto error;
+	  Mu_OpenTelemetry(mu);
+	  if (!Mu_JobsInitialize(&mu->jobs)) {
+	       mu->error = "could not start job workers";
+	       goto error;
+	  }
+	  if (!mu_application_initialize(mu, session)) goto error;
+	  if (!mu_window_initialize(mu, session)) goto error;
+	  if (!mu_audio_initialize(mu, session)) goto error;
+	  if (!mu_gamepad_initialize(mu, session)) goto error;
 	  mu->initialized = MU_TRUE; // partially
 	  mu->cocoa = &session->cocoa_resources;
 	  [NSApp finishLaunching];
@@ -1040,9 +1191,15 @@ Mu_Bool Mu_Initialize(struct Mu *mu)
      }
 
 #if MU_MACOS_RUN_MODE==MU_MACOS_RUN_MODE_COROUTINE
-     if (!mu_fibers_initialize(mu, session)) return MU_FALSE;
+     if (!mu_fibers_initialize(mu, session)) goto error;
 #endif
      return MU_TRUE;
+
+error:
+     // the job workers and the audio device may already run
+     mu->initialized = MU_FALSE;
+     mu_session_close(mu, session);
+     return MU_FALSE;
 }
 
 enum {
@@ -1095,9 +1252,19 @@ enum {
 #endif
 };
 
+// time of the event as `mu->time.ticks`
+MU_MACOS_INTERNAL
+uint64_t mu_nsevent_ticks(struct Mu_Session const * const session, NSEvent const * const event)
+{
+     // seconds since startup, like mach_absolute_time
+     double const nanoseconds = [event timestamp] * 1e9;
+     return (uint64_t)(nanoseconds * session->timebase.denom / session->timebase.numer) - session->initial_ticks;
+}
+
 MU_MACOS_INTERNAL
 Mu_Bool mu_nsevent_process(struct Mu * const mu, struct Mu_Session const * const session, NSEvent const * const event)
 {
+     struct Mu_InputEvents * const input_events = &mu->input_events;
      switch ([event type]) {
      case Mu_NSEventTypeFlagsChanged: {
 	  NSEventModifierFlags flags = [event modifierFlags];
@@ -1111,13 +1278,13 @@ Mu_Bool mu_nsevent_process(struct Mu * const mu, struct Mu_Session const * const
 	  case MU_SHIFT: is_down=(flags & Mu_NSEventModifierFlagShift)? MU_TRUE:MU_FALSE; e_p=1; break;
 	  }
 	  if (e_p && keyCode < MU_MAX_KEYS) {
-	       mu_update_digital_button(&mu->keys[keyCode], is_down);
+	       mu_update_logged_digital_button(&mu->keys[keyCode], is_down, input_events, MU_INPUT_DEVICE_KEYBOARD, keyCode, mu_nsevent_ticks(session, event));
 	  }
      } break;
      case Mu_NSEventTypeKeyDown: {
 	  unsigned short keyCode = [event keyCode];
 	  if (keyCode < MU_MAX_KEYS) {
-	       mu_update_digital_button(&mu->keys[keyCode], MU_TRUE);
+	       mu_update_logged_digital_button(&mu->keys[keyCode], MU_TRUE, input_events, MU_INPUT_DEVICE_KEYBOARD, keyCode, mu_nsevent_ticks(session, event));
 	  }
 	  NSString *str = [event characters];
 	  for (char const* utf8_str = [str UTF8String]; *utf8_str && mu->text_length < MU_MAX_TEXT - 1; ++mu->text_length, ++utf8_str) {
@@ -1128,20 +1295,20 @@ Mu_Bool mu_nsevent_process(struct Mu * const mu, struct Mu_Session const * const
      case Mu_NSEventTypeKeyUp: {
 	  unsigned short keyCode = [event keyCode];
 	  if (keyCode < MU_MAX_KEYS) {
-	       mu_update_digital_button(&mu->keys[keyCode], MU_FALSE);
+	       mu_update_logged_digital_button(&mu->keys[keyCode], MU_FALSE, input_events, MU_INPUT_DEVICE_KEYBOARD, keyCode, mu_nsevent_ticks(session, event));
 	  }
      } break;
      case Mu_NSEventTypeLeftMouseDown: {
-	  mu_update_digital_button(&mu->mouse.left_button, MU_TRUE);
+	  mu_update_logged_digital_button(&mu->mouse.left_button, MU_TRUE, input_events, MU_INPUT_DEVICE_MOUSE, MU_MOUSE_LEFT_BUTTON, mu_nsevent_ticks(session, event));
      } break;
      case Mu_NSEventTypeRightMouseDown: {
-	  mu_update_digital_button(&mu->mouse.right_button, MU_TRUE);
+	  mu_update_logged_digital_button(&mu->mouse.right_button, MU_TRUE, input_events, MU_INPUT_DEVICE_MOUSE, MU_MOUSE_RIGHT_BUTTON, mu_nsevent_ticks(session, event));
      } break;
      case Mu_NSEventTypeLeftMouseUp: {
-	  mu_update_digital_button(&mu->mouse.left_button, MU_FALSE);
+	  mu_update_logged_digital_button(&mu->mouse.left_button, MU_FALSE, input_events, MU_INPUT_DEVICE_MOUSE, MU_MOUSE_LEFT_BUTTON, mu_nsevent_ticks(session, event));
      } break;
      case Mu_NSEventTypeRightMouseUp: {
-	  mu_update_digital_button(&mu->mouse.right_button, MU_FALSE);
+	  mu_update_logged_digital_button(&mu->mouse.right_button, MU_FALSE, input_events, MU_INPUT_DEVICE_MOUSE, MU_MOUSE_RIGHT_BUTTON, mu_nsevent_ticks(session, event));
      } break;
      case Mu_NSEventTypeRightMouseDragged: /* fallthrough */
      case Mu_NSEventTypeLeftMouseDragged: /* fallthrough */
@@ -1238,8 +1405,9 @@ void mu_window_pull(struct Mu * const mu, struct Mu_Session * const session)
 
 #if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
 MU_MACOS_INTERNAL
-void mu_run_loop_fiber(struct Mu_Session* session)
+void mu_run_loop_fiber(void *context)
 {
+     struct Mu_Session* session = context;
      for (;;) {
 	  mu_window_pull(session->pull_destination, session);
 	  mu_fibers_switch_to_main(session);
@@ -1247,28 +1415,41 @@ void mu_run_loop_fiber(struct Mu_Session* session)
 }
 #endif
 
+// the last frame, whoever set `mu->quit`: publishes it, and releases
+// everything
+MU_MACOS_INTERNAL
+void mu_macos_quit(struct Mu *mu, struct Mu_Session *session)
+{
+     Mu_PublishTelemetry(mu);
+     mu_session_close(mu, session);
+}
+
 Mu_Bool Mu_Pull(struct Mu *mu)
 {
-     if (!mu->initialized || mu->quit) return MU_FALSE;
+     if (!mu->initialized) return MU_FALSE;
      struct Mu_Session* session = mu_get_session(mu);
+     if (!session) return MU_FALSE; // closed by the last frame
+     if (mu->quit) {
+          // set by the program
+          mu_macos_quit(mu, session);
+          return MU_FALSE;
+     }
+     uint64_t const frame_ticks = mach_absolute_time();
+     Mu_PullFrameStats(&mu->frame_stats, &session->frame_timer, frame_ticks);
+     Mu_JobsPull(&mu->jobs);
 
      if (!atomic_flag_test_and_set(&session->output_audio_isdefault)) {
 	  mu_audio_output_close(mu, session);
 	  mu_audio_output_start(mu, session);
+	  session->audio_restarts_n++;
      }
+     Mu_PublishAudioStats(&session->audio_telemetry, &mu->audio.stats);
+     mu->audio.stats.restarts_n = session->audio_restarts_n;
+     mu_audio_clock_pull(mu, session);
 
      // reset window state
      mu->window.resized = MU_FALSE;
 
-     // reset gamepad state
-#define X(button_name) mu_update_digital_button(&mu->gamepad.button_name, mu->gamepad.button_name.down);
-     MU_GAMEPAD_DIGITAL_BUTTONS_XENUM;
-#undef X
-
-#define X(analog_button_name) mu_update_analog_button(&mu->gamepad.analog_button_name, mu->gamepad.analog_button_name.value);
-     MU_GAMEPAD_ANALOG_BUTTONS_XENUM;
-#undef X
-     
      // reset mouse state
      mu->mouse.left_button = (struct Mu_DigitalButton){.down=mu->mouse.left_button.down};
      mu->mouse.right_button = (struct Mu_DigitalButton){.down=mu->mouse.right_button.down};
@@ -1281,6 +1462,8 @@ Mu_Bool Mu_Pull(struct Mu *mu)
      }
      mu->text[0] = 0;
      mu->text_length = 0;
+     mu->input_events.events_n = 0;
+     mu->input_events.dropped_n = 0;
 
      session->pull_destination = mu;
 #if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
@@ -1288,21 +1471,13 @@ Mu_Bool Mu_Pull(struct Mu *mu)
 #else
      mu_window_pull(mu, session);
 #endif
+     uint64_t const update_ticks = mach_absolute_time();
      mu_time_pull(mu, session);
      mu_gamepad_pull(mu, session);
      session->pull_destination = NULL;
      
      if (mu->quit) {
-	  [session->window_delegate release];
-	  [session->opengl_view release];
-	  mu_audio_output_close(mu, session);
-#if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
-          mu_fibers_close(mu, session);
-#endif
-	  mu_gamepad_close(mu, session);
-	  mu->cocoa = NULL;
-	  free(session);
-	  session = NULL;
+	  mu_macos_quit(mu, session);
 	  return MU_FALSE;
      }
 
@@ -1316,19 +1491,36 @@ Mu_Bool Mu_Pull(struct Mu *mu)
      mu->window.size.y = contentRect.size.height;
      mu->window.resized = old_window.size.x != mu->window.size.x ||
 	  old_window.size.y != mu->window.size.y;
+     if (!mu_framebuffer_pull(mu, session)) {
+          mu->quit = MU_TRUE;
+          mu_macos_quit(mu, session);
+          return MU_FALSE;
+     }
+     Mu_PublishTelemetry(mu);
      
      [[session->opengl_view openGLContext] makeCurrentContext];
+     struct Mu_FrameTimer *frame_timer = &session->frame_timer;
+     frame_timer->pull_ticks = mach_absolute_time();
+     frame_timer->frame_ticks = frame_ticks;
+     frame_timer->events_ticks_n = update_ticks - frame_ticks;
+     frame_timer->update_ticks_n = frame_timer->pull_ticks - update_ticks;
      return MU_TRUE;
 }
 
 void Mu_Push(struct Mu *mu)
 {
      if (!mu->initialized || mu->quit) return;
+     struct Mu_Session *session = mu_get_session(mu);
+     if (!session) return;
+     struct Mu_FrameTimer *frame_timer = &session->frame_timer;
+     frame_timer->push_ticks = mach_absolute_time();
      @autoreleasepool {
-          assert([NSOpenGLContext currentContext] == [mu_get_session(mu)->opengl_view openGLContext]);
+          assert([NSOpenGLContext currentContext] == [session->opengl_view openGLContext]);
+          mu_framebuffer_push(mu, session);
           glFlush();
           [[NSOpenGLContext currentContext] flushBuffer];
      }
+     frame_timer->swap_ticks_n = mach_absolute_time() - frame_timer->push_ticks;
 }
 
 Mu_Bool Mu_LoadImage(const char *filename, struct Mu_Image *d_image)
@@ -1343,25 +1535,43 @@ Mu_Bool Mu_LoadImage(const char *filename, struct Mu_Image *d_image)
           if (!image_source) return MU_FALSE;
      }
      CGImageRef image = CGImageSourceCreateImageAtIndex(image_source, 0, NULL);
+     if (!image) {
+          CFRelease(image_source);
+          return MU_FALSE;
+     }
      size_t w = CGImageGetWidth(image);
      size_t h = CGImageGetHeight(image);
+     // rows may be padded: the layout is the image's, not length/(w*h)
+     size_t const bits_per_component = CGImageGetBitsPerComponent(image);
+     size_t const channels = CGImageGetBitsPerPixel(image) / 8;
+     size_t const stride = CGImageGetBytesPerRow(image);
      CFDataRef rawData = CGDataProviderCopyData(CGImageGetDataProvider(image));
      UInt8 * buf = (UInt8 *) CFDataGetBytePtr(rawData); 
      CFIndex length = CFDataGetLength(rawData);
-     d_image->pixels = malloc(length);
-     d_image->channels = length / (w*h);
-     memcpy(d_image->pixels, buf, length);
-     d_image->width = w;
-     d_image->height = h;
+     Mu_Bool const loaded = bits_per_component == 8 && channels >= 1 && channels <= 4
+          && h > 0 && stride >= w*channels && (size_t)length >= stride*(h - 1) + w*channels;
+     if (loaded) {
+          d_image->pixels = malloc(length);
+          memcpy(d_image->pixels, buf, length);
+          d_image->channels = channels;
+          d_image->width = w;
+          d_image->height = h;
+          d_image->stride = stride;
+     }
      CFRelease(rawData);
      CFRelease(image);
      CFRelease(image_source);
-     return MU_TRUE;
+     return loaded && d_image->pixels;
 }
 
 #include <AudioToolbox/ExtendedAudioFile.h>
 
 Mu_Bool Mu_LoadAudio(const char *filename, struct Mu_AudioBuffer *audio)
+{
+     return Mu_LoadAudioWithFormat(filename, (struct Mu_AudioFormat){ .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16 }, audio);
+}
+
+Mu_Bool Mu_LoadAudioWithFormat(const char *filename, struct Mu_AudioFormat d_format, struct Mu_AudioBuffer *audio)
 {
      ExtAudioFileRef audiofile;
      /* open audio file */ {
@@ -1403,11 +1613,14 @@ Mu_Bool Mu_LoadAudio(const char *filename, struct Mu_AudioBuffer *audio)
                .samples_per_second = desc.mSampleRate,
                .channels = desc.mChannelsPerFrame,
                .bytes_per_sample = desc.mBitsPerChannel/8,
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32,
           };
      }
+     Mu_Bool const d_is_float = d_format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     int const d_bytes_per_sample = d_is_float? sizeof (float) : sizeof (int16_t);
      int dest_buffer_capacity = 4096;
      int dest_buffer_n = 0;
-     int16_t *dest_buffer = (int16_t*)malloc(dest_buffer_capacity * sizeof *dest_buffer);
+     char *dest_buffer = malloc(dest_buffer_capacity * d_bytes_per_sample);
      /* read all and convert */ {
           int in_buffer_capacity = 4096;
           char* in_buffer = malloc(in_buffer_capacity);
@@ -1418,11 +1631,13 @@ Mu_Bool Mu_LoadAudio(const char *filename, struct Mu_AudioBuffer *audio)
           while ((frames_n = in_buffer_frames_n), (st = ExtAudioFileRead(audiofile, &frames_n, &io_audiobufferlist)), (st == noErr && frames_n != 0)) {
                int read_samples_n = frames_n * format.channels;
                while (dest_buffer_n + read_samples_n >= dest_buffer_capacity) dest_buffer_capacity *= 2;
-               dest_buffer = realloc(dest_buffer, dest_buffer_capacity * (sizeof *dest_buffer));
+               dest_buffer = realloc(dest_buffer, dest_buffer_capacity * d_bytes_per_sample);
                float *s_sample = (float*)io_audiobufferlist.mBuffers[0].mData;
-               int16_t *d_sample = dest_buffer + dest_buffer_n;
-               for (int frame_i = 0; frame_i < frames_n; ++frame_i) {
-                    for (int channel_i = 0; channel_i < format.channels; ++channel_i) {
+               if (d_is_float) {
+                    memcpy(dest_buffer + dest_buffer_n * d_bytes_per_sample, s_sample, read_samples_n * sizeof *s_sample);
+               } else {
+                    int16_t *d_sample = (int16_t*)dest_buffer + dest_buffer_n;
+                    for (int sample_i = 0; sample_i < read_samples_n; ++sample_i) {
                          *d_sample = 32767*(*s_sample);
                          ++d_sample;
                          ++s_sample;
@@ -1434,12 +1649,15 @@ Mu_Bool Mu_LoadAudio(const char *filename, struct Mu_AudioBuffer *audio)
           ExtAudioFileDispose(audiofile);
           if (st != noErr && st != kAudioFileEndOfFileError) goto error;
      }
-     audio->samples = realloc(dest_buffer, dest_buffer_n * (sizeof *dest_buffer));
+     void *samples = realloc(dest_buffer, dest_buffer_n * d_bytes_per_sample);
+     if (d_is_float) audio->float_samples = samples;
+     else audio->samples = samples;
      audio->samples_count = dest_buffer_n;
      audio->format = (struct Mu_AudioFormat){
           .samples_per_second = format.samples_per_second,
           .channels = format.channels,
-          .bytes_per_sample = (sizeof *dest_buffer),
+          .bytes_per_sample = d_bytes_per_sample,
+          .sample_format = d_is_float? MU_AUDIO_SAMPLE_FORMAT_FLOAT32 : MU_AUDIO_SAMPLE_FORMAT_INT16,
      };
      return MU_TRUE;
 
@@ -1452,27 +1670,13 @@ error:
 #if MU_MACOS_RUN_MODE == MU_MACOS_RUN_MODE_COROUTINE
 // Coroutine/fiber support
 // -----------------------
-//
-// If this stops working, or if the definitions are removed, then
-// we'll just have to reimplement them in assembly.
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
 
 MU_MACOS_INTERNAL
 Mu_Bool mu_fibers_initialize(struct Mu *mu, struct Mu_Session *session)
 {
-     if (0 != getcontext(&session->run_loop_fiber)) {
-          strerror_r(errno, mu->error_buffer, MU_MAX_ERROR);
-          mu->error = mu->error_buffer;
-          return MU_FALSE;
-     }
-     session->run_loop_fiber.uc_stack.ss_size = 512*1024;
-     session->run_loop_fiber_stack = calloc(1, session->run_loop_fiber.uc_stack.ss_size);
-     session->run_loop_fiber.uc_stack.ss_sp = session->run_loop_fiber_stack;
-     session->run_loop_fiber.uc_link = NULL;
-     makecontext(&session->run_loop_fiber, mu_run_loop_fiber, 1, session);
-
-     if (0 != getcontext(&session->main_fiber)) {
+     // the main fiber is the thread's own stack, saved on the first switch
+     session->main_fiber = (struct Mu_Fiber){ 0 };
+     if (!Mu_InitializeFiber(&session->run_loop_fiber, 512*1024, mu_run_loop_fiber, session)) {
           strerror_r(errno, mu->error_buffer, MU_MAX_ERROR);
           mu->error = mu->error_buffer;
           return MU_FALSE;
@@ -1483,23 +1687,21 @@ Mu_Bool mu_fibers_initialize(struct Mu *mu, struct Mu_Session *session)
 MU_MACOS_INTERNAL
 void mu_fibers_close(struct Mu *mu, struct Mu_Session *session)
 {
-     free(session->run_loop_fiber_stack), session->run_loop_fiber_stack = NULL;
+     Mu_FreeFiber(&session->run_loop_fiber);
 }
 
 MU_MACOS_INTERNAL
 void mu_fibers_switch_to_run_loop(struct Mu_Session *session, struct Mu *mu)
 {
-     swapcontext(&session->main_fiber, &session->run_loop_fiber);
+     Mu_SwitchFiber(&session->main_fiber, &session->run_loop_fiber);
 }
 
 MU_MACOS_INTERNAL
 void mu_fibers_switch_to_main(struct Mu_Session *session)
 {
-     swapcontext(&session->run_loop_fiber, &session->main_fiber);
+     Mu_SwitchFiber(&session->run_loop_fiber, &session->main_fiber);
 }
 
-#pragma clang diagnostic pop
-
 #endif
 
 #undef MU_MACOS_RUN_MODE_PLAIN
@@ -0,0 +1,498 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_adpcm.h"
+#include "xxxx_mu_mixer.h"
+#include "xxxx_mu_resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MU_MIXER_X86 1
+#include <immintrin.h>
+#define MU_MIXER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MU_MIXER_X86 0
+#endif
+
+#define MU_MIXER_INTERNAL static
+
+enum {
+     // frames per block, every voice is accumulated into a block
+     // before it is added to the destination
+     MU_MIXER_BLOCK_FRAMES = 256,
+     // frames of a compressed voice decoded at once: a block at up to 4
+     // times the destination's rate, plus what a resampler reads ahead
+     MU_MIXER_ADPCM_WINDOW_FRAMES = 4 * MU_MIXER_BLOCK_FRAMES + MU_RESAMPLER_TAPS + MU_RESAMPLER_BLOCK_FRAMES + 2,
+};
+
+struct Mu_MixerKernels
+{
+     int isa; // MU_MIXER_ISA_*, of the decoder of compressed voices
+     // acc[i] += gain * s[i]
+     void (*accumulate_i16)(float *acc, int16_t const *s, size_t samples_n, float gain);
+     void (*accumulate_f32)(float *acc, float const *s, size_t samples_n, float gain);
+     // acc[2*i] += gain * s[i], acc[2*i+1] += gain * s[i]
+     void (*accumulate_mono_to_stereo_i16)(float *acc, int16_t const *s, size_t frames_n, float gain);
+     void (*accumulate_mono_to_stereo_f32)(float *acc, float const *s, size_t frames_n, float gain);
+     // d[i] = saturate(d[i] + 32768 * acc[i])
+     void (*store_i16)(int16_t *d, float const *acc, size_t samples_n);
+     // d[i] += acc[i]
+     void (*store_f32)(float *d, float const *acc, size_t samples_n);
+};
+
+// Scalar kernels:
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_i16_scalar(float *acc, int16_t const *s, size_t samples_n, float gain)
+{
+     for (size_t i = 0; i < samples_n; ++i) acc[i] += gain * s[i];
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_f32_scalar(float *acc, float const *s, size_t samples_n, float gain)
+{
+     for (size_t i = 0; i < samples_n; ++i) acc[i] += gain * s[i];
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_mono_to_stereo_i16_scalar(float *acc, int16_t const *s, size_t frames_n, float gain)
+{
+     for (size_t i = 0; i < frames_n; ++i) {
+          float const x = gain * s[i];
+          acc[2*i] += x;
+          acc[2*i + 1] += x;
+     }
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_mono_to_stereo_f32_scalar(float *acc, float const *s, size_t frames_n, float gain)
+{
+     for (size_t i = 0; i < frames_n; ++i) {
+          float const x = gain * s[i];
+          acc[2*i] += x;
+          acc[2*i + 1] += x;
+     }
+}
+
+MU_MIXER_INTERNAL
+int16_t mu_mixer_saturate_i16(float x)
+{
+     if (x >= 32767.0f) return 32767;
+     if (x <= -32768.0f) return -32768;
+     return (int16_t)lrintf(x);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_store_i16_scalar(int16_t *d, float const *acc, size_t samples_n)
+{
+     for (size_t i = 0; i < samples_n; ++i) d[i] = mu_mixer_saturate_i16(d[i] + 32768.0f * acc[i]);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_store_f32_scalar(float *d, float const *acc, size_t samples_n)
+{
+     for (size_t i = 0; i < samples_n; ++i) d[i] += acc[i];
+}
+
+MU_MIXER_INTERNAL
+struct Mu_MixerKernels const mu_mixer_kernels_scalar = {
+     .isa = MU_MIXER_ISA_SCALAR,
+     .accumulate_i16 = mu_mixer_accumulate_i16_scalar,
+     .accumulate_f32 = mu_mixer_accumulate_f32_scalar,
+     .accumulate_mono_to_stereo_i16 = mu_mixer_accumulate_mono_to_stereo_i16_scalar,
+     .accumulate_mono_to_stereo_f32 = mu_mixer_accumulate_mono_to_stereo_f32_scalar,
+     .store_i16 = mu_mixer_store_i16_scalar,
+     .store_f32 = mu_mixer_store_f32_scalar,
+};
+
+#if MU_MIXER_X86
+// SSE2 kernels:
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_i16_sse2(float *acc, int16_t const *s, size_t samples_n, float gain)
+{
+     __m128 const g = _mm_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 8 <= samples_n; i += 8) {
+          __m128i const x = _mm_loadu_si128((__m128i const*)(s + i));
+          __m128 const lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+          __m128 const hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+          _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(g, lo)));
+          _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(g, hi)));
+     }
+     mu_mixer_accumulate_i16_scalar(acc + i, s + i, samples_n - i, gain);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_f32_sse2(float *acc, float const *s, size_t samples_n, float gain)
+{
+     __m128 const g = _mm_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 4 <= samples_n; i += 4) {
+          _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(g, _mm_loadu_ps(s + i))));
+     }
+     mu_mixer_accumulate_f32_scalar(acc + i, s + i, samples_n - i, gain);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_mono_to_stereo_i16_sse2(float *acc, int16_t const *s, size_t frames_n, float gain)
+{
+     __m128 const g = _mm_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 4 <= frames_n; i += 4) {
+          __m128i const x = _mm_loadl_epi64((__m128i const*)(s + i));
+          __m128 const y = _mm_mul_ps(g, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)));
+          float * const a = acc + 2*i;
+          _mm_storeu_ps(a, _mm_add_ps(_mm_loadu_ps(a), _mm_unpacklo_ps(y, y)));
+          _mm_storeu_ps(a + 4, _mm_add_ps(_mm_loadu_ps(a + 4), _mm_unpackhi_ps(y, y)));
+     }
+     mu_mixer_accumulate_mono_to_stereo_i16_scalar(acc + 2*i, s + i, frames_n - i, gain);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_mono_to_stereo_f32_sse2(float *acc, float const *s, size_t frames_n, float gain)
+{
+     __m128 const g = _mm_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 4 <= frames_n; i += 4) {
+          __m128 const y = _mm_mul_ps(g, _mm_loadu_ps(s + i));
+          float * const a = acc + 2*i;
+          _mm_storeu_ps(a, _mm_add_ps(_mm_loadu_ps(a), _mm_unpacklo_ps(y, y)));
+          _mm_storeu_ps(a + 4, _mm_add_ps(_mm_loadu_ps(a + 4), _mm_unpackhi_ps(y, y)));
+     }
+     mu_mixer_accumulate_mono_to_stereo_f32_scalar(acc + 2*i, s + i, frames_n - i, gain);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_store_i16_sse2(int16_t *d, float const *acc, size_t samples_n)
+{
+     __m128 const scale = _mm_set1_ps(32768.0f);
+     size_t i = 0;
+     for (; i + 8 <= samples_n; i += 8) {
+          __m128i const x = _mm_loadu_si128((__m128i const*)(d + i));
+          __m128 const lo = _mm_add_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), _mm_mul_ps(scale, _mm_loadu_ps(acc + i)));
+          __m128 const hi = _mm_add_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), _mm_mul_ps(scale, _mm_loadu_ps(acc + i + 4)));
+          // out of range floats convert to INT32_MIN, clamp before
+          __m128 const max = _mm_set1_ps(32767.0f), min = _mm_set1_ps(-32768.0f);
+          __m128i const y = _mm_packs_epi32(_mm_cvtps_epi32(_mm_max_ps(min, _mm_min_ps(max, lo))),
+                                            _mm_cvtps_epi32(_mm_max_ps(min, _mm_min_ps(max, hi))));
+          _mm_storeu_si128((__m128i*)(d + i), y);
+     }
+     mu_mixer_store_i16_scalar(d + i, acc + i, samples_n - i);
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_store_f32_sse2(float *d, float const *acc, size_t samples_n)
+{
+     size_t i = 0;
+     for (; i + 4 <= samples_n; i += 4) {
+          _mm_storeu_ps(d + i, _mm_add_ps(_mm_loadu_ps(d + i), _mm_loadu_ps(acc + i)));
+     }
+     mu_mixer_store_f32_scalar(d + i, acc + i, samples_n - i);
+}
+
+MU_MIXER_INTERNAL
+struct Mu_MixerKernels const mu_mixer_kernels_sse2 = {
+     .isa = MU_MIXER_ISA_SSE2,
+     .accumulate_i16 = mu_mixer_accumulate_i16_sse2,
+     .accumulate_f32 = mu_mixer_accumulate_f32_sse2,
+     .accumulate_mono_to_stereo_i16 = mu_mixer_accumulate_mono_to_stereo_i16_sse2,
+     .accumulate_mono_to_stereo_f32 = mu_mixer_accumulate_mono_to_stereo_f32_sse2,
+     .store_i16 = mu_mixer_store_i16_sse2,
+     .store_f32 = mu_mixer_store_f32_sse2,
+};
+
+// AVX2 kernels:
+//
+// tails are left to the scalar kernels, the SSE2 ones are not VEX
+// encoded and would cost an AVX/SSE transition.
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_accumulate_i16_avx2(float *acc, int16_t const *s, size_t samples_n, float gain)
+{
+     __m256 const g = _mm256_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 16 <= samples_n; i += 16) {
+          __m256 const lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)(s + i))));
+          __m256 const hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)(s + i + 8))));
+          _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(g, lo)));
+          _mm256_storeu_ps(acc + i + 8, _mm256_add_ps(_mm256_loadu_ps(acc + i + 8), _mm256_mul_ps(g, hi)));
+     }
+     mu_mixer_accumulate_i16_scalar(acc + i, s + i, samples_n - i, gain);
+}
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_accumulate_f32_avx2(float *acc, float const *s, size_t samples_n, float gain)
+{
+     __m256 const g = _mm256_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 8 <= samples_n; i += 8) {
+          _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(g, _mm256_loadu_ps(s + i))));
+     }
+     mu_mixer_accumulate_f32_scalar(acc + i, s + i, samples_n - i, gain);
+}
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_accumulate_mono_to_stereo_avx2(float *acc, __m256 y)
+{
+     // y = [a b c d | e f g h] => [a a b b | c c d d], [e e f f | g g h h]
+     __m256 const lo = _mm256_unpacklo_ps(y, y);
+     __m256 const hi = _mm256_unpackhi_ps(y, y);
+     _mm256_storeu_ps(acc, _mm256_add_ps(_mm256_loadu_ps(acc), _mm256_permute2f128_ps(lo, hi, 0x20)));
+     _mm256_storeu_ps(acc + 8, _mm256_add_ps(_mm256_loadu_ps(acc + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+}
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_accumulate_mono_to_stereo_i16_avx2(float *acc, int16_t const *s, size_t frames_n, float gain)
+{
+     __m256 const g = _mm256_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 8 <= frames_n; i += 8) {
+          __m256 const y = _mm256_mul_ps(g, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)(s + i)))));
+          mu_mixer_accumulate_mono_to_stereo_avx2(acc + 2*i, y);
+     }
+     mu_mixer_accumulate_mono_to_stereo_i16_scalar(acc + 2*i, s + i, frames_n - i, gain);
+}
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_accumulate_mono_to_stereo_f32_avx2(float *acc, float const *s, size_t frames_n, float gain)
+{
+     __m256 const g = _mm256_set1_ps(gain);
+     size_t i = 0;
+     for (; i + 8 <= frames_n; i += 8) {
+          mu_mixer_accumulate_mono_to_stereo_avx2(acc + 2*i, _mm256_mul_ps(g, _mm256_loadu_ps(s + i)));
+     }
+     mu_mixer_accumulate_mono_to_stereo_f32_scalar(acc + 2*i, s + i, frames_n - i, gain);
+}
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_store_i16_avx2(int16_t *d, float const *acc, size_t samples_n)
+{
+     __m256 const scale = _mm256_set1_ps(32768.0f);
+     __m256 const max = _mm256_set1_ps(32767.0f), min = _mm256_set1_ps(-32768.0f);
+     size_t i = 0;
+     for (; i + 16 <= samples_n; i += 16) {
+          __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)(d + i))));
+          __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)(d + i + 8))));
+          lo = _mm256_max_ps(min, _mm256_min_ps(max, _mm256_add_ps(lo, _mm256_mul_ps(scale, _mm256_loadu_ps(acc + i)))));
+          hi = _mm256_max_ps(min, _mm256_min_ps(max, _mm256_add_ps(hi, _mm256_mul_ps(scale, _mm256_loadu_ps(acc + i + 8)))));
+          // packs works within 128bit lanes, reorder the 64bit quarters after
+          __m256i const y = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+          _mm256_storeu_si256((__m256i*)(d + i), _mm256_permute4x64_epi64(y, 0xd8));
+     }
+     mu_mixer_store_i16_scalar(d + i, acc + i, samples_n - i);
+}
+
+MU_MIXER_INTERNAL MU_MIXER_TARGET_AVX2
+void mu_mixer_store_f32_avx2(float *d, float const *acc, size_t samples_n)
+{
+     size_t i = 0;
+     for (; i + 8 <= samples_n; i += 8) {
+          _mm256_storeu_ps(d + i, _mm256_add_ps(_mm256_loadu_ps(d + i), _mm256_loadu_ps(acc + i)));
+     }
+     mu_mixer_store_f32_scalar(d + i, acc + i, samples_n - i);
+}
+
+MU_MIXER_INTERNAL
+struct Mu_MixerKernels const mu_mixer_kernels_avx2 = {
+     .isa = MU_MIXER_ISA_AVX2,
+     .accumulate_i16 = mu_mixer_accumulate_i16_avx2,
+     .accumulate_f32 = mu_mixer_accumulate_f32_avx2,
+     .accumulate_mono_to_stereo_i16 = mu_mixer_accumulate_mono_to_stereo_i16_avx2,
+     .accumulate_mono_to_stereo_f32 = mu_mixer_accumulate_mono_to_stereo_f32_avx2,
+     .store_i16 = mu_mixer_store_i16_avx2,
+     .store_f32 = mu_mixer_store_f32_avx2,
+};
+#endif // MU_MIXER_X86
+
+MU_MIXER_INTERNAL
+struct Mu_MixerKernels const *mu_mixer_kernels_for_isa(int isa)
+{
+     switch (isa) {
+     case MU_MIXER_ISA_SCALAR: return &mu_mixer_kernels_scalar;
+#if MU_MIXER_X86
+     case MU_MIXER_ISA_SSE2: return &mu_mixer_kernels_sse2;
+     case MU_MIXER_ISA_AVX2: return __builtin_cpu_supports("avx2")? &mu_mixer_kernels_avx2 : NULL;
+     case MU_MIXER_ISA_AUTO: return __builtin_cpu_supports("avx2")? &mu_mixer_kernels_avx2 : &mu_mixer_kernels_sse2;
+#else
+     case MU_MIXER_ISA_AUTO: return &mu_mixer_kernels_scalar;
+#endif
+     }
+     return NULL;
+}
+
+MU_MIXER_INTERNAL
+float mu_mixer_source_sample(struct Mu_AudioBuffer const *source, size_t sample_i)
+{
+     return source->format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32?
+          source->float_samples[sample_i] : source->samples[sample_i];
+}
+
+// N->M mapping, and resampling of sources at a different rate
+// (linear interpolation) both go through this slow path.
+MU_MIXER_INTERNAL
+size_t mu_mixer_accumulate_generic(float *acc, int d_channels_n, size_t d_frames_n, struct Mu_MixerVoice *voice, int d_rate, float gain)
+{
+     struct Mu_AudioBuffer const *source = voice->source;
+     int const s_channels_n = source->format.channels;
+     size_t const s_frames_n = source->samples_count / s_channels_n;
+     uint64_t const step = ((uint64_t)source->format.samples_per_second << 32) / d_rate;
+     uint64_t position = ((uint64_t)voice->source_frame_i << 32) | voice->source_frame_fraction;
+     size_t frame_i = 0;
+     for (; frame_i < d_frames_n && (position >> 32) < s_frames_n; ++frame_i, position += step) {
+          size_t const s0 = position >> 32;
+          size_t const s1 = s0 + 1 < s_frames_n? s0 + 1 : s0;
+          float const t = (uint32_t)position * (1.0f / 4294967296.0f);
+          float * const d = acc + frame_i * d_channels_n;
+          for (int d_channel_i = 0; d_channel_i < d_channels_n; ++d_channel_i) {
+               int s_channel_i, s_channel_l;
+               float channel_gain = gain;
+               if (s_channels_n == 1) s_channel_i = 0, s_channel_l = 1;
+               else if (d_channels_n == 1) s_channel_i = 0, s_channel_l = s_channels_n, channel_gain /= s_channels_n;
+               else if (d_channel_i < s_channels_n) s_channel_i = d_channel_i, s_channel_l = d_channel_i + 1;
+               else continue;
+               for (; s_channel_i < s_channel_l; ++s_channel_i) {
+                    float const x0 = mu_mixer_source_sample(source, s0 * s_channels_n + s_channel_i);
+                    float const x1 = mu_mixer_source_sample(source, s1 * s_channels_n + s_channel_i);
+                    d[d_channel_i] += channel_gain * (x0 + t * (x1 - x0));
+               }
+          }
+     }
+     voice->source_frame_i = position >> 32;
+     voice->source_frame_fraction = (uint32_t)position;
+     return frame_i;
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_voice(struct Mu_MixerKernels const *kernels, float *acc, struct Mu_AudioFormat d_format, size_t d_frames_n, struct Mu_MixerVoice *voice);
+
+// Compressed voices are decoded from their cursor on, into a window of
+// int16 frames which is then mixed as any source.
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_adpcm_voice(struct Mu_MixerKernels const *kernels, float *acc, struct Mu_AudioFormat d_format, size_t d_frames_n, struct Mu_MixerVoice *voice)
+{
+     struct Mu_AdpcmAudio const *adpcm = voice->adpcm;
+     int const s_channels_n = adpcm->format.channels;
+     if (s_channels_n == 0 || s_channels_n > MU_MIXER_MAX_CHANNELS || voice->source_frame_i >= adpcm->frames_n) return;
+
+     // frames read for `d_frames_n`, with the next one for the linear
+     // interpolation, or what the resampler buffers
+     size_t window_n = d_frames_n;
+     if (adpcm->format.samples_per_second != d_format.samples_per_second || voice->source_frame_fraction != 0) {
+          uint64_t const step = ((uint64_t)adpcm->format.samples_per_second << 32) / d_format.samples_per_second;
+          window_n = (size_t)((voice->source_frame_fraction + d_frames_n * step) >> 32) + 2;
+          if (voice->resampler) window_n += MU_RESAMPLER_TAPS + MU_RESAMPLER_BLOCK_FRAMES;
+     }
+     if (window_n > MU_MIXER_ADPCM_WINDOW_FRAMES) window_n = MU_MIXER_ADPCM_WINDOW_FRAMES;
+
+     _Alignas(32) int16_t samples[MU_MIXER_ADPCM_WINDOW_FRAMES * MU_MIXER_MAX_CHANNELS];
+     size_t const frames_n = Mu_DecodeAdpcmWithISA(kernels->isa, adpcm, voice->source_frame_i, samples, window_n);
+     struct Mu_AudioBuffer const window = {
+          .samples = samples,
+          .samples_count = frames_n * s_channels_n,
+          .format = adpcm->format,
+     };
+     struct Mu_MixerVoice window_voice = *voice;
+     window_voice.source = &window;
+     window_voice.adpcm = NULL;
+     window_voice.source_frame_i = 0;
+     mu_mixer_accumulate_voice(kernels, acc, d_format, d_frames_n, &window_voice);
+     voice->source_frame_i += window_voice.source_frame_i;
+     voice->source_frame_fraction = window_voice.source_frame_fraction;
+}
+
+MU_MIXER_INTERNAL
+void mu_mixer_accumulate_voice(struct Mu_MixerKernels const *kernels, float *acc, struct Mu_AudioFormat d_format, size_t d_frames_n, struct Mu_MixerVoice *voice)
+{
+     if (voice->adpcm) {
+          mu_mixer_accumulate_adpcm_voice(kernels, acc, d_format, d_frames_n, voice);
+          return;
+     }
+     struct Mu_AudioBuffer const *source = voice->source;
+     if (!source || source->format.channels == 0) return;
+     int const s_channels_n = source->format.channels;
+     int const d_channels_n = d_format.channels;
+     Mu_Bool const s_is_float = source->format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+     float const gain = s_is_float? voice->gain : voice->gain * (1.0f / 32768.0f);
+     size_t const s_frames_n = source->samples_count / s_channels_n;
+     if (voice->source_frame_i >= s_frames_n) return;
+
+     struct Mu_Resampler *resampler = voice->resampler;
+     if (resampler
+         && source->format.samples_per_second != d_format.samples_per_second
+         && resampler->filter->s_rate == source->format.samples_per_second
+         && resampler->filter->d_rate == d_format.samples_per_second
+         && resampler->channels == s_channels_n) {
+          // resample into a block at the destination's rate, then mix it as any voice
+          _Alignas(32) float frames[MU_MIXER_BLOCK_FRAMES * MU_MIXER_MAX_CHANNELS];
+          size_t const frames_n = Mu_Resample(resampler, source, &voice->source_frame_i, frames, d_frames_n);
+          struct Mu_AudioBuffer const resampled = {
+               .float_samples = frames,
+               .samples_count = frames_n * s_channels_n,
+               .format = {
+                    .samples_per_second = d_format.samples_per_second,
+                    .channels = s_channels_n,
+                    .bytes_per_sample = sizeof (float),
+                    .sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32,
+               },
+          };
+          struct Mu_MixerVoice resampled_voice = { .source = &resampled, .gain = voice->gain };
+          mu_mixer_accumulate_voice(kernels, acc, d_format, frames_n, &resampled_voice);
+          return;
+     }
+
+     if (source->format.samples_per_second != d_format.samples_per_second
+         || voice->source_frame_fraction != 0
+         || (s_channels_n != d_channels_n && !(s_channels_n == 1 && d_channels_n == 2))) {
+          mu_mixer_accumulate_generic(acc, d_channels_n, d_frames_n, voice, d_format.samples_per_second, gain);
+          return;
+     }
+
+     size_t const frames_n = s_frames_n - voice->source_frame_i < d_frames_n? s_frames_n - voice->source_frame_i : d_frames_n;
+     size_t const s_sample_i = voice->source_frame_i * s_channels_n;
+     if (s_channels_n == d_channels_n) {
+          if (s_is_float) kernels->accumulate_f32(acc, source->float_samples + s_sample_i, frames_n * s_channels_n, gain);
+          else kernels->accumulate_i16(acc, source->samples + s_sample_i, frames_n * s_channels_n, gain);
+     } else {
+          if (s_is_float) kernels->accumulate_mono_to_stereo_f32(acc, source->float_samples + s_sample_i, frames_n, gain);
+          else kernels->accumulate_mono_to_stereo_i16(acc, source->samples + s_sample_i, frames_n, gain);
+     }
+     voice->source_frame_i += frames_n;
+}
+
+Mu_Bool Mu_MixWithISA(int isa, struct Mu_AudioBuffer *dest, struct Mu_MixerVoice *voices, int voices_n)
+{
+     struct Mu_MixerKernels const *kernels = mu_mixer_kernels_for_isa(isa);
+     if (!kernels) return MU_FALSE;
+     struct Mu_AudioFormat const d_format = dest->format;
+     int const d_channels_n = d_format.channels;
+     if (d_channels_n == 0 || d_channels_n > MU_MIXER_MAX_CHANNELS) return MU_TRUE;
+     size_t const d_frames_n = dest->samples_count / d_channels_n;
+     Mu_Bool const d_is_float = d_format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+
+     _Alignas(32) float acc[MU_MIXER_BLOCK_FRAMES * MU_MIXER_MAX_CHANNELS];
+     for (size_t frame_i = 0; frame_i < d_frames_n; frame_i += MU_MIXER_BLOCK_FRAMES) {
+          size_t const block_frames_n = d_frames_n - frame_i < MU_MIXER_BLOCK_FRAMES? d_frames_n - frame_i : MU_MIXER_BLOCK_FRAMES;
+          size_t const block_samples_n = block_frames_n * d_channels_n;
+          memset(acc, 0, block_samples_n * sizeof *acc);
+          for (int voice_i = 0; voice_i < voices_n; ++voice_i) {
+               mu_mixer_accumulate_voice(kernels, acc, d_format, block_frames_n, &voices[voice_i]);
+          }
+          size_t const d_sample_i = frame_i * d_channels_n;
+          if (d_is_float) kernels->store_f32(dest->float_samples + d_sample_i, acc, block_samples_n);
+          else kernels->store_i16(dest->samples + d_sample_i, acc, block_samples_n);
+     }
+     return MU_TRUE;
+}
+
+void Mu_Mix(struct Mu_AudioBuffer *dest, struct Mu_MixerVoice *voices, int voices_n)
+{
+     Mu_MixWithISA(MU_MIXER_ISA_AUTO, dest, voices, voices_n);
+}
+
+#undef MU_MIXER_INTERNAL
+#undef MU_MIXER_TARGET_AVX2
+#undef MU_MIXER_X86
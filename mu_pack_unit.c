@@ -0,0 +1,172 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_pack.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define MU_PACK_INTERNAL static
+#define MU_PACK_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+uint64_t Mu_PackHash(char const *name, size_t name_n)
+{
+     uint64_t hash = 0xcbf29ce484222325ull;
+     for (size_t i = 0; i < name_n; ++i) {
+          hash ^= (uint8_t)name[i];
+          hash *= 0x100000001b3ull;
+     }
+     return hash;
+}
+
+size_t Mu_PackMipOffset(uint32_t width, uint32_t height, int level, size_t *size)
+{
+     size_t offset = 0;
+     for (int level_i = 0; ; ++level_i) {
+          size_t const w = width >> level_i? width >> level_i : 1;
+          size_t const h = height >> level_i? height >> level_i : 1;
+          size_t const n = w * h * 4;
+          if (level_i == level) {
+               if (size) *size = n;
+               return offset;
+          }
+          offset += (n + MU_PACK_ALIGNMENT - 1) & ~(size_t)(MU_PACK_ALIGNMENT - 1);
+     }
+}
+
+MU_PACK_INTERNAL
+Mu_Bool mu_pack_range_ok(uint64_t offset, uint64_t size, uint64_t file_size)
+{
+     return offset <= file_size && size <= file_size - offset;
+}
+
+/*
+ * Checked once when opening, so that lookups can trust the table of contents.
+ */
+MU_PACK_INTERNAL
+Mu_Bool mu_pack_validate(struct Mu_PackHeader const *header, size_t file_size)
+{
+     if (file_size < sizeof *header) return MU_FALSE;
+     if (0 != memcmp(header->magic, "MU_PACK", 8)) return MU_FALSE;
+     if (header->byte_order != MU_PACK_BYTE_ORDER_MARK || header->version != MU_PACK_VERSION) return MU_FALSE;
+     if (header->size != file_size) return MU_FALSE;
+     uint32_t const slots_n = header->slots_n;
+     if (slots_n == 0 || (slots_n & (slots_n - 1)) || slots_n <= header->entries_n) return MU_FALSE;
+     if (header->entries_offset % 8 || header->slots_offset % 4) return MU_FALSE;
+     if (!mu_pack_range_ok(header->entries_offset, (uint64_t)header->entries_n * sizeof (struct Mu_PackEntry), file_size)) return MU_FALSE;
+     if (!mu_pack_range_ok(header->slots_offset, (uint64_t)slots_n * sizeof (uint32_t), file_size)) return MU_FALSE;
+     if (header->names_offset > file_size) return MU_FALSE;
+
+     uint8_t const *bytes = (uint8_t const *)header;
+     struct Mu_PackEntry const *entries = (struct Mu_PackEntry const *)(bytes + header->entries_offset);
+     uint32_t const *slots = (uint32_t const *)(bytes + header->slots_offset);
+     char const *names = (char const *)bytes + header->names_offset;
+     uint64_t const names_size = file_size - header->names_offset;
+     // one slot per entry, so that probes of a missing name end on an empty one
+     uint32_t empty_slots_n = 0;
+     for (uint32_t slot_i = 0; slot_i < slots_n; ++slot_i) {
+          if (slots[slot_i] > header->entries_n) return MU_FALSE;
+          empty_slots_n += slots[slot_i] == 0;
+     }
+     if (empty_slots_n != slots_n - header->entries_n) return MU_FALSE;
+     for (uint32_t entry_i = 0; entry_i < header->entries_n; ++entry_i) {
+          struct Mu_PackEntry const *entry = &entries[entry_i];
+          if ((uint64_t)entry->name_offset + entry->name_n >= names_size || names[entry->name_offset + entry->name_n] != 0) return MU_FALSE;
+          if (entry->data_offset % MU_PACK_ALIGNMENT || !mu_pack_range_ok(entry->data_offset, entry->data_size, file_size)) return MU_FALSE;
+          uint64_t expected_size;
+          if (entry->type == MU_PACK_ENTRY_IMAGE) {
+               if (entry->mips_n < 1 || entry->mips_n > 17 || entry->width > (1u << 16) || entry->height > (1u << 16)) return MU_FALSE;
+               size_t last_size;
+               expected_size = Mu_PackMipOffset(entry->width, entry->height, entry->mips_n - 1, &last_size) + last_size;
+          } else if (entry->type == MU_PACK_ENTRY_AUDIO) {
+               if (entry->format.bytes_per_sample != 2 && entry->format.bytes_per_sample != 4) return MU_FALSE;
+               if (entry->format.channels == 0 || entry->samples_count > UINT64_MAX / 4) return MU_FALSE;
+               expected_size = entry->samples_count * entry->format.bytes_per_sample;
+          } else {
+               return MU_FALSE;
+          }
+          if (entry->data_size < expected_size) return MU_FALSE;
+     }
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_OpenPack(const char *filename, struct Mu_Pack *pack)
+{
+     FILE *file = fopen(filename, "rb");
+     if (!file) return MU_FALSE;
+     fseek(file, 0, SEEK_END);
+     long const file_size = ftell(file);
+     // private and writable: pixels handed out are not const, but writes stay in memory
+     void *mapping = file_size > 0? mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0) : NULL;
+     fclose(file);
+     if (mapping == MAP_FAILED || !mapping) return MU_FALSE;
+     struct Mu_PackHeader const *header = mapping;
+     if (!mu_pack_validate(header, file_size)) {
+          MU_PACK_TRACEF("ERROR: invalid asset pack %s\n", filename);
+          munmap(mapping, file_size);
+          return MU_FALSE;
+     }
+     uint8_t const *bytes = mapping;
+     *pack = (struct Mu_Pack){
+          .header = header,
+          .entries = (struct Mu_PackEntry const *)(bytes + header->entries_offset),
+          .slots = (uint32_t const *)(bytes + header->slots_offset),
+          .names = (char const *)bytes + header->names_offset,
+          .mapping = mapping,
+          .mapping_size = file_size,
+     };
+     return MU_TRUE;
+}
+
+void Mu_ClosePack(struct Mu_Pack *pack)
+{
+     if (pack->mapping) munmap(pack->mapping, pack->mapping_size);
+     *pack = (struct Mu_Pack){ 0 };
+}
+
+struct Mu_PackEntry const *Mu_FindPackEntry(struct Mu_Pack const *pack, char const *name)
+{
+     if (!pack->header) return NULL;
+     size_t const name_n = strlen(name);
+     uint64_t const hash = Mu_PackHash(name, name_n);
+     uint32_t const mask = pack->header->slots_n - 1;
+     // there is always an empty slot, since slots_n > entries_n (see mu_pack_validate)
+     for (uint32_t slot_i = (uint32_t)hash & mask; pack->slots[slot_i]; slot_i = (slot_i + 1) & mask) {
+          struct Mu_PackEntry const *entry = &pack->entries[pack->slots[slot_i] - 1];
+          if (entry->name_hash == hash && entry->name_n == name_n && 0 == memcmp(pack->names + entry->name_offset, name, name_n)) {
+               return entry;
+          }
+     }
+     return NULL;
+}
+
+Mu_Bool Mu_GetPackImage(struct Mu_Pack const *pack, char const *name, int level, struct Mu_Image *image)
+{
+     struct Mu_PackEntry const *entry = Mu_FindPackEntry(pack, name);
+     if (!entry || entry->type != MU_PACK_ENTRY_IMAGE || level < 0 || (uint32_t)level >= entry->mips_n) return MU_FALSE;
+     size_t const offset = Mu_PackMipOffset(entry->width, entry->height, level, NULL);
+     *image = (struct Mu_Image){
+          .pixels = (uint8_t *)pack->mapping + entry->data_offset + offset,
+          .channels = 4,
+          .width = entry->width >> level? entry->width >> level : 1,
+          .height = entry->height >> level? entry->height >> level : 1,
+     };
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_GetPackAudio(struct Mu_Pack const *pack, char const *name, struct Mu_AudioBuffer *audio)
+{
+     struct Mu_PackEntry const *entry = Mu_FindPackEntry(pack, name);
+     if (!entry || entry->type != MU_PACK_ENTRY_AUDIO) return MU_FALSE;
+     *audio = (struct Mu_AudioBuffer){
+          .samples = (int16_t *)((uint8_t *)pack->mapping + entry->data_offset),
+          .samples_count = entry->samples_count,
+          .format = entry->format,
+     };
+     return MU_TRUE;
+}
+
+#undef MU_PACK_TRACEF
+#undef MU_PACK_INTERNAL
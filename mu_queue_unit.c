@@ -0,0 +1,186 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_queue.h"
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MU_QUEUE_INTERNAL static
+#define MU_QUEUE_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+enum {
+     MU_QUEUE_DEFAULT_BYTES_CAPACITY = 64 * 1024,
+     MU_QUEUE_MAX_BYTES_CAPACITY = 1 << 30,
+     MU_QUEUE_CACHE_LINE = 64,
+};
+
+/*
+ * Cursors count bytes since the start and never wrap in practice. Each
+ * side works on private copies of them, on its own cache line, and
+ * only touches the shared ones when publishing, releasing, or when its
+ * copy says it ran out of commands (consumer) or of space (producer).
+ */
+struct Mu_QueueRing
+{
+     uint8_t *bytes;
+     uint64_t mask; // bytes_capacity - 1
+
+     // producer:
+     _Alignas(MU_QUEUE_CACHE_LINE) uint64_t write_n; // written, published or not
+     uint64_t released_n_copy;
+     uint64_t unpublished_commands_n;
+     atomic_uint_fast64_t commands_n; // @shared: stats
+     atomic_uint_fast64_t rejected_n; // @shared: stats
+     atomic_uint bytes_high_water; // @shared: stats
+
+     // consumer:
+     _Alignas(MU_QUEUE_CACHE_LINE) uint64_t read_n; // popped, released or not
+     uint64_t published_n_copy;
+
+     _Alignas(MU_QUEUE_CACHE_LINE) atomic_uint_fast64_t published_n; // @shared
+     _Alignas(MU_QUEUE_CACHE_LINE) atomic_uint_fast64_t released_n; // @shared
+};
+
+Mu_Bool Mu_QueueInitialize(struct Mu_Queue *queue)
+{
+     size_t const bytes_capacity = queue->bytes_capacity? queue->bytes_capacity : MU_QUEUE_DEFAULT_BYTES_CAPACITY;
+     if (bytes_capacity < MU_QUEUE_CACHE_LINE || bytes_capacity > MU_QUEUE_MAX_BYTES_CAPACITY || (bytes_capacity & (bytes_capacity - 1))) {
+          MU_QUEUE_TRACEF("ERROR: queue capacity must be a power of two between %d and %d bytes\n", MU_QUEUE_CACHE_LINE, MU_QUEUE_MAX_BYTES_CAPACITY);
+          return MU_FALSE;
+     }
+     struct Mu_QueueRing *ring = aligned_alloc(MU_QUEUE_CACHE_LINE, sizeof *ring);
+     uint8_t *bytes = aligned_alloc(MU_QUEUE_CACHE_LINE, bytes_capacity);
+     if (!ring || !bytes) {
+          free(ring);
+          free(bytes);
+          return MU_FALSE;
+     }
+     memset(ring, 0, sizeof *ring);
+     ring->bytes = bytes;
+     ring->mask = bytes_capacity - 1;
+     atomic_init(&ring->commands_n, 0);
+     atomic_init(&ring->rejected_n, 0);
+     atomic_init(&ring->bytes_high_water, 0);
+     atomic_init(&ring->published_n, 0);
+     atomic_init(&ring->released_n, 0);
+     queue->bytes_capacity = bytes_capacity;
+     queue->ring = ring;
+     return MU_TRUE;
+}
+
+void Mu_QueueClose(struct Mu_Queue *queue)
+{
+     if (queue->ring) {
+          free(queue->ring->bytes);
+          free(queue->ring);
+     }
+     queue->ring = NULL;
+}
+
+// Producer:
+
+// single writer: a plain load and store, which other threads may read at any time
+MU_QUEUE_INTERNAL
+void mu_queue_stats_add(atomic_uint_fast64_t *counter, uint64_t n)
+{
+     atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+void *Mu_QueueReserve(struct Mu_Queue *queue, uint32_t type, size_t payload_size)
+{
+     struct Mu_QueueRing * const ring = queue->ring;
+     uint64_t const capacity = ring->mask + 1;
+     uint64_t const n = (sizeof (struct Mu_QueueCommand) + (uint64_t)payload_size + MU_QUEUE_ALIGNMENT - 1) & ~(uint64_t)(MU_QUEUE_ALIGNMENT - 1);
+     uint64_t const contiguous_n = capacity - (ring->write_n & ring->mask);
+     // a command that does not fit before the end of the ring starts over at its beginning
+     uint64_t const needed_n = n <= contiguous_n? n : contiguous_n + n;
+     if (ring->write_n + needed_n - ring->released_n_copy > capacity) {
+          ring->released_n_copy = atomic_load_explicit(&ring->released_n, memory_order_acquire);
+          if (ring->write_n + needed_n - ring->released_n_copy > capacity) {
+               mu_queue_stats_add(&ring->rejected_n, 1);
+               return NULL;
+          }
+     }
+     if (n > contiguous_n) {
+          struct Mu_QueueCommand *padding = (struct Mu_QueueCommand *)(ring->bytes + (ring->write_n & ring->mask));
+          *padding = (struct Mu_QueueCommand){ .type = MU_QUEUE_COMMAND_PADDING, .size = (uint32_t)contiguous_n };
+          ring->write_n += contiguous_n;
+     }
+     struct Mu_QueueCommand *command = (struct Mu_QueueCommand *)(ring->bytes + (ring->write_n & ring->mask));
+     *command = (struct Mu_QueueCommand){ .type = type, .size = (uint32_t)n };
+     ring->write_n += n;
+     ring->unpublished_commands_n++;
+     return command + 1;
+}
+
+Mu_Bool Mu_QueuePush(struct Mu_Queue *queue, uint32_t type, void const *payload, size_t payload_size)
+{
+     void *destination = Mu_QueueReserve(queue, type, payload_size);
+     if (!destination) return MU_FALSE;
+     memcpy(destination, payload, payload_size);
+     return MU_TRUE;
+}
+
+void Mu_QueuePublish(struct Mu_Queue *queue)
+{
+     struct Mu_QueueRing * const ring = queue->ring;
+     if (ring->unpublished_commands_n == 0) return;
+     atomic_store_explicit(&ring->published_n, ring->write_n, memory_order_release);
+     mu_queue_stats_add(&ring->commands_n, ring->unpublished_commands_n);
+     ring->unpublished_commands_n = 0;
+     // at most what is in use now, and at least what was in use when published
+     uint64_t const used_n = ring->write_n - atomic_load_explicit(&ring->released_n, memory_order_relaxed);
+     if (used_n > atomic_load_explicit(&ring->bytes_high_water, memory_order_relaxed)) {
+          atomic_store_explicit(&ring->bytes_high_water, (unsigned)used_n, memory_order_relaxed);
+     }
+}
+
+// Consumer:
+
+struct Mu_QueueCommand const *Mu_QueuePeek(struct Mu_Queue *queue)
+{
+     struct Mu_QueueRing * const ring = queue->ring;
+     for (;;) {
+          if (ring->read_n == ring->published_n_copy) {
+               ring->published_n_copy = atomic_load_explicit(&ring->published_n, memory_order_acquire);
+               if (ring->read_n == ring->published_n_copy) return NULL;
+          }
+          struct Mu_QueueCommand const *command = (struct Mu_QueueCommand const *)(ring->bytes + (ring->read_n & ring->mask));
+          if (command->type != MU_QUEUE_COMMAND_PADDING) return command;
+          ring->read_n += command->size;
+     }
+}
+
+void Mu_QueuePop(struct Mu_Queue *queue)
+{
+     struct Mu_QueueRing * const ring = queue->ring;
+     struct Mu_QueueCommand const *command = (struct Mu_QueueCommand const *)(ring->bytes + (ring->read_n & ring->mask));
+     ring->read_n += command->size;
+}
+
+void Mu_QueueRelease(struct Mu_Queue *queue)
+{
+     struct Mu_QueueRing * const ring = queue->ring;
+     atomic_store_explicit(&ring->released_n, ring->read_n, memory_order_release);
+}
+
+void Mu_QueueGetStats(struct Mu_Queue const *queue, struct Mu_QueueStats *stats)
+{
+     struct Mu_QueueRing * const ring = queue->ring;
+     *stats = (struct Mu_QueueStats){
+          .commands_n = atomic_load_explicit(&ring->commands_n, memory_order_relaxed),
+          .rejected_n = atomic_load_explicit(&ring->rejected_n, memory_order_relaxed),
+          .bytes_high_water = atomic_load_explicit(&ring->bytes_high_water, memory_order_relaxed),
+     };
+}
+
+#undef MU_QUEUE_TRACEF
+#undef MU_QUEUE_INTERNAL
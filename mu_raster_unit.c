@@ -0,0 +1,380 @@
+// @language: c11
+// @dependencylist: xxxx_mu, mu_jobs_unit
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_jobs.h"
+#include "xxxx_mu_raster.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MU_RASTER_X86 1
+#include <immintrin.h>
+#define MU_RASTER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MU_RASTER_X86 0
+#endif
+
+#define MU_RASTER_INTERNAL static
+
+enum {
+     MU_RASTER_MAX_TEXTURE_SIZE = 32767, // texel coordinates are 16.16 fixed point
+};
+
+// spans of one row: `n` pixels at `d`
+typedef void (*Mu_RasterFill)(uint32_t *d, int n, uint32_t color);
+// texel of pixel i: `texels[(u + i*du) >> 16]`, always within the row.
+// Unsigned, as the steps past the last pixel may wrap around
+typedef void (*Mu_RasterStretch)(uint32_t *d, int n, uint32_t const *texels, uint32_t u, uint32_t du);
+
+struct Mu_RasterKernels
+{
+     Mu_RasterFill fill;
+     Mu_RasterStretch stretch;
+};
+
+struct Mu_RasterPass
+{
+     struct Mu_RasterList const *list;
+     struct Mu_Framebuffer const *framebuffer;
+     struct Mu_RasterKernels kernels;
+     int tiles_x, tiles_y;
+     // commands of tile t: `bins[bins_first[t] .. bins_first[t + 1][`
+     uint32_t const *bins_first;
+     uint32_t const *bins;
+};
+
+struct Mu_RasterRow
+{
+     struct Mu_RasterPass const *pass;
+     int tile_y;
+};
+
+// Kernels:
+
+MU_RASTER_INTERNAL
+void mu_raster_fill_scalar(uint32_t *d, int n, uint32_t color)
+{
+     for (int i = 0; i < n; ++i) d[i] = color;
+}
+
+MU_RASTER_INTERNAL
+void mu_raster_stretch_scalar(uint32_t *d, int n, uint32_t const *texels, uint32_t u, uint32_t du)
+{
+     for (int i = 0; i < n; ++i, u += du) d[i] = texels[u >> 16];
+}
+
+#if MU_RASTER_X86
+MU_RASTER_INTERNAL
+void mu_raster_fill_sse2(uint32_t *d, int n, uint32_t color)
+{
+     __m128i const x = _mm_set1_epi32((int)color);
+     int i = 0;
+     for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i *)(d + i), x);
+     for (; i < n; ++i) d[i] = color;
+}
+
+// texels 1:1 are copied 16 bytes at a time, others gathered 4 at a time
+MU_RASTER_INTERNAL
+void mu_raster_stretch_sse2(uint32_t *d, int n, uint32_t const *texels, uint32_t u, uint32_t du)
+{
+     int i = 0;
+     if (du == 1u << 16) {
+          uint32_t const *s = texels + (u >> 16);
+          for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i *)(d + i), _mm_loadu_si128((__m128i const *)(s + i)));
+          for (; i < n; ++i) d[i] = s[i];
+          return;
+     }
+     for (; i + 4 <= n; i += 4, u += 4 * du) {
+          __m128i const x = _mm_set_epi32((int)texels[(u + 3 * du) >> 16], (int)texels[(u + 2 * du) >> 16],
+                                          (int)texels[(u + du) >> 16], (int)texels[u >> 16]);
+          _mm_storeu_si128((__m128i *)(d + i), x);
+     }
+     for (; i < n; ++i, u += du) d[i] = texels[u >> 16];
+}
+
+MU_RASTER_INTERNAL MU_RASTER_TARGET_AVX2
+void mu_raster_fill_avx2(uint32_t *d, int n, uint32_t color)
+{
+     __m256i const x = _mm256_set1_epi32((int)color);
+     int i = 0;
+     for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i *)(d + i), x);
+     for (; i < n; ++i) d[i] = color;
+}
+
+MU_RASTER_INTERNAL MU_RASTER_TARGET_AVX2
+void mu_raster_stretch_avx2(uint32_t *d, int n, uint32_t const *texels, uint32_t u, uint32_t du)
+{
+     int i = 0;
+     if (du == 1u << 16) {
+          uint32_t const *s = texels + (u >> 16);
+          for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i *)(d + i), _mm256_loadu_si256((__m256i const *)(s + i)));
+          for (; i < n; ++i) d[i] = s[i];
+          return;
+     }
+     __m256i us = _mm256_add_epi32(_mm256_set1_epi32((int)u), _mm256_mullo_epi32(_mm256_set1_epi32((int)du), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+     __m256i const step = _mm256_set1_epi32((int)(8 * du));
+     for (; i + 8 <= n; i += 8, u += 8 * du) {
+          __m256i const x = _mm256_i32gather_epi32((int const *)texels, _mm256_srli_epi32(us, 16), 4);
+          _mm256_storeu_si256((__m256i *)(d + i), x);
+          us = _mm256_add_epi32(us, step);
+     }
+     for (; i < n; ++i, u += du) d[i] = texels[u >> 16];
+}
+#endif
+
+MU_RASTER_INTERNAL
+Mu_Bool mu_raster_kernels_for_isa(int isa, struct Mu_RasterKernels *kernels)
+{
+     if (isa == MU_RASTER_ISA_AUTO) {
+#if MU_RASTER_X86
+          isa = __builtin_cpu_supports("avx2")? MU_RASTER_ISA_AVX2 : MU_RASTER_ISA_SSE2;
+#else
+          isa = MU_RASTER_ISA_SCALAR;
+#endif
+     }
+     switch (isa) {
+     case MU_RASTER_ISA_SCALAR:
+          *kernels = (struct Mu_RasterKernels){ mu_raster_fill_scalar, mu_raster_stretch_scalar };
+          return MU_TRUE;
+#if MU_RASTER_X86
+     case MU_RASTER_ISA_SSE2:
+          *kernels = (struct Mu_RasterKernels){ mu_raster_fill_sse2, mu_raster_stretch_sse2 };
+          return MU_TRUE;
+     case MU_RASTER_ISA_AVX2:
+          if (!__builtin_cpu_supports("avx2")) return MU_FALSE;
+          *kernels = (struct Mu_RasterKernels){ mu_raster_fill_avx2, mu_raster_stretch_avx2 };
+          return MU_TRUE;
+#endif
+     }
+     return MU_FALSE;
+}
+
+// Commands:
+
+Mu_Bool Mu_AllocateRasterList(struct Mu_RasterList *list, int commands_capacity)
+{
+     *list = (struct Mu_RasterList){ .isa = list->isa };
+     list->commands = malloc(commands_capacity * sizeof *list->commands);
+     if (!list->commands) return MU_FALSE;
+     list->commands_capacity = commands_capacity;
+     return MU_TRUE;
+}
+
+void Mu_FreeRasterList(struct Mu_RasterList *list)
+{
+     free(list->commands);
+     free(list->bins);
+     free(list->rows);
+     *list = (struct Mu_RasterList){ .isa = list->isa };
+}
+
+uint32_t Mu_RasterColor(float red, float green, float blue, float alpha)
+{
+     float const channels[4] = { red, green, blue, alpha };
+     uint8_t bytes[4];
+     for (int channel_i = 0; channel_i < 4; ++channel_i) {
+          float const x = channels[channel_i];
+          bytes[channel_i] = x <= 0.0f? 0 : x >= 1.0f? 255 : (uint8_t)(x * 255.0f + 0.5f);
+     }
+     uint32_t color;
+     memcpy(&color, bytes, sizeof color);
+     return color;
+}
+
+MU_RASTER_INTERNAL
+void mu_raster_push(struct Mu_RasterList *list, struct Mu_RasterCommand const *command)
+{
+     if (command->x0 >= command->x1 || command->y0 >= command->y1) return;
+     if (list->commands_n == list->commands_capacity) {
+          ++list->dropped_n;
+          return;
+     }
+     list->commands[list->commands_n++] = *command;
+}
+
+void Mu_RasterClear(struct Mu_RasterList *list, uint32_t color)
+{
+     list->commands_n = 0;
+     mu_raster_push(list, &(struct Mu_RasterCommand){ .x1 = INT32_MAX, .y1 = INT32_MAX, .color = color });
+}
+
+void Mu_RasterQuad(struct Mu_RasterList *list, int x0, int y0, int x1, int y1, uint32_t color)
+{
+     mu_raster_push(list, &(struct Mu_RasterCommand){ x0, y0, x1, y1, .color = color });
+}
+
+void Mu_RasterTexturedQuad(struct Mu_RasterList *list, int x0, int y0, int x1, int y1,
+                           struct Mu_Image const *texture, int u0, int v0, int u1, int v1)
+{
+     if (!texture->pixels || texture->channels != 4) return;
+     if (texture->width > MU_RASTER_MAX_TEXTURE_SIZE || texture->height > MU_RASTER_MAX_TEXTURE_SIZE) return;
+     int const w = (int)texture->width, h = (int)texture->height;
+     u0 = u0 < 0? 0 : u0 > w? w : u0;
+     u1 = u1 < 0? 0 : u1 > w? w : u1;
+     v0 = v0 < 0? 0 : v0 > h? h : v0;
+     v1 = v1 < 0? 0 : v1 > h? h : v1;
+     if (u0 == u1 || v0 == v1) return;
+     mu_raster_push(list, &(struct Mu_RasterCommand){ x0, y0, x1, y1, .texture = texture, .u0 = u0, .v0 = v0, .u1 = u1, .v1 = v1 });
+}
+
+// Tiles:
+
+// the texel coordinate, 16.16, of pixel `i` of a quad `n` pixels
+// across mapped to [t0, t1[, sampled at the pixel's center
+MU_RASTER_INTERNAL
+int32_t mu_raster_texel_start(int t0, int t1, int64_t n, int64_t i, int32_t *dt)
+{
+     int64_t const step = ((int64_t)(t1 - t0) << 16) / n;
+     *dt = (int32_t)step;
+     int64_t t = ((int64_t)t0 << 16) + i * step + step / 2;
+     // rounding may land the last pixel on the texel past the range
+     int64_t const t_min = (int64_t)(t0 < t1? t0 : t1) << 16, t_max = ((int64_t)(t0 < t1? t1 : t0) << 16) - 1;
+     return (int32_t)(t < t_min? t_min : t > t_max? t_max : t);
+}
+
+MU_RASTER_INTERNAL
+void mu_raster_draw(struct Mu_RasterPass const *pass, struct Mu_RasterCommand const *command, int x0, int y0, int x1, int y1)
+{
+     struct Mu_Framebuffer const *framebuffer = pass->framebuffer;
+     if (command->x0 > x0) x0 = command->x0;
+     if (command->y0 > y0) y0 = command->y0;
+     if (command->x1 < x1) x1 = command->x1;
+     if (command->y1 < y1) y1 = command->y1;
+     if (x0 >= x1 || y0 >= y1) return;
+     int const n = x1 - x0;
+     struct Mu_Image const *texture = command->texture;
+     if (!texture) {
+          for (int y = y0; y < y1; ++y) {
+               pass->kernels.fill((uint32_t *)(framebuffer->pixels + (size_t)y * framebuffer->pitch) + x0, n, command->color);
+          }
+          return;
+     }
+     int32_t du, dv;
+     int32_t u = mu_raster_texel_start(command->u0, command->u1, (int64_t)command->x1 - command->x0, (int64_t)x0 - command->x0, &du);
+     int64_t v = mu_raster_texel_start(command->v0, command->v1, (int64_t)command->y1 - command->y0, (int64_t)y0 - command->y0, &dv);
+     // keep the last pixel of the span within the texels
+     int64_t const u_last = (int64_t)u + (int64_t)(n - 1) * du;
+     int32_t const u_limit = (command->u0 < command->u1? command->u1 : command->u0) << 16;
+     int32_t const u_floor = (command->u0 < command->u1? command->u0 : command->u1) << 16;
+     if (u_last >= u_limit || u_last < u_floor) du = n > 1? (int32_t)(((u_last >= u_limit? u_limit - 1 : u_floor) - (int64_t)u) / (n - 1)) : 0;
+     int32_t const v_limit = (command->v0 < command->v1? command->v1 : command->v0) << 16;
+     int32_t const v_floor = (command->v0 < command->v1? command->v0 : command->v1) << 16;
+     for (int y = y0; y < y1; ++y, v += dv) {
+          int32_t const v_clamped = (int32_t)(v >= v_limit? v_limit - 1 : v < v_floor? v_floor : v);
+          uint32_t const *texels = (uint32_t const *)(texture->pixels + (size_t)(v_clamped >> 16) * (texture->stride? texture->stride : texture->width * 4));
+          pass->kernels.stretch((uint32_t *)(framebuffer->pixels + (size_t)y * framebuffer->pitch) + x0, n, texels, (uint32_t)u, (uint32_t)du);
+     }
+}
+
+MU_RASTER_INTERNAL
+void mu_raster_row(void *data)
+{
+     struct Mu_RasterRow const *row = data;
+     struct Mu_RasterPass const *pass = row->pass;
+     struct Mu_RasterCommand const *commands = pass->list->commands;
+     int const y0 = row->tile_y * MU_RASTER_TILE_SIZE;
+     int const y1 = y0 + MU_RASTER_TILE_SIZE < pass->framebuffer->size.y? y0 + MU_RASTER_TILE_SIZE : pass->framebuffer->size.y;
+     for (int tile_x = 0; tile_x < pass->tiles_x; ++tile_x) {
+          int const x0 = tile_x * MU_RASTER_TILE_SIZE;
+          int const x1 = x0 + MU_RASTER_TILE_SIZE < pass->framebuffer->size.x? x0 + MU_RASTER_TILE_SIZE : pass->framebuffer->size.x;
+          int const tile_i = row->tile_y * pass->tiles_x + tile_x;
+          uint32_t const first = pass->bins_first[tile_i], last = pass->bins_first[tile_i + 1];
+          uint32_t start = first;
+          for (uint32_t bin_i = last; bin_i-- > first; ) {
+               struct Mu_RasterCommand const *command = &commands[pass->bins[bin_i]];
+               if (command->x0 <= x0 && command->y0 <= y0 && command->x1 >= x1 && command->y1 >= y1) {
+                    start = bin_i;
+                    break;
+               }
+          }
+          for (uint32_t bin_i = start; bin_i < last; ++bin_i) {
+               mu_raster_draw(pass, &commands[pass->bins[bin_i]], x0, y0, x1, y1);
+          }
+     }
+}
+
+// tiles overlapped by a command, as [tx0, tx1[ x [ty0, ty1[
+MU_RASTER_INTERNAL
+Mu_Bool mu_raster_command_tiles(struct Mu_RasterCommand const *command, struct Mu_Framebuffer const *framebuffer, int tiles[4])
+{
+     int const x0 = command->x0 < 0? 0 : command->x0, y0 = command->y0 < 0? 0 : command->y0;
+     int const x1 = command->x1 > framebuffer->size.x? framebuffer->size.x : command->x1;
+     int const y1 = command->y1 > framebuffer->size.y? framebuffer->size.y : command->y1;
+     if (x0 >= x1 || y0 >= y1) return MU_FALSE;
+     tiles[0] = x0 / MU_RASTER_TILE_SIZE;
+     tiles[1] = y0 / MU_RASTER_TILE_SIZE;
+     tiles[2] = (x1 + MU_RASTER_TILE_SIZE - 1) / MU_RASTER_TILE_SIZE;
+     tiles[3] = (y1 + MU_RASTER_TILE_SIZE - 1) / MU_RASTER_TILE_SIZE;
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_RasterRun(struct Mu_RasterList *list, struct Mu_Framebuffer const *framebuffer, struct Mu_Jobs *jobs)
+{
+     struct Mu_RasterPass pass = {
+          .list = list,
+          .framebuffer = framebuffer,
+          .tiles_x = (framebuffer->size.x + MU_RASTER_TILE_SIZE - 1) / MU_RASTER_TILE_SIZE,
+          .tiles_y = (framebuffer->size.y + MU_RASTER_TILE_SIZE - 1) / MU_RASTER_TILE_SIZE,
+     };
+     if (!mu_raster_kernels_for_isa(list->isa, &pass.kernels)) return MU_FALSE;
+     if (!framebuffer->pixels || pass.tiles_x <= 0 || pass.tiles_y <= 0) return MU_TRUE;
+
+     // binning: count the commands of each tile, then place them
+     size_t const tiles_n = (size_t)pass.tiles_x * pass.tiles_y;
+     size_t entries_n = 0;
+     for (int command_i = 0; command_i < list->commands_n; ++command_i) {
+          int t[4];
+          if (mu_raster_command_tiles(&list->commands[command_i], framebuffer, t)) entries_n += (size_t)(t[2] - t[0]) * (t[3] - t[1]);
+     }
+     size_t const bins_n = 2 * (tiles_n + 1) + entries_n;
+     if (bins_n > list->bins_capacity) {
+          uint32_t *bins = realloc(list->bins, bins_n * sizeof *bins);
+          if (!bins) return MU_FALSE;
+          list->bins = bins;
+          list->bins_capacity = bins_n;
+     }
+     if (pass.tiles_y > list->rows_capacity) {
+          struct Mu_RasterRow *rows = realloc(list->rows, pass.tiles_y * sizeof *rows);
+          if (!rows) return MU_FALSE;
+          list->rows = rows;
+          list->rows_capacity = pass.tiles_y;
+     }
+     uint32_t *bins_first = list->bins, *bins_next = list->bins + tiles_n + 1, *bins = bins_next + tiles_n + 1;
+     memset(bins_first, 0, (tiles_n + 1) * sizeof *bins_first);
+     for (int command_i = 0; command_i < list->commands_n; ++command_i) {
+          int t[4];
+          if (!mu_raster_command_tiles(&list->commands[command_i], framebuffer, t)) continue;
+          for (int tile_y = t[1]; tile_y < t[3]; ++tile_y) {
+               for (int tile_x = t[0]; tile_x < t[2]; ++tile_x) ++bins_first[tile_y * pass.tiles_x + tile_x + 1];
+          }
+     }
+     for (size_t tile_i = 0; tile_i < tiles_n; ++tile_i) {
+          bins_first[tile_i + 1] += bins_first[tile_i];
+          bins_next[tile_i] = bins_first[tile_i];
+     }
+     for (int command_i = 0; command_i < list->commands_n; ++command_i) {
+          int t[4];
+          if (!mu_raster_command_tiles(&list->commands[command_i], framebuffer, t)) continue;
+          for (int tile_y = t[1]; tile_y < t[3]; ++tile_y) {
+               for (int tile_x = t[0]; tile_x < t[2]; ++tile_x) bins[bins_next[tile_y * pass.tiles_x + tile_x]++] = (uint32_t)command_i;
+          }
+     }
+     pass.bins_first = bins_first;
+     pass.bins = bins;
+
+     struct Mu_Job *rows_jobs = jobs? Mu_JobsFrameAlloc(jobs, pass.tiles_y * sizeof *rows_jobs) : NULL;
+     for (int tile_y = 0; tile_y < pass.tiles_y; ++tile_y) {
+          list->rows[tile_y] = (struct Mu_RasterRow){ &pass, tile_y };
+          if (rows_jobs) rows_jobs[tile_y] = (struct Mu_Job){ mu_raster_row, &list->rows[tile_y] };
+          else mu_raster_row(&list->rows[tile_y]);
+     }
+     if (rows_jobs) Mu_JobsRunAndWait(jobs, rows_jobs, pass.tiles_y);
+     return MU_TRUE;
+}
+
+#undef MU_RASTER_TARGET_AVX2
+#undef MU_RASTER_X86
+#undef MU_RASTER_INTERNAL
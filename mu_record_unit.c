@@ -0,0 +1,458 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+// Log format:
+// -----------
+//
+// header: "MuR2", varint ticks_per_second, varint initial_ticks,
+//         varint ticks, varint nanoseconds (time before the first frame)
+//
+// frame: varint flags,
+//        varint delta_ticks, varint delta_nanoseconds,
+//        [keys]  varint n, n * varint(key_index_delta << 3 | state)
+//        [slots] MU_RECORD_SLOT_MASKS_N * varint changed_slots_mask (64 slots each),
+//                n * zigzag varint(slot delta)
+//        [text]  varint text_length, text bytes
+//
+// A digital button state is packed as (down | pressed << 1 | released << 2).
+// Input events are not recorded, and replayed buttons count at most one
+// half transition per pressed and released.
+// Slots are the 32bit scalar fields of window, mouse and every gamepad of
+// `gamepads`, `gamepad` being derived from them.
+//
+// Version 1 ("MuR1") recorded `gamepad` alone, in a single mask.
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_record.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MU_RECORD_INTERNAL static
+
+enum {
+     MU_RECORD_FLAG_KEYS = 1<<0,
+     MU_RECORD_FLAG_SLOTS = 1<<1,
+     MU_RECORD_FLAG_TEXT = 1<<2,
+     MU_RECORD_HEADER_MAX_BYTES = 4 + 4*10,
+};
+
+MU_RECORD_INTERNAL
+char const mu_record_magic[4] = { 'M', 'u', 'R', '2' };
+
+#define MU_RECORD_INT_SLOTS_XENUM \
+     X(window.position.x)        \
+     X(window.position.y)        \
+     X(window.size.x)            \
+     X(window.size.y)            \
+     X(window.resized)           \
+     X(mouse.wheel)              \
+     X(mouse.delta_wheel)        \
+     X(mouse.position.x)         \
+     X(mouse.position.y)         \
+     X(mouse.delta_position.x)   \
+     X(mouse.delta_position.y)
+
+#define MU_RECORD_DIGITAL_BUTTON_SLOTS_XENUM \
+     X(mouse.left_button)                    \
+     X(mouse.right_button)
+
+// fields of each of `gamepads`
+#define MU_RECORD_GAMEPAD_INT_SLOTS_XENUM \
+     X(connected)
+
+#define MU_RECORD_GAMEPAD_DIGITAL_BUTTON_SLOTS_XENUM \
+     X(a_button)                                     \
+     X(b_button)                                     \
+     X(x_button)                                     \
+     X(y_button)                                     \
+     X(left_shoulder_button)                         \
+     X(right_shoulder_button)                        \
+     X(up_button)                                    \
+     X(down_button)                                  \
+     X(left_button)                                  \
+     X(right_button)                                 \
+     X(left_thumb_button)                            \
+     X(right_thumb_button)                           \
+     X(back_button)                                  \
+     X(start_button)
+
+#define MU_RECORD_GAMEPAD_FLOAT_SLOTS_XENUM \
+     X(left_trigger.threshold)              \
+     X(left_trigger.value)                  \
+     X(right_trigger.threshold)             \
+     X(right_trigger.value)                 \
+     X(left_thumb_stick.threshold)          \
+     X(left_thumb_stick.x)                  \
+     X(left_thumb_stick.y)                  \
+     X(right_thumb_stick.threshold)         \
+     X(right_thumb_stick.x)                 \
+     X(right_thumb_stick.y)
+
+#define MU_RECORD_GAMEPAD_ANALOG_BUTTON_SLOTS_XENUM \
+     X(left_trigger)                                \
+     X(right_trigger)
+
+#define X(field) + 1
+_Static_assert(MU_RECORD_SLOTS_N == 0 MU_RECORD_INT_SLOTS_XENUM MU_RECORD_DIGITAL_BUTTON_SLOTS_XENUM
+               + MU_MAX_GAMEPADS * (0 MU_RECORD_GAMEPAD_INT_SLOTS_XENUM MU_RECORD_GAMEPAD_DIGITAL_BUTTON_SLOTS_XENUM
+                                    MU_RECORD_GAMEPAD_FLOAT_SLOTS_XENUM MU_RECORD_GAMEPAD_ANALOG_BUTTON_SLOTS_XENUM),
+               "MU_RECORD_SLOTS_N does not match the slots");
+#undef X
+
+MU_RECORD_INTERNAL
+uint8_t mu_record_button_state(Mu_Bool down, Mu_Bool pressed, Mu_Bool released)
+{
+     return (down? 1:0) | (pressed? 2:0) | (released? 4:0);
+}
+
+MU_RECORD_INTERNAL
+uint8_t mu_record_half_transitions(uint32_t state)
+{
+     return ((state & 2) != 0) + ((state & 4) != 0);
+}
+
+MU_RECORD_INTERNAL
+void mu_record_slots_get(struct Mu const *mu, uint32_t slots[MU_RECORD_SLOTS_N])
+{
+     int slot_i = 0;
+#define X(field) slots[slot_i++] = (uint32_t)mu->field;
+     MU_RECORD_INT_SLOTS_XENUM;
+#undef X
+#define X(field) slots[slot_i++] = mu_record_button_state(mu->field.down, mu->field.pressed, mu->field.released);
+     MU_RECORD_DIGITAL_BUTTON_SLOTS_XENUM;
+#undef X
+     for (int gamepad_i = 0; gamepad_i < MU_MAX_GAMEPADS; ++gamepad_i) {
+          struct Mu_Gamepad const *gamepad = &mu->gamepads[gamepad_i];
+#define X(field) slots[slot_i++] = (uint32_t)gamepad->field;
+          MU_RECORD_GAMEPAD_INT_SLOTS_XENUM;
+#undef X
+#define X(field) slots[slot_i++] = mu_record_button_state(gamepad->field.down, gamepad->field.pressed, gamepad->field.released);
+          MU_RECORD_GAMEPAD_DIGITAL_BUTTON_SLOTS_XENUM;
+          MU_RECORD_GAMEPAD_ANALOG_BUTTON_SLOTS_XENUM;
+#undef X
+#define X(field) memcpy(&slots[slot_i++], &gamepad->field, sizeof (uint32_t));
+          MU_RECORD_GAMEPAD_FLOAT_SLOTS_XENUM;
+#undef X
+     }
+}
+
+MU_RECORD_INTERNAL
+void mu_record_slots_set(struct Mu *mu, uint32_t const slots[MU_RECORD_SLOTS_N])
+{
+     int slot_i = 0;
+#define X(field) mu->field = slots[slot_i++];
+     MU_RECORD_INT_SLOTS_XENUM;
+#undef X
+#define X(field) do {                                   \
+          uint32_t const state = slots[slot_i++];      \
+          mu->field.down = (state & 1) != 0;            \
+          mu->field.pressed = (state & 2) != 0;         \
+          mu->field.released = (state & 4) != 0;        \
+          mu->field.half_transition_count = mu_record_half_transitions(state); \
+     } while (0);
+     MU_RECORD_DIGITAL_BUTTON_SLOTS_XENUM;
+#undef X
+     int first_connected_i = -1;
+     for (int gamepad_i = 0; gamepad_i < MU_MAX_GAMEPADS; ++gamepad_i) {
+          struct Mu_Gamepad *gamepad = &mu->gamepads[gamepad_i];
+#define X(field) gamepad->field = slots[slot_i++];
+          MU_RECORD_GAMEPAD_INT_SLOTS_XENUM;
+#undef X
+#define X(field) do {                                        \
+               uint32_t const state = slots[slot_i++];      \
+               gamepad->field.down = (state & 1) != 0;       \
+               gamepad->field.pressed = (state & 2) != 0;    \
+               gamepad->field.released = (state & 4) != 0;  \
+               gamepad->field.half_transition_count = mu_record_half_transitions(state); \
+          } while (0);
+          MU_RECORD_GAMEPAD_DIGITAL_BUTTON_SLOTS_XENUM;
+#undef X
+#define X(field) do {                                        \
+               uint32_t const state = slots[slot_i++];      \
+               gamepad->field.down = (state & 1) != 0;       \
+               gamepad->field.pressed = (state & 2) != 0;    \
+               gamepad->field.released = (state & 4) != 0;  \
+          } while (0);
+          MU_RECORD_GAMEPAD_ANALOG_BUTTON_SLOTS_XENUM;
+#undef X
+#define X(field) memcpy(&gamepad->field, &slots[slot_i++], sizeof (uint32_t));
+          MU_RECORD_GAMEPAD_FLOAT_SLOTS_XENUM;
+#undef X
+          if (first_connected_i < 0 && gamepad->connected) first_connected_i = gamepad_i;
+     }
+     mu->gamepad = mu->gamepads[first_connected_i >= 0? first_connected_i : 0];
+}
+
+MU_RECORD_INTERNAL
+uint8_t *mu_record_put_varint(uint8_t *d, uint64_t x)
+{
+     while (x >= 0x80) {
+          *d++ = (uint8_t)(x | 0x80);
+          x >>= 7;
+     }
+     *d++ = (uint8_t)x;
+     return d;
+}
+
+MU_RECORD_INTERNAL
+uint8_t const *mu_record_get_varint(uint8_t const *s, uint8_t const *s_l, uint64_t *x)
+{
+     uint64_t y = 0;
+     for (int shift = 0; s != s_l && shift < 64; shift += 7) {
+          uint8_t const byte = *s++;
+          y |= (uint64_t)(byte & 0x7f) << shift;
+          if (!(byte & 0x80)) {
+               *x = y;
+               return s;
+          }
+     }
+     return NULL;
+}
+
+MU_RECORD_INTERNAL
+uint32_t mu_record_zigzag(int32_t x)
+{
+     return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+MU_RECORD_INTERNAL
+int32_t mu_record_unzigzag(uint32_t x)
+{
+     return (int32_t)(x >> 1) ^ -(int32_t)(x & 1);
+}
+
+Mu_Bool Mu_AllocateRecording(struct Mu_Recording *recording, size_t frames_n)
+{
+     size_t const capacity = MU_RECORD_HEADER_MAX_BYTES + frames_n * MU_RECORD_FRAME_MAX_BYTES;
+     *recording = (struct Mu_Recording){
+          .bytes = malloc(capacity),
+          .bytes_capacity = capacity,
+     };
+     return recording->bytes != NULL;
+}
+
+void Mu_FreeRecording(struct Mu_Recording *recording)
+{
+     free(recording->bytes);
+     *recording = (struct Mu_Recording){0};
+}
+
+MU_RECORD_INTERNAL
+void mu_record_frame(struct Mu const *mu, struct Mu_Recording *recording)
+{
+     size_t const header_n = recording->bytes_n == 0? MU_RECORD_HEADER_MAX_BYTES : 0;
+     if (recording->overflow || recording->bytes_capacity - recording->bytes_n < header_n + MU_RECORD_FRAME_MAX_BYTES) {
+          recording->overflow = MU_TRUE;
+          return;
+     }
+     uint8_t *d = recording->bytes + recording->bytes_n;
+     if (header_n) {
+          memcpy(d, mu_record_magic, sizeof mu_record_magic), d += sizeof mu_record_magic;
+          d = mu_record_put_varint(d, mu->time.ticks_per_second);
+          d = mu_record_put_varint(d, mu->time.initial_ticks);
+          d = mu_record_put_varint(d, mu->time.ticks - mu->time.delta_ticks);
+          d = mu_record_put_varint(d, mu->time.nanoseconds - mu->time.delta_nanoseconds);
+          recording->ticks_per_second = mu->time.ticks_per_second;
+          memset(recording->previous_keys, 0, sizeof recording->previous_keys);
+          memset(recording->previous_slots, 0, sizeof recording->previous_slots);
+     }
+
+     uint8_t keys[MU_MAX_KEYS];
+     int changed_keys_n = 0;
+     for (int key_i = 0; key_i < MU_MAX_KEYS; ++key_i) {
+          struct Mu_DigitalButton const key = mu->keys[key_i];
+          keys[key_i] = mu_record_button_state(key.down, key.pressed, key.released);
+          changed_keys_n += keys[key_i] != recording->previous_keys[key_i];
+     }
+     uint32_t slots[MU_RECORD_SLOTS_N];
+     mu_record_slots_get(mu, slots);
+     uint64_t changed_slots_masks[MU_RECORD_SLOT_MASKS_N] = {0};
+     Mu_Bool slots_changed = MU_FALSE;
+     for (int slot_i = 0; slot_i < MU_RECORD_SLOTS_N; ++slot_i) {
+          if (slots[slot_i] == recording->previous_slots[slot_i]) continue;
+          changed_slots_masks[slot_i / 64] |= (uint64_t)1 << (slot_i % 64);
+          slots_changed = MU_TRUE;
+     }
+
+     int const flags = (changed_keys_n? MU_RECORD_FLAG_KEYS:0) |
+          (slots_changed? MU_RECORD_FLAG_SLOTS:0) |
+          (mu->text_length? MU_RECORD_FLAG_TEXT:0);
+     d = mu_record_put_varint(d, flags);
+     d = mu_record_put_varint(d, mu->time.delta_ticks);
+     d = mu_record_put_varint(d, mu->time.delta_nanoseconds);
+     if (flags & MU_RECORD_FLAG_KEYS) {
+          d = mu_record_put_varint(d, changed_keys_n);
+          for (int key_i = 0, previous_key_i = 0; key_i < MU_MAX_KEYS; ++key_i) {
+               if (keys[key_i] == recording->previous_keys[key_i]) continue;
+               d = mu_record_put_varint(d, (uint64_t)(key_i - previous_key_i) << 3 | keys[key_i]);
+               previous_key_i = key_i;
+          }
+          memcpy(recording->previous_keys, keys, sizeof keys);
+     }
+     if (flags & MU_RECORD_FLAG_SLOTS) {
+          for (int mask_i = 0; mask_i < MU_RECORD_SLOT_MASKS_N; ++mask_i) d = mu_record_put_varint(d, changed_slots_masks[mask_i]);
+          for (int slot_i = 0; slot_i < MU_RECORD_SLOTS_N; ++slot_i) {
+               if (!(changed_slots_masks[slot_i / 64] & ((uint64_t)1 << (slot_i % 64)))) continue;
+               d = mu_record_put_varint(d, mu_record_zigzag((int32_t)(slots[slot_i] - recording->previous_slots[slot_i])));
+          }
+          memcpy(recording->previous_slots, slots, sizeof slots);
+     }
+     if (flags & MU_RECORD_FLAG_TEXT) {
+          size_t const text_n = mu->text_length < MU_MAX_TEXT - 1? mu->text_length : MU_MAX_TEXT - 1;
+          d = mu_record_put_varint(d, text_n);
+          memcpy(d, mu->text, text_n), d += text_n;
+     }
+     recording->bytes_n = d - recording->bytes;
+     recording->frames_n++;
+}
+
+Mu_Bool Mu_Record(struct Mu *mu, struct Mu_Recording *recording)
+{
+     if (!Mu_Pull(mu)) return MU_FALSE;
+     mu_record_frame(mu, recording);
+     return MU_TRUE;
+}
+
+MU_RECORD_INTERNAL
+Mu_Bool mu_replay_header(struct Mu *mu, struct Mu_Recording *recording)
+{
+     uint8_t const *s = recording->bytes;
+     uint8_t const * const s_l = recording->bytes + recording->bytes_n;
+     if (recording->bytes_n < sizeof mu_record_magic || memcmp(s, mu_record_magic, sizeof mu_record_magic) != 0) return MU_FALSE;
+     s += sizeof mu_record_magic;
+     uint64_t header[4];
+     for (int header_i = 0; header_i < 4; ++header_i) {
+          if (!(s = mu_record_get_varint(s, s_l, &header[header_i]))) return MU_FALSE;
+     }
+     recording->ticks_per_second = header[0];
+     recording->previous_ticks = header[2];
+     recording->previous_nanoseconds = header[3];
+     memset(recording->previous_keys, 0, sizeof recording->previous_keys);
+     memset(recording->previous_slots, 0, sizeof recording->previous_slots);
+     mu->time.ticks_per_second = header[0];
+     mu->time.initial_ticks = header[1];
+     recording->read_i = s - recording->bytes;
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_Replay(struct Mu *mu, struct Mu_Recording *recording)
+{
+     if (mu->quit) return MU_FALSE;
+     if (recording->read_i == 0 && !mu_replay_header(mu, recording)) goto end;
+     if (recording->read_i == recording->bytes_n) goto end;
+
+     uint8_t const *s = recording->bytes + recording->read_i;
+     uint8_t const * const s_l = recording->bytes + recording->bytes_n;
+     uint64_t flags, delta_ticks, delta_nanoseconds;
+     if (!(s = mu_record_get_varint(s, s_l, &flags))) goto end;
+     if (!(s = mu_record_get_varint(s, s_l, &delta_ticks))) goto end;
+     if (!(s = mu_record_get_varint(s, s_l, &delta_nanoseconds))) goto end;
+
+     if (flags & MU_RECORD_FLAG_KEYS) {
+          uint64_t changed_keys_n;
+          if (!(s = mu_record_get_varint(s, s_l, &changed_keys_n))) goto end;
+          for (uint64_t key_i = 0; changed_keys_n--;) {
+               uint64_t x;
+               if (!(s = mu_record_get_varint(s, s_l, &x))) goto end;
+               key_i += x >> 3;
+               if (key_i >= MU_MAX_KEYS) goto end;
+               recording->previous_keys[key_i] = x & 7;
+          }
+     }
+     if (flags & MU_RECORD_FLAG_SLOTS) {
+          uint64_t changed_slots_masks[MU_RECORD_SLOT_MASKS_N];
+          for (int mask_i = 0; mask_i < MU_RECORD_SLOT_MASKS_N; ++mask_i) {
+               if (!(s = mu_record_get_varint(s, s_l, &changed_slots_masks[mask_i]))) goto end;
+          }
+          for (int slot_i = 0; slot_i < MU_RECORD_SLOTS_N; ++slot_i) {
+               if (!(changed_slots_masks[slot_i / 64] & ((uint64_t)1 << (slot_i % 64)))) continue;
+               uint64_t x;
+               if (!(s = mu_record_get_varint(s, s_l, &x))) goto end;
+               recording->previous_slots[slot_i] += (uint32_t)mu_record_unzigzag((uint32_t)x);
+          }
+     }
+     mu->text_length = 0;
+     if (flags & MU_RECORD_FLAG_TEXT) {
+          uint64_t text_n;
+          if (!(s = mu_record_get_varint(s, s_l, &text_n))) goto end;
+          if (text_n >= MU_MAX_TEXT || text_n > (uint64_t)(s_l - s)) goto end;
+          memcpy(mu->text, s, text_n), s += text_n;
+          mu->text_length = text_n;
+     }
+     mu->text[mu->text_length] = 0;
+
+     for (int key_i = 0; key_i < MU_MAX_KEYS; ++key_i) {
+          uint8_t const state = recording->previous_keys[key_i];
+          mu->keys[key_i] = (struct Mu_DigitalButton){
+               .down = (state & 1) != 0,
+               .pressed = (state & 2) != 0,
+               .released = (state & 4) != 0,
+               .half_transition_count = mu_record_half_transitions(state),
+          };
+     }
+     mu->input_events.events_n = 0;
+     mu->input_events.dropped_n = 0;
+     mu_record_slots_set(mu, recording->previous_slots);
+
+     uint64_t const tps = recording->ticks_per_second;
+     recording->previous_ticks += delta_ticks;
+     recording->previous_nanoseconds += delta_nanoseconds;
+     mu->time.delta_ticks = delta_ticks;
+     mu->time.ticks = recording->previous_ticks;
+     mu->time.nanoseconds = recording->previous_nanoseconds;
+     mu->time.microseconds = mu->time.nanoseconds / 1000;
+     mu->time.milliseconds = mu->time.microseconds / 1000;
+     mu->time.seconds = (float)mu->time.ticks / (float)tps;
+     mu->time.delta_nanoseconds = delta_nanoseconds;
+     mu->time.delta_microseconds = mu->time.delta_nanoseconds / 1000;
+     mu->time.delta_milliseconds = mu->time.delta_microseconds / 1000;
+     mu->time.delta_seconds = (float)mu->time.delta_ticks / (float)tps;
+
+     recording->read_i = s - recording->bytes;
+     recording->frames_n++;
+     return MU_TRUE;
+end:
+     recording->read_i = recording->bytes_n;
+     mu->quit = MU_TRUE;
+     return MU_FALSE;
+}
+
+Mu_Bool Mu_SaveRecording(const char *filename, struct Mu_Recording const *recording)
+{
+     FILE *file = fopen(filename, "wb");
+     if (!file) return MU_FALSE;
+     Mu_Bool const written = fwrite(recording->bytes, 1, recording->bytes_n, file) == recording->bytes_n;
+     return (fclose(file) == 0) && written;
+}
+
+Mu_Bool Mu_LoadRecording(const char *filename, struct Mu_Recording *recording)
+{
+     FILE *file = fopen(filename, "rb");
+     if (!file) return MU_FALSE;
+     long size;
+     if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) goto error_with_file_open;
+     *recording = (struct Mu_Recording){
+          .bytes = malloc(size? size : 1),
+          .bytes_capacity = size,
+          .bytes_n = size,
+     };
+     if (!recording->bytes) goto error_with_file_open;
+     if (fread(recording->bytes, 1, size, file) != (size_t)size) {
+          Mu_FreeRecording(recording);
+          goto error_with_file_open;
+     }
+     fclose(file);
+     return MU_TRUE;
+error_with_file_open:
+     fclose(file);
+     return MU_FALSE;
+}
+
+#undef MU_RECORD_INTERNAL
+#undef MU_RECORD_INT_SLOTS_XENUM
+#undef MU_RECORD_DIGITAL_BUTTON_SLOTS_XENUM
+#undef MU_RECORD_GAMEPAD_INT_SLOTS_XENUM
+#undef MU_RECORD_GAMEPAD_DIGITAL_BUTTON_SLOTS_XENUM
+#undef MU_RECORD_GAMEPAD_FLOAT_SLOTS_XENUM
+#undef MU_RECORD_GAMEPAD_ANALOG_BUTTON_SLOTS_XENUM
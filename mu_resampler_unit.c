@@ -0,0 +1,424 @@
+// @language: c11
+// @dependencylist: xxxx_mu, xxxx_mu_mixer, mu_jobs_unit
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_jobs.h"
+#include "xxxx_mu_mixer.h"
+#include "xxxx_mu_resampler.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MU_RESAMPLER_X86 1
+#include <immintrin.h>
+#define MU_RESAMPLER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MU_RESAMPLER_X86 0
+#endif
+
+#define MU_RESAMPLER_INTERNAL static
+
+enum {
+     // tap of the filter at the source frame preceding the output position
+     MU_RESAMPLER_CENTER_TAP = MU_RESAMPLER_TAPS/2 - 1,
+     // output frames converted at once by `Mu_ResampleAudio` workers
+     MU_RESAMPLER_OFFLINE_BLOCK_FRAMES = 1024,
+     // below, `Mu_ResampleAudio` converts on the calling thread
+     MU_RESAMPLER_OFFLINE_JOBS_MIN_FRAMES = 16384,
+     MU_RESAMPLER_OFFLINE_MAX_JOBS = 64,
+};
+
+// d[c] = sum over k of (coefficients[k] + t*deltas[k]) * x[c][k]
+typedef void (*Mu_ResamplerKernel)(float *d, float const *const *x, int channels_n, float const *coefficients, float const *deltas, float t);
+
+// Kernels:
+
+MU_RESAMPLER_INTERNAL
+void mu_resampler_kernel_scalar(float *d, float const *const *x, int channels_n, float const *coefficients, float const *deltas, float t)
+{
+     float k[MU_RESAMPLER_TAPS];
+     for (int tap_i = 0; tap_i < MU_RESAMPLER_TAPS; ++tap_i) k[tap_i] = coefficients[tap_i] + t * deltas[tap_i];
+     for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+          float const *xc = x[channel_i];
+          float sum = 0.0f;
+          for (int tap_i = 0; tap_i < MU_RESAMPLER_TAPS; ++tap_i) sum += k[tap_i] * xc[tap_i];
+          d[channel_i] = sum;
+     }
+}
+
+#if MU_RESAMPLER_X86
+MU_RESAMPLER_INTERNAL
+void mu_resampler_kernel_sse2(float *d, float const *const *x, int channels_n, float const *coefficients, float const *deltas, float t)
+{
+     __m128 const tt = _mm_set1_ps(t);
+     __m128 k[MU_RESAMPLER_TAPS/4];
+     for (int i = 0; i < MU_RESAMPLER_TAPS/4; ++i) {
+          k[i] = _mm_add_ps(_mm_load_ps(coefficients + 4*i), _mm_mul_ps(tt, _mm_load_ps(deltas + 4*i)));
+     }
+     for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+          float const *xc = x[channel_i];
+          __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+          for (int i = 0; i < MU_RESAMPLER_TAPS/4; i += 2) {
+               sum0 = _mm_add_ps(sum0, _mm_mul_ps(k[i], _mm_loadu_ps(xc + 4*i)));
+               sum1 = _mm_add_ps(sum1, _mm_mul_ps(k[i + 1], _mm_loadu_ps(xc + 4*i + 4)));
+          }
+          __m128 sum = _mm_add_ps(sum0, sum1);
+          sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+          sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+          d[channel_i] = _mm_cvtss_f32(sum);
+     }
+}
+
+MU_RESAMPLER_INTERNAL MU_RESAMPLER_TARGET_AVX2
+void mu_resampler_kernel_avx2(float *d, float const *const *x, int channels_n, float const *coefficients, float const *deltas, float t)
+{
+     __m256 const tt = _mm256_set1_ps(t);
+     __m256 k[MU_RESAMPLER_TAPS/8];
+     for (int i = 0; i < MU_RESAMPLER_TAPS/8; ++i) {
+          k[i] = _mm256_add_ps(_mm256_load_ps(coefficients + 8*i), _mm256_mul_ps(tt, _mm256_load_ps(deltas + 8*i)));
+     }
+     for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+          float const *xc = x[channel_i];
+          __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+          for (int i = 0; i < MU_RESAMPLER_TAPS/8; i += 2) {
+               sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(k[i], _mm256_loadu_ps(xc + 8*i)));
+               sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(k[i + 1], _mm256_loadu_ps(xc + 8*i + 8)));
+          }
+          __m256 const sum8 = _mm256_add_ps(sum0, sum1);
+          __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+          sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+          sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+          d[channel_i] = _mm_cvtss_f32(sum);
+     }
+}
+#endif
+
+MU_RESAMPLER_INTERNAL
+Mu_ResamplerKernel mu_resampler_kernel_for_isa(int isa)
+{
+     switch (isa) {
+     case MU_MIXER_ISA_SCALAR: return mu_resampler_kernel_scalar;
+#if MU_RESAMPLER_X86
+     case MU_MIXER_ISA_SSE2: return mu_resampler_kernel_sse2;
+     case MU_MIXER_ISA_AVX2: return __builtin_cpu_supports("avx2")? mu_resampler_kernel_avx2 : NULL;
+#endif
+     }
+     return NULL;
+}
+
+// Filter:
+
+// modified Bessel function of the first kind, order 0
+MU_RESAMPLER_INTERNAL
+double mu_resampler_bessel_i0(double x)
+{
+     double sum = 1.0, term = 1.0;
+     for (int k = 1; k < 64 && term > 1e-12 * sum; ++k) {
+          double const y = x / (2.0 * k);
+          term *= y * y;
+          sum += term;
+     }
+     return sum;
+}
+
+Mu_Bool Mu_InitializeResamplerFilterWithISA(int isa, struct Mu_ResamplerFilter *filter, uint32_t s_rate, uint32_t d_rate)
+{
+     if (isa == MU_MIXER_ISA_AUTO) {
+#if MU_RESAMPLER_X86
+          isa = __builtin_cpu_supports("avx2")? MU_MIXER_ISA_AVX2 : MU_MIXER_ISA_SSE2;
+#else
+          isa = MU_MIXER_ISA_SCALAR;
+#endif
+     }
+     if (!mu_resampler_kernel_for_isa(isa) || s_rate == 0 || d_rate == 0) return MU_FALSE;
+
+     size_t const table_n = (MU_RESAMPLER_PHASES + 1) * MU_RESAMPLER_TAPS;
+     size_t const alignment = 32;
+     uint8_t *allocation = malloc(2 * table_n * sizeof (float) + alignment);
+     if (!allocation) return MU_FALSE;
+     float *coefficients = (float *)(((uintptr_t)allocation + alignment - 1) & ~(uintptr_t)(alignment - 1));
+     float *deltas = coefficients + table_n;
+
+     // Kaiser window (beta 8.6, about -90dB stop band). The cutoff leaves
+     // room for the transition band below the lowest of the two Nyquist rates.
+     double const beta = 8.6;
+     double const cutoff = 0.46 * (d_rate < s_rate? (double)d_rate / s_rate : 1.0);
+     double const i0_beta = mu_resampler_bessel_i0(beta);
+     for (int phase_i = 0; phase_i <= MU_RESAMPLER_PHASES; ++phase_i) {
+          double const fraction = (double)phase_i / MU_RESAMPLER_PHASES;
+          float *row = coefficients + phase_i * MU_RESAMPLER_TAPS;
+          double sum = 0.0;
+          for (int tap_i = 0; tap_i < MU_RESAMPLER_TAPS; ++tap_i) {
+               double const x = tap_i - MU_RESAMPLER_CENTER_TAP - fraction;
+               double const u = x / (MU_RESAMPLER_TAPS / 2);
+               double const window = u*u < 1.0? mu_resampler_bessel_i0(beta * sqrt(1.0 - u*u)) / i0_beta : 0.0;
+               double const a = 3.141592653589793 * 2.0 * cutoff * x;
+               double const sinc = x == 0.0? 1.0 : sin(a) / a;
+               row[tap_i] = (float)(2.0 * cutoff * sinc * window);
+               sum += row[tap_i];
+          }
+          // unit gain at DC
+          for (int tap_i = 0; tap_i < MU_RESAMPLER_TAPS; ++tap_i) row[tap_i] = (float)(row[tap_i] / sum);
+     }
+     for (int phase_i = 0; phase_i <= MU_RESAMPLER_PHASES; ++phase_i) {
+          for (int tap_i = 0; tap_i < MU_RESAMPLER_TAPS; ++tap_i) {
+               int const i = phase_i * MU_RESAMPLER_TAPS + tap_i;
+               deltas[i] = phase_i < MU_RESAMPLER_PHASES? coefficients[i + MU_RESAMPLER_TAPS] - coefficients[i] : 0.0f;
+          }
+     }
+
+     *filter = (struct Mu_ResamplerFilter){
+          .s_rate = s_rate,
+          .d_rate = d_rate,
+          .isa = isa,
+          .coefficients = coefficients,
+          .deltas = deltas,
+          .allocation = allocation,
+     };
+     return MU_TRUE;
+}
+
+Mu_Bool Mu_InitializeResamplerFilter(struct Mu_ResamplerFilter *filter, uint32_t s_rate, uint32_t d_rate)
+{
+     return Mu_InitializeResamplerFilterWithISA(MU_MIXER_ISA_AUTO, filter, s_rate, d_rate);
+}
+
+void Mu_FreeResamplerFilter(struct Mu_ResamplerFilter *filter)
+{
+     free(filter->allocation);
+     *filter = (struct Mu_ResamplerFilter){ 0 };
+}
+
+/*
+ * Output frame at `fraction`/`d_rate` past the source frame at
+ * `MU_RESAMPLER_CENTER_TAP` in `x`.
+ */
+MU_RESAMPLER_INTERNAL
+void mu_resampler_filter_frame(Mu_ResamplerKernel kernel, struct Mu_ResamplerFilter const *filter, float *d, float const *const *x, int channels_n, uint32_t fraction)
+{
+     uint64_t const phase = (uint64_t)fraction * MU_RESAMPLER_PHASES;
+     uint32_t const phase_i = (uint32_t)(phase / filter->d_rate);
+     float const t = (float)(phase % filter->d_rate) / filter->d_rate;
+     kernel(d, x, channels_n,
+            filter->coefficients + phase_i * MU_RESAMPLER_TAPS,
+            filter->deltas + phase_i * MU_RESAMPLER_TAPS, t);
+}
+
+MU_RESAMPLER_INTERNAL
+float mu_resampler_source_sample(struct Mu_AudioBuffer const *source, size_t sample_i)
+{
+     if (source->format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32) return source->float_samples[sample_i];
+     return source->samples[sample_i] * (1.0f / 32768.0f);
+}
+
+// Resample on load:
+
+struct Mu_ResamplerWork
+{
+     struct Mu_ResamplerFilter const *filter;
+     struct Mu_AudioBuffer const *source;
+     struct Mu_AudioBuffer *dest;
+     size_t d_frame_begin;
+     size_t d_frame_end;
+     Mu_Bool failed;
+};
+
+MU_RESAMPLER_INTERNAL
+void mu_resampler_work(void *arg)
+{
+     struct Mu_ResamplerWork *work = arg;
+     struct Mu_ResamplerFilter const *filter = work->filter;
+     struct Mu_AudioBuffer const *source = work->source;
+     Mu_ResamplerKernel const kernel = mu_resampler_kernel_for_isa(filter->isa);
+     int const channels_n = source->format.channels;
+     int64_t const s_frames_n = source->samples_count / channels_n;
+     Mu_Bool const d_is_float = work->dest->format.sample_format == MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+
+     // source frames of a block, one row per channel
+     size_t const row_n = (uint64_t)MU_RESAMPLER_OFFLINE_BLOCK_FRAMES * filter->s_rate / filter->d_rate + MU_RESAMPLER_TAPS + 2;
+     float *rows = malloc(row_n * channels_n * sizeof *rows);
+     if (!rows) {
+          work->failed = MU_TRUE;
+          return;
+     }
+
+     for (size_t block_i = work->d_frame_begin; block_i < work->d_frame_end; block_i += MU_RESAMPLER_OFFLINE_BLOCK_FRAMES) {
+          size_t const block_l = work->d_frame_end - block_i < MU_RESAMPLER_OFFLINE_BLOCK_FRAMES? work->d_frame_end : block_i + MU_RESAMPLER_OFFLINE_BLOCK_FRAMES;
+          // from the first tap of the first frame to the last tap of the last frame
+          int64_t const s_first = (int64_t)((uint64_t)block_i * filter->s_rate / filter->d_rate) - MU_RESAMPLER_CENTER_TAP;
+          int64_t const s_last = (int64_t)((uint64_t)(block_l - 1) * filter->s_rate / filter->d_rate) - MU_RESAMPLER_CENTER_TAP + MU_RESAMPLER_TAPS;
+          for (int64_t s_i = s_first; s_i < s_last; ++s_i) {
+               Mu_Bool const inside = s_i >= 0 && s_i < s_frames_n;
+               for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+                    rows[channel_i * row_n + (s_i - s_first)] = inside? mu_resampler_source_sample(source, s_i * channels_n + channel_i) : 0.0f;
+               }
+          }
+          for (size_t frame_i = block_i; frame_i < block_l; ++frame_i) {
+               uint64_t const position = (uint64_t)frame_i * filter->s_rate;
+               int64_t const s_i = (int64_t)(position / filter->d_rate) - MU_RESAMPLER_CENTER_TAP;
+               float const *x[MU_RESAMPLER_MAX_CHANNELS];
+               for (int channel_i = 0; channel_i < channels_n; ++channel_i) x[channel_i] = rows + channel_i * row_n + (s_i - s_first);
+               float y[MU_RESAMPLER_MAX_CHANNELS];
+               mu_resampler_filter_frame(kernel, filter, y, x, channels_n, (uint32_t)(position % filter->d_rate));
+               for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+                    size_t const d_i = frame_i * channels_n + channel_i;
+                    if (d_is_float) {
+                         work->dest->float_samples[d_i] = y[channel_i];
+                    } else {
+                         float const z = 32768.0f * y[channel_i];
+                         work->dest->samples[d_i] = z >= 32767.0f? 32767 : z <= -32768.0f? -32768 : (int16_t)lrintf(z);
+                    }
+               }
+          }
+     }
+     free(rows);
+     return;
+}
+
+Mu_Bool Mu_ResampleAudio(struct Mu_AudioBuffer const *source, uint32_t samples_per_second, struct Mu_AudioBuffer *dest, struct Mu_Jobs *jobs)
+{
+     int const channels_n = source->format.channels;
+     if (channels_n == 0 || channels_n > MU_RESAMPLER_MAX_CHANNELS) return MU_FALSE;
+     struct Mu_ResamplerFilter filter;
+     if (!Mu_InitializeResamplerFilter(&filter, source->format.samples_per_second, samples_per_second)) return MU_FALSE;
+
+     uint64_t const s_frames_n = source->samples_count / channels_n;
+     size_t const d_frames_n = (s_frames_n * samples_per_second + source->format.samples_per_second - 1) / source->format.samples_per_second;
+     *dest = (struct Mu_AudioBuffer){
+          .samples_count = d_frames_n * channels_n,
+          .format = source->format,
+     };
+     dest->format.samples_per_second = samples_per_second;
+     dest->samples = malloc(dest->samples_count * dest->format.bytes_per_sample + 1);
+     if (!dest->samples) {
+          Mu_FreeResamplerFilter(&filter);
+          return MU_FALSE;
+     }
+
+     // without workers of the caller, a pool for this conversion only
+     struct Mu_Jobs resample_jobs = { 0 };
+     if (!jobs && d_frames_n >= MU_RESAMPLER_OFFLINE_JOBS_MIN_FRAMES) {
+          resample_jobs.frame_arena_capacity = 64;
+          if (Mu_JobsInitialize(&resample_jobs)) jobs = &resample_jobs;
+     }
+     int works_n = !jobs || d_frames_n < MU_RESAMPLER_OFFLINE_JOBS_MIN_FRAMES? 1 : jobs->workers_n;
+     if (works_n > MU_RESAMPLER_OFFLINE_MAX_JOBS) works_n = MU_RESAMPLER_OFFLINE_MAX_JOBS;
+     struct Mu_ResamplerWork works[MU_RESAMPLER_OFFLINE_MAX_JOBS];
+     struct Mu_Job works_jobs[MU_RESAMPLER_OFFLINE_MAX_JOBS];
+     for (int work_i = 0; work_i < works_n; ++work_i) {
+          works[work_i] = (struct Mu_ResamplerWork){
+               .filter = &filter,
+               .source = source,
+               .dest = dest,
+               .d_frame_begin = d_frames_n * work_i / works_n,
+               .d_frame_end = d_frames_n * (work_i + 1) / works_n,
+          };
+          works_jobs[work_i] = (struct Mu_Job){ mu_resampler_work, &works[work_i] };
+     }
+     if (works_n > 1) Mu_JobsRunAndWait(jobs, works_jobs, works_n);
+     else mu_resampler_work(&works[0]);
+     Mu_JobsClose(&resample_jobs);
+     Mu_Bool failed = MU_FALSE;
+     for (int work_i = 0; work_i < works_n; ++work_i) failed |= works[work_i].failed;
+     Mu_FreeResamplerFilter(&filter);
+     if (failed) {
+          free(dest->samples);
+          *dest = (struct Mu_AudioBuffer){ 0 };
+          return MU_FALSE;
+     }
+     return MU_TRUE;
+}
+
+// Streaming:
+
+void Mu_InitializeResampler(struct Mu_Resampler *resampler, struct Mu_ResamplerFilter const *filter, int channels)
+{
+     resampler->filter = filter;
+     resampler->channels = channels < MU_RESAMPLER_MAX_CHANNELS? channels : MU_RESAMPLER_MAX_CHANNELS;
+     // silence before the first frame, up to the center of the filter
+     resampler->history_n = MU_RESAMPLER_CENTER_TAP;
+     resampler->position = 0;
+     resampler->position_fraction = 0;
+     for (int channel_i = 0; channel_i < resampler->channels; ++channel_i) {
+          memset(resampler->history[channel_i], 0, MU_RESAMPLER_CENTER_TAP * sizeof (float));
+     }
+}
+
+/*
+ * Drops the consumed frames of the history and appends frames of `source`.
+ *
+ * @return: MU_FALSE when there are not enough frames for the next output frame
+ */
+MU_RESAMPLER_INTERNAL
+Mu_Bool mu_resampler_refill(struct Mu_Resampler *resampler, struct Mu_AudioBuffer const *source, size_t *source_frame_i)
+{
+     int const channels_n = resampler->channels;
+     int const s_channels_n = source->format.channels;
+     size_t const s_frames_n = source->samples_count / s_channels_n;
+     size_t s_i = *source_frame_i < s_frames_n? *source_frame_i : s_frames_n;
+
+     if (resampler->position >= resampler->history_n) {
+          // the next frame starts past the history (downsampling)
+          size_t const skip_n = resampler->position - resampler->history_n < s_frames_n - s_i?
+               resampler->position - resampler->history_n : s_frames_n - s_i;
+          s_i += skip_n;
+          resampler->position -= resampler->history_n + skip_n;
+          resampler->history_n = 0;
+     } else {
+          size_t const kept_n = resampler->history_n - resampler->position;
+          for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+               memmove(resampler->history[channel_i], resampler->history[channel_i] + resampler->position, kept_n * sizeof (float));
+          }
+          resampler->history_n = kept_n;
+          resampler->position = 0;
+     }
+
+     size_t const capacity = MU_RESAMPLER_TAPS + MU_RESAMPLER_BLOCK_FRAMES;
+     size_t n = capacity - resampler->history_n;
+     if (resampler->position != 0) n = 0;
+     if (n > s_frames_n - s_i) n = s_frames_n - s_i;
+     for (size_t frame_i = 0; frame_i < n; ++frame_i) {
+          for (int channel_i = 0; channel_i < channels_n; ++channel_i) {
+               resampler->history[channel_i][resampler->history_n + frame_i] = mu_resampler_source_sample(source, (s_i + frame_i) * s_channels_n + channel_i);
+          }
+     }
+     resampler->history_n += n;
+     *source_frame_i = s_i + n;
+     return resampler->position + MU_RESAMPLER_TAPS <= resampler->history_n;
+}
+
+size_t Mu_Resample(struct Mu_Resampler *resampler, struct Mu_AudioBuffer const *source, size_t *source_frame_i, float *d_frames, size_t d_frames_n)
+{
+     struct Mu_ResamplerFilter const *filter = resampler->filter;
+     Mu_ResamplerKernel const kernel = mu_resampler_kernel_for_isa(filter->isa);
+     int const channels_n = resampler->channels;
+     if (source->format.channels == 0) return 0;
+     uint32_t const step = filter->s_rate / filter->d_rate;
+     uint32_t const step_fraction = filter->s_rate % filter->d_rate;
+
+     size_t frame_i = 0;
+     for (; frame_i < d_frames_n; ++frame_i) {
+          if (resampler->position + MU_RESAMPLER_TAPS > resampler->history_n
+              && !mu_resampler_refill(resampler, source, source_frame_i)) {
+               break;
+          }
+          float const *x[MU_RESAMPLER_MAX_CHANNELS];
+          for (int channel_i = 0; channel_i < channels_n; ++channel_i) x[channel_i] = resampler->history[channel_i] + resampler->position;
+          mu_resampler_filter_frame(kernel, filter, d_frames + frame_i * channels_n, x, channels_n, resampler->position_fraction);
+
+          resampler->position += step;
+          resampler->position_fraction += step_fraction;
+          if (resampler->position_fraction >= filter->d_rate) {
+               resampler->position_fraction -= filter->d_rate;
+               resampler->position++;
+          }
+     }
+     return frame_i;
+}
+
+#undef MU_RESAMPLER_TARGET_AVX2
+#undef MU_RESAMPLER_X86
+#undef MU_RESAMPLER_INTERNAL
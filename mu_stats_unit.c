@@ -0,0 +1,117 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MU_STATS_INTERNAL static
+
+// Frame Stats:
+
+MU_STATS_INTERNAL
+int mu_frame_stats_compare(void const *a, void const *b)
+{
+     uint32_t const x = *(uint32_t const *)a, y = *(uint32_t const *)b;
+     return (x > y) - (x < y);
+}
+
+MU_STATS_INTERNAL
+void mu_frame_stats_record(struct Mu_FrameStats *stats, uint64_t const nanoseconds[MU_FRAME_STAGES_N])
+{
+     uint32_t const slot_i = (uint32_t)(stats->frames_n & (MU_FRAME_STATS_FRAMES - 1));
+     for (int stage_i = 0; stage_i < MU_FRAME_STAGES_N; ++stage_i) {
+          stats->ring[stage_i][slot_i] = nanoseconds[stage_i] < UINT32_MAX? (uint32_t)nanoseconds[stage_i] : UINT32_MAX;
+     }
+     uint64_t const target = stats->target_nanoseconds? stats->target_nanoseconds : 1000000000ull / 60;
+     if (2*nanoseconds[MU_FRAME_STAGE_FRAME] > 3*target) stats->missed_n++;
+     stats->last_i = slot_i;
+     stats->frames_n++;
+     if (slot_i != MU_FRAME_STATS_FRAMES - 1) return;
+
+     // the ring was filled again: percentiles, once every MU_FRAME_STATS_FRAMES frames
+     for (int stage_i = 0; stage_i < MU_FRAME_STAGES_N; ++stage_i) {
+          uint32_t sorted[MU_FRAME_STATS_FRAMES];
+          memcpy(sorted, stats->ring[stage_i], sizeof sorted);
+          qsort(sorted, MU_FRAME_STATS_FRAMES, sizeof *sorted, mu_frame_stats_compare);
+          stats->summary[stage_i] = (struct Mu_FrameStageSummary){
+               .p50_nanoseconds = sorted[MU_FRAME_STATS_FRAMES / 2],
+               .p99_nanoseconds = sorted[MU_FRAME_STATS_FRAMES * 99 / 100],
+               .max_nanoseconds = sorted[MU_FRAME_STATS_FRAMES - 1],
+          };
+     }
+}
+
+void Mu_PullFrameStats(struct Mu_FrameStats *stats, struct Mu_FrameTimer const *timer, uint64_t now)
+{
+     if (timer->frame_ticks == 0) return;
+     Mu_Bool const pushed = timer->push_ticks >= timer->pull_ticks;
+     uint64_t nanoseconds[MU_FRAME_STAGES_N] = {
+          [MU_FRAME_STAGE_EVENTS] = timer->events_ticks_n,
+          [MU_FRAME_STAGE_UPDATE] = timer->update_ticks_n,
+          [MU_FRAME_STAGE_CLIENT] = (pushed? timer->push_ticks : now) - timer->pull_ticks,
+          [MU_FRAME_STAGE_SWAP] = pushed? timer->swap_ticks_n : 0,
+          [MU_FRAME_STAGE_FRAME] = now - timer->frame_ticks,
+     };
+     if (timer->ticks_denom) {
+          for (int stage_i = 0; stage_i < MU_FRAME_STAGES_N; ++stage_i) {
+               nanoseconds[stage_i] = nanoseconds[stage_i] * timer->ticks_numer / timer->ticks_denom;
+          }
+     }
+     mu_frame_stats_record(stats, nanoseconds);
+}
+
+// Audio Telemetry:
+
+// single writer: plain loads and stores, no read-modify-write
+MU_STATS_INTERNAL
+void mu_audio_telemetry_add(atomic_uint_fast64_t *counter, uint64_t n)
+{
+     atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+MU_STATS_INTERNAL
+void mu_audio_telemetry_max(atomic_uint_fast64_t *counter, uint64_t x)
+{
+     if (x > atomic_load_explicit(counter, memory_order_relaxed)) atomic_store_explicit(counter, x, memory_order_relaxed);
+}
+
+void Mu_RecordAudioCallback(struct Mu_AudioTelemetry *telemetry, uint64_t frames_n, uint64_t samples_per_second, uint64_t nanoseconds)
+{
+     uint64_t const budget = samples_per_second? frames_n * 1000000000ull / samples_per_second : 0;
+     uint64_t const load_permille = budget? nanoseconds * 1000 / budget : 1000;
+     uint64_t const bucket_i = load_permille / (1000 / MU_AUDIO_LOAD_BUCKETS);
+     mu_audio_telemetry_add(&telemetry->callbacks_n, 1);
+     atomic_store_explicit(&telemetry->block_frames, frames_n, memory_order_relaxed);
+     atomic_store_explicit(&telemetry->budget_nanoseconds, budget, memory_order_relaxed);
+     mu_audio_telemetry_add(&telemetry->callback_nanoseconds, nanoseconds);
+     mu_audio_telemetry_max(&telemetry->callback_max_nanoseconds, nanoseconds);
+     mu_audio_telemetry_max(&telemetry->load_max_permille, load_permille);
+     mu_audio_telemetry_add(&telemetry->load_histogram[bucket_i < MU_AUDIO_LOAD_BUCKETS? bucket_i : MU_AUDIO_LOAD_BUCKETS - 1], 1);
+     if (nanoseconds > budget) mu_audio_telemetry_add(&telemetry->overruns_n, 1);
+}
+
+// also written by device listeners (macos), hence the read-modify-write
+void Mu_AddAudioUnderrun(struct Mu_AudioTelemetry *telemetry)
+{
+     atomic_fetch_add_explicit(&telemetry->underruns_n, 1, memory_order_relaxed);
+}
+
+void Mu_PublishAudioStats(struct Mu_AudioTelemetry *telemetry, struct Mu_AudioStats *stats)
+{
+#define MU_LOAD(x) atomic_load_explicit(&(x), memory_order_relaxed)
+     stats->callbacks_n = MU_LOAD(telemetry->callbacks_n);
+     stats->block_frames = MU_LOAD(telemetry->block_frames);
+     stats->budget_nanoseconds = MU_LOAD(telemetry->budget_nanoseconds);
+     stats->callback_nanoseconds = MU_LOAD(telemetry->callback_nanoseconds);
+     stats->callback_max_nanoseconds = MU_LOAD(telemetry->callback_max_nanoseconds);
+     stats->load_max_permille = MU_LOAD(telemetry->load_max_permille);
+     for (int bucket_i = 0; bucket_i < MU_AUDIO_LOAD_BUCKETS; ++bucket_i) stats->load_histogram[bucket_i] = MU_LOAD(telemetry->load_histogram[bucket_i]);
+     stats->overruns_n = MU_LOAD(telemetry->overruns_n);
+     stats->underruns_n = MU_LOAD(telemetry->underruns_n);
+#undef MU_LOAD
+}
+
+#undef MU_STATS_INTERNAL
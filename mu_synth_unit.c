@@ -0,0 +1,153 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_synth.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MU_SYNTH_INTERNAL static
+
+enum {
+     // frames rendered per pass over the voices
+     MU_SYNTH_BLOCK_FRAMES = 256,
+     MU_SYNTH_ARRAYS_N = 7,
+};
+
+// MU_SYNTH_LANES voices, processed together as one vector (split in
+// smaller registers by the compiler when the target has none this wide)
+typedef float Mu_SynthLanes __attribute__((vector_size(MU_SYNTH_LANES * sizeof(float))));
+
+MU_SYNTH_INTERNAL
+float *mu_synth_arrays(struct Mu_Synth *synth, int array_i)
+{
+     float **arrays[MU_SYNTH_ARRAYS_N] = {
+          &synth->osc_cos, &synth->osc_sin, &synth->rot_cos, &synth->rot_sin,
+          &synth->env, &synth->env_mul, &synth->gain,
+     };
+     return *arrays[array_i];
+}
+
+Mu_Bool Mu_SynthInitialize(struct Mu_Synth *synth, int voices_capacity)
+{
+     if (voices_capacity <= 0) return MU_FALSE;
+     voices_capacity = (voices_capacity + MU_SYNTH_LANES - 1) & ~(MU_SYNTH_LANES - 1);
+     size_t const array_size = voices_capacity * sizeof(float);
+     size_t const alignment = sizeof(Mu_SynthLanes);
+     uint8_t *allocation = calloc(1, MU_SYNTH_ARRAYS_N * array_size + alignment);
+     if (!allocation) return MU_FALSE;
+
+     float *arrays = (float *)(((uintptr_t)allocation + alignment - 1) & ~(uintptr_t)(alignment - 1));
+     *synth = (struct Mu_Synth){
+          .voices_capacity = voices_capacity,
+          .end_threshold = 0.01f,
+          .osc_cos = arrays + 0*voices_capacity,
+          .osc_sin = arrays + 1*voices_capacity,
+          .rot_cos = arrays + 2*voices_capacity,
+          .rot_sin = arrays + 3*voices_capacity,
+          .env = arrays + 4*voices_capacity,
+          .env_mul = arrays + 5*voices_capacity,
+          .gain = arrays + 6*voices_capacity,
+          .allocation = allocation,
+     };
+     return MU_TRUE;
+}
+
+void Mu_SynthClose(struct Mu_Synth *synth)
+{
+     free(synth->allocation);
+     *synth = (struct Mu_Synth){ 0 };
+}
+
+Mu_Bool Mu_SynthNoteOn(struct Mu_Synth *synth, float samples_per_second, float pitch_hz, float gain, float decay_per_second)
+{
+     if (synth->voices_n == synth->voices_capacity) return MU_FALSE;
+     int const i = synth->voices_n++;
+     // @note: the only transcendental calls, once per note
+     double const w = 2.0 * 3.141592653589793 * pitch_hz / samples_per_second;
+     synth->osc_cos[i] = 1.0f;
+     synth->osc_sin[i] = 0.0f;
+     synth->rot_cos[i] = (float)cos(w);
+     synth->rot_sin[i] = (float)sin(w);
+     synth->env[i] = 1.0f;
+     synth->env_mul[i] = (float)exp(-decay_per_second / samples_per_second);
+     synth->gain[i] = gain;
+     return MU_TRUE;
+}
+
+MU_SYNTH_INTERNAL
+void mu_synth_render_block(struct Mu_Synth *synth, float *mono_frames, int frames_n)
+{
+     // per-lane partial sums, reduced once per block rather than once per voice
+     Mu_SynthLanes partial[MU_SYNTH_BLOCK_FRAMES];
+     memset(partial, 0, frames_n * sizeof partial[0]);
+
+     for (int voice_i = 0; voice_i < synth->voices_n; voice_i += MU_SYNTH_LANES) {
+          Mu_SynthLanes c = *(Mu_SynthLanes *)&synth->osc_cos[voice_i];
+          Mu_SynthLanes s = *(Mu_SynthLanes *)&synth->osc_sin[voice_i];
+          Mu_SynthLanes const rc = *(Mu_SynthLanes *)&synth->rot_cos[voice_i];
+          Mu_SynthLanes const rs = *(Mu_SynthLanes *)&synth->rot_sin[voice_i];
+          Mu_SynthLanes e = *(Mu_SynthLanes *)&synth->env[voice_i];
+          Mu_SynthLanes const em = *(Mu_SynthLanes *)&synth->env_mul[voice_i];
+          Mu_SynthLanes const g = *(Mu_SynthLanes *)&synth->gain[voice_i];
+          Mu_SynthLanes ge = g * e;
+          for (int frame_i = 0; frame_i < frames_n; ++frame_i) {
+               partial[frame_i] += ge * s;
+               Mu_SynthLanes const c_next = c*rc - s*rs;
+               s = s*rc + c*rs;
+               c = c_next;
+               ge *= em;
+          }
+          // the oscillator slowly drifts off the unit circle, pull it back
+          // (first order approximation of 1/sqrt(c^2 + s^2))
+          Mu_SynthLanes const k = 1.5f - 0.5f * (c*c + s*s);
+          *(Mu_SynthLanes *)&synth->osc_cos[voice_i] = c * k;
+          *(Mu_SynthLanes *)&synth->osc_sin[voice_i] = s * k;
+          // the envelope is kept apart from the gain, to test for the end
+          // of voices: e * em^frames_n, by squaring
+          Mu_SynthLanes em_n = em;
+          for (int n = frames_n; n; n >>= 1) {
+               if (n & 1) e *= em_n;
+               em_n *= em_n;
+          }
+          *(Mu_SynthLanes *)&synth->env[voice_i] = e;
+     }
+
+     for (int frame_i = 0; frame_i < frames_n; ++frame_i) {
+          float sum = 0.0f;
+          for (int lane_i = 0; lane_i < MU_SYNTH_LANES; ++lane_i) sum += partial[frame_i][lane_i];
+          mono_frames[frame_i] = sum;
+     }
+}
+
+MU_SYNTH_INTERNAL
+void mu_synth_retire_ended_voices(struct Mu_Synth *synth)
+{
+     for (int voice_i = 0; voice_i < synth->voices_n; ) {
+          if (synth->env[voice_i] >= synth->end_threshold) {
+               ++voice_i;
+               continue;
+          }
+          // replace by the last voice, and silence the freed lane
+          int const last_i = --synth->voices_n;
+          for (int array_i = 0; array_i < MU_SYNTH_ARRAYS_N; ++array_i) {
+               float *array = mu_synth_arrays(synth, array_i);
+               array[voice_i] = array[last_i];
+               array[last_i] = 0.0f;
+          }
+     }
+}
+
+void Mu_SynthRender(struct Mu_Synth *synth, float *mono_frames, int frames_n)
+{
+     for (int frame_i = 0; frame_i < frames_n; frame_i += MU_SYNTH_BLOCK_FRAMES) {
+          int const block_n = frames_n - frame_i < MU_SYNTH_BLOCK_FRAMES? frames_n - frame_i : MU_SYNTH_BLOCK_FRAMES;
+          mu_synth_render_block(synth, mono_frames + frame_i, block_n);
+     }
+     mu_synth_retire_ended_voices(synth);
+}
+
+#undef MU_SYNTH_INTERNAL
@@ -0,0 +1,250 @@
+// @language: c11
+// @dependencylist: xxxx_mu
+
+#include "xxxx_mu.h"
+#include "xxxx_mu_telemetry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+#include <stdatomic.h>
+
+#define MU_TELEMETRY_INTERNAL static
+#define MU_TELEMETRY_TRACEF(...) printf("Mu: " __VA_ARGS__)
+
+enum {
+     MU_TELEMETRY_WORDS_N = (sizeof (struct Mu_TelemetrySnapshot) + 7) / 8,
+     // copies a reader tries before giving up
+     MU_TELEMETRY_READ_TRIES = 64,
+};
+
+// Shared memory layout:
+
+struct Mu_TelemetryRegion
+{
+     char magic[8]; // "MU_TELEM"
+     uint32_t version; // MU_TELEMETRY_VERSION
+     uint32_t snapshot_size;
+     uint32_t pid;
+     _Alignas(64) atomic_uint sequence; // odd while a snapshot is written
+     // the snapshot, read and written a word at a time so that a torn
+     // copy is detected rather than undefined
+     _Alignas(64) atomic_uint_least64_t words[MU_TELEMETRY_WORDS_N];
+};
+
+union Mu_TelemetryWords
+{
+     struct Mu_TelemetrySnapshot snapshot;
+     uint64_t words[MU_TELEMETRY_WORDS_N];
+};
+
+MU_TELEMETRY_INTERNAL
+char const *mu_telemetry_name(char const *name)
+{
+     return name? name : "/mu_telemetry";
+}
+
+MU_TELEMETRY_INTERNAL
+uint64_t mu_telemetry_nanoseconds(void)
+{
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Writer:
+
+// pid of the program that created the object `name`, 0 when it cannot
+// be told yet (being created by that program) or at all (another layout)
+MU_TELEMETRY_INTERNAL
+uint32_t mu_telemetry_owner_pid(char const *name)
+{
+     int fd = shm_open(name, O_RDONLY, 0);
+     if (fd < 0) return 0;
+     struct stat st;
+     struct Mu_TelemetryRegion const *region = MAP_FAILED;
+     if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof *region) {
+          region = mmap(NULL, sizeof *region, PROT_READ, MAP_SHARED, fd, 0);
+     }
+     close(fd);
+     if (region == MAP_FAILED) return 0;
+     uint32_t const pid = memcmp(region->magic, "MU_TELEM", sizeof region->magic) == 0? region->pid : 0;
+     munmap((void *)region, sizeof *region);
+     return pid;
+}
+
+void Mu_OpenTelemetry(struct Mu *mu)
+{
+     struct Mu_Telemetry *telemetry = &mu->telemetry;
+     if (!telemetry->enabled) return;
+     char const *name = mu_telemetry_name(telemetry->name);
+     int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+     if (fd < 0 && errno == EEXIST) {
+          uint32_t const pid = mu_telemetry_owner_pid(name);
+          if (pid == 0) {
+               MU_TELEMETRY_TRACEF("telemetry disabled: shared memory object %s is being created, or of another layout\n", name);
+               return;
+          }
+          // EPERM: alive, but another user's
+          if (kill((pid_t)pid, 0) == 0 || errno == EPERM) {
+               MU_TELEMETRY_TRACEF("telemetry disabled: shared memory object %s is used by process %u\n", name, pid);
+               return;
+          }
+          // left over by a program that did not quit, and which macOS would not resize
+          shm_unlink(name);
+          fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+     }
+     if (fd < 0) {
+          MU_TELEMETRY_TRACEF("telemetry disabled: could not create shared memory object %s: %s\n", name, strerror(errno));
+          return;
+     }
+     struct Mu_TelemetryRegion *region = MAP_FAILED;
+     if (ftruncate(fd, sizeof *region) == 0) {
+          region = mmap(NULL, sizeof *region, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+     }
+     close(fd);
+     if (region == MAP_FAILED) {
+          MU_TELEMETRY_TRACEF("telemetry disabled: could not map shared memory object %s: %s\n", name, strerror(errno));
+          shm_unlink(name);
+          return;
+     }
+     memcpy(region->magic, "MU_TELEM", sizeof region->magic);
+     region->version = MU_TELEMETRY_VERSION;
+     region->snapshot_size = sizeof (struct Mu_TelemetrySnapshot);
+     region->pid = (uint32_t)getpid();
+     atomic_init(&region->sequence, 0);
+     for (int word_i = 0; word_i < MU_TELEMETRY_WORDS_N; ++word_i) atomic_init(&region->words[word_i], 0);
+     telemetry->region = region;
+     telemetry->published_n = 0;
+}
+
+MU_TELEMETRY_INTERNAL
+void mu_telemetry_snapshot(struct Mu const *mu, struct Mu_TelemetrySnapshot *snapshot)
+{
+     struct Mu_FrameStats const *frame_stats = &mu->frame_stats;
+     snapshot->published_n = mu->telemetry.published_n;
+     snapshot->publish_nanoseconds = mu->telemetry.publish_nanoseconds;
+     snapshot->quit = mu->quit;
+     snapshot->time = mu->time;
+     snapshot->window_position = mu->window.position;
+     snapshot->window_size = mu->window.size;
+     snapshot->mouse = mu->mouse;
+     for (int key_i = 0; key_i < MU_MAX_KEYS; ++key_i) {
+          if (mu->keys[key_i].down) snapshot->keys_down[key_i / 64] |= 1ull << (key_i % 64);
+     }
+     memcpy(snapshot->gamepads, mu->gamepads, sizeof snapshot->gamepads);
+     snapshot->input_events_n = mu->input_events.events_n;
+     snapshot->input_events_dropped_n = mu->input_events.dropped_n;
+     snapshot->frame_target_nanoseconds = frame_stats->target_nanoseconds;
+     snapshot->frames_n = frame_stats->frames_n;
+     snapshot->frames_missed_n = frame_stats->missed_n;
+     for (int stage_i = 0; stage_i < MU_FRAME_STAGES_N; ++stage_i) {
+          snapshot->frame_nanoseconds[stage_i] = frame_stats->ring[stage_i][frame_stats->last_i];
+          snapshot->frame_summary[stage_i] = frame_stats->summary[stage_i];
+     }
+     snapshot->audio_stats = mu->audio.stats;
+     snapshot->audio_clock = mu->audio.clock;
+     snapshot->jobs_n = mu->jobs.jobs_n;
+     snapshot->jobs_steals_n = mu->jobs.steals_n;
+     snapshot->frame_arena_bytes_n = mu->jobs.frame_arena_bytes_n;
+}
+
+void Mu_PublishTelemetry(struct Mu *mu)
+{
+     struct Mu_Telemetry *telemetry = &mu->telemetry;
+     struct Mu_TelemetryRegion *region = telemetry->region;
+     if (!region) return;
+     uint64_t const t0 = mu_telemetry_nanoseconds();
+     telemetry->published_n++;
+     union Mu_TelemetryWords staging = { 0 };
+     mu_telemetry_snapshot(mu, &staging.snapshot);
+
+     unsigned const sequence = atomic_load_explicit(&region->sequence, memory_order_relaxed);
+     atomic_store_explicit(&region->sequence, sequence + 1, memory_order_relaxed);
+     atomic_thread_fence(memory_order_release);
+     for (int word_i = 0; word_i < MU_TELEMETRY_WORDS_N; ++word_i) {
+          atomic_store_explicit(&region->words[word_i], staging.words[word_i], memory_order_relaxed);
+     }
+     atomic_store_explicit(&region->sequence, sequence + 2, memory_order_release);
+     telemetry->publish_nanoseconds = mu_telemetry_nanoseconds() - t0;
+
+     if (mu->quit) Mu_CloseTelemetry(mu);
+}
+
+void Mu_CloseTelemetry(struct Mu *mu)
+{
+     struct Mu_Telemetry *telemetry = &mu->telemetry;
+     if (!telemetry->region) return;
+     munmap(telemetry->region, sizeof *telemetry->region);
+     shm_unlink(mu_telemetry_name(telemetry->name));
+     telemetry->region = NULL;
+}
+
+// Reader:
+
+Mu_Bool Mu_OpenTelemetryReader(char const *name, struct Mu_TelemetryReader *reader)
+{
+     *reader = (struct Mu_TelemetryReader){ 0 };
+     int fd = shm_open(mu_telemetry_name(name), O_RDONLY, 0);
+     if (fd < 0) return MU_FALSE;
+     struct stat st;
+     struct Mu_TelemetryRegion const *region = MAP_FAILED;
+     if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof *region) {
+          region = mmap(NULL, sizeof *region, PROT_READ, MAP_SHARED, fd, 0);
+     }
+     close(fd);
+     if (region == MAP_FAILED) return MU_FALSE;
+     if (memcmp(region->magic, "MU_TELEM", sizeof region->magic) != 0
+         || region->version != MU_TELEMETRY_VERSION
+         || region->snapshot_size != sizeof (struct Mu_TelemetrySnapshot)) {
+          munmap((void *)region, sizeof *region);
+          return MU_FALSE;
+     }
+     reader->region = region;
+     reader->pid = region->pid;
+     return MU_TRUE;
+}
+
+void Mu_CloseTelemetryReader(struct Mu_TelemetryReader *reader)
+{
+     if (reader->region) munmap((void *)reader->region, sizeof *reader->region);
+     reader->region = NULL;
+}
+
+Mu_Bool Mu_ReadTelemetry(struct Mu_TelemetryReader *reader, struct Mu_TelemetrySnapshot *snapshot)
+{
+     // only loaded from, which a read-only mapping allows for lock-free atomics
+     struct Mu_TelemetryRegion *region = (struct Mu_TelemetryRegion *)reader->region;
+     if (!region) return MU_FALSE;
+     union Mu_TelemetryWords copy;
+     for (int try_i = 0; try_i < MU_TELEMETRY_READ_TRIES; ++try_i) {
+          unsigned const sequence = atomic_load_explicit(&region->sequence, memory_order_acquire);
+          if (sequence & 1) {
+               reader->retries_n++;
+               continue;
+          }
+          for (int word_i = 0; word_i < MU_TELEMETRY_WORDS_N; ++word_i) {
+               copy.words[word_i] = atomic_load_explicit(&region->words[word_i], memory_order_relaxed);
+          }
+          atomic_thread_fence(memory_order_acquire);
+          if (sequence == atomic_load_explicit(&region->sequence, memory_order_relaxed)) {
+               *snapshot = copy.snapshot;
+               return MU_TRUE;
+          }
+          reader->retries_n++;
+     }
+     return MU_FALSE;
+}
+
+#undef MU_TELEMETRY_TRACEF
+#undef MU_TELEMETRY_INTERNAL
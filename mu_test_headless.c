@@ -0,0 +1,18 @@
+#include <limits.h>
+#include <unistd.h>
+
+// resources are found next to the executable, see linux_build.sh
+MU_TEST_INTERNAL
+int platform_get_resource_path(char* buffer, int buffer_n, char const * const relative_path, int relative_path_n)
+{
+     ssize_t exe_n = readlink("/proc/self/exe", buffer, buffer_n);
+     if (exe_n <= 0 || exe_n >= buffer_n) return buffer_n;
+     int buffer_i = exe_n;
+     while (buffer_i > 0 && buffer[buffer_i - 1] != '/') --buffer_i;
+     char const * s = relative_path;
+     int const s_n = relative_path_n;
+     if (buffer_i + s_n < buffer_n) memcpy(buffer + buffer_i, s, s_n), buffer_i += s_n;
+     else return buffer_n;
+     buffer[buffer_i++] = 0;
+     return buffer_i;
+}
@@ -0,0 +1,47 @@
+// @language: c11
+// @platform: headless
+//
+// Null OpenGL 1.x entry points for the test program, letting its
+// frame loop run without a window server or a GL driver. Only what
+// `mu_test_unit.c` uses is declared.
+
+typedef unsigned int GLenum;
+typedef unsigned int GLbitfield;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef float GLfloat;
+typedef double GLdouble;
+
+enum {
+     GL_QUADS = 0x0007,
+     GL_NEAREST = 0x2600,
+     GL_TEXTURE_MAG_FILTER = 0x2800,
+     GL_TEXTURE_MIN_FILTER = 0x2801,
+     GL_MODELVIEW = 0x1700,
+     GL_PROJECTION = 0x1701,
+     GL_UNSIGNED_BYTE = 0x1401,
+     GL_RGBA = 0x1908,
+     GL_UNPACK_ROW_LENGTH = 0x0CF2,
+     GL_DEPTH_BUFFER_BIT = 0x00000100,
+     GL_COLOR_BUFFER_BIT = 0x00004000,
+};
+
+static inline void glGenTextures(GLsizei n, GLuint *textures) { static GLuint next_id = 1; while (n--) *textures++ = next_id++; }
+static inline void glBindTexture(GLenum target, GLuint texture) {}
+static inline void glTexParameteri(GLenum target, GLenum pname, GLint param) {}
+static inline void glPixelStorei(GLenum pname, GLint param) {}
+static inline void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) {}
+static inline void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {}
+static inline void glMatrixMode(GLenum mode) {}
+static inline void glLoadIdentity(void) {}
+static inline void glOrtho(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble near_val, GLdouble far_val) {}
+static inline void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {}
+static inline void glClear(GLbitfield mask) {}
+static inline void glEnable(GLenum cap) {}
+static inline void glDisable(GLenum cap) {}
+static inline void glColor3f(GLfloat red, GLfloat green, GLfloat blue) {}
+static inline void glBegin(GLenum mode) {}
+static inline void glEnd(void) {}
+static inline void glVertex2f(GLfloat x, GLfloat y) {}
+static inline void glTexCoord2i(GLint s, GLint t) {}
@@ -6,10 +6,23 @@
 //
 
 #include "xxxx_mu.h"
-
+#include "xxxx_mu_audiofile.h"
+#include "xxxx_mu_audiograph.h"
+#include "xxxx_mu_mixer.h"
+#include "xxxx_mu_pack.h"
+#include "xxxx_mu_queue.h"
+#include "xxxx_mu_raster.h"
+#include "xxxx_mu_record.h"
+#include "xxxx_mu_resampler.h"
+#include "xxxx_mu_synth.h"
+
+#if defined(__APPLE__)
 #include "xxxx_mu_cocoa.h" // @todo: @platform{macos} because I need the platform specific keyname
-
 #include "OpenGL/gl.h" // @todo: @platform{macos} specific location
+#else
+#include "xxxx_mu_headless.h"
+#include "mu_test_headless_gl.h"
+#endif
 
 #if defined(__STDC_NO_ATOMICS__)
 #error "Error: C11 atomics not found"
@@ -25,34 +38,91 @@
 // @note: marks assets
 #define MU_TEST_ASSET(x__) x__
 
-struct Mu_Test_AudioNote_InitParameters
+// commands sent to the audio thread, which all start with the frame of
+// the audio stream they apply at (0 for as soon as possible)
+enum {
+     MU_TEST_AUDIOCOMMAND_NOTE_ON = 1,
+     MU_TEST_AUDIOCOMMAND_PLAY_SAMPLE,
+     MU_TEST_AUDIOCOMMAND_SET_MUSIC,
+     // sent back by the audio thread
+     MU_TEST_AUDIOCOMMAND_SAMPLE_ENDED,
+};
+
+struct Mu_Test_AudioCommand_NoteOn
 {
+     uint64_t frame_i;
      float pitch_hz;
-     struct Mu_AudioBuffer *optional_source;
+};
+
+struct Mu_Test_AudioCommand_PlaySample
+{
+     uint64_t frame_i;
+     struct Mu_AudioBuffer *source;
+};
+
+struct Mu_Test_AudioCommand_SetMusic
+{
+     uint64_t frame_i;
+     bool playing;
+};
+
+struct Mu_Test_AudioCommand_SampleEnded
+{
+     struct Mu_AudioBuffer *source;
 };
 
 struct Mu_Test_AudioNote_Playing
 {
-     struct Mu_Test_AudioNote_InitParameters init_parameters;
-     double phase;
-     int source_frame_i;
+     struct Mu_AudioBuffer *source;
+     size_t source_frame_i;
+};
+
+enum {
+     MU_TEST_AUDIOSYNTH_COMMANDS_BYTES_CAPACITY = 64 * 1024,
+     MU_TEST_AUDIOSYNTH_RETIRED_BYTES_CAPACITY = 4 * 1024,
+     MU_TEST_AUDIOSYNTH_PLAYING_NOTES_CAPACITY = 4096,
+     MU_TEST_AUDIOSYNTH_PLAYING_SAMPLES_CAPACITY = 64,
+     // frames of oscillators rendered at once, before being mixed
+     MU_TEST_AUDIOSYNTH_BLOCK_FRAMES = 512,
 };
 
+// submix buses of the synth's graph, mixed into its master bus
 enum {
-     MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_POWER = 3,
-    MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_COUNT = 1<<MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_POWER,
-    MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_MASK = (1<<MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_POWER) - 1,
-     MU_TEST_AUDIOSYNTH_PLAYING_NOTES_CAPACITY = 64,
+     MU_TEST_AUDIOBUS_NOTES = 1,
+     MU_TEST_AUDIOBUS_MUSIC,
+     MU_TEST_AUDIOBUS_SAMPLES,
+     MU_TEST_AUDIOBUSES_N,
 };
 
 struct Mu_Test_AudioSynth
 {
-     atomic_uint input_notes_rb_write_n; // @shared
-     atomic_uint input_notes_rb_read_n; // @shared
-     struct Mu_Test_AudioNote_InitParameters input_notes_rb[MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_COUNT]; // @shared
-
-     int playing_notes_n;
-     struct Mu_Test_AudioNote_Playing playing_notes[MU_TEST_AUDIOSYNTH_PLAYING_NOTES_CAPACITY];
+     struct Mu_Queue commands; // @shared: main thread to audio thread
+     struct Mu_Queue retired; // @shared: audio thread to main thread, once done with a buffer
+     atomic_uint late_commands_n; // @shared: applied after their frame
+     int playing_sources_n; // main thread: buffers sent but not yet retired
+
+     uint64_t frames_n; // passed to the callback so far, see `Mu_AudioClock`
+     double amp; // of notes, samples and music
+
+     struct Mu_Synth playing_notes;
+     int playing_samples_n;
+     struct Mu_Test_AudioNote_Playing playing_samples[MU_TEST_AUDIOSYNTH_PLAYING_SAMPLES_CAPACITY];
+     float notes_frames[MU_TEST_AUDIOSYNTH_BLOCK_FRAMES];
+
+     // @shared: set before the first MU_TEST_AUDIOCOMMAND_SET_MUSIC, with
+     // the resampler of `music_voice` when the rates differ
+     struct Mu_AudioStream *music;
+     struct Mu_ResamplerFilter music_filter;
+     struct Mu_Resampler music_resampler;
+     bool music_playing;
+     // frames read from the stream and not mixed yet: the voice's cursor
+     // (fraction, resampler history) carries over from block to block.
+     // Up to four blocks, for a music at up to three times the device's rate.
+     struct Mu_MixerVoice music_voice;
+     size_t music_frames_n;
+     int16_t music_samples[4*MU_TEST_AUDIOSYNTH_BLOCK_FRAMES*MU_MIXER_MAX_CHANNELS];
+
+     struct Mu_AudioGraph graph;
 };
 
 MU_TEST_INTERNAL
@@ -65,137 +135,282 @@ double db_to_amp (double volume_in_db)
 }
 
 MU_TEST_INTERNAL
-int audio_mix(struct Mu_AudioBuffer const * source, struct Mu_AudioBuffer *dest, double amp, int s_frame_i)
+void main_audio_callback(struct Mu_AudioBuffer *audiobuffer)
 {
-     int16_t* const s_sample_f = source->samples;
-     int16_t* const s_sample_l = s_sample_f + source->samples_count;
-     int16_t* s_sample = s_sample_f + s_frame_i;
-     int16_t* const d_sample_f = dest->samples;
-     int16_t* const d_sample_l = dest->samples + dest->samples_count;
-     int16_t* d_sample = d_sample_f;
-     if (source->format.channels == 1) {
-          while (d_sample != d_sample_l && s_sample != s_sample_l) {
-               int16_t x = amp * (*s_sample);
-               for(int n = dest->format.channels; n--;) {
-                    *d_sample++ += x;
+     int const frames_n = audiobuffer->samples_count/audiobuffer->format.channels;
+     double const sr_hz = audiobuffer->format.samples_per_second;
+     memset(audiobuffer->samples, 0, frames_n*audiobuffer->format.channels*audiobuffer->format.bytes_per_sample);
+
+     struct Mu_Test_AudioSynth * const synth = &mu_test_audiosynth;
+     double const amp = synth->amp;
+
+     struct Mu_AudioBuffer notes_buffer = {
+          .float_samples = synth->notes_frames,
+          .format = {
+               .samples_per_second = audiobuffer->format.samples_per_second,
+               .channels = 1,
+               .bytes_per_sample = sizeof(float),
+               .sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32,
+          },
+     };
+     for (int frame_i = 0, block_n; frame_i < frames_n; frame_i += block_n) {
+          block_n = frames_n - frame_i < MU_TEST_AUDIOSYNTH_BLOCK_FRAMES? frames_n - frame_i : MU_TEST_AUDIOSYNTH_BLOCK_FRAMES;
+
+          // apply the commands due at this frame, and end the block at the next one
+          uint64_t const stream_frame_i = synth->frames_n + frame_i;
+          for (struct Mu_QueueCommand const *command; (command = Mu_QueuePeek(&synth->commands)); Mu_QueuePop(&synth->commands)) {
+               uint64_t const command_frame_i = *(uint64_t const *)(command + 1);
+               if (command_frame_i > stream_frame_i) {
+                    if (command_frame_i - stream_frame_i < (uint64_t)block_n) block_n = command_frame_i - stream_frame_i;
+                    break;
                }
-               ++s_sample;
-          }
-     } else {
-          while (d_sample != d_sample_l && s_sample != s_sample_l) {
-               int s_channels = source->format.channels;
-               int d_channels = dest->format.channels;
-               int channels_n = d_channels < s_channels ? d_channels:s_channels;
-               for (int channel_i=0; channel_i < channels_n; ++channel_i) {
-                    d_sample[channel_i] += amp*s_sample[channel_i];
+               if (command->type == MU_TEST_AUDIOCOMMAND_NOTE_ON) {
+                    struct Mu_Test_AudioCommand_NoteOn const *note_on = (void const *)(command + 1);
+                    // envelope: exp(-0.006 * periods elapsed)
+                    if (!Mu_SynthNoteOn(&synth->playing_notes, sr_hz, note_on->pitch_hz, amp, 0.006 * note_on->pitch_hz)) break;
+               } else if (command->type == MU_TEST_AUDIOCOMMAND_PLAY_SAMPLE) {
+                    struct Mu_Test_AudioCommand_PlaySample const *play_sample = (void const *)(command + 1);
+                    if (synth->playing_samples_n == MU_TEST_AUDIOSYNTH_PLAYING_SAMPLES_CAPACITY) break;
+                    synth->playing_samples[synth->playing_samples_n++] = (struct Mu_Test_AudioNote_Playing){
+                         .source = play_sample->source,
+                    };
+               } else if (command->type == MU_TEST_AUDIOCOMMAND_SET_MUSIC) {
+                    synth->music_playing = ((struct Mu_Test_AudioCommand_SetMusic const *)(command + 1))->playing;
                }
-               d_sample += d_channels;
-               s_sample += s_channels;
+               if (command_frame_i && command_frame_i < stream_frame_i) atomic_fetch_add(&synth->late_commands_n, 1);
+          }
+
+          struct Mu_AudioBuffer block = *audiobuffer;
+          block.samples_count = block_n*block.format.channels;
+          block.samples = (int16_t *)((uint8_t *)audiobuffer->samples + frame_i*block.format.channels*block.format.bytes_per_sample);
+
+          struct Mu_MixerVoice voices[2 + MU_TEST_AUDIOSYNTH_PLAYING_SAMPLES_CAPACITY];
+          int voices_n = 0;
+          /* notes */ {
+               Mu_SynthRender(&synth->playing_notes, synth->notes_frames, block_n);
+               notes_buffer.samples_count = block_n;
+               voices[voices_n++] = (struct Mu_MixerVoice){ .source = &notes_buffer, .gain = 1.0f };
+          }
+          struct Mu_AudioGraphBus * const buses = synth->graph.buses;
+          buses[MU_TEST_AUDIOBUS_NOTES].voices = voices;
+          buses[MU_TEST_AUDIOBUS_NOTES].voices_n = 1;
+          buses[MU_TEST_AUDIOBUS_MUSIC].voices = voices + voices_n;
+          buses[MU_TEST_AUDIOBUS_MUSIC].voices_n = synth->music_playing? 1 : 0;
+          struct Mu_AudioBuffer music_buffer;
+          int const music_voice_i = voices_n;
+          if (synth->music_playing) {
+               struct Mu_AudioStream * const music = synth->music;
+               size_t const music_channels_n = music->format.channels;
+               size_t const music_capacity = sizeof synth->music_samples / sizeof synth->music_samples[0] / music_channels_n;
+               // drop what the last block mixed, then top up from the stream
+               size_t const mixed_n = synth->music_voice.source_frame_i < synth->music_frames_n? synth->music_voice.source_frame_i : synth->music_frames_n;
+               synth->music_frames_n -= mixed_n;
+               memmove(synth->music_samples, synth->music_samples + mixed_n*music_channels_n, synth->music_frames_n*music_channels_n*sizeof synth->music_samples[0]);
+               synth->music_frames_n += Mu_ReadAudioStream(music, synth->music_samples + synth->music_frames_n*music_channels_n, music_capacity - synth->music_frames_n);
+               music_buffer = (struct Mu_AudioBuffer){
+                    .samples = synth->music_samples,
+                    .samples_count = synth->music_frames_n * music_channels_n,
+                    .format = music->format,
+               };
+               synth->music_voice.source = &music_buffer;
+               synth->music_voice.gain = amp;
+               synth->music_voice.source_frame_i = 0;
+               voices[voices_n++] = synth->music_voice;
+          }
+          int const samples_voice_i = voices_n;
+          for (int sample_i = 0; sample_i < synth->playing_samples_n; ++sample_i) {
+               struct Mu_Test_AudioNote_Playing * const sample = &synth->playing_samples[sample_i];
+               voices[voices_n++] = (struct Mu_MixerVoice){
+                    .source = sample->source,
+                    .gain = amp,
+                    .source_frame_i = sample->source_frame_i,
+               };
+          }
+          buses[MU_TEST_AUDIOBUS_SAMPLES].voices = voices + samples_voice_i;
+          buses[MU_TEST_AUDIOBUS_SAMPLES].voices_n = synth->playing_samples_n;
+          Mu_AudioGraphRender(&synth->graph, &block);
+          if (synth->music_playing) synth->music_voice = voices[music_voice_i];
+          for (int sample_i = 0; sample_i < synth->playing_samples_n; ++sample_i) {
+               synth->playing_samples[sample_i].source_frame_i = voices[samples_voice_i + sample_i].source_frame_i;
+          }
+     }
+     Mu_QueueRelease(&synth->commands);
+     synth->frames_n += frames_n;
+
+     for (int sample_i = 0; sample_i < synth->playing_samples_n;) {
+          struct Mu_Test_AudioNote_Playing * const sample = &synth->playing_samples[sample_i];
+          struct Mu_AudioBuffer * const source = sample->source;
+          if (sample->source_frame_i >= source->samples_count/source->format.channels) {
+               // when the queue is full, try again at the next callback
+               struct Mu_Test_AudioCommand_SampleEnded const sample_ended = { .source = source };
+               if (!Mu_QueuePush(&synth->retired, MU_TEST_AUDIOCOMMAND_SAMPLE_ENDED, &sample_ended, sizeof sample_ended)) break;
+               *sample = synth->playing_samples[--synth->playing_samples_n];
+          } else {
+               sample_i++;
           }
      }
-     return s_sample - s_sample_f;
+     Mu_QueuePublish(&synth->retired);
 }
 
 MU_TEST_INTERNAL
-void main_audio_callback(struct Mu_AudioBuffer *audiobuffer)
+bool mu_test_audiosynth_initialize(struct Mu_Test_AudioSynth * const synth)
 {
-     int16_t * const stereo_frames = audiobuffer->samples;
-     int const frames_n = audiobuffer->samples_count/audiobuffer->format.channels;
-     double const sr_hz = audiobuffer->format.samples_per_second;
-     memset(stereo_frames, 0, frames_n*audiobuffer->format.channels*audiobuffer->format.bytes_per_sample);
-
-     struct Mu_Test_AudioSynth * const synth = &mu_test_audiosynth;
-     
-     unsigned int input_notes_n = atomic_load(&synth->input_notes_rb_write_n);
-     unsigned int input_notes_read_n = atomic_load(&synth->input_notes_rb_read_n);
-     for (unsigned int input_note_i = input_notes_read_n; input_note_i != input_notes_n; input_note_i++) {
-	      int next_note_i = synth->playing_notes_n;
-	      if (next_note_i != MU_TEST_AUDIOSYNTH_PLAYING_NOTES_CAPACITY) {
-                   int note_i = input_note_i & MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_MASK;
-                   synth->playing_notes_n++;
-                   synth->playing_notes[next_note_i] = (struct Mu_Test_AudioNote_Playing){
-                        .init_parameters = synth->input_notes_rb[note_i],
-                   };
-                   ++input_notes_read_n;
-	      }
-     }
-     atomic_store(&synth->input_notes_rb_read_n, input_notes_read_n);
-     
-     static const double TAU = 6.2831853071795864769252;
-     for (int note_i = 0; note_i < synth->playing_notes_n;) {
-	  struct Mu_Test_AudioNote_Playing * const note = &synth->playing_notes[note_i];
-	  double phase = note->phase;
-	  double phase_delta = note->init_parameters.pitch_hz / sr_hz;
-	  double const amp = db_to_amp(-20.0);
-	  _Bool note_has_ended = false;
-	  for (int frame_i = 0; frame_i < frames_n; ++frame_i) {
-	       double const env = fmin(1.0, exp(-6.0 * phase * 0.001));
-	       float const y = (float) (env * amp * sin(TAU*phase));
-	       stereo_frames[2*frame_i] += 32767.0f*y;
-	       stereo_frames[2*frame_i + 1] += 32767.0f*y;
-	       phase += phase_delta;
-	       note_has_ended = env < 0.01;
-	  }
-          struct Mu_AudioBuffer *source = note->init_parameters.optional_source;
-          if (source) {
-               note->source_frame_i = audio_mix(source, audiobuffer, amp, note->source_frame_i);
-          }
-	  note->phase = phase;
-	  if (note_has_ended) {
-	       synth->playing_notes_n--;
-	       if (synth->playing_notes_n != note_i) {
-		    memcpy(note, &synth->playing_notes[synth->playing_notes_n], sizeof *note);
-	       }
-	  } else {
-	       note_i++;
-	  }
+     atomic_init(&synth->late_commands_n, 0);
+     synth->amp = db_to_amp(-20.0);
+     synth->commands.bytes_capacity = MU_TEST_AUDIOSYNTH_COMMANDS_BYTES_CAPACITY;
+     synth->retired.bytes_capacity = MU_TEST_AUDIOSYNTH_RETIRED_BYTES_CAPACITY;
+     synth->graph.buses_n = MU_TEST_AUDIOBUSES_N;
+     synth->graph.frames_capacity = MU_TEST_AUDIOSYNTH_BLOCK_FRAMES;
+     synth->graph.buses[MU_AUDIOGRAPH_MASTER] = (struct Mu_AudioGraphBus){ .gain = 1.0f, .limiter_threshold = 0.98f };
+     for (int bus_i = MU_TEST_AUDIOBUS_NOTES; bus_i < MU_TEST_AUDIOBUSES_N; ++bus_i) {
+          synth->graph.buses[bus_i] = (struct Mu_AudioGraphBus){ .parent = MU_AUDIOGRAPH_MASTER, .gain = 1.0f };
      }
+     return Mu_QueueInitialize(&synth->commands)
+          && Mu_QueueInitialize(&synth->retired)
+          && Mu_SynthInitialize(&synth->playing_notes, MU_TEST_AUDIOSYNTH_PLAYING_NOTES_CAPACITY)
+          && Mu_AudioGraphInitialize(&synth->graph);
 }
 
+/*
+ * Frame of the audio stream where an event that happens at `ticks` is
+ * heard. Every event is heard with the same delay, two device buffers
+ * plus the frames rendered ahead in blocks, so that none is late for the
+ * audio thread and their onsets keep the timing they had in input.
+ */
 MU_TEST_INTERNAL
-void mu_test_audiosynth_initialize(struct Mu_Test_AudioSynth * const synth)
+uint64_t mu_test_audiosynth_event_frame(struct Mu const *mu, uint64_t ticks)
 {
-     atomic_init(&synth->input_notes_rb_read_n, 0);
-     atomic_init(&synth->input_notes_rb_write_n, 0);
+     struct Mu_AudioClock const clock = mu->audio.clock;
+     uint64_t const rate = mu->audio.format.samples_per_second;
+     if (clock.frames_n == 0 && clock.output_ticks == 0) return 0; // not running yet
+     int64_t const frame_i = (int64_t)clock.frames_n
+          + (int64_t)(ticks - clock.output_ticks) * (int64_t)rate / (int64_t)mu->time.ticks_per_second
+          + 2*(int64_t)mu->audio.stats.block_frames + (int64_t)mu->audio.block_latency_frames;
+     return frame_i > 0? frame_i : 0;
 }
 
 MU_TEST_INTERNAL
-bool mu_test_audiosynth_push_event(struct Mu_Test_AudioSynth * const synth, double const pitch_hz, struct Mu_AudioBuffer *optional_source)
+bool mu_test_audiosynth_push_note(struct Mu_Test_AudioSynth * const synth, uint64_t const frame_i, double const pitch_hz)
 {
-    unsigned int write_n = atomic_load(&synth->input_notes_rb_write_n);
-    unsigned int read_n = atomic_load(&synth->input_notes_rb_read_n);
-    if (write_n - read_n >=MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_COUNT) {
-        return false;
-    }
-    unsigned int input_note_i = (write_n & MU_TEST_AUDIOSYNTH_INPUT_NOTES_RINGBUFFER_MASK);
-    synth->input_notes_rb[input_note_i] = (struct Mu_Test_AudioNote_InitParameters){
-        .pitch_hz = pitch_hz,
-        .optional_source = optional_source,
-    };
-    atomic_store(&synth->input_notes_rb_write_n, write_n + 1);
-    return true;
+     struct Mu_Test_AudioCommand_NoteOn const note_on = { .frame_i = frame_i, .pitch_hz = pitch_hz };
+     return Mu_QueuePush(&synth->commands, MU_TEST_AUDIOCOMMAND_NOTE_ON, &note_on, sizeof note_on);
 }
 
 MU_TEST_INTERNAL
-bool mu_test_audiosynth_push_note(struct Mu_Test_AudioSynth * const synth, double const pitch_hz)
+bool mu_test_audiosynth_push_sample(struct Mu_Test_AudioSynth * const synth, uint64_t const frame_i, struct Mu_AudioBuffer *source)
 {
-     mu_test_audiosynth_push_event(synth, pitch_hz, NULL);
+     struct Mu_Test_AudioCommand_PlaySample const play_sample = { .frame_i = frame_i, .source = source };
+     if (!Mu_QueuePush(&synth->commands, MU_TEST_AUDIOCOMMAND_PLAY_SAMPLE, &play_sample, sizeof play_sample)) return false;
+     synth->playing_sources_n++;
      return true;
 }
 
 MU_TEST_INTERNAL
-bool mu_test_audiosynth_push_sample(struct Mu_Test_AudioSynth * const synth, struct Mu_AudioBuffer *source)
+bool mu_test_audiosynth_push_music(struct Mu_Test_AudioSynth * const synth, uint64_t const frame_i, bool const playing)
 {
-     mu_test_audiosynth_push_event(synth, 0.0, source);
-     return true;
+     struct Mu_Test_AudioCommand_SetMusic const set_music = { .frame_i = frame_i, .playing = playing };
+     return Mu_QueuePush(&synth->commands, MU_TEST_AUDIOCOMMAND_SET_MUSIC, &set_music, sizeof set_music);
+}
+
+/*
+ * Once per frame: hands the commands of the frame over to the audio
+ * thread, and takes back the buffers it is done with.
+ */
+MU_TEST_INTERNAL
+void mu_test_audiosynth_update(struct Mu_Test_AudioSynth * const synth)
+{
+     Mu_QueuePublish(&synth->commands);
+     for (struct Mu_QueueCommand const *command; (command = Mu_QueuePeek(&synth->retired)); Mu_QueuePop(&synth->retired)) {
+          if (command->type == MU_TEST_AUDIOCOMMAND_SAMPLE_ENDED) {
+               // buffers owned by the test program are static, so there is nothing to free
+               synth->playing_sources_n--;
+          }
+     }
+     Mu_QueueRelease(&synth->retired);
 }
 
 MU_TEST_INTERNAL
 int platform_get_resource_path(char* buffer, int buffer_n, char const * const relative_path, int relative_path_n);
 
+// the scene is drawn with OpenGL, or into `mu.framebuffer` through this
+// list when started with --framebuffer
+MU_TEST_INTERNAL struct Mu_RasterList *mu_test_raster;
+
+MU_TEST_INTERNAL
+void mu_test_clear(float r, float g, float b)
+{
+     if (mu_test_raster) {
+          Mu_RasterClear(mu_test_raster, Mu_RasterColor(r, g, b, 1.0f));
+          return;
+     }
+     glClearColor(r, g, b, 0.0f);
+     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+MU_TEST_INTERNAL
+void mu_test_quad(int x0, int y0, int x1, int y1, float r, float g, float b)
+{
+     if (mu_test_raster) {
+          Mu_RasterQuad(mu_test_raster, x0, y0, x1, y1, Mu_RasterColor(r, g, b, 1.0f));
+          return;
+     }
+     glColor3f(r, g, b);
+     glBegin(GL_QUADS);
+     glVertex2f(x0, y0);
+     glVertex2f(x1, y0);
+     glVertex2f(x1, y1);
+     glVertex2f(x0, y1);
+     glEnd();
+}
+
+MU_TEST_INTERNAL
+void mu_test_textured_quad(int x0, int y0, int x1, int y1, struct Mu_Image const *image, GLuint texture_id)
+{
+     if (mu_test_raster) {
+          Mu_RasterTexturedQuad(mu_test_raster, x0, y0, x1, y1, image, 0, 0, image->width, image->height);
+          return;
+     }
+     GLuint const defGL_TEXTURE_RECTANGLE = 0x84F5;
+     glBindTexture(defGL_TEXTURE_RECTANGLE, texture_id);
+     glEnable(defGL_TEXTURE_RECTANGLE);
+     glColor3f(1.0f, 1.0f, 1.0f);
+     glBegin(GL_QUADS);
+     glTexCoord2i(0, 0);                          glVertex2f(x0, y0);
+     glTexCoord2i(image->width, 0);               glVertex2f(x1, y0);
+     glTexCoord2i(image->width, image->height);   glVertex2f(x1, y1);
+     glTexCoord2i(0, image->height);              glVertex2f(x0, y1);
+     glEnd();
+     glDisable(defGL_TEXTURE_RECTANGLE);
+}
+
 int main(int argc, char **argv)
 {
-     mu_test_audiosynth_initialize(&mu_test_audiosynth);
+     // --record <file> or --replay <file>, --framebuffer, --telemetry
+     char const *record_path = NULL;
+     char const *replay_path = NULL;
+     bool framebuffer = false;
+     bool telemetry = false;
+     for (int arg_i = 1; arg_i < argc; ++arg_i) {
+          if (0 == strcmp(argv[arg_i], "--framebuffer")) framebuffer = true;
+          else if (0 == strcmp(argv[arg_i], "--telemetry")) telemetry = true;
+          else if (arg_i + 1 == argc) break;
+          else if (0 == strcmp(argv[arg_i], "--record")) record_path = argv[++arg_i];
+          else if (0 == strcmp(argv[arg_i], "--replay")) replay_path = argv[++arg_i];
+     }
+     struct Mu_Recording recording = {0};
+     if (record_path && !Mu_AllocateRecording(&recording, 60*60)) {
+          printf("ERROR: could not allocate recording\n");
+          return 1;
+     }
+     if (replay_path && !Mu_LoadRecording(replay_path, &recording)) {
+          printf("ERROR: could not load recording: '%s'\n", replay_path);
+          return 1;
+     }
+
+     if (!mu_test_audiosynth_initialize(&mu_test_audiosynth)) {
+          printf("ERROR: could not allocate the synth\n");
+          return 1;
+     }
      struct Mu mu = {
 	  .window.position.x=640,
 	  .window.size.x=640,
@@ -205,40 +420,93 @@ int main(int argc, char **argv)
 	  .gamepad.left_thumb_stick.threshold=1.0/50.0f,
 	  .gamepad.right_thumb_stick.threshold=1.0/50.0f,
 	  .audio.callback = main_audio_callback,
+	  .audio.block_frames = 128,
+	  .input_events.enabled = MU_TRUE,
+	  .framebuffer.enabled = framebuffer,
+	  .telemetry.enabled = telemetry,
      };
      if (!Mu_Initialize(&mu)) {
 	  printf("ERROR: Mu could not initialize: '%s'\n", mu.error);
 	  return 1;
      }
+     struct Mu_RasterList raster = {0};
+     if (framebuffer) {
+          if (!Mu_AllocateRasterList(&raster, 256)) {
+               printf("ERROR: could not allocate the raster list\n");
+               return 1;
+          }
+          mu_test_raster = &raster;
+     }
 
-     struct Mu_AudioBuffer test_audio;
-     Mu_Bool test_audio_loaded = MU_FALSE;
-     char const * test_sound_path = MU_TEST_ASSET("test_assets/chime.wav");
      char buffer[4096];
      int const buffer_n = sizeof buffer;
-     if (buffer_n != platform_get_resource_path(buffer, buffer_n, test_sound_path, strlen(test_sound_path))) {
-          test_audio_loaded = Mu_LoadAudio(buffer, &test_audio);
+
+     // prebaked by tools/mu_pack_tool.c at build time, when available:
+     // assets come straight from its mapping, else from their files
+     struct Mu_Pack test_pack = {0};
+     char const *test_pack_path = MU_TEST_ASSET("test_assets/test_assets.mupack");
+     if (buffer_n != platform_get_resource_path(buffer, buffer_n, test_pack_path, strlen(test_pack_path))) {
+          Mu_OpenPack(buffer, &test_pack);
+     }
+
+     // mapped rather than decoded, in the int16 format of the file
+     struct Mu_MappedAudio test_audio_file;
+     struct Mu_AudioFormat const test_audio_format = { .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16 };
+     char const * test_sound_path = MU_TEST_ASSET("test_assets/chime.wav");
+     struct Mu_AudioBuffer test_audio;
+     Mu_Bool const test_audio_packed = Mu_GetPackAudio(&test_pack, test_sound_path, &test_audio)
+          && test_audio.format.samples_per_second == mu.audio.format.samples_per_second
+          && test_audio.format.sample_format == MU_AUDIO_SAMPLE_FORMAT_INT16;
+     Mu_Bool test_audio_loaded = test_audio_packed;
+     if (!test_audio_loaded && buffer_n != platform_get_resource_path(buffer, buffer_n, test_sound_path, strlen(test_sound_path))) {
+          test_audio_loaded = Mu_MapAudio(buffer, test_audio_format, &test_audio_file);
           if (!test_audio_loaded) printf("ERROR: Mu could not load file: '%s'\n", buffer);
      }
-     if (!test_audio_loaded) test_audio_loaded = Mu_LoadAudio(test_sound_path, &test_audio);
+     if (!test_audio_loaded) test_audio_loaded = Mu_MapAudio(test_sound_path, test_audio_format, &test_audio_file);
      if (!test_audio_loaded) {
           printf("ERROR: Mu could not load file: '%s'\n", test_sound_path);
           return 1;
      }
+     if (!test_audio_packed) test_audio = test_audio_file.buffer;
+     if (test_audio.format.samples_per_second != mu.audio.format.samples_per_second) {
+          struct Mu_AudioBuffer resampled;
+          if (Mu_ResampleAudio(&test_audio, mu.audio.format.samples_per_second, &resampled, &mu.jobs)) test_audio = resampled;
+          else printf("ERROR: Mu could not resample file: '%s'\n", test_sound_path);
+     }
 
      struct Mu_Image test_image = {0,};
      char const *test_image_path = "test_assets/ln2.png";
-     if (buffer_n != platform_get_resource_path(buffer, buffer_n, test_image_path, strlen(test_image_path))) {
+     Mu_Bool const test_image_packed = Mu_GetPackImage(&test_pack, test_image_path, 0, &test_image);
+     if (!test_image_packed && buffer_n != platform_get_resource_path(buffer, buffer_n, test_image_path, strlen(test_image_path))) {
        Mu_Bool test_image_loaded = Mu_LoadImage(buffer, &test_image);
        if(!test_image_loaded) printf("ERROR: Mu could not load file: '%s'\n", buffer);
      }
 
-     float theta = 0.0f;
+     // looping music, toggled by typing 'm'
+     struct Mu_AudioStream test_music = { .loop = MU_TRUE };
+     Mu_Bool test_music_opened = MU_FALSE;
+     char const *test_music_path = MU_TEST_ASSET("test_assets/chime.aif");
+     if (buffer_n != platform_get_resource_path(buffer, buffer_n, test_music_path, strlen(test_music_path))) {
+          test_music_opened = Mu_OpenAudioStream(buffer, (struct Mu_AudioFormat){ .sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16 }, &test_music);
+          if (!test_music_opened) printf("ERROR: Mu could not open file: '%s'\n", buffer);
+     }
+     if (test_music_opened) {
+          struct Mu_Test_AudioSynth * const synth = &mu_test_audiosynth;
+          if (test_music.format.samples_per_second != mu.audio.format.samples_per_second
+              && Mu_InitializeResamplerFilter(&synth->music_filter, test_music.format.samples_per_second, mu.audio.format.samples_per_second)) {
+               Mu_InitializeResampler(&synth->music_resampler, &synth->music_filter, test_music.format.channels);
+               synth->music_voice.resampler = &synth->music_resampler;
+          }
+          synth->music = &test_music;
+     }
+     bool test_music_playing = false;
+
      int frame_i = 0;
+     uint64_t test_missed_n = 0;
      GLuint test_image_texture_id = 0;
      GLuint const defGL_TEXTURE_RECTANGLE = 0x84F5;
 
-     while (Mu_Pull(&mu)) {
+     while (replay_path? Mu_Replay(&mu, &recording) : record_path? Mu_Record(&mu, &recording) : Mu_Pull(&mu)) {
           if (test_image_texture_id == 0) {
                glGenTextures(1, &test_image_texture_id);
                if (test_image.width * test_image.height && test_image.channels == 4) {
@@ -246,7 +514,9 @@ int main(int argc, char **argv)
                     glBindTexture(target, test_image_texture_id);
                     glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                     glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, test_image.stride / 4);
                     glTexImage2D(target, 0, GL_RGBA, test_image.width, test_image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, test_image.pixels);
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
                     glBindTexture(target, 0);
                }
           }
@@ -261,62 +531,70 @@ int main(int argc, char **argv)
                printf("ortho %d %d\n", mu.window.size.x, mu.window.size.y);
           }
           // some debugging GL2 style code
-          glClearColor(fabs(sin(theta)), fabs(sin(3*theta)), 0.6f, 0.0f);
-          glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
-          glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          mu_test_clear(0.5f, 0.5f, 0.5f);
           int px = ((int)rint(mu.time.seconds / 3.0 * 640)) % mu.window.size.x;
           int cy = 10;
 
           /* dropped frame indicator */ {
                if (frame_i & 1) {
-                    glColor3f(1.0f, 0.0f, 0.0f);
+                    mu_test_quad(10, cy, 10+100, cy+100, 1.0f, 0.0f, 0.0f);
                } else {
-                    glColor3f(0.0f, 1.0f, 1.0f);
+                    mu_test_quad(10, cy, 10+100, cy+100, 0.0f, 1.0f, 1.0f);
                }
-               glBegin(GL_QUADS);
-               glVertex2f(10, cy);
-               glVertex2f(10+100, cy);
-               glVertex2f(10+100, cy+100);
-               glVertex2f(10, cy+100);
-               glEnd();
           }
           cy += 100;
 
           /* logo */ {
             cy += 10;
-            glBindTexture(defGL_TEXTURE_RECTANGLE, test_image_texture_id);
-            glEnable(defGL_TEXTURE_RECTANGLE);
-            glColor3f(1.0f, 1.0f, 1.0f);
             int w = test_image.width;
             int h = test_image.height;
-            glBegin(GL_QUADS);
-            glTexCoord2i(0, 0);                                 glVertex2f(10, cy);
-            glTexCoord2i(test_image.width, 0);                  glVertex2f(10+w, cy);
-            glTexCoord2i(test_image.width, test_image.height);  glVertex2f(10+w, cy+h);
-            glTexCoord2i(0, test_image.height);                 glVertex2f(10, cy+h);
-            glDisable(defGL_TEXTURE_RECTANGLE);
+            mu_test_textured_quad(10, cy, 10+w, cy+h, &test_image, test_image_texture_id);
             cy += h;
           }
 
           /* frame time */ {
             cy += 10;
-            glColor3f(1.0f, 0.0f, 0.0f);
             int y = cy;
             int h = mu.window.size.y - y;
             int fty = (int)(h * (mu.time.delta_milliseconds * 60 / 2) / 1000.0);
-            glBegin(GL_QUADS);
-            glVertex2f(10, cy);
-            glVertex2f(10 + 20, cy);
-            glVertex2f(10 + 20, cy + fty);
-            glVertex2f(10, cy + fty);
-            glEnd();
+            mu_test_quad(10, cy, 10 + 20, cy + fty, 1.0f, 0.0f, 0.0f);
             cy += 10;
           }
 
+          if (mu.frame_stats.missed_n != test_missed_n) {
+               test_missed_n = mu.frame_stats.missed_n;
+               printf("missed deadlines: %llu (last frame: %u ns, p99: %u ns)\n", (unsigned long long)test_missed_n,
+                      mu.frame_stats.ring[MU_FRAME_STAGE_FRAME][mu.frame_stats.last_i],
+                      mu.frame_stats.summary[MU_FRAME_STAGE_FRAME].p99_nanoseconds);
+          }
+
       for(char *p = mu.text, * const p_l = mu.text + mu.text_length; p != p_l; ++p) {
         if (*p == 033 /* escape */) {
               mu.quit = MU_TRUE;
         }
+        if (*p == 'm' && test_music_opened) {
+              if (mu_test_audiosynth_push_music(&mu_test_audiosynth, 0, !test_music_playing)) test_music_playing = !test_music_playing;
+        }
+        if (*p == 's') {
+              struct Mu_AudioStats const *stats = &mu.audio.stats;
+              printf("audio: %llu callbacks of %llu frames, load max: %.1f%%, overruns: %llu, underruns: %llu, restarts: %llu\n",
+                     (unsigned long long)stats->callbacks_n, (unsigned long long)stats->block_frames,
+                     stats->load_max_permille / 10.0, (unsigned long long)stats->overruns_n,
+                     (unsigned long long)stats->underruns_n, (unsigned long long)stats->restarts_n);
+              struct Mu_QueueStats commands_stats;
+              Mu_QueueGetStats(&mu_test_audiosynth.commands, &commands_stats);
+              printf("audio commands: %llu, late: %u, rejected: %llu, high water: %u/%zu bytes, samples playing: %d\n",
+                     (unsigned long long)commands_stats.commands_n, atomic_load(&mu_test_audiosynth.late_commands_n),
+                     (unsigned long long)commands_stats.rejected_n, commands_stats.bytes_high_water,
+                     mu_test_audiosynth.commands.bytes_capacity, mu_test_audiosynth.playing_sources_n);
+              printf("audio graph: %d threads%s, renders serial: %llu, parallel: %llu\n",
+                     mu_test_audiosynth.graph.threads_n, mu_test_audiosynth.graph.realtime? " (real-time)" : "",
+                     (unsigned long long)mu_test_audiosynth.graph.serial_renders_n,
+                     (unsigned long long)mu_test_audiosynth.graph.parallel_renders_n);
+              for (int bucket_i = 0; bucket_i < MU_AUDIO_LOAD_BUCKETS; ++bucket_i) {
+                   printf("  load %3d%%: %llu\n", bucket_i * 100 / MU_AUDIO_LOAD_BUCKETS, (unsigned long long)stats->load_histogram[bucket_i]);
+              }
+        }
       }
 
           if (mu.keys[/* F1 on mac */ 0x7A].pressed) {
@@ -349,13 +627,7 @@ int main(int argc, char **argv)
                     int bw = 50;
                     int bx = cx;
                     int by = cy;
-                    glColor3f(0.94f, 0.94f, 0.94f);
-                    glBegin(GL_QUADS);
-                    glVertex2f(bx, by-bw);
-                    glVertex2f(bx+bw, by-bw);
-                    glVertex2f(bx+bw, by);
-                    glVertex2f(bx, by);
-                    glEnd();
+                    mu_test_quad(bx, by-bw, bx+bw, by, 0.94f, 0.94f, 0.94f);
 
                     float const x = sticks[stick_i].stick.x;
                     float const y = sticks[stick_i].stick.y;
@@ -363,13 +635,7 @@ int main(int argc, char **argv)
                     int px = bx + bw/2 + bw/2*x - pw/2;
                     int py = by - bw + bw/2 + (-bw/2*y) + pw/2;
 
-                    glColor3f(0.04f, 0.04f, 0.04f);
-                    glBegin(GL_QUADS);
-                    glVertex2f(px, py-pw);
-                    glVertex2f(px+pw, py-pw);
-                    glVertex2f(px+pw, py);
-                    glVertex2f(px, py);
-                    glEnd();
+                    mu_test_quad(px, py-pw, px+pw, py, 0.04f, 0.04f, 0.04f);
 
                     cx += bw + 10;
                }
@@ -378,21 +644,33 @@ int main(int argc, char **argv)
           /* show mouse position */ {
                struct Mu_Int2 mp = mu.mouse.position;
                int b = mu.mouse.left_button.down? 8:4;
-               glColor3f(0.6f, 0.9f, 0.8f);
-               glBegin(GL_QUADS);
-               glVertex2f(mp.x-b, mp.y-b);
-               glVertex2f(mp.x+b, mp.y-b);
-               glVertex2f(mp.x+b, mp.y+b);
-               glVertex2f(mp.x-b, mp.y+b);
-               glEnd();
+               mu_test_quad(mp.x-b, mp.y-b, mp.x+b, mp.y+b, 0.6f, 0.9f, 0.8f);
           }
 
-          if (mu.mouse.left_button.pressed) {
-               mu_test_audiosynth_push_note(&mu_test_audiosynth, 432.0 * pow(2.0, mu.mouse.position.x/240.0));
+          // every click is heard, at the time it happened within the frame
+          int clicks_n = 0;
+          for (uint32_t event_i = 0; event_i < mu.input_events.events_n; ++event_i) {
+               struct Mu_InputEvent const *event = &mu.input_events.events[event_i];
+               if (event->device != MU_INPUT_DEVICE_MOUSE || !event->down) continue;
+               uint64_t const event_frame_i = mu_test_audiosynth_event_frame(&mu, event->ticks);
+               if (event->button == MU_MOUSE_LEFT_BUTTON) {
+                    mu_test_audiosynth_push_note(&mu_test_audiosynth, event_frame_i, 432.0 * pow(2.0, mu.mouse.position.x/240.0));
+               } else if (event->button == MU_MOUSE_RIGHT_BUTTON) {
+                    mu_test_audiosynth_push_sample(&mu_test_audiosynth, event_frame_i, &test_audio);
+               }
+               ++clicks_n;
           }
-          if (mu.mouse.right_button.pressed) {
-               mu_test_audiosynth_push_sample(&mu_test_audiosynth, &test_audio);
+          if (clicks_n == 0) {
+               // no input events (replays): at the start of the frame
+               uint64_t const event_frame_i = mu_test_audiosynth_event_frame(&mu, mu.time.ticks);
+               if (mu.mouse.left_button.pressed) {
+                    mu_test_audiosynth_push_note(&mu_test_audiosynth, event_frame_i, 432.0 * pow(2.0, mu.mouse.position.x/240.0));
+               }
+               if (mu.mouse.right_button.pressed) {
+                    mu_test_audiosynth_push_sample(&mu_test_audiosynth, event_frame_i, &test_audio);
+               }
           }
+          mu_test_audiosynth_update(&mu_test_audiosynth);
 
           if (mu.gamepad.a_button.pressed) {
                printf("A button was pressed\n");
@@ -401,21 +679,29 @@ int main(int argc, char **argv)
           int const ey = mu.window.size.y;
           int pw = 3;
 
-          glColor3f(1.0f, 1.0f, 1.0f);
-          glBegin(GL_QUADS);
-          glVertex2f(px, ey);
-          glVertex2f(px+pw, ey);
-          glVertex2f(px+pw, 0.0f);
-          glVertex2f(px, 0.0f);
-          glEnd();
+          mu_test_quad(px, 0, px+pw, ey, 1.0f, 1.0f, 1.0f);
 
+          if (mu_test_raster && !Mu_RasterRun(mu_test_raster, &mu.framebuffer, &mu.jobs)) {
+               printf("ERROR: could not draw into the framebuffer\n");
+          }
           Mu_Push(&mu);
           ++frame_i;
-          theta += 0.01f;
      }
+     if (record_path) {
+          if (recording.overflow) printf("ERROR: recording was truncated\n");
+          if (!Mu_SaveRecording(record_path, &recording)) printf("ERROR: could not save recording: '%s'\n", record_path);
+     }
+     if (replay_path || record_path) {
+          printf("recording: %llu frames, %zu bytes\n", (unsigned long long)recording.frames_n, recording.bytes_n);
+     }
+     Mu_FreeRasterList(&raster);
      return 0;
 }
 
+#if defined(__APPLE__)
 #include "mu_test_macos.c"
+#else
+#include "mu_test_headless.c"
+#endif
 
 #undef MU_TEST_INTERNAL
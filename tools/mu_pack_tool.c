@@ -0,0 +1,257 @@
+// @language: c11
+//
+// offline packer of asset packs (see xxxx_mu_pack.h)
+//
+// usage: mu_pack_tool -o <pack> [-C <dir>] [--mips] [--float32] [--samples-per-second <rate>] <files>...
+//
+// - entries are named after the paths given, files are read from <dir>
+// - .png files are decoded to RGBA8, with their mip levels with --mips
+//   (box filtered in linear light, see xxxx_mu_imageprep.h)
+// - .wav/.aif/.aiff files are converted to int16 (float32 with --float32)
+//   at <rate> (48000 by default), channels are kept
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_audiofile.h"
+#include "../xxxx_mu_image.h"
+#include "../xxxx_mu_imageprep.h"
+#include "../xxxx_mu_pack.h"
+#include "../xxxx_mu_resampler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MU_PACK_TOOL_INTERNAL static
+
+struct Mu_PackToolItem
+{
+     char const *name;
+     char path[4096];
+     struct Mu_PackEntry entry;
+     uint8_t *data; // entry.data_size bytes
+};
+
+MU_PACK_TOOL_INTERNAL
+Mu_Bool mu_pack_tool_has_extension(char const *name, char const *extension)
+{
+     size_t const name_n = strlen(name), extension_n = strlen(extension);
+     if (name_n < extension_n) return MU_FALSE;
+     for (size_t i = 0; i < extension_n; ++i) {
+          char c = name[name_n - extension_n + i];
+          if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+          if (c != extension[i]) return MU_FALSE;
+     }
+     return MU_TRUE;
+}
+
+MU_PACK_TOOL_INTERNAL
+Mu_Bool mu_pack_tool_image(struct Mu_PackToolItem *item, struct Mu_Image const *image, Mu_Bool mips)
+{
+     if (image->width > (1u << 16) || image->height > (1u << 16)) return MU_FALSE;
+     uint32_t mips_n = 1;
+     if (mips) while ((image->width >> mips_n) || (image->height >> mips_n)) ++mips_n;
+     size_t last_size;
+     size_t const data_size = Mu_PackMipOffset(image->width, image->height, mips_n - 1, &last_size) + last_size;
+     item->data = calloc(1, data_size);
+     if (!item->data) return MU_FALSE;
+     size_t const stride = Mu_ImageStride(image);
+     for (uint32_t y = 0; y < image->height; ++y) {
+          memcpy(item->data + (size_t)y * image->width * 4, image->pixels + y * stride, (size_t)image->width * 4);
+     }
+     if (mips_n > 1) {
+          // box filtered in linear light, colors weighted by alpha
+          struct Mu_ImageMips image_mips;
+          if (!Mu_GenerateImageMips(image, MU_IMAGEPREP_FILTER_BOX, MU_IMAGEPREP_SRGB, &image_mips) || image_mips.levels_n != (int)mips_n) {
+               Mu_FreeImageMips(&image_mips);
+               free(item->data);
+               item->data = NULL;
+               return MU_FALSE;
+          }
+          for (uint32_t level = 1; level < mips_n; ++level) {
+               struct Mu_Image const *level_image = &image_mips.levels[level];
+               memcpy(item->data + Mu_PackMipOffset(image->width, image->height, level, NULL), level_image->pixels,
+                      (size_t)level_image->width * level_image->height * 4);
+          }
+          Mu_FreeImageMips(&image_mips);
+     }
+     item->entry.type = MU_PACK_ENTRY_IMAGE;
+     item->entry.mips_n = mips_n;
+     item->entry.width = image->width;
+     item->entry.height = image->height;
+     item->entry.data_size = data_size;
+     return MU_TRUE;
+}
+
+MU_PACK_TOOL_INTERNAL
+Mu_Bool mu_pack_tool_audio(struct Mu_PackToolItem *item, uint32_t sample_format, uint32_t samples_per_second)
+{
+     struct Mu_MappedAudio mapped;
+     if (!Mu_MapAudio(item->path, (struct Mu_AudioFormat){ .sample_format = sample_format }, &mapped)) return MU_FALSE;
+     struct Mu_AudioBuffer audio = mapped.buffer;
+     struct Mu_AudioBuffer resampled = { 0 };
+     if (audio.format.samples_per_second != samples_per_second) {
+          if (!Mu_ResampleAudio(&audio, samples_per_second, &resampled, NULL)) {
+               Mu_UnmapAudio(&mapped);
+               return MU_FALSE;
+          }
+          audio = resampled;
+     }
+     size_t const data_size = audio.samples_count * audio.format.bytes_per_sample;
+     item->data = malloc(data_size? data_size : 1);
+     if (item->data) memcpy(item->data, audio.samples, data_size);
+     item->entry.type = MU_PACK_ENTRY_AUDIO;
+     item->entry.mips_n = 0;
+     item->entry.format = audio.format;
+     item->entry.samples_count = audio.samples_count;
+     item->entry.data_size = data_size;
+     free(resampled.samples);
+     Mu_UnmapAudio(&mapped);
+     return item->data != NULL;
+}
+
+MU_PACK_TOOL_INTERNAL
+uint64_t mu_pack_tool_align(uint64_t x, uint64_t alignment)
+{
+     return (x + alignment - 1) & ~(alignment - 1);
+}
+
+MU_PACK_TOOL_INTERNAL
+Mu_Bool mu_pack_tool_write(char const *filename, struct Mu_PackToolItem *items, uint32_t items_n)
+{
+     uint32_t slots_n = 1;
+     while (slots_n < 2*items_n + 1) slots_n *= 2;
+
+     struct Mu_PackHeader header = {
+          .magic = "MU_PACK",
+          .version = MU_PACK_VERSION,
+          .byte_order = MU_PACK_BYTE_ORDER_MARK,
+          .entries_n = items_n,
+          .slots_n = slots_n,
+     };
+     header.entries_offset = mu_pack_tool_align(sizeof header, 8);
+     header.slots_offset = header.entries_offset + (uint64_t)items_n * sizeof (struct Mu_PackEntry);
+     header.names_offset = header.slots_offset + (uint64_t)slots_n * sizeof (uint32_t);
+     uint64_t offset = header.names_offset;
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) {
+          struct Mu_PackEntry *entry = &items[item_i].entry;
+          entry->name_n = strlen(items[item_i].name);
+          entry->name_offset = offset - header.names_offset;
+          entry->name_hash = Mu_PackHash(items[item_i].name, entry->name_n);
+          offset += entry->name_n + 1;
+     }
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) {
+          struct Mu_PackEntry *entry = &items[item_i].entry;
+          offset = mu_pack_tool_align(offset, MU_PACK_ALIGNMENT);
+          entry->data_offset = offset;
+          offset += entry->data_size;
+     }
+     header.size = offset;
+
+     uint32_t *slots = calloc(slots_n, sizeof *slots);
+     if (!slots) return MU_FALSE;
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) {
+          uint32_t slot_i = (uint32_t)items[item_i].entry.name_hash & (slots_n - 1);
+          while (slots[slot_i]) {
+               struct Mu_PackToolItem const *other = &items[slots[slot_i] - 1];
+               if (0 == strcmp(other->name, items[item_i].name)) {
+                    printf("ERROR: %s is given twice\n", items[item_i].name);
+                    free(slots);
+                    return MU_FALSE;
+               }
+               slot_i = (slot_i + 1) & (slots_n - 1);
+          }
+          slots[slot_i] = item_i + 1;
+     }
+
+     FILE *file = fopen(filename, "wb");
+     if (!file) {
+          free(slots);
+          return MU_FALSE;
+     }
+     static uint8_t const zeros[MU_PACK_ALIGNMENT];
+     Mu_Bool written = fwrite(&header, sizeof header, 1, file) == 1;
+     if (written && header.entries_offset > sizeof header) written = fwrite(zeros, header.entries_offset - sizeof header, 1, file) == 1;
+     for (uint32_t item_i = 0; written && item_i < items_n; ++item_i) written = fwrite(&items[item_i].entry, sizeof (struct Mu_PackEntry), 1, file) == 1;
+     written = written && fwrite(slots, sizeof *slots, slots_n, file) == slots_n;
+     for (uint32_t item_i = 0; written && item_i < items_n; ++item_i) written = fwrite(items[item_i].name, items[item_i].entry.name_n + 1, 1, file) == 1;
+     for (uint32_t item_i = 0; written && item_i < items_n; ++item_i) {
+          struct Mu_PackEntry const *entry = &items[item_i].entry;
+          long const padding = (long)entry->data_offset - ftell(file);
+          if (padding > 0) written = fwrite(zeros, padding, 1, file) == 1;
+          if (written && entry->data_size) written = fwrite(items[item_i].data, entry->data_size, 1, file) == 1;
+     }
+     written = (fclose(file) == 0) && written;
+     free(slots);
+     return written;
+}
+
+int main(int argc, char **argv)
+{
+     char const *pack_path = NULL;
+     char const *root = NULL;
+     Mu_Bool mips = MU_FALSE;
+     uint32_t sample_format = MU_AUDIO_SAMPLE_FORMAT_INT16;
+     uint32_t samples_per_second = 48000;
+     struct Mu_PackToolItem *items = calloc(argc, sizeof *items);
+     uint32_t items_n = 0;
+     if (!items) return 1;
+     for (int arg_i = 1; arg_i < argc; ++arg_i) {
+          if (0 == strcmp(argv[arg_i], "-o") && arg_i + 1 < argc) pack_path = argv[++arg_i];
+          else if (0 == strcmp(argv[arg_i], "-C") && arg_i + 1 < argc) root = argv[++arg_i];
+          else if (0 == strcmp(argv[arg_i], "--mips")) mips = MU_TRUE;
+          else if (0 == strcmp(argv[arg_i], "--float32")) sample_format = MU_AUDIO_SAMPLE_FORMAT_FLOAT32;
+          else if (0 == strcmp(argv[arg_i], "--samples-per-second") && arg_i + 1 < argc) samples_per_second = atoi(argv[++arg_i]);
+          else items[items_n++].name = argv[arg_i];
+     }
+     if (!pack_path || items_n == 0 || samples_per_second == 0) {
+          printf("usage: %s -o <pack> [-C <dir>] [--mips] [--float32] [--samples-per-second <rate>] <files>...\n", argv[0]);
+          return 1;
+     }
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) {
+          snprintf(items[item_i].path, sizeof items[item_i].path, "%s%s%s", root? root : "", root? "/" : "", items[item_i].name);
+     }
+
+     // images are decoded as a batch, on every core
+     char const **image_paths = calloc(items_n, sizeof *image_paths);
+     struct Mu_PackToolItem **image_items = calloc(items_n, sizeof *image_items);
+     struct Mu_Image *images = calloc(items_n, sizeof *images);
+     int images_n = 0;
+     if (!image_paths || !image_items || !images) return 1;
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) {
+          if (!mu_pack_tool_has_extension(items[item_i].name, ".png")) continue;
+          image_paths[images_n] = items[item_i].path;
+          image_items[images_n++] = &items[item_i];
+     }
+     Mu_LoadImages(image_paths, images_n, images, NULL, NULL);
+     for (int image_i = 0; image_i < images_n; ++image_i) {
+          if (images[image_i].width == 0 || !mu_pack_tool_image(image_items[image_i], &images[image_i], mips)) {
+               printf("ERROR: could not pack image %s\n", image_items[image_i]->path);
+               return 1;
+          }
+          free(images[image_i].pixels);
+     }
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) {
+          struct Mu_PackToolItem *item = &items[item_i];
+          if (item->data) continue;
+          if (!mu_pack_tool_has_extension(item->name, ".wav") && !mu_pack_tool_has_extension(item->name, ".aif")
+              && !mu_pack_tool_has_extension(item->name, ".aiff")) {
+               printf("ERROR: unknown type of file %s\n", item->path);
+               return 1;
+          }
+          if (!mu_pack_tool_audio(item, sample_format, samples_per_second)) {
+               printf("ERROR: could not pack audio %s\n", item->path);
+               return 1;
+          }
+     }
+
+     if (!mu_pack_tool_write(pack_path, items, items_n)) {
+          printf("ERROR: could not write %s\n", pack_path);
+          return 1;
+     }
+     for (uint32_t item_i = 0; item_i < items_n; ++item_i) free(items[item_i].data);
+     free(items);
+     free(image_paths);
+     free(image_items);
+     free(images);
+     return 0;
+}
@@ -0,0 +1,147 @@
+// @language: c11
+//
+// viewer of the telemetry a program publishes with
+// `mu.telemetry.enabled` (see xxxx_mu_telemetry.h), refreshed at its
+// own rate, however fast the program runs.
+//
+// usage: mu_telemetry_viewer [--name <name>] [--hz <n>] [--once]
+//
+// - <name> is the shared memory object, "/mu_telemetry" by default
+// - the view is redrawn <n> times a second (10 by default), until the
+//   program quits. With --once, a single snapshot is printed.
+// - waits for the program when it is not running yet
+
+#include "../xxxx_mu.h"
+#include "../xxxx_mu_telemetry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MU_TELEMETRY_VIEWER_INTERNAL static
+
+MU_TELEMETRY_VIEWER_INTERNAL
+void mu_telemetry_viewer_sleep(int hz)
+{
+     long const nanoseconds = 1000000000l / hz;
+     struct timespec ts = { nanoseconds / 1000000000l, nanoseconds % 1000000000l };
+     nanosleep(&ts, NULL);
+}
+
+MU_TELEMETRY_VIEWER_INTERNAL
+double mu_telemetry_viewer_ms(uint64_t nanoseconds)
+{
+     return nanoseconds / 1e6;
+}
+
+MU_TELEMETRY_VIEWER_INTERNAL
+void mu_telemetry_viewer_print(struct Mu_TelemetryReader const *reader,
+                               struct Mu_TelemetrySnapshot const *snapshot,
+                               struct Mu_TelemetrySnapshot const *previous)
+{
+     static char const * const stage_names[MU_FRAME_STAGES_N] = { "events", "update", "client", "swap", "frame" };
+
+     // rate over the refresh, on the program's clock
+     double fps = 0.0;
+     if (previous && snapshot->time.nanoseconds > previous->time.nanoseconds) {
+          fps = 1e9 * (snapshot->published_n - previous->published_n) / (snapshot->time.nanoseconds - previous->time.nanoseconds);
+     }
+     Mu_Bool const stalled = previous && previous->published_n == snapshot->published_n && !snapshot->quit;
+     printf("pid %u  frame %llu  time %.3fs  %.1f fps%s%s\n", reader->pid,
+            (unsigned long long)snapshot->published_n, snapshot->time.seconds, fps,
+            stalled? "  (stalled)" : "", snapshot->quit? "  (quit)" : "");
+
+     printf("\n%-8s %10s %10s %10s %10s\n", "stage", "last ms", "p50 ms", "p99 ms", "max ms");
+     for (int stage_i = 0; stage_i < MU_FRAME_STAGES_N; ++stage_i) {
+          struct Mu_FrameStageSummary const *summary = &snapshot->frame_summary[stage_i];
+          printf("%-8s %10.3f %10.3f %10.3f %10.3f\n", stage_names[stage_i],
+                 mu_telemetry_viewer_ms(snapshot->frame_nanoseconds[stage_i]),
+                 mu_telemetry_viewer_ms(summary->p50_nanoseconds),
+                 mu_telemetry_viewer_ms(summary->p99_nanoseconds),
+                 mu_telemetry_viewer_ms(summary->max_nanoseconds));
+     }
+     printf("frames %llu, missed %llu, target %.3f ms\n",
+            (unsigned long long)snapshot->frames_n, (unsigned long long)snapshot->frames_missed_n,
+            mu_telemetry_viewer_ms(snapshot->frame_target_nanoseconds));
+
+     printf("\nwindow %dx%d at %d,%d\n", snapshot->window_size.x, snapshot->window_size.y,
+            snapshot->window_position.x, snapshot->window_position.y);
+     printf("mouse %d,%d wheel %d buttons %c%c\n", snapshot->mouse.position.x, snapshot->mouse.position.y,
+            snapshot->mouse.wheel, snapshot->mouse.left_button.down? 'L' : '-',
+            snapshot->mouse.right_button.down? 'R' : '-');
+     printf("keys down:");
+     for (int key_i = 0; key_i < MU_MAX_KEYS; ++key_i) {
+          if (snapshot->keys_down[key_i / 64] & (1ull << (key_i % 64))) printf(" %d", key_i);
+     }
+     printf("\ninput events %u, dropped %u\n", snapshot->input_events_n, snapshot->input_events_dropped_n);
+     for (int gamepad_i = 0; gamepad_i < MU_MAX_GAMEPADS; ++gamepad_i) {
+          struct Mu_Gamepad const *gamepad = &snapshot->gamepads[gamepad_i];
+          if (!gamepad->connected) continue;
+          printf("gamepad %d: left %+.2f,%+.2f right %+.2f,%+.2f triggers %.2f %.2f buttons %c%c%c%c\n", gamepad_i,
+                 gamepad->left_thumb_stick.x, gamepad->left_thumb_stick.y,
+                 gamepad->right_thumb_stick.x, gamepad->right_thumb_stick.y,
+                 gamepad->left_trigger.value, gamepad->right_trigger.value,
+                 gamepad->a_button.down? 'A' : '-', gamepad->b_button.down? 'B' : '-',
+                 gamepad->x_button.down? 'X' : '-', gamepad->y_button.down? 'Y' : '-');
+     }
+
+     struct Mu_AudioStats const *audio = &snapshot->audio_stats;
+     double const load = audio->callbacks_n && audio->budget_nanoseconds?
+          100.0 * audio->callback_nanoseconds / audio->callbacks_n / audio->budget_nanoseconds : 0.0;
+     printf("\naudio callbacks %llu, load %.1f%% (max %.1f%%), overruns %llu, underruns %llu, restarts %llu\n",
+            (unsigned long long)audio->callbacks_n, load, audio->load_max_permille / 10.0,
+            (unsigned long long)audio->overruns_n, (unsigned long long)audio->underruns_n,
+            (unsigned long long)audio->restarts_n);
+     printf("audio clock: frame %llu at tick %llu\n", (unsigned long long)snapshot->audio_clock.frames_n,
+            (unsigned long long)snapshot->audio_clock.output_ticks);
+     printf("jobs %llu, steals %llu, frame arena %llu bytes\n", (unsigned long long)snapshot->jobs_n,
+            (unsigned long long)snapshot->jobs_steals_n, (unsigned long long)snapshot->frame_arena_bytes_n);
+
+     printf("\npublish %.2f us, reader retries %llu\n", snapshot->publish_nanoseconds / 1e3,
+            (unsigned long long)reader->retries_n);
+}
+
+int main(int argc, char **argv)
+{
+     char const *name = NULL;
+     int hz = 10;
+     Mu_Bool once = MU_FALSE;
+     for (int arg_i = 1; arg_i < argc; ++arg_i) {
+          if (0 == strcmp(argv[arg_i], "--once")) once = MU_TRUE;
+          else if (0 == strcmp(argv[arg_i], "--name") && arg_i + 1 < argc) name = argv[++arg_i];
+          else if (0 == strcmp(argv[arg_i], "--hz") && arg_i + 1 < argc) hz = atoi(argv[++arg_i]);
+          else {
+               printf("usage: %s [--name <name>] [--hz <n>] [--once]\n", argv[0]);
+               return 1;
+          }
+     }
+     if (hz <= 0) hz = 10;
+
+     struct Mu_TelemetryReader reader;
+     while (!Mu_OpenTelemetryReader(name, &reader)) {
+          if (once) {
+               printf("ERROR: no telemetry at '%s'\n", name? name : "/mu_telemetry");
+               return 1;
+          }
+          mu_telemetry_viewer_sleep(hz);
+     }
+
+     struct Mu_TelemetrySnapshot snapshot, previous = { 0 };
+     Mu_Bool has_previous = MU_FALSE;
+     for (;;) {
+          if (!Mu_ReadTelemetry(&reader, &snapshot)) {
+               mu_telemetry_viewer_sleep(hz);
+               continue;
+          }
+          if (!once) printf("\x1b[H\x1b[2J");
+          mu_telemetry_viewer_print(&reader, &snapshot, has_previous? &previous : NULL);
+          fflush(stdout);
+          if (once || snapshot.quit) break;
+          previous = snapshot;
+          has_previous = MU_TRUE;
+          mu_telemetry_viewer_sleep(hz);
+     }
+     Mu_CloseTelemetryReader(&reader);
+     return 0;
+}
@@ -1,6 +1,6 @@
 /*
  * @url: https://gist.github.com/pervognsen/6a67966c5dc4247a0021b95c8d0a7b72
- * @lang: c99
+ * @lang: c11
  * @taglist: platform
  * @dependencylist: xxxx_mu_win32
  *
@@ -18,7 +18,10 @@ enum {
     MU_MAX_KEYS = 256,
     MU_MAX_TEXT = 256,
     MU_MAX_ERROR = 1024,
-    MU_MAX_AUDIO_BUFFER = 2 * 1024
+    MU_MAX_AUDIO_BUFFER = 2 * 1024,
+    MU_MAX_AUDIO_BLOCK_FRAMES = 4096,
+    MU_MAX_INPUT_EVENTS = 256,
+    MU_MAX_GAMEPADS = 4,
 };
 
 typedef uint8_t Mu_Bool;
@@ -30,8 +33,9 @@ struct Mu_Int2 {
 
 struct Mu_DigitalButton {
     Mu_Bool down;
-    Mu_Bool pressed;
-    Mu_Bool released;
+    Mu_Bool pressed;  // went down during the frame, even if released since
+    Mu_Bool released; // went up during the frame, even if pressed since
+    uint8_t half_transition_count; // changes of `down` during the frame, up to 255
 };
 
 struct Mu_AnalogButton {
@@ -79,6 +83,61 @@ struct Mu_Mouse {
     struct Mu_Int2 delta_position;
 };
 
+// Input devices of `Mu_InputEvent`:
+enum {
+    MU_INPUT_DEVICE_KEYBOARD, // button: index in `keys`
+    MU_INPUT_DEVICE_MOUSE,    // button: MU_MOUSE_*
+    MU_INPUT_DEVICE_GAMEPAD,  // button: MU_GAMEPAD_*, of `gamepads[device - MU_INPUT_DEVICE_GAMEPAD]`
+};
+
+enum {
+    MU_MOUSE_LEFT_BUTTON,
+    MU_MOUSE_RIGHT_BUTTON,
+};
+
+// Digital buttons of `struct Mu_Gamepad`, in order:
+enum {
+    MU_GAMEPAD_A_BUTTON,
+    MU_GAMEPAD_B_BUTTON,
+    MU_GAMEPAD_X_BUTTON,
+    MU_GAMEPAD_Y_BUTTON,
+    MU_GAMEPAD_LEFT_SHOULDER_BUTTON,
+    MU_GAMEPAD_RIGHT_SHOULDER_BUTTON,
+    MU_GAMEPAD_UP_BUTTON,
+    MU_GAMEPAD_DOWN_BUTTON,
+    MU_GAMEPAD_LEFT_BUTTON,
+    MU_GAMEPAD_RIGHT_BUTTON,
+    MU_GAMEPAD_LEFT_THUMB_BUTTON,
+    MU_GAMEPAD_RIGHT_THUMB_BUTTON,
+    MU_GAMEPAD_BACK_BUTTON,
+    MU_GAMEPAD_START_BUTTON,
+};
+
+/*
+ * One transition of a digital button, timestamped by the system when it
+ * received it rather than when `Mu_Pull` noticed it.
+ */
+struct Mu_InputEvent {
+    uint64_t ticks;  // as `mu.time.ticks`, can be earlier than the frame's
+    uint16_t button; // see MU_INPUT_DEVICE_*
+    uint8_t device;  // MU_INPUT_DEVICE_*
+    Mu_Bool down;    // state after the transition
+};
+
+/*
+ * Every button transition of the last frame, oldest first. Lets
+ * programs tell when input happened within the frame, and see
+ * transitions that cancelled out.
+ */
+struct Mu_InputEvents {
+    Mu_Bool enabled; // @input: off by default
+
+    // @output
+    uint32_t events_n;
+    uint32_t dropped_n; // transitions past MU_MAX_INPUT_EVENTS, during the frame
+    struct Mu_InputEvent events[MU_MAX_INPUT_EVENTS];
+};
+
 struct Mu_Window {
     char *title; // @todo: can be made `char const*`
     struct Mu_Int2 position;
@@ -86,23 +145,123 @@ struct Mu_Window {
     Mu_Bool resized;
 };
 
+/*
+ * CPU framebuffer, presented by Mu_Push in place of what was drawn with
+ * OpenGL. See xxxx_mu_raster.h to draw into it.
+ */
+struct Mu_Framebuffer {
+    Mu_Bool enabled; // @input
+    // @output: sized to `mu.window.size` by Mu_Pull
+    uint8_t *pixels; // RGBA8, as `struct Mu_Image`
+    int pitch;       // bytes from one row to the next
+    struct Mu_Int2 size;
+};
+
+enum {
+    MU_AUDIO_SAMPLE_FORMAT_INT16 = 0,   // @representation: [-32768,+32767]
+    MU_AUDIO_SAMPLE_FORMAT_FLOAT32 = 1, // @representation: [-1,+1]
+};
+
 struct Mu_AudioFormat {
     uint32_t samples_per_second; // number of "frames" (of n=channels samples) per second
     uint32_t channels;
     uint32_t bytes_per_sample;
+    uint32_t sample_format; // MU_AUDIO_SAMPLE_FORMAT_*
 };
 
 struct Mu_AudioBuffer {
-    int16_t *samples;
+    union {
+        int16_t *samples;        // MU_AUDIO_SAMPLE_FORMAT_INT16
+        float *float_samples;    // MU_AUDIO_SAMPLE_FORMAT_FLOAT32
+    };
     size_t samples_count; // frame_count*channels
     struct Mu_AudioFormat format;
 };
 
 typedef void (*Mu_AudioCallback)(struct Mu_AudioBuffer *buffer);
 
+enum {
+    MU_AUDIO_LOAD_BUCKETS = 10,
+};
+
+/*
+ * Telemetry of the audio thread, which it writes without locks, and
+ * that Mu_Pull copies. The budget of a block is its duration at the
+ * device's rate, and its load is the time spent in `callback` over
+ * that budget. The headroom left is 1000 - `load_max_permille`.
+ *
+ * Blocks are the device's periods: with `Mu_Audio.block_frames`, the
+ * time of a block is that of the calls to `callback` it took, if any.
+ */
+struct Mu_AudioStats {
+    uint64_t callbacks_n;
+    uint64_t block_frames;             // frames asked by the device at its last period
+    uint64_t budget_nanoseconds;       // of the last block
+    uint64_t callback_nanoseconds;     // accumulated time spent in `callback`
+    uint64_t callback_max_nanoseconds;
+    uint64_t load_max_permille;
+    // callbacks by load, in tenths of their budget. The last bucket
+    // holds the loads of 90% and above.
+    uint64_t load_histogram[MU_AUDIO_LOAD_BUCKETS];
+    uint64_t overruns_n;  // callbacks that took longer than their budget
+    uint64_t underruns_n; // blocks the device played without samples from `callback`
+    uint64_t restarts_n;  // device restarts, after a change of the default output device
+};
+
+/*
+ * Position of the audio stream, to schedule events with sample accuracy.
+ *
+ * Frame `frames_n` of the stream, counting every frame passed to
+ * `callback` so far, is heard at `output_ticks` (in the units and from
+ * the origin of `Mu_Time.ticks`). The frame heard at `ticks` is then:
+ *
+ *   frames_n + (int64_t)(ticks - output_ticks) * samples_per_second / ticks_per_second
+ *
+ * `callback` can count the frames it is passed to know where its
+ * buffers start in the stream.
+ */
+struct Mu_AudioClock {
+    uint64_t frames_n;
+    uint64_t output_ticks;
+};
+
 struct Mu_Audio {
+    // @input: `format.sample_format` selects the samples passed to `callback`
+    // @output: negotiated format
     struct Mu_AudioFormat format;
     Mu_AudioCallback callback;
+    // @input: frames the device is asked for at every period, which sets
+    // the output latency. 0 for the device's default
+    // @output: frames of the device's period
+    uint32_t device_period_frames;
+    // @input: frames passed to `callback` at once, a power of two up to
+    // MU_MAX_AUDIO_BLOCK_FRAMES (64, 128 or 256 suit SIMD/FFT code),
+    // whatever the device period. 0 for the device period as it comes
+    uint32_t block_frames;
+    // @output: frames rendered ahead of the device, at most, for the
+    // blocks of `block_frames` to cover its periods
+    uint32_t block_latency_frames;
+    struct Mu_AudioStats stats; // @output
+    struct Mu_AudioClock clock; // @output: as of the last buffer passed to `callback`
+};
+
+/*
+ * Worker threads for the program's and the library's parallel work,
+ * started by Mu_Initialize. See xxxx_mu_jobs.h
+ */
+struct Mu_Jobs {
+    // @input: threads, the one calling Mu_Initialize included. 0 for
+    // one per core, 1 runs every job on the calling thread
+    // @output: threads started
+    int workers_n;
+    size_t frame_arena_capacity; // @input: bytes, 0 for a default
+
+    // @output: refreshed by Mu_Pull
+    uint64_t jobs_n;             // run so far
+    uint64_t steals_n;           // jobs run by another worker than the one that queued them
+    size_t frame_arena_bytes_n;  // used during the last frame
+
+    struct Mu_JobsPool *pool;
 };
 
 struct Mu_Time {
@@ -122,8 +281,64 @@ struct Mu_Time {
     uint64_t ticks_per_second;
 };
 
+enum {
+    MU_FRAME_STATS_FRAMES = 128, // frames kept in `Mu_FrameStats.ring`, a power of two
+};
+
+// Stages of a frame, timed by the library:
+enum {
+    MU_FRAME_STAGE_EVENTS,  // in Mu_Pull: input reset, event pump (`mu_window_pull`)
+    MU_FRAME_STAGE_UPDATE,  // in Mu_Pull: time and gamepad update (audio pacing on headless)
+    MU_FRAME_STAGE_CLIENT,  // from Mu_Pull returning to Mu_Push being called
+    MU_FRAME_STAGE_SWAP,    // in Mu_Push: flush and buffer swap
+    MU_FRAME_STAGE_FRAME,   // whole frame, from one Mu_Pull to the next
+    MU_FRAME_STAGES_N,
+};
+
+struct Mu_FrameStageSummary {
+    uint32_t p50_nanoseconds;
+    uint32_t p99_nanoseconds;
+    uint32_t max_nanoseconds;
+};
+
+/*
+ * Frame timings, recorded at every Mu_Pull for the previous frame, from
+ * a few clock reads. A frame misses its deadline when it lasts more than
+ * 1.5 `target_nanoseconds`, i.e. when it would have skipped a vsync.
+ */
+struct Mu_FrameStats {
+    uint64_t target_nanoseconds; // @input: frame period, 0 for 1/60 second
+
+    // @output
+    uint64_t frames_n;           // frames recorded
+    uint64_t missed_n;           // frames that missed their deadline
+    uint32_t last_i;             // slot of the last frame in `ring`
+    uint32_t ring[MU_FRAME_STAGES_N][MU_FRAME_STATS_FRAMES]; // nanoseconds, by MU_FRAME_STAGE_*
+    // over the last MU_FRAME_STATS_FRAMES frames, refreshed every
+    // MU_FRAME_STATS_FRAMES frames
+    struct Mu_FrameStageSummary summary[MU_FRAME_STAGES_N];
+};
+
+/*
+ * Snapshot of every frame (time, window, input, frame/audio/jobs
+ * counters), published by Mu_Pull into POSIX shared memory for another
+ * process to watch, without ever waiting for it. See
+ * xxxx_mu_telemetry.h and tools/mu_telemetry_viewer.c
+ */
+struct Mu_Telemetry {
+    Mu_Bool enabled;  // @input: off by default
+    char const *name; // @input: of the shared memory object, NULL for "/mu_telemetry"
+
+    // @output
+    uint64_t published_n;
+    uint64_t publish_nanoseconds; // spent publishing the last snapshot
+
+    struct Mu_TelemetryRegion *region;
+};
+
 /* @platform{win32} */ struct Mu_Win32;
 /* @platform{macos} */ struct Mu_Cocoa;
+/* @platform{headless} */ struct Mu_Headless;
 
 struct Mu {
     Mu_Bool initialized;
@@ -133,17 +348,26 @@ struct Mu {
     char error_buffer[MU_MAX_ERROR];
 
     struct Mu_Window window;
+    struct Mu_Framebuffer framebuffer;
     struct Mu_DigitalButton keys[MU_MAX_KEYS];
-    struct Mu_Gamepad gamepad;
+    struct Mu_Gamepad gamepad; // the first connected of `gamepads`
+    // @input: thresholds, which default to those of `gamepad`
+    // @output: in the order they were found
+    struct Mu_Gamepad gamepads[MU_MAX_GAMEPADS];
     struct Mu_Mouse mouse;
 
     char text[MU_MAX_TEXT];
     size_t text_length;
+    struct Mu_InputEvents input_events;
 
     struct Mu_Time time;
     struct Mu_Audio audio;
+    struct Mu_Jobs jobs;
+    struct Mu_FrameStats frame_stats;
+    struct Mu_Telemetry telemetry;
     /* @platform{win32} */ struct Mu_Win32 *win32;
     /* @platform{macos} */ struct Mu_Cocoa *cocoa;
+    /* @platform{headless} */ struct Mu_Headless *headless;
 };
 
 /*
@@ -167,6 +391,7 @@ struct Mu_Image {
     uint32_t channels;
     uint32_t width;
     uint32_t height;
+    uint32_t stride; // bytes from one row to the next, 0 when rows are packed (width * channels)
 };
 
 /*
@@ -178,3 +403,12 @@ Mu_Bool Mu_LoadImage(const char *filename, struct Mu_Image *image);
  * @return: MU_FALSE on error
  */
 Mu_Bool Mu_LoadAudio(const char *filename, struct Mu_AudioBuffer *audio);
+
+/*
+ * Same as `Mu_LoadAudio`, with samples converted to `format.sample_format`.
+ * Only `format.sample_format` is used: the samples keep the rate and
+ * channels of the file.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_LoadAudioWithFormat(const char *filename, struct Mu_AudioFormat format, struct Mu_AudioBuffer *audio);
@@ -0,0 +1,62 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu, xxxx_mu_mixer
+ *
+ * Sounds kept compressed in memory, 4 bits per sample (IMA-ADPCM), and
+ * decoded while mixing: give a `Mu_AdpcmAudio` to `Mu_MixerVoice.adpcm`.
+ *
+ * Samples are cut into blocks of MU_ADPCM_BLOCK_FRAMES frames. Every
+ * block starts, for each channel, with the state of the decoder at
+ * that frame, so that:
+ * - playback can start at any frame, decoding at most one block ahead
+ * - blocks decode independently of each other: the SIMD kernels decode
+ *   one block and channel per lane, 4 (SSE2) or 8 (AVX2) at once
+ *
+ * The stream is the one a continuous IMA-ADPCM encoder would produce,
+ * for 3.6 times less memory than int16 samples.
+ */
+
+enum {
+    MU_ADPCM_BLOCK_FRAMES = 64,
+    // per channel and block: predictor (int16, little endian), step
+    // index, a zero byte, then a nibble per frame, low nibble first
+    MU_ADPCM_BLOCK_HEADER_BYTES = 4,
+    MU_ADPCM_BLOCK_BYTES = MU_ADPCM_BLOCK_HEADER_BYTES + MU_ADPCM_BLOCK_FRAMES / 2,
+};
+
+struct Mu_AdpcmAudio {
+    // samples_per_second and channels of the sound. Decoding produces
+    // MU_AUDIO_SAMPLE_FORMAT_INT16 samples.
+    struct Mu_AudioFormat format;
+    size_t frames_n;
+    size_t blocks_n;
+    // blocks_n x channels x MU_ADPCM_BLOCK_BYTES, the channels of a
+    // block one after the other
+    uint8_t *blocks;
+    size_t bytes_n;
+};
+
+/*
+ * Compresses `source` (int16 or float samples), after `Mu_LoadAudio`
+ * for instance, into an allocation that `Mu_FreeAdpcm` releases.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_EncodeAdpcm(struct Mu_AudioBuffer const *source, struct Mu_AdpcmAudio *adpcm);
+
+void Mu_FreeAdpcm(struct Mu_AdpcmAudio *adpcm);
+
+/*
+ * Decodes up to `frames_n` interleaved int16 frames from `frame_i` on.
+ *
+ * @return: frames written, less than `frames_n` at the end of the sound
+ */
+size_t Mu_DecodeAdpcm(struct Mu_AdpcmAudio const *adpcm, size_t frame_i, int16_t *samples, size_t frames_n);
+
+/*
+ * Same as `Mu_DecodeAdpcm` with the kernels of an instruction set
+ * (MU_MIXER_ISA_*). All of them decode the same samples.
+ *
+ * @return: frames written, 0 when the instruction set is not supported by this machine
+ */
+size_t Mu_DecodeAdpcmWithISA(int isa, struct Mu_AdpcmAudio const *adpcm, size_t frame_i, int16_t *samples, size_t frames_n);
@@ -0,0 +1,46 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Adapter between the periods of an audio device, of whatever size it
+ * asks for, and a render function called with blocks of a fixed power
+ * of two frames (`Mu_Audio.block_frames`), shared by the platform units.
+ *
+ * The adapter is a FIFO of one block, in a buffer allocated up front
+ * and aligned to 64 bytes: a period takes what is left of the block,
+ * renders the next one when it runs out, and so on. It lives on the
+ * audio thread only, so it has no locks. Frames come out in order,
+ * none dropped nor added: frame n of the device is frame n of the blocks.
+ */
+
+typedef void (*Mu_AudioBlockRender)(void *context, struct Mu_AudioBuffer *block);
+
+struct Mu_AudioBlockAdapter {
+    struct Mu_AudioFormat format;
+    uint32_t block_frames;       // 0 to render periods as they come
+    uint32_t block_read_frames;  // frames of `block` already handed out
+    uint8_t *block;              // 64 bytes aligned
+    Mu_AudioBlockRender render;
+    void *render_context;
+};
+
+/*
+ * @param block_frames: a power of two up to MU_MAX_AUDIO_BLOCK_FRAMES, or 0
+ * @return: MU_FALSE on error, or when `block_frames` is not supported
+ */
+Mu_Bool Mu_InitializeAudioBlockAdapter(struct Mu_AudioBlockAdapter *adapter, struct Mu_AudioFormat const *format,
+                                       uint32_t block_frames, Mu_AudioBlockRender render, void *render_context);
+
+void Mu_FreeAudioBlockAdapter(struct Mu_AudioBlockAdapter *adapter);
+
+/*
+ * Fills `buffer`, a period of the device, in `adapter->format`.
+ */
+void Mu_AdaptAudioBlocks(struct Mu_AudioBlockAdapter *adapter, struct Mu_AudioBuffer *buffer);
+
+/*
+ * @param period_frames: of the device, 0 when it varies
+ * @return: frames rendered ahead of the device, at most, for blocks of
+ *          `block_frames` to cover periods of `period_frames`
+ */
+uint32_t Mu_AudioBlockLatencyFrames(uint32_t block_frames, uint32_t period_frames);
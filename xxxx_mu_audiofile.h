@@ -0,0 +1,76 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Reading of audio files without the platform's decoders.
+ * Files can be streamed (`Mu_OpenAudioStream`) or mapped (`Mu_MapAudio`).
+ *
+ * Containers: RIFF/WAVE, AIFF and AIFF-C, holding 16bit PCM or 32bit
+ * float samples.
+ */
+
+/*
+ * Stream of a long audio file (music) decoded ahead of time by a
+ * background thread, into a ring buffer of constant size.
+ *
+ * `Mu_ReadAudioStream` neither locks nor calls the system, so it can be
+ * used from the audio callback. There must be only one reader.
+ */
+struct Mu_AudioStream {
+    Mu_Bool loop;                 // @input: restart at the beginning of the file once it ends
+    size_t ring_frames;           // @input: frames decoded ahead, 0 for a default
+
+    struct Mu_AudioFormat format; // @output: format of the frames read
+    uint64_t frames_n;            // @output: frames in the file
+    uint64_t frames_read_n;       // @output: frames read so far
+    uint64_t underruns_n;         // @output: reads that found less frames than requested, before the end
+    Mu_Bool ended;                // @output: every frame has been read (never when looping)
+
+    struct Mu_AudioStreamDecoder *decoder;
+};
+
+/*
+ * Opens `filename` and starts decoding. The first frames are decoded
+ * before it returns. Only `format.sample_format` is used: the stream
+ * keeps the rate and channels of the file.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_OpenAudioStream(const char *filename, struct Mu_AudioFormat format, struct Mu_AudioStream *stream);
+
+/*
+ * Copies up to `frames_n` frames of `stream->format` into `frames`.
+ *
+ * @return: frames copied, less than `frames_n` on underrun or at the end
+ */
+size_t Mu_ReadAudioStream(struct Mu_AudioStream *stream, void *frames, size_t frames_n);
+
+void Mu_CloseAudioStream(struct Mu_AudioStream *stream);
+
+/*
+ * Audio file loaded by mapping it in memory.
+ *
+ * When the file's samples are already in the requested sample format
+ * and in the host's byte order, `buffer.samples` points straight into
+ * the mapped pages of the file (no copy, shared with other processes
+ * through the page cache) and must not be written to. Otherwise the
+ * samples are converted once, into an allocation.
+ *
+ * Sample rate and channels are never converted: `Mu_Mix` adapts them.
+ */
+struct Mu_MappedAudio {
+    struct Mu_AudioBuffer buffer; // @output
+    Mu_Bool zero_copy;            // @output: `buffer` points into the mapped file
+
+    void *mapping;
+    size_t mapping_size;
+};
+
+/*
+ * Only `format.sample_format` is used, see `struct Mu_MappedAudio`.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_MapAudio(const char *filename, struct Mu_AudioFormat format, struct Mu_MappedAudio *audio);
+
+void Mu_UnmapAudio(struct Mu_MappedAudio *audio);
@@ -0,0 +1,87 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu, xxxx_mu_mixer
+ *
+ * Audio graph: voices are mixed into submix buses, buses into their
+ * parent bus, up to the master bus which is written to the device
+ * buffer. Each bus applies its gain and, optionally, a soft limiter.
+ *
+ * The graph is compiled once into a flat schedule, children before
+ * their parent. Rendering runs it from the audio callback: small
+ * graphs on the audio thread alone, larger ones together with helper
+ * threads (real-time priority, pinned to a core on Linux) which take
+ * the next bus without children until none is left. The thread that
+ * renders the last child of a bus renders that bus, so independent
+ * buses are mixed in parallel and no thread waits for another. The
+ * audio thread never takes a lock: it wakes the helpers with a
+ * semaphore, and after a short spin sleeps on another until the master
+ * is rendered. Helpers are only started with real-time priority, the
+ * audio thread must not wait on threads it can preempt.
+ */
+
+enum {
+    MU_AUDIOGRAPH_MAX_BUSES = 64,
+    MU_AUDIOGRAPH_MAX_THREADS = 4, // audio thread included
+    MU_AUDIOGRAPH_MASTER = 0,      // index of the master bus
+    // default of `parallel_min_voices`: below, helpers cost more to wake
+    // than they save
+    MU_AUDIOGRAPH_PARALLEL_MIN_VOICES = 64,
+};
+
+struct Mu_AudioGraphBus {
+    int parent;              // @input: bus this one is mixed into, ignored for the master
+    float gain;              // @input: may change between blocks, ramped over a block
+    // @input: 0 for none, else the peak the bus is held under. Peaks
+    // above two thirds of it are bent smoothly towards it (a tanh soft
+    // knee) and the gain recovers over 50ms
+    float limiter_threshold;
+
+    // @input: set by the audio callback before each `Mu_AudioGraphRender`,
+    // which advances their cursors (see `struct Mu_MixerVoice`)
+    struct Mu_MixerVoice *voices;
+    int voices_n;
+};
+
+struct Mu_AudioGraph {
+    // @input: bus 0 is the master, every other bus must lead to it
+    int buses_n;
+    struct Mu_AudioGraphBus buses[MU_AUDIOGRAPH_MAX_BUSES];
+    // @input: most frames of one render, 0 for 1024. Longer buffers are
+    // rendered in several passes.
+    int frames_capacity;
+    // @input: threads rendering the graph, the audio thread included. 0
+    // for one per core up to MU_AUDIOGRAPH_MAX_THREADS, 1 renders every
+    // bus on the audio thread
+    // @output: threads started, plus the audio thread
+    int threads_n;
+    // @input: voices from which the helpers are used, 0 for
+    // MU_AUDIOGRAPH_PARALLEL_MIN_VOICES
+    int parallel_min_voices;
+
+    // @output
+    Mu_Bool realtime;            // helpers run, with real-time priority. Else renders are serial
+    uint64_t serial_renders_n;   // renders on the audio thread alone
+    uint64_t parallel_renders_n; // renders with the helpers
+
+    struct Mu_AudioGraphSession *session;
+};
+
+/*
+ * Compiles the schedule of `graph`, allocates its buses and starts its
+ * helpers. `graph` must stay at the same address until closed, and its
+ * bus parents must not change.
+ *
+ * @return: MU_FALSE on error, or when a bus does not lead to the master
+ */
+Mu_Bool Mu_AudioGraphInitialize(struct Mu_AudioGraph *graph);
+
+/*
+ * Stops the helpers, once `Mu_AudioGraphRender` has returned.
+ */
+void Mu_AudioGraphClose(struct Mu_AudioGraph *graph);
+
+/*
+ * Mixes the voices of every bus, through the graph, into `dest` which
+ * is overwritten. From one thread at a time, the audio thread.
+ */
+void Mu_AudioGraphRender(struct Mu_AudioGraph *graph, struct Mu_AudioBuffer *dest);
@@ -0,0 +1,45 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Fibers: stacks that one thread switches between by hand, for the
+ * coroutine run mode of the macos backend.
+ *
+ * A switch saves the callee-saved registers of the current fiber on its
+ * stack and restores those of the other one (x86-64 and AArch64), with
+ * no system call: unlike swapcontext, the signal mask is left alone.
+ *
+ * The stack of a fiber is mapped with a guard page below it, so that an
+ * overflow faults rather than corrupting the heap.
+ */
+
+typedef void (*Mu_FiberFunction)(void *context);
+
+struct Mu_Fiber {
+    void *stack_pointer; // while switched out
+    uint8_t *mapping;    // guard page then stack, NULL for a thread's own stack
+    size_t mapping_size;
+};
+
+/*
+ * Prepares `fiber` to call `function(context)` on a stack of
+ * `stack_size` bytes when it is first switched to. `function` must not
+ * return.
+ *
+ * A zeroed `struct Mu_Fiber` stands for the stack of the calling
+ * thread, and only needs to be switched from.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_InitializeFiber(struct Mu_Fiber *fiber, size_t stack_size, Mu_FiberFunction function, void *context);
+
+/*
+ * Unmaps the stack of `fiber`, which must not be running.
+ */
+void Mu_FreeFiber(struct Mu_Fiber *fiber);
+
+/*
+ * Suspends the calling fiber into `from` and resumes `to`, returning
+ * when another fiber switches back to `from`.
+ */
+void Mu_SwitchFiber(struct Mu_Fiber *from, struct Mu_Fiber *to);
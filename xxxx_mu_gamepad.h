@@ -0,0 +1,214 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Decoding of gamepad input, shared by the platform units.
+ *
+ * A mapping describes which HID element (usage page, usage) drives
+ * which member of `struct Mu_Gamepad`. It is compiled once per device
+ * into a dispatch table indexed by usage, so that decoding a value is
+ * one lookup rather than a compare against every member.
+ *
+ * Devices with a known report layout (Sony DUALSHOCK 4) are decoded a
+ * whole report at a time instead.
+ *
+ * Linux evdev events use the same tables, under the pseudo usage pages
+ * MU_HID_PAGE_EVDEV_KEY/ABS with the event code as usage.
+ */
+
+enum {
+    MU_HID_PAGE_GENERIC_DESKTOP = 0x01,
+    MU_HID_PAGE_BUTTON = 0x09,
+    MU_HID_PAGE_EVDEV_KEY = 0xff01, // EV_KEY events, usage: KEY_*/BTN_* code
+    MU_HID_PAGE_EVDEV_ABS = 0xff03, // EV_ABS events, usage: ABS_* code
+
+    MU_HID_USAGE_X = 0x30,
+    MU_HID_USAGE_Y = 0x31,
+    MU_HID_USAGE_Z = 0x32,
+    MU_HID_USAGE_RX = 0x33,
+    MU_HID_USAGE_RY = 0x34,
+    MU_HID_USAGE_RZ = 0x35,
+    MU_HID_USAGE_HATSWITCH = 0x39,
+
+    MU_HID_MAPPING_MAX_STATES = 4,
+
+    MU_GAMEPAD_DISPATCH_PAGES = 4,    // distinct usage pages of a mapping
+    MU_GAMEPAD_DISPATCH_USAGES = 512, // usages at or above are ignored
+    MU_GAMEPAD_DISPATCH_BINDINGS = 64,
+    MU_GAMEPAD_MAX_REPORT = 64,       // bytes
+
+    MU_DS4_VENDOR_ID = 0x054c,
+    MU_DS4_PRODUCT_ID = 0x05c4,
+    MU_DS4_V2_PRODUCT_ID = 0x09cc,
+
+    MU_EVDEV_ABS_N = 0x12, // ABS_X .. ABS_HAT0Y
+};
+
+struct Mu_HIDAddress {
+    uint16_t usage_page;
+    uint16_t usage;
+};
+
+struct Mu_Gamepad_HID_Mapping_DigitalButton {
+    struct Mu_HIDAddress address;
+    // states_n == 0 for normal buttons, otherwise states_n <=
+    // MU_HID_MAPPING_MAX_STATES for HID buttons that trigger on
+    // different discrete values. (Hatswitch)
+    int states_n;
+    int states[MU_HID_MAPPING_MAX_STATES];
+};
+
+struct Mu_Gamepad_HID_Mapping_AnalogButton {
+    struct Mu_HIDAddress address;
+    float xmin, xmax;
+};
+
+struct Mu_Gamepad_HID_Mapping_Stick {
+    struct Mu_HIDAddress x_address;
+    float xmin, xmax;
+    struct Mu_HIDAddress y_address;
+    float ymin, ymax;
+};
+
+// Descriptors of how HID elements are bound to members of Mu_Gamepad,
+// unused members have a zero address
+struct Mu_Gamepad_HID_Mapping {
+    struct Mu_Gamepad_HID_Mapping_DigitalButton a_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton b_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton x_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton y_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton left_shoulder_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton right_shoulder_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton up_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton down_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton left_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton right_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton left_thumb_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton right_thumb_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton back_button;
+    struct Mu_Gamepad_HID_Mapping_DigitalButton start_button;
+
+    struct Mu_Gamepad_HID_Mapping_AnalogButton left_trigger;
+    struct Mu_Gamepad_HID_Mapping_AnalogButton right_trigger;
+
+    struct Mu_Gamepad_HID_Mapping_Stick left_thumb_stick;
+    struct Mu_Gamepad_HID_Mapping_Stick right_thumb_stick;
+};
+
+// What one HID element drives, see `Mu_GamepadDispatch`
+struct Mu_GamepadBinding {
+    uint8_t kind;   // digital button, analog button, stick x or stick y
+    uint8_t target; // MU_GAMEPAD_*_BUTTON, or index of the trigger/stick
+    uint8_t states_n;
+    int8_t states[MU_HID_MAPPING_MAX_STATES];
+    float min, range; // normalized value: (value - min) / range
+};
+
+struct Mu_GamepadDispatch {
+    int pages_n;
+    uint16_t pages[MU_GAMEPAD_DISPATCH_PAGES];
+    // bindings of a usage are `bindings[first[page_i][usage] ..+ count[page_i][usage]]`
+    uint8_t first[MU_GAMEPAD_DISPATCH_PAGES][MU_GAMEPAD_DISPATCH_USAGES];
+    uint8_t count[MU_GAMEPAD_DISPATCH_PAGES][MU_GAMEPAD_DISPATCH_USAGES];
+    int bindings_n;
+    struct Mu_GamepadBinding bindings[MU_GAMEPAD_DISPATCH_BINDINGS];
+};
+
+/*
+ * Input of one device, accumulated between two `Mu_Pull`.
+ */
+struct Mu_GamepadSlot {
+    struct Mu_GamepadDispatch dispatch;
+    struct Mu_Gamepad gamepad;    // thresholds are not used
+    struct Mu_InputEvents events; // of `gamepad`'s buttons
+    uint8_t device;               // MU_INPUT_DEVICE_GAMEPAD + index in `mu.gamepads`
+};
+
+/*
+ * @return: MU_FALSE when the mapping uses too many usage pages or bindings
+ */
+Mu_Bool Mu_CompileGamepadMapping(struct Mu_Gamepad_HID_Mapping const *mapping, struct Mu_GamepadDispatch *dispatch);
+
+/*
+ * Decodes the value of one HID element (or evdev event) received at
+ * `ticks` (as `mu.time.ticks`).
+ */
+void Mu_DecodeGamepadValue(struct Mu_GamepadSlot *slot, uint16_t usage_page, uint16_t usage, int32_t value, uint64_t ticks);
+
+/*
+ * Decodes a whole DUALSHOCK 4 input report (USB: id 0x01, bluetooth:
+ * id 0x11), starting with its report id.
+ *
+ * @return: MU_FALSE when it is not an input report
+ */
+Mu_Bool Mu_DecodeDS4Report(struct Mu_GamepadSlot *slot, uint8_t const *report, size_t report_n, uint64_t ticks);
+
+/*
+ * The device of `slot` was unplugged at `ticks`: buttons still held are
+ * released (as transitions and input events), everything else is reset.
+ */
+void Mu_DisconnectGamepad(struct Mu_GamepadSlot *slot, uint64_t ticks);
+
+/*
+ * Hands the input accumulated in `slot` over to `gamepad` (applying its
+ * thresholds) and `input_events`, and starts accumulating the next frame.
+ */
+void Mu_PublishGamepad(struct Mu_GamepadSlot *slot, struct Mu_Gamepad *gamepad, struct Mu_InputEvents *input_events);
+
+/*
+ * Mapping of the Linux gamepad API (BTN_SOUTH, ABS_X, ABS_HAT0X...),
+ * with the ranges the device reports for its axes (EVIOCGABS).
+ */
+void Mu_MakeEvdevGamepadMapping(struct Mu_Gamepad_HID_Mapping *mapping, int32_t const abs_min[MU_EVDEV_ABS_N], int32_t const abs_max[MU_EVDEV_ABS_N]);
+
+// Fixtures:
+//
+// Captured input of one gamepad, replayed in place of a device. Text,
+// one record per line, '#' starts a comment:
+//
+//   ds4                        first line: reports of a DUALSHOCK 4
+//   <nanoseconds> <hex bytes>  a whole input report
+//
+//   evdev                      first line: events of a Linux gamepad
+//   abs <code> <min> <max>     range of an axis
+//   <nanoseconds> <type> <code> <value>
+//
+// Times are from the start of the replay, in increasing order.
+
+enum {
+    MU_GAMEPAD_FIXTURE_DS4 = 1,
+    MU_GAMEPAD_FIXTURE_EVDEV = 2,
+};
+
+struct Mu_GamepadFixtureRecord {
+    uint64_t nanoseconds;
+    uint16_t usage_page; // evdev
+    uint16_t usage;
+    int32_t value;
+    uint8_t report_n;    // ds4
+    uint8_t report[MU_GAMEPAD_MAX_REPORT];
+};
+
+struct Mu_GamepadFixture {
+    int kind; // MU_GAMEPAD_FIXTURE_*
+    struct Mu_Gamepad_HID_Mapping mapping; // evdev
+    size_t records_n;
+    size_t replayed_n;
+    struct Mu_GamepadFixtureRecord *records;
+};
+
+/*
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_LoadGamepadFixture(const char *filename, struct Mu_GamepadFixture *fixture);
+
+void Mu_CloseGamepadFixture(struct Mu_GamepadFixture *fixture);
+
+/*
+ * Decodes the records of the fixture up to `nanoseconds` from its
+ * start, timestamped with their own nanoseconds (as ticks of the
+ * headless platform). Compiles `slot`'s dispatch table on the first call.
+ *
+ * @return: MU_FALSE once every record has been replayed
+ */
+Mu_Bool Mu_ReplayGamepadFixture(struct Mu_GamepadFixture *fixture, struct Mu_GamepadSlot *slot, uint64_t nanoseconds);
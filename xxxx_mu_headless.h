@@ -0,0 +1,31 @@
+/*
+ * @lang: c11
+ * @platform: headless (linux)
+ */
+
+// evdev key codes (linux/input-event-codes.h), there is no keyboard
+// on a headless host but this keeps the keyname table consistent with
+// the other platforms for injected input.
+enum {
+  MU_CTRL = 29,   // KEY_LEFTCTRL
+  MU_SHIFT = 42,  // KEY_LEFTSHIFT
+  MU_ALT = 56,    // KEY_LEFTALT
+  MU_CMD = 125,   // KEY_LEFTMETA
+};
+
+struct Mu_Headless {
+  // @input: Mu_Pull will set `quit` once `frames_n` reaches this
+  // value. 0 means never. Initialized from the MU_HEADLESS_FRAMES
+  // environment variable.
+  uint64_t frames_limit;
+
+  // @output: counters, refreshed at every Mu_Pull
+  uint64_t frames_n;
+  uint64_t client_nanoseconds;           // accumulated Mu_Pull->Mu_Push time
+  uint64_t client_max_nanoseconds;
+  uint64_t audio_blocks_n;
+  uint64_t audio_frames_n;
+  uint64_t audio_callback_nanoseconds;   // accumulated time spent in `mu->audio.callback`
+  uint64_t audio_callback_max_nanoseconds;
+  Mu_Bool audio_realtime;                // audio thread got a real-time scheduling class
+};
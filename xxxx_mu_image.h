@@ -0,0 +1,48 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Portable image decoding, without the platform's decoders.
+ *
+ * PNG: 8bit and 16bit grayscale, grayscale+alpha, RGB and RGBA, and
+ * palettes of 1 to 8 bits, not interlaced. Images are always decoded
+ * to 4 channels (RGBA, 8 bits each).
+ */
+
+/*
+ * Memory for the pixels of many images, used front to back.
+ */
+struct Mu_ImageArena {
+    uint8_t *bytes;        // @input
+    size_t bytes_capacity; // @input
+    size_t bytes_n;        // @input/@output: bytes used so far
+};
+
+/*
+ * Decodes the PNG file held in `bytes`. Pixels are written into
+ * `image->pixels` when not NULL (at least width*height*4 bytes, see
+ * `Mu_ReadImageInfo`), into a `malloc` allocation otherwise.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_DecodePNG(uint8_t const *bytes, size_t bytes_n, struct Mu_Image *image);
+
+/*
+ * Reads the size of an image from its header, without decoding it.
+ * `image->pixels` is left untouched.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_ReadImageInfo(const char *filename, struct Mu_Image *image);
+
+/*
+ * Loads `filenames_n` images in parallel, as jobs of `jobs` (`&mu.jobs`
+ * for instance), or of a pool started for the call when NULL.
+ *
+ * Pixels of `images[i]` go to `images[i].pixels` when not NULL, to
+ * `arena` when not NULL and large enough, into a `malloc` allocation
+ * otherwise.
+ *
+ * @return: number of images loaded. The others have a width and height of 0.
+ */
+int Mu_LoadImages(char const * const *filenames, int filenames_n, struct Mu_Image *images, struct Mu_ImageArena *arena, struct Mu_Jobs *jobs);
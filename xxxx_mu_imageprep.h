@@ -0,0 +1,126 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu, xxxx_mu_jobs
+ *
+ * Preparation of images for upload, once they are loaded: premultiplied
+ * alpha, sRGB to/from linear light, mip chains and texture atlases.
+ *
+ * Images are `struct Mu_Image` of 4 channels (RGBA8), with rows
+ * `Mu_ImageStride` bytes apart. Linear images are 4 floats per pixel,
+ * in [0, 1], rows packed.
+ *
+ * Batches run one job per worker of `jobs` (`&mu.jobs` for instance),
+ * each taking the next image until none is left, or on the calling
+ * thread when `jobs` is NULL.
+ */
+
+enum {
+    MU_IMAGEPREP_ISA_AUTO = 0, // best available
+    MU_IMAGEPREP_ISA_SCALAR,
+    MU_IMAGEPREP_ISA_SSE2,
+    MU_IMAGEPREP_ISA_AVX2,
+
+    // flags
+    MU_IMAGEPREP_SRGB = 1 << 0,          // color channels are sRGB encoded, alpha is linear
+    MU_IMAGEPREP_PREMULTIPLIED = 1 << 1, // color channels are already multiplied by alpha
+
+    // mip filters
+    MU_IMAGEPREP_FILTER_BOX = 0, // average of the texels under each texel
+    MU_IMAGEPREP_FILTER_KAISER,  // Kaiser windowed sinc, sharper
+
+    MU_IMAGEPREP_MAX_MIPS = 32,
+};
+
+/*
+ * @return: bytes from one row of `image` to the next
+ */
+uint32_t Mu_ImageStride(struct Mu_Image const *image);
+
+/*
+ * Multiplies the color channels of `image` by its alpha, in place. With
+ * MU_IMAGEPREP_SRGB, in linear light then encoded back to sRGB.
+ *
+ * @return: MU_FALSE when `image` has not 4 channels, or when `isa` is not
+ *          supported by this machine
+ */
+Mu_Bool Mu_PremultiplyImage(struct Mu_Image *image, uint32_t flags);
+Mu_Bool Mu_PremultiplyImageWithISA(int isa, struct Mu_Image *image, uint32_t flags);
+
+/*
+ * @return: number of images premultiplied
+ */
+int Mu_PremultiplyImages(struct Mu_Image *images, int images_n, uint32_t flags, struct Mu_Jobs *jobs);
+
+/*
+ * Converts `image` to `linear` (width * height * 4 floats), decoding its
+ * colors from sRGB with MU_IMAGEPREP_SRGB.
+ *
+ * @return: MU_FALSE when `image` has not 4 channels, or when `isa` is not
+ *          supported by this machine
+ */
+Mu_Bool Mu_ImageToLinear(struct Mu_Image const *image, uint32_t flags, float *linear);
+Mu_Bool Mu_ImageToLinearWithISA(int isa, struct Mu_Image const *image, uint32_t flags, float *linear);
+
+/*
+ * Converts `linear` to `image`, whose size and pixels are set, encoding
+ * its colors to sRGB with MU_IMAGEPREP_SRGB. Values are clamped to [0, 1].
+ *
+ * @return: MU_FALSE when `image` has not 4 channels, or when `isa` is not
+ *          supported by this machine
+ */
+Mu_Bool Mu_ImageFromLinear(float const *linear, uint32_t flags, struct Mu_Image *image);
+Mu_Bool Mu_ImageFromLinearWithISA(int isa, float const *linear, uint32_t flags, struct Mu_Image *image);
+
+struct Mu_ImageMips {
+    int levels_n;
+    // levels[0] is the image itself, levels[i] is half the size of
+    // levels[i - 1] (rounded down, at least 1x1) down to 1x1
+    struct Mu_Image levels[MU_IMAGEPREP_MAX_MIPS];
+    uint8_t *pixels; // of levels 1.., rows packed
+};
+
+/*
+ * Filters the mip levels of `image` with `filter` (MU_IMAGEPREP_FILTER_*).
+ * Filtering happens in linear light with MU_IMAGEPREP_SRGB, and on
+ * premultiplied colors: without MU_IMAGEPREP_PREMULTIPLIED, levels come
+ * out with straight alpha like `image`, but transparent texels do not
+ * bleed into the others.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_GenerateImageMips(struct Mu_Image const *image, int filter, uint32_t flags, struct Mu_ImageMips *mips);
+
+/*
+ * @return: number of images whose mips were generated. The others have
+ *          `levels_n` at 0.
+ */
+int Mu_GenerateImagesMips(struct Mu_Image const *images, int images_n, int filter, uint32_t flags,
+                          struct Mu_ImageMips *mips, struct Mu_Jobs *jobs);
+
+void Mu_FreeImageMips(struct Mu_ImageMips *mips);
+
+// where an image went in an atlas
+struct Mu_AtlasPlacement {
+    int page;      // -1 when the image does not fit in a page
+    uint32_t x, y; // of its top left texel, padding excluded
+};
+
+struct Mu_Atlas {
+    uint32_t page_width;  // @input
+    uint32_t page_height; // @input
+    uint32_t padding;     // @input: texels around each image, repeating its edges
+    int pages_n;              // @output
+    struct Mu_Image *pages;   // @output: RGBA8, rows packed, transparent black where empty
+    uint64_t used_texels_n;   // @output: texels covered by images and their padding
+};
+
+/*
+ * Packs `images` into as few pages as it can (skyline bottom-left, the
+ * tallest images first), then copies them to their pages as jobs.
+ *
+ * @return: number of images placed, or -1 on error
+ */
+int Mu_PackAtlas(struct Mu_Atlas *atlas, struct Mu_Image const *images, int images_n,
+                 struct Mu_AtlasPlacement *placements, struct Mu_Jobs *jobs);
+
+void Mu_FreeAtlas(struct Mu_Atlas *atlas);
@@ -0,0 +1,82 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Job system: one worker thread per core, each with its own deque of
+ * jobs that the others steal from when theirs is empty.
+ *
+ * The thread that initializes `struct Mu_Jobs` (the main thread, when
+ * started by Mu_Initialize) is worker 0: it queues jobs and helps
+ * running them while it waits for their completion. Jobs may queue
+ * more jobs. Other threads (the audio thread for instance) must not
+ * queue jobs: theirs are run on the spot.
+ *
+ * Fork/join: jobs queued with a counter decrement it once done, and
+ * `Mu_JobsWait` returns when it reaches zero.
+ *
+ * Memory whose lifetime is the frame, like counters or per-job data,
+ * comes from a frame arena which Mu_Pull resets.
+ */
+
+typedef void (*Mu_JobFunction)(void *data);
+
+struct Mu_Job {
+    Mu_JobFunction function;
+    void *data;
+};
+
+/*
+ * Starts the workers. Called by Mu_Initialize for `mu.jobs`.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_JobsInitialize(struct Mu_Jobs *jobs);
+
+/*
+ * Stops the workers, once the jobs they run are done.
+ */
+void Mu_JobsClose(struct Mu_Jobs *jobs);
+
+/*
+ * Resets the frame arena and refreshes the counters of `jobs`. Called
+ * by Mu_Pull, no job may be using the frame arena anymore.
+ */
+void Mu_JobsPull(struct Mu_Jobs *jobs);
+
+/*
+ * Thread-safe allocation of `size` bytes, aligned to a cache line, from
+ * the frame arena.
+ *
+ * @return: NULL when the arena is exhausted
+ */
+void *Mu_JobsFrameAlloc(struct Mu_Jobs *jobs, size_t size);
+
+/*
+ * A counter at zero, from the frame arena.
+ *
+ * @return: NULL when the arena is exhausted
+ */
+struct Mu_JobCounter *Mu_JobsCounter(struct Mu_Jobs *jobs);
+
+/*
+ * Queues `jobs_n` jobs, which decrement `counter` (may be NULL) once
+ * done. Jobs that do not fit in the worker's deque are run on the spot.
+ */
+void Mu_JobsRun(struct Mu_Jobs *jobs, struct Mu_Job const *jobs_list, int jobs_n, struct Mu_JobCounter *counter);
+
+/*
+ * Runs jobs until `counter` is zero.
+ */
+void Mu_JobsWait(struct Mu_Jobs *jobs, struct Mu_JobCounter *counter);
+
+/*
+ * `Mu_JobsRun` and `Mu_JobsWait`, with a counter of its own: does not
+ * use the frame arena.
+ */
+void Mu_JobsRunAndWait(struct Mu_Jobs *jobs, struct Mu_Job const *jobs_list, int jobs_n);
+
+/*
+ * @return: index of the calling thread's worker, in [0, workers_n[, -1
+ *          when it is not a worker of `jobs`. For per-worker scratch memory.
+ */
+int Mu_JobsWorkerIndex(struct Mu_Jobs const *jobs);
@@ -0,0 +1,60 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Mixing of many audio buffers (voices) into a destination buffer.
+ *
+ * Voices are accumulated in float, block by block, and the
+ * destination is read and written once per block: it saturates
+ * when the destination holds int16 samples.
+ *
+ * Channels are mapped as follows:
+ * - same channel count: straight
+ * - mono source: copied to every destination channel
+ * - mono destination: average of the source channels
+ * - otherwise: channel by channel, extra channels are dropped/silent
+ */
+
+enum {
+    MU_MIXER_MAX_CHANNELS = 8,
+
+    MU_MIXER_ISA_AUTO = 0, // best available
+    MU_MIXER_ISA_SCALAR,
+    MU_MIXER_ISA_SSE2,
+    MU_MIXER_ISA_AVX2,
+};
+
+struct Mu_Resampler;
+struct Mu_AdpcmAudio;
+
+struct Mu_MixerVoice {
+    struct Mu_AudioBuffer const *source;
+    // @input: optional, a compressed sound played instead of `source`
+    // (see xxxx_mu_adpcm.h), decoded as it is mixed. Its rate may be
+    // up to 4 times the destination's.
+    struct Mu_AdpcmAudio const *adpcm;
+    float gain;
+    // @input: optional, converts the source's sample rate with a
+    // windowed-sinc filter (see xxxx_mu_resampler.h) rather than
+    // linear interpolation. Its filter must convert from the source's
+    // to the destination's sample rate.
+    struct Mu_Resampler *resampler;
+    // @input/@output: playback cursor, advanced by the mix. The voice has
+    // ended once it reaches the source's frame count.
+    size_t source_frame_i;
+    // fractional part of the cursor, used when the source's sample
+    // rate differs from the destination's.
+    uint32_t source_frame_fraction;
+};
+
+/*
+ * Adds `voices` to `dest`.
+ */
+void Mu_Mix(struct Mu_AudioBuffer *dest, struct Mu_MixerVoice *voices, int voices_n);
+
+/*
+ * Same as `Mu_Mix` with the kernels of a given instruction set.
+ *
+ * @return: MU_FALSE when the instruction set is not supported by this machine
+ */
+Mu_Bool Mu_MixWithISA(int isa, struct Mu_AudioBuffer *dest, struct Mu_MixerVoice *voices, int voices_n);
@@ -0,0 +1,112 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Asset packs: images and sounds prebaked by an offline packer
+ * (tools/mu_pack_tool.c) into one file, in the layout the program
+ * uses them in, so that loading one is a matter of mapping the file.
+ *
+ * - images are RGBA8, rows of width*4 bytes, optionally followed by
+ *   their mip levels (width>>level x height>>level, at least 1x1)
+ * - sounds are in the sample format and rate chosen at packing time
+ * - every image, mip level and sound starts on MU_PACK_ALIGNMENT bytes
+ *
+ * Names are found through a hash table of slots (open addressing,
+ * linear probing), prebuilt by the packer.
+ *
+ * The file is in the byte order of the host that wrote it, and is
+ * rejected by hosts of the other byte order.
+ */
+
+enum {
+    MU_PACK_VERSION = 1,
+    MU_PACK_ALIGNMENT = 64,
+    MU_PACK_BYTE_ORDER_MARK = 0x01020304,
+
+    MU_PACK_ENTRY_IMAGE = 1,
+    MU_PACK_ENTRY_AUDIO = 2,
+};
+
+struct Mu_PackHeader {
+    char magic[8];      // "MU_PACK\0"
+    uint32_t version;   // MU_PACK_VERSION
+    uint32_t byte_order; // MU_PACK_BYTE_ORDER_MARK, as written by the packer's host
+    uint32_t entries_n;
+    uint32_t slots_n;   // power of two, above entries_n
+    uint64_t entries_offset; // entries_n x struct Mu_PackEntry
+    uint64_t slots_offset;   // slots_n x uint32_t: entry index + 1, 0 when empty
+    uint64_t names_offset;   // names, zero terminated
+    uint64_t size;           // of the whole file
+};
+
+struct Mu_PackEntry {
+    uint64_t name_hash; // Mu_PackHash
+    uint32_t name_offset; // from `names_offset`
+    uint32_t name_n;      // without the terminating zero
+    uint32_t type;        // MU_PACK_ENTRY_*
+    uint32_t mips_n;      // images: number of levels, 1 without mips
+    uint64_t data_offset;
+    uint64_t data_size;
+
+    // MU_PACK_ENTRY_IMAGE:
+    uint32_t width;
+    uint32_t height;
+    // MU_PACK_ENTRY_AUDIO:
+    struct Mu_AudioFormat format;
+    uint64_t samples_count;
+};
+
+struct Mu_Pack {
+    struct Mu_PackHeader const *header;
+    struct Mu_PackEntry const *entries;
+    uint32_t const *slots;
+    char const *names;
+
+    void *mapping;
+    size_t mapping_size;
+};
+
+/*
+ * Maps a pack and checks its table of contents. Nothing is read from
+ * the images and sounds until they are used.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_OpenPack(const char *filename, struct Mu_Pack *pack);
+
+/*
+ * @note: views returned by the pack become invalid
+ */
+void Mu_ClosePack(struct Mu_Pack *pack);
+
+/*
+ * @return: NULL when the pack holds no entry of this name
+ */
+struct Mu_PackEntry const *Mu_FindPackEntry(struct Mu_Pack const *pack, char const *name);
+
+/*
+ * Points `image` at mip level `level` (0 for the full size image) of
+ * the image called `name`, inside the pack.
+ *
+ * @note: pixels may be written to, without changing the file
+ * @return: MU_FALSE when missing
+ */
+Mu_Bool Mu_GetPackImage(struct Mu_Pack const *pack, char const *name, int level, struct Mu_Image *image);
+
+/*
+ * Points `audio` at the samples of the sound called `name`, inside the pack.
+ *
+ * @return: MU_FALSE when missing
+ */
+Mu_Bool Mu_GetPackAudio(struct Mu_Pack const *pack, char const *name, struct Mu_AudioBuffer *audio);
+
+/*
+ * Hash of the names in the table of contents (64bit FNV-1a).
+ */
+uint64_t Mu_PackHash(char const *name, size_t name_n);
+
+/*
+ * Offset and size in bytes of mip level `level` of an image, from the
+ * start of its data.
+ */
+size_t Mu_PackMipOffset(uint32_t width, uint32_t height, int level, size_t *size);
@@ -0,0 +1,93 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Single producer, single consumer queue of typed commands of any
+ * size, to talk to the audio thread (and back) without locks.
+ *
+ * Commands are written in place into a ring of bytes, and stay
+ * invisible to the consumer until the producer publishes them: all the
+ * commands of a frame are handed over by one release store, and taken
+ * back by one acquire load, however many they are.
+ *
+ * A typical program uses two queues: the main thread sends commands to
+ * the audio thread, which sends back the buffers it is done with, for
+ * the main thread to free them.
+ */
+
+enum {
+    MU_QUEUE_ALIGNMENT = 8, // of commands and their payload
+    MU_QUEUE_COMMAND_PADDING = 0, // type reserved by the queue, skipped by readers
+};
+
+// followed by its payload, at `command + 1`
+struct Mu_QueueCommand {
+    uint32_t type; // chosen by the program, other than MU_QUEUE_COMMAND_PADDING
+    uint32_t size; // in bytes, of this header and the payload after it, padded to MU_QUEUE_ALIGNMENT
+};
+
+/*
+ * Counters of the producer's side, readable from any thread.
+ */
+struct Mu_QueueStats {
+    uint64_t commands_n;       // published
+    uint64_t rejected_n;       // pushes that found the queue full
+    uint32_t bytes_high_water; // most bytes ever in use, out of `bytes_capacity`
+};
+
+struct Mu_Queue {
+    size_t bytes_capacity; // @input: power of two, 0 for a default
+
+    struct Mu_QueueRing *ring;
+};
+
+/*
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_QueueInitialize(struct Mu_Queue *queue);
+
+/*
+ * @note: neither side may be using the queue anymore
+ */
+void Mu_QueueClose(struct Mu_Queue *queue);
+
+/*
+ * Producer: writes a command of `type` in the queue, unpublished.
+ *
+ * @return: where to write the `payload_size` bytes of its payload, NULL
+ *          when the queue is full (the command is then counted as rejected)
+ */
+void *Mu_QueueReserve(struct Mu_Queue *queue, uint32_t type, size_t payload_size);
+
+/*
+ * Producer: `Mu_QueueReserve` and copy of `payload`.
+ *
+ * @return: MU_FALSE when the queue is full
+ */
+Mu_Bool Mu_QueuePush(struct Mu_Queue *queue, uint32_t type, void const *payload, size_t payload_size);
+
+/*
+ * Producer: makes every command written since the last call visible to
+ * the consumer, at once.
+ */
+void Mu_QueuePublish(struct Mu_Queue *queue);
+
+/*
+ * Consumer: next published command, left in the queue.
+ *
+ * @return: NULL when there is none
+ */
+struct Mu_QueueCommand const *Mu_QueuePeek(struct Mu_Queue *queue);
+
+/*
+ * Consumer: moves past the command returned by `Mu_QueuePeek`.
+ */
+void Mu_QueuePop(struct Mu_Queue *queue);
+
+/*
+ * Consumer: gives the space of every popped command back to the
+ * producer, at once.
+ */
+void Mu_QueueRelease(struct Mu_Queue *queue);
+
+void Mu_QueueGetStats(struct Mu_Queue const *queue, struct Mu_QueueStats *stats);
@@ -0,0 +1,80 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu, xxxx_mu_jobs
+ *
+ * Software rasterizer for `mu.framebuffer`.
+ *
+ * Draws are recorded in a list of commands (solid and textured quads,
+ * aligned with the axes, in window pixels) then run at once by
+ * `Mu_RasterRun`: commands are binned to the tiles of
+ * MU_RASTER_TILE_SIZE pixels they overlap, and each row of tiles is a
+ * job which runs the commands of its tiles in order. Quads are opaque:
+ * a tile starts at the last of its commands that covers it whole.
+ *
+ * Textures are `struct Mu_Image` of 4 channels, sampled nearest, with
+ * texel coordinates as `GL_TEXTURE_RECTANGLE`.
+ */
+
+enum {
+    MU_RASTER_TILE_SIZE = 64, // pixels
+
+    MU_RASTER_ISA_AUTO = 0, // best available
+    MU_RASTER_ISA_SCALAR,
+    MU_RASTER_ISA_SSE2,
+    MU_RASTER_ISA_AVX2,
+};
+
+struct Mu_RasterCommand {
+    int x0, y0, x1, y1;             // covers [x0, x1[ x [y0, y1[
+    uint32_t color;                 // RGBA8, of solid quads
+    struct Mu_Image const *texture; // NULL for solid quads
+    int u0, v0, u1, v1;             // texels at the corners (x0, y0), (x1, y1)
+};
+
+struct Mu_RasterList {
+    int isa; // @input: MU_RASTER_ISA_*
+    int commands_n;
+    int commands_capacity;
+    uint64_t dropped_n; // commands recorded past the capacity
+    struct Mu_RasterCommand *commands;
+
+    // scratch memory of `Mu_RasterRun`
+    size_t bins_capacity;
+    uint32_t *bins;
+    int rows_capacity;
+    struct Mu_RasterRow *rows;
+};
+
+/*
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_AllocateRasterList(struct Mu_RasterList *list, int commands_capacity);
+
+void Mu_FreeRasterList(struct Mu_RasterList *list);
+
+/*
+ * @return: `red`, `green`, `blue`, `alpha` in [0, 1] as an RGBA8 pixel
+ */
+uint32_t Mu_RasterColor(float red, float green, float blue, float alpha);
+
+/*
+ * Starts a new list, which fills the framebuffer with `color`.
+ */
+void Mu_RasterClear(struct Mu_RasterList *list, uint32_t color);
+
+void Mu_RasterQuad(struct Mu_RasterList *list, int x0, int y0, int x1, int y1, uint32_t color);
+
+/*
+ * Texels [u0, u1[ x [v0, v1[ of `texture` stretched over the quad,
+ * which `texture` must outlive until `Mu_RasterRun`.
+ */
+void Mu_RasterTexturedQuad(struct Mu_RasterList *list, int x0, int y0, int x1, int y1,
+                           struct Mu_Image const *texture, int u0, int v0, int u1, int v1);
+
+/*
+ * Draws the commands of `list` into `framebuffer`, as jobs of `jobs`
+ * (may be NULL to draw on the calling thread).
+ *
+ * @return: MU_FALSE on error, or when `list->isa` is not supported by this machine
+ */
+Mu_Bool Mu_RasterRun(struct Mu_RasterList *list, struct Mu_Framebuffer const *framebuffer, struct Mu_Jobs *jobs);
@@ -0,0 +1,78 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Record and replay of the input part of `struct Mu`.
+ *
+ * Since `struct Mu` is plain old data, a session can be captured
+ * frame by frame and fed back later, faster than real time, to
+ * reproduce a problem or benchmark a frame loop.
+ *
+ * Each frame is stored as the delta of the `time`, `window`, `keys`,
+ * `mouse`, `gamepads` and `text` fields against the previous frame,
+ * varint encoded, into storage that is allocated once up-front. On
+ * replay, `gamepad` is the first connected of `gamepads`, as on every
+ * platform.
+ */
+
+enum {
+    // upper bound of the size of one encoded frame
+    MU_RECORD_FRAME_MAX_BYTES = 1536,
+    // 32bit fields: 13 of window and mouse, 27 per gamepad
+    MU_RECORD_SLOTS_N = 13 + 27 * MU_MAX_GAMEPADS,
+    MU_RECORD_SLOT_MASKS_N = (MU_RECORD_SLOTS_N + 63) / 64,
+};
+
+struct Mu_Recording {
+    uint8_t *bytes;        // @input: storage
+    size_t bytes_capacity; // @input: size of `bytes`
+    size_t bytes_n;        // @output: size of the log
+    size_t read_i;         // replay cursor, set to 0 to rewind
+    uint64_t frames_n;     // @output: frames recorded or replayed
+    Mu_Bool overflow;      // @output: recording stopped because `bytes` is full
+
+    // previous frame, to compute/apply deltas
+    uint64_t ticks_per_second;
+    uint64_t previous_ticks;
+    uint64_t previous_nanoseconds;
+    uint8_t previous_keys[MU_MAX_KEYS];
+    uint32_t previous_slots[MU_RECORD_SLOTS_N];
+};
+
+/*
+ * Allocate the storage of a recording, able to hold at least
+ * `frames_n` worst-case frames.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_AllocateRecording(struct Mu_Recording *recording, size_t frames_n);
+
+void Mu_FreeRecording(struct Mu_Recording *recording);
+
+/*
+ * Drop-in replacement for `Mu_Pull`, appending the pulled frame to
+ * `recording`.
+ *
+ * @return: same as `Mu_Pull`
+ */
+Mu_Bool Mu_Record(struct Mu *mu, struct Mu_Recording *recording);
+
+/*
+ * Drop-in replacement for `Mu_Pull`, filling the input of `mu` with
+ * the next frame of `recording`. Does not wait nor poll the platform.
+ *
+ * @return: MU_FALSE at the end of the recording
+ */
+Mu_Bool Mu_Replay(struct Mu *mu, struct Mu_Recording *recording);
+
+/*
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_SaveRecording(const char *filename, struct Mu_Recording const *recording);
+
+/*
+ * Allocates the storage of `recording`, rewound for replay.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_LoadRecording(const char *filename, struct Mu_Recording *recording);
@@ -0,0 +1,86 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu, xxxx_mu_mixer
+ *
+ * Sample rate conversion with a polyphase windowed-sinc filter.
+ *
+ * A filter (`Mu_ResamplerFilter`) is built once per pair of rates and
+ * can be shared. It tabulates MU_RESAMPLER_TAPS coefficients for
+ * MU_RESAMPLER_PHASES sub-sample positions, linearly interpolated in
+ * between.
+ *
+ * Two modes:
+ * - on load: `Mu_ResampleAudio` converts a whole buffer, on every core
+ * - streaming: a `Mu_Resampler` holds the state of one voice, for a
+ *   cost per output frame that does not vary, which is suitable for
+ *   the audio thread. See `Mu_MixerVoice.resampler`.
+ */
+
+enum {
+    MU_RESAMPLER_TAPS = 64,         // filter length, in source frames
+    MU_RESAMPLER_PHASES = 128,
+    MU_RESAMPLER_MAX_CHANNELS = 8,
+    MU_RESAMPLER_BLOCK_FRAMES = 128, // source frames buffered at once by a `Mu_Resampler`
+};
+
+struct Mu_ResamplerFilter {
+    uint32_t s_rate;
+    uint32_t d_rate;
+    int isa; // MU_MIXER_ISA_*, never MU_MIXER_ISA_AUTO
+
+    // (MU_RESAMPLER_PHASES + 1) x MU_RESAMPLER_TAPS coefficients, and
+    // their difference with the next phase
+    float *coefficients;
+    float *deltas;
+    void *allocation;
+};
+
+/*
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_InitializeResamplerFilter(struct Mu_ResamplerFilter *filter, uint32_t s_rate, uint32_t d_rate);
+
+/*
+ * Same as `Mu_InitializeResamplerFilter`, with the kernels of an instruction set.
+ *
+ * @return: MU_FALSE on error, or when the instruction set is not supported by this machine
+ */
+Mu_Bool Mu_InitializeResamplerFilterWithISA(int isa, struct Mu_ResamplerFilter *filter, uint32_t s_rate, uint32_t d_rate);
+
+void Mu_FreeResamplerFilter(struct Mu_ResamplerFilter *filter);
+
+/*
+ * Converts `source` to `samples_per_second`, in the same sample format
+ * and channels, into an allocation that `free` releases. Long buffers
+ * are split into jobs of `jobs` (`&mu.jobs` for instance), or of a pool
+ * started for the call when NULL.
+ *
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_ResampleAudio(struct Mu_AudioBuffer const *source, uint32_t samples_per_second, struct Mu_AudioBuffer *dest, struct Mu_Jobs *jobs);
+
+/*
+ * Streaming state of one voice.
+ */
+struct Mu_Resampler {
+    struct Mu_ResamplerFilter const *filter;
+    int channels;
+
+    // source frames not consumed yet, one row per channel
+    size_t history_n;
+    size_t position;          // of the first tap of the next frame, in `history`
+    uint32_t position_fraction; // sub-frame position, over `filter->d_rate`
+    float history[MU_RESAMPLER_MAX_CHANNELS][MU_RESAMPLER_TAPS + MU_RESAMPLER_BLOCK_FRAMES];
+};
+
+void Mu_InitializeResampler(struct Mu_Resampler *resampler, struct Mu_ResamplerFilter const *filter, int channels);
+
+/*
+ * Writes up to `d_frames_n` interleaved float frames at `filter->d_rate`,
+ * reading `source` from `*source_frame_i` on.
+ *
+ * @note: the last MU_RESAMPLER_TAPS/2 frames of `source` stay in the
+ * history until more frames follow.
+ * @return: frames written, less than `d_frames_n` once `source` is consumed
+ */
+size_t Mu_Resample(struct Mu_Resampler *resampler, struct Mu_AudioBuffer const *source, size_t *source_frame_i, float *d_frames, size_t d_frames_n);
@@ -0,0 +1,69 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Statistics of the frame loop (`mu.frame_stats`) and of the audio
+ * callback (`mu.audio.stats`), shared by the platform units, which time
+ * the stages of each frame and each callback with their own clock.
+ */
+
+#if defined(__STDC_NO_ATOMICS__)
+#error "Error: C11 atomics not found"
+#endif
+
+#include <stdatomic.h>
+
+/*
+ * Platforms: timestamps of the frame in progress, in ticks of the
+ * platform's clock, recorded by the next Mu_Pull.
+ */
+struct Mu_FrameTimer {
+    uint64_t frame_ticks; // at the start of Mu_Pull, 0 before the first frame
+    uint64_t pull_ticks;  // when Mu_Pull returned
+    uint64_t push_ticks;  // when Mu_Push was called
+    uint64_t events_ticks_n;
+    uint64_t update_ticks_n;
+    uint64_t swap_ticks_n;
+    // nanoseconds per tick, as a fraction. 0 when ticks are nanoseconds
+    uint32_t ticks_numer;
+    uint32_t ticks_denom;
+};
+
+/*
+ * Platforms: records the previous frame into `stats`, at the start of
+ * Mu_Pull (`now`).
+ */
+void Mu_PullFrameStats(struct Mu_FrameStats *stats, struct Mu_FrameTimer const *timer, uint64_t now);
+
+/*
+ * Platforms: telemetry of the audio thread, which is its only writer
+ * apart from Mu_AddAudioUnderrun, published to `mu.audio.stats` by
+ * Mu_Pull.
+ */
+struct Mu_AudioTelemetry {
+    atomic_uint_fast64_t callbacks_n;
+    atomic_uint_fast64_t block_frames;
+    atomic_uint_fast64_t budget_nanoseconds;
+    atomic_uint_fast64_t callback_nanoseconds;
+    atomic_uint_fast64_t callback_max_nanoseconds;
+    atomic_uint_fast64_t load_max_permille;
+    atomic_uint_fast64_t load_histogram[MU_AUDIO_LOAD_BUCKETS];
+    atomic_uint_fast64_t overruns_n;
+    atomic_uint_fast64_t underruns_n;
+};
+
+/*
+ * Platforms: from the audio thread, after a callback that rendered
+ * `frames_n` frames in `nanoseconds`.
+ */
+void Mu_RecordAudioCallback(struct Mu_AudioTelemetry *telemetry, uint64_t frames_n, uint64_t samples_per_second, uint64_t nanoseconds);
+
+/*
+ * Platforms: the device played without our samples. From any thread.
+ */
+void Mu_AddAudioUnderrun(struct Mu_AudioTelemetry *telemetry);
+
+/*
+ * Platforms: copies the counters into `stats`, from Mu_Pull.
+ */
+void Mu_PublishAudioStats(struct Mu_AudioTelemetry *telemetry, struct Mu_AudioStats *stats);
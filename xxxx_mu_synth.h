@@ -0,0 +1,52 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Polyphonic sine voices with exponential decay.
+ *
+ * Voices are stored as a structure of arrays, MU_SYNTH_LANES voices
+ * at a time are rendered together. Oscillators are complex rotations
+ * and envelopes are per-sample multipliers, so rendering does no
+ * transcendental function call.
+ */
+
+enum {
+    MU_SYNTH_LANES = 8,
+};
+
+struct Mu_Synth {
+    int voices_n;
+    int voices_capacity; // multiple of MU_SYNTH_LANES
+    float end_threshold; // voices end once their envelope is below
+
+    // one entry per voice:
+    float *osc_cos;  // oscillator state (cos(phase), sin(phase))
+    float *osc_sin;
+    float *rot_cos;  // per-sample rotation (cos(w), sin(w))
+    float *rot_sin;
+    float *env;      // envelope
+    float *env_mul;  // per-sample envelope multiplier
+    float *gain;
+
+    void *allocation;
+};
+
+/*
+ * @return: MU_FALSE on error
+ */
+Mu_Bool Mu_SynthInitialize(struct Mu_Synth *synth, int voices_capacity);
+
+void Mu_SynthClose(struct Mu_Synth *synth);
+
+/*
+ * Start a voice of frequency `pitch_hz` which envelope decays by
+ * `decay_per_second` nepers per second.
+ *
+ * @return: MU_FALSE when all voices are busy
+ */
+Mu_Bool Mu_SynthNoteOn(struct Mu_Synth *synth, float samples_per_second, float pitch_hz, float gain, float decay_per_second);
+
+/*
+ * Render the sum of all voices into `mono_frames`, and retire ended voices.
+ */
+void Mu_SynthRender(struct Mu_Synth *synth, float *mono_frames, int frames_n);
@@ -0,0 +1,103 @@
+/*
+ * @lang: c11
+ * @dependencylist: xxxx_mu
+ *
+ * Telemetry export, to watch a running program from another process
+ * (tools/mu_telemetry_viewer.c) rather than by printing or attaching a
+ * profiler, which disturbs its frame timing.
+ *
+ * With `mu.telemetry.enabled`, Mu_Initialize creates a POSIX shared
+ * memory object, and every Mu_Pull writes a `Mu_TelemetrySnapshot` of
+ * the frame into it under a sequence lock: the program never waits,
+ * a reader copies the snapshot again when it was being written. The
+ * object is removed after the last frame. One left over by a program
+ * that did not quit is replaced; when the object belongs to another
+ * running program, or its owner cannot be told, telemetry is disabled
+ * (with a trace) and the program runs without it.
+ *
+ * The object holds a header (magic "MU_TELEM", MU_TELEMETRY_VERSION,
+ * size of the snapshot, pid of the writer), then the sequence, odd
+ * while a snapshot is written, then the snapshot as 64bit words. A
+ * reader must be built with the same `Mu_TelemetrySnapshot`, which
+ * the version and size check.
+ */
+
+enum {
+    MU_TELEMETRY_VERSION = 1,
+};
+
+struct Mu_TelemetrySnapshot {
+    uint64_t published_n;         // snapshots so far, this one included
+    uint64_t publish_nanoseconds; // spent publishing the previous one
+    Mu_Bool quit;                 // last snapshot, the program is quitting
+
+    struct Mu_Time time;
+    struct Mu_Int2 window_position;
+    struct Mu_Int2 window_size;
+    struct Mu_Mouse mouse;
+    uint64_t keys_down[MU_MAX_KEYS / 64]; // bit k%64 of word k/64: `keys[k].down`
+    struct Mu_Gamepad gamepads[MU_MAX_GAMEPADS];
+    uint32_t input_events_n;
+    uint32_t input_events_dropped_n;
+
+    // of `Mu_FrameStats`: the last frame, by MU_FRAME_STAGE_*, and the
+    // summary of the frames before
+    uint64_t frame_target_nanoseconds;
+    uint64_t frames_n;
+    uint64_t frames_missed_n;
+    uint32_t frame_nanoseconds[MU_FRAME_STAGES_N];
+    struct Mu_FrameStageSummary frame_summary[MU_FRAME_STAGES_N];
+
+    struct Mu_AudioStats audio_stats;
+    struct Mu_AudioClock audio_clock;
+
+    uint64_t jobs_n;
+    uint64_t jobs_steals_n;
+    uint64_t frame_arena_bytes_n;
+};
+
+/*
+ * Platforms: creates the shared memory object of `mu->telemetry`, when
+ * enabled, at Mu_Initialize, before it starts any thread. Only replaces
+ * an existing object whose recorded pid is dead; on errors nothing is
+ * published, which does not fail Mu_Initialize.
+ */
+void Mu_OpenTelemetry(struct Mu *mu);
+
+/*
+ * Platforms: publishes the state of `mu` at the end of Mu_Pull. When
+ * `mu->quit` is set, publishes the last snapshot and removes the object.
+ */
+void Mu_PublishTelemetry(struct Mu *mu);
+
+/*
+ * Platforms: removes the object, when Mu_Initialize fails after
+ * Mu_OpenTelemetry. Does nothing once it is removed.
+ */
+void Mu_CloseTelemetry(struct Mu *mu);
+
+struct Mu_TelemetryReader {
+    // @output
+    uint32_t pid;      // of the writer
+    uint64_t retries_n; // copies started again, the snapshot being written meanwhile
+
+    struct Mu_TelemetryRegion const *region;
+};
+
+/*
+ * Maps the shared memory object called `name` (NULL for "/mu_telemetry")
+ * for reading.
+ *
+ * @return: MU_FALSE when there is none, or of another layout
+ */
+Mu_Bool Mu_OpenTelemetryReader(char const *name, struct Mu_TelemetryReader *reader);
+
+void Mu_CloseTelemetryReader(struct Mu_TelemetryReader *reader);
+
+/*
+ * Copies the last snapshot published.
+ *
+ * @return: MU_FALSE when none could be copied whole, the writer
+ *          publishing faster than it is read
+ */
+Mu_Bool Mu_ReadTelemetry(struct Mu_TelemetryReader *reader, struct Mu_TelemetrySnapshot *snapshot);